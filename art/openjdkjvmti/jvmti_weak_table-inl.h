@@ -34,7 +34,7 @@
 
 #include "jvmti_weak_table.h"
 
-#include <limits>
+#include <algorithm>
 
 #include <android-base/logging.h>
 
@@ -64,9 +64,104 @@ void JvmtiWeakTable<T>::AssertLocked() {
 }
 
 template <typename T>
-void JvmtiWeakTable<T>::UpdateTableWithReadBarrier() {
-  update_since_last_sweep_ = true;
+void JvmtiWeakTable<T>::Allow() {
+  allow_new_weak_.store(true, std::memory_order_release);
+  art::gc::SystemWeakHolder::Allow();
+}
+template <typename T>
+void JvmtiWeakTable<T>::Disallow() {
+  allow_new_weak_.store(false, std::memory_order_release);
+  art::gc::SystemWeakHolder::Disallow();
+}
+
+template <typename T>
+bool JvmtiWeakTable<T>::Shard::Insert(art::mirror::Object* obj, T tag, bool overwrite) {
+  DCHECK(obj != nullptr);
+  if (size_ != 0) {
+    Entry& entry = slots_[FindSlot(obj)];
+    if (!entry.root.IsNull()) {
+      if (overwrite) {
+        entry.tag = tag;
+        modifications_++;
+      }
+      return true;
+    }
+  }
+
+  // Keep the load factor at or below 3/4.
+  if ((size_ + 1) * 4 > slots_.size() * 3) {
+    Resize(std::max(kMinCapacity, slots_.size() * 2));
+  }
+  Entry& entry = slots_[FindSlot(obj)];
+  entry.root = art::GcRoot<art::mirror::Object>(obj);
+  entry.tag = tag;
+  size_++;
+  modifications_++;
+  return false;
+}
+
+template <typename T>
+bool JvmtiWeakTable<T>::Shard::Erase(art::mirror::Object* obj, T* tag) {
+  if (size_ == 0) {
+    return false;
+  }
+  size_t hole = FindSlot(obj);
+  if (slots_[hole].root.IsNull()) {
+    return false;
+  }
+  if (tag != nullptr) {
+    *tag = slots_[hole].tag;
+  }
+
+  // Backward-shift deletion: move later entries of the probe sequence into the hole unless their
+  // home slot lies between the hole and their current slot.
+  size_t mask = slots_.size() - 1;
+  for (size_t i = (hole + 1) & mask; !slots_[i].root.IsNull(); i = (i + 1) & mask) {
+    size_t home = HomeSlot(slots_[i].root.template Read<art::kWithoutReadBarrier>(), slots_.size());
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots_[hole] = slots_[i];
+      hole = i;
+    }
+  }
+  slots_[hole] = Entry();
+  size_--;
+  modifications_++;
+  return true;
+}
+
+template <typename T>
+void JvmtiWeakTable<T>::Shard::ShrinkIfSparse() {
+  if (slots_.size() <= kMinCapacity || size_ * 8 >= slots_.size()) {
+    return;
+  }
+  size_t capacity = 0;
+  if (size_ != 0) {
+    capacity = kMinCapacity;
+    while (capacity < size_ * 2) {
+      capacity *= 2;
+    }
+  }
+  Resize(capacity);
+}
 
+template <typename T>
+void JvmtiWeakTable<T>::Shard::Resize(size_t capacity) {
+  std::vector<Entry, JvmtiAllocator<Entry>> old_slots(capacity);
+  old_slots.swap(slots_);
+  for (const Entry& entry : old_slots) {
+    if (!entry.root.IsNull()) {
+      size_t mask = capacity - 1;
+      size_t i = HomeSlot(entry.root.template Read<art::kWithoutReadBarrier>(), capacity);
+      while (!slots_[i].root.IsNull()) {
+        i = (i + 1) & mask;
+      }
+      slots_[i] = entry;
+    }
+  }
+}
+
+template <typename T>
+void JvmtiWeakTable<T>::UpdateTableWithReadBarrier() {
   auto WithReadBarrierUpdater = [&](const art::GcRoot<art::mirror::Object>& original_root,
                                     art::mirror::Object* original_obj ATTRIBUTE_UNUSED)
      REQUIRES_SHARED(art::Locks::mutator_lock_) {
@@ -74,6 +169,10 @@ void JvmtiWeakTable<T>::UpdateTableWithReadBarrier() {
   };
 
   UpdateTableWith<decltype(WithReadBarrierUpdater), kIgnoreNull>(WithReadBarrierUpdater);
+
+  // Only publish this once every shard is done: until then, lookups that miss must come here and
+  // wait for allow_disallow_lock_.
+  update_since_last_sweep_.store(true, std::memory_order_release);
 }
 
 template <typename T>
@@ -89,9 +188,21 @@ bool JvmtiWeakTable<T>::GetTagSlowPath(art::Thread* self, art::ObjPtr<art::mirro
 template <typename T>
 bool JvmtiWeakTable<T>::Remove(art::ObjPtr<art::mirror::Object> obj, /* out */ T* tag) {
   art::Thread* self = art::Thread::Current();
+  WaitUnlocked(self);
+
+  Shard& shard = GetShard(obj.Ptr());
+  {
+    art::MutexLock mu(self, shard.lock_);
+    if (shard.Erase(obj.Ptr(), tag)) {
+      return true;
+    }
+    if (!NeedsReadBarrierUpdate(self)) {
+      return false;
+    }
+  }
+
   art::MutexLock mu(self, allow_disallow_lock_);
   Wait(self);
-
   return RemoveLocked(self, obj, tag);
 }
 template <typename T>
@@ -105,16 +216,15 @@ bool JvmtiWeakTable<T>::RemoveLocked(art::ObjPtr<art::mirror::Object> obj, T* ta
 
 template <typename T>
 bool JvmtiWeakTable<T>::RemoveLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, T* tag) {
-  auto it = tagged_objects_.find(art::GcRoot<art::mirror::Object>(obj));
-  if (it != tagged_objects_.end()) {
-    if (tag != nullptr) {
-      *tag = it->second;
+  Shard& shard = GetShard(obj.Ptr());
+  {
+    art::MutexLock mu(self, shard.lock_);
+    if (shard.Erase(obj.Ptr(), tag)) {
+      return true;
     }
-    tagged_objects_.erase(it);
-    return true;
   }
 
-  if (art::kUseReadBarrier && self->GetIsGcMarking() && !update_since_last_sweep_) {
+  if (NeedsReadBarrierUpdate(self)) {
     // Under concurrent GC, there is a window between moving objects and sweeping of system
     // weaks in which mutators are active. We may receive a to-space object pointer in obj,
     // but still have from-space pointers in the table. Explicitly update the table once.
@@ -134,9 +244,23 @@ bool JvmtiWeakTable<T>::RemoveLocked(art::Thread* self, art::ObjPtr<art::mirror:
 template <typename T>
 bool JvmtiWeakTable<T>::Set(art::ObjPtr<art::mirror::Object> obj, T new_tag) {
   art::Thread* self = art::Thread::Current();
+  WaitUnlocked(self);
+
+  Shard& shard = GetShard(obj.Ptr());
+  {
+    art::MutexLock mu(self, shard.lock_);
+    // Only insert right away if the object cannot be in the table under its from-space address.
+    if (!NeedsReadBarrierUpdate(self)) {
+      return shard.Insert(obj.Ptr(), new_tag, /* overwrite= */ true);
+    }
+    T old_tag;
+    if (shard.Find(obj.Ptr(), &old_tag)) {
+      return shard.Insert(obj.Ptr(), new_tag, /* overwrite= */ true);
+    }
+  }
+
   art::MutexLock mu(self, allow_disallow_lock_);
   Wait(self);
-
   return SetLocked(self, obj, new_tag);
 }
 template <typename T>
@@ -150,29 +274,26 @@ bool JvmtiWeakTable<T>::SetLocked(art::ObjPtr<art::mirror::Object> obj, T new_ta
 
 template <typename T>
 bool JvmtiWeakTable<T>::SetLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, T new_tag) {
-  auto it = tagged_objects_.find(art::GcRoot<art::mirror::Object>(obj));
-  if (it != tagged_objects_.end()) {
-    it->second = new_tag;
-    return true;
+  Shard& shard = GetShard(obj.Ptr());
+  {
+    art::MutexLock mu(self, shard.lock_);
+    T old_tag;
+    if (shard.Find(obj.Ptr(), &old_tag) || !NeedsReadBarrierUpdate(self)) {
+      // Existing element, or new element that cannot be stored under its from-space address.
+      return shard.Insert(obj.Ptr(), new_tag, /* overwrite= */ true);
+    }
   }
 
-  if (art::kUseReadBarrier && self->GetIsGcMarking() && !update_since_last_sweep_) {
-    // Under concurrent GC, there is a window between moving objects and sweeping of system
-    // weaks in which mutators are active. We may receive a to-space object pointer in obj,
-    // but still have from-space pointers in the table. Explicitly update the table once.
-    // Note: this will keep *all* objects in the table live, but should be a rare occurrence.
-
-    // Update the table.
-    UpdateTableWithReadBarrier();
+  // Under concurrent GC, there is a window between moving objects and sweeping of system
+  // weaks in which mutators are active. We may receive a to-space object pointer in obj,
+  // but still have from-space pointers in the table. Explicitly update the table once.
+  // Note: this will keep *all* objects in the table live, but should be a rare occurrence.
 
-    // And try again.
-    return SetLocked(self, obj, new_tag);
-  }
+  // Update the table.
+  UpdateTableWithReadBarrier();
 
-  // New element.
-  auto insert_it = tagged_objects_.emplace(art::GcRoot<art::mirror::Object>(obj), new_tag);
-  DCHECK(insert_it.second);
-  return false;
+  // And try again.
+  return SetLocked(self, obj, new_tag);
 }
 
 template <typename T>
@@ -189,7 +310,7 @@ void JvmtiWeakTable<T>::Sweep(art::IsMarkedVisitor* visitor) {
   // to ensure we compare against to-space pointers. But we want to do this only once. Once
   // sweeping is done, we know all objects are to-space pointers until the next GC cycle,
   // so we re-enable the explicit update for the next marking.
-  update_since_last_sweep_ = false;
+  update_since_last_sweep_.store(false, std::memory_order_release);
 }
 
 template <typename T>
@@ -205,43 +326,71 @@ void JvmtiWeakTable<T>::SweepImpl(art::IsMarkedVisitor* visitor) {
 
   UpdateTableWith<decltype(IsMarkedUpdater),
                   kHandleNull ? kCallHandleNull : kRemoveNull>(IsMarkedUpdater);
+
+  // Most entries have moved or died, drop the index rather than keep a stale copy alive.
+  std::vector<Entry, JvmtiAllocator<Entry>>().swap(tag_index_);
+  tag_index_valid_ = false;
 }
 
 template <typename T>
 template <typename Updater, typename JvmtiWeakTable<T>::TableUpdateNullTarget kTargetNull>
 ALWAYS_INLINE inline void JvmtiWeakTable<T>::UpdateTableWith(Updater& updater) {
-  // We optimistically hope that elements will still be well-distributed when re-inserting them.
-  // So play with the map mechanics, and postpone rehashing. This avoids the need of a side
-  // vector and two passes.
-  float original_max_load_factor = tagged_objects_.max_load_factor();
-  tagged_objects_.max_load_factor(std::numeric_limits<float>::max());
-  // For checking that a max load-factor actually does what we expect.
-  size_t original_bucket_count = tagged_objects_.bucket_count();
-
-  for (auto it = tagged_objects_.begin(); it != tagged_objects_.end();) {
-    DCHECK(!it->first.IsNull());
-    art::mirror::Object* original_obj = it->first.template Read<art::kWithoutReadBarrier>();
-    art::mirror::Object* target_obj = updater(it->first, original_obj);
-    if (original_obj != target_obj) {
-      if (kTargetNull == kIgnoreNull && target_obj == nullptr) {
-        // Ignore null target, don't do anything.
-      } else {
-        T tag = it->second;
-        it = tagged_objects_.erase(it);
-        if (target_obj != nullptr) {
-          tagged_objects_.emplace(art::GcRoot<art::mirror::Object>(target_obj), tag);
-          DCHECK_EQ(original_bucket_count, tagged_objects_.bucket_count());
-        } else if (kTargetNull == kCallHandleNull) {
-          HandleNullSweep(tag);
-        }
-        continue;  // Iterator was implicitly updated by erase.
+  art::Thread* self = art::Thread::Current();
+
+  // The updater may run read barriers or query the collector, which can take locks that must not
+  // be acquired under a shard lock. So each shard is handled in three steps: copy its roots, run
+  // the updater on the copies without the lock, and apply the changes. Entries that moved are
+  // re-inserted after all shards are done, as their new address likely maps to another shard.
+  std::vector<art::GcRoot<art::mirror::Object>> roots;
+  std::vector<std::pair<art::mirror::Object*, art::mirror::Object*>> changed;
+  std::vector<std::pair<art::mirror::Object*, T>> moved;
+  std::vector<T> freed;
+  for (Shard& shard : shards_) {
+    roots.clear();
+    {
+      art::MutexLock mu(self, shard.lock_);
+      roots.reserve(shard.Size());
+      shard.VisitEntries([&](const Entry& entry) { roots.push_back(entry.root); });
+    }
+
+    changed.clear();
+    for (const art::GcRoot<art::mirror::Object>& root : roots) {
+      DCHECK(!root.IsNull());
+      art::mirror::Object* original_obj = root.template Read<art::kWithoutReadBarrier>();
+      art::mirror::Object* target_obj = updater(root, original_obj);
+      if (original_obj != target_obj &&
+          !(kTargetNull == kIgnoreNull && target_obj == nullptr)) {
+        changed.emplace_back(original_obj, target_obj);
+      }
+    }
+    if (changed.empty()) {
+      continue;
+    }
+
+    art::MutexLock mu(self, shard.lock_);
+    for (const auto& change : changed) {
+      T tag;
+      if (!shard.Erase(change.first, &tag)) {
+        continue;  // Removed in the meantime.
+      }
+      if (change.second != nullptr) {
+        moved.emplace_back(change.second, tag);
+      } else if (kTargetNull == kCallHandleNull) {
+        freed.push_back(tag);
       }
     }
-    it++;
+    shard.ShrinkIfSparse();
   }
 
-  tagged_objects_.max_load_factor(original_max_load_factor);
-  // TODO: consider rehash here.
+  for (const auto& move : moved) {
+    Shard& shard = GetShard(move.first);
+    art::MutexLock mu(self, shard.lock_);
+    // If the new address was tagged in the meantime, that tag is the more recent one.
+    shard.Insert(move.first, move.second, /* overwrite= */ false);
+  }
+  for (T tag : freed) {
+    HandleNullSweep(tag);
+  }
 }
 
 template <typename T>
@@ -302,6 +451,76 @@ struct JvmtiWeakTable<T>::ReleasableContainer {
   size_t capacity;
 };
 
+template <typename T>
+bool JvmtiWeakTable<T>::UpdateTagIndex(art::Thread* self) {
+  std::array<uint64_t, kShardCount> modifications;
+  size_t size = 0;
+  for (size_t i = 0; i != kShardCount; ++i) {
+    art::MutexLock mu(self, shards_[i].lock_);
+    modifications[i] = shards_[i].Modifications();
+    size += shards_[i].Size();
+  }
+  bool unchanged = modifications == tag_index_modifications_;
+  if (tag_index_valid_ && unchanged) {
+    return true;
+  }
+  tag_index_modifications_ = modifications;
+  tag_index_valid_ = false;
+  if (!unchanged) {
+    // First lookup since the table changed. Don't pay for the sort yet.
+    std::vector<Entry, JvmtiAllocator<Entry>>().swap(tag_index_);
+    return false;
+  }
+
+  tag_index_.clear();
+  tag_index_.reserve(size);
+  for (size_t i = 0; i != kShardCount; ++i) {
+    art::MutexLock mu(self, shards_[i].lock_);
+    shards_[i].VisitEntries([&](const Entry& entry) { tag_index_.push_back(entry); });
+    tag_index_modifications_[i] = shards_[i].Modifications();
+  }
+  std::sort(tag_index_.begin(),
+            tag_index_.end(),
+            [](const Entry& a, const Entry& b) { return a.tag < b.tag; });
+  tag_index_valid_ = true;
+  return true;
+}
+
+template <typename T>
+template <typename Visitor>
+void JvmtiWeakTable<T>::VisitTaggedEntries(art::Thread* self,
+                                           const T* tags,
+                                           size_t tag_count,
+                                           const Visitor& visitor) {
+  if (tags != nullptr && UpdateTagIndex(self)) {
+    auto by_tag = [](const Entry& entry, T tag) { return entry.tag < tag; };
+    for (size_t i = 0; i != tag_count; ++i) {
+      auto it = std::lower_bound(tag_index_.begin(), tag_index_.end(), tags[i], by_tag);
+      for (; it != tag_index_.end() && it->tag == tags[i]; ++it) {
+        visitor(*it);
+      }
+    }
+    return;
+  }
+
+  // Copy the matching entries out of each shard, so that visitor can run read barriers.
+  std::vector<Entry> selected;
+  for (Shard& shard : shards_) {
+    selected.clear();
+    {
+      art::MutexLock mu(self, shard.lock_);
+      shard.VisitEntries([&](const Entry& entry) {
+        if (tags == nullptr || std::binary_search(tags, tags + tag_count, entry.tag)) {
+          selected.push_back(entry);
+        }
+      });
+    }
+    for (const Entry& entry : selected) {
+      visitor(entry);
+    }
+  }
+}
+
 template <typename T>
 jvmtiError JvmtiWeakTable<T>::GetTaggedObjects(jvmtiEnv* jvmti_env,
                                                jint tag_count,
@@ -332,12 +551,22 @@ jvmtiError JvmtiWeakTable<T>::GetTaggedObjects(jvmtiEnv* jvmti_env,
 
   art::JNIEnvExt* jni_env = self->GetJniEnv();
 
+  // Sorted and without duplicates, so that each object is reported once.
+  std::vector<T> wanted(tags, tags + tag_count);
+  std::sort(wanted.begin(), wanted.end());
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
   constexpr size_t kDefaultSize = 10;
   size_t initial_object_size;
   size_t initial_tag_size;
   if (tag_count == 0) {
-    initial_object_size = (object_result_ptr != nullptr) ? tagged_objects_.size() : 0;
-    initial_tag_size = (tag_result_ptr != nullptr) ? tagged_objects_.size() : 0;
+    size_t size = 0;
+    for (Shard& shard : shards_) {
+      art::MutexLock shard_mu(self, shard.lock_);
+      size += shard.Size();
+    }
+    initial_object_size = (object_result_ptr != nullptr) ? size : 0;
+    initial_tag_size = (tag_result_ptr != nullptr) ? size : 0;
   } else {
     initial_object_size = initial_tag_size = kDefaultSize;
   }
@@ -347,33 +576,19 @@ jvmtiError JvmtiWeakTable<T>::GetTaggedObjects(jvmtiEnv* jvmti_env,
   ReleasableContainer<T, JvmtiAllocator<T>> selected_tags(allocator, initial_tag_size);
 
   size_t count = 0;
-  for (auto& pair : tagged_objects_) {
-    bool select;
-    if (tag_count > 0) {
-      select = false;
-      for (size_t i = 0; i != static_cast<size_t>(tag_count); ++i) {
-        if (tags[i] == pair.second) {
-          select = true;
-          break;
-        }
+  auto visitor = [&](const Entry& entry) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    art::ObjPtr<art::mirror::Object> obj = entry.root.template Read<art::kWithReadBarrier>();
+    if (obj != nullptr) {
+      count++;
+      if (object_result_ptr != nullptr) {
+        selected_objects.Pushback(jni_env->AddLocalReference<jobject>(obj));
       }
-    } else {
-      select = true;
-    }
-
-    if (select) {
-      art::ObjPtr<art::mirror::Object> obj = pair.first.template Read<art::kWithReadBarrier>();
-      if (obj != nullptr) {
-        count++;
-        if (object_result_ptr != nullptr) {
-          selected_objects.Pushback(jni_env->AddLocalReference<jobject>(obj));
-        }
-        if (tag_result_ptr != nullptr) {
-          selected_tags.Pushback(pair.second);
-        }
+      if (tag_result_ptr != nullptr) {
+        selected_tags.Pushback(entry.tag);
       }
     }
-  }
+  };
+  VisitTaggedEntries(self, tag_count > 0 ? wanted.data() : nullptr, wanted.size(), visitor);
 
   if (object_result_ptr != nullptr) {
     *object_result_ptr = selected_objects.Release();
@@ -391,15 +606,16 @@ art::ObjPtr<art::mirror::Object> JvmtiWeakTable<T>::Find(T tag) {
   art::MutexLock mu(self, allow_disallow_lock_);
   Wait(self);
 
-  for (auto& pair : tagged_objects_) {
-    if (tag == pair.second) {
-      art::ObjPtr<art::mirror::Object> obj = pair.first.template Read<art::kWithReadBarrier>();
-      if (obj != nullptr) {
-        return obj;
-      }
+  art::ObjPtr<art::mirror::Object> result = nullptr;
+  VisitTaggedEntries(self,
+                     &tag,
+                     1,
+                     [&](const Entry& entry) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    if (result == nullptr) {
+      result = entry.root.template Read<art::kWithReadBarrier>();
     }
-  }
-  return nullptr;
+  });
+  return result;
 }
 
 }  // namespace openjdkjvmti
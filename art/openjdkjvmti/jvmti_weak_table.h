@@ -32,8 +32,11 @@
 #ifndef ART_OPENJDKJVMTI_JVMTI_WEAK_TABLE_H_
 #define ART_OPENJDKJVMTI_JVMTI_WEAK_TABLE_H_
 
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <vector>
 
+#include "base/bit_utils.h"
 #include "base/globals.h"
 #include "base/macros.h"
 #include "base/mutex.h"
@@ -50,14 +53,31 @@ class EventHandler;
 
 // A system-weak container mapping objects to elements of the template type. This corresponds
 // to a weak hash map. For historical reasons the stored value is called "tag."
+//
+// The mappings are spread over a fixed number of shards by object address. Each shard is an
+// open-addressing hash table with its own lock, so Set, GetTag and Remove only take the lock of
+// one shard while weak access is allowed. allow_disallow_lock_ is still taken to wait for the GC,
+// by sweeping, by the *Locked functions and by the tag-based lookups.
 template <typename T>
 class JvmtiWeakTable : public art::gc::SystemWeakHolder {
  public:
   JvmtiWeakTable()
       : art::gc::SystemWeakHolder(art::kTaggingLockLevel),
-        update_since_last_sweep_(false) {
+        update_since_last_sweep_(false),
+        allow_new_weak_(true),
+        tag_index_valid_(false) {
+    tag_index_modifications_.fill(0);
   }
 
+  // Mirror the allow/disallow state in allow_new_weak_, so that the single-shard operations can
+  // check it without allow_disallow_lock_. Only used without read barriers.
+  void Allow() override
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_);
+  void Disallow() override
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_);
+
   // Remove the mapping for the given object, returning whether such a mapping existed (and the old
   // value).
   ALWAYS_INLINE bool Remove(art::ObjPtr<art::mirror::Object> obj, /* out */ T* tag)
@@ -82,9 +102,21 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
       REQUIRES_SHARED(art::Locks::mutator_lock_)
       REQUIRES(!allow_disallow_lock_) {
     art::Thread* self = art::Thread::Current();
+    WaitUnlocked(self);
+
+    Shard& shard = GetShard(obj.Ptr());
+    {
+      art::MutexLock mu(self, shard.lock_);
+      if (shard.Find(obj.Ptr(), result)) {
+        return true;
+      }
+    }
+    if (!NeedsReadBarrierUpdate(self)) {
+      return false;
+    }
+
     art::MutexLock mu(self, allow_disallow_lock_);
     Wait(self);
-
     return GetTagLocked(self, obj, result);
   }
   bool GetTagLocked(art::ObjPtr<art::mirror::Object> obj, /* out */ T* result)
@@ -113,7 +145,8 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
       REQUIRES_SHARED(art::Locks::mutator_lock_)
       REQUIRES(!allow_disallow_lock_);
 
-  // Locking functions, to allow coarse-grained locking and amortization.
+  // Locking functions, to allow coarse-grained locking and amortization. Note that holding the
+  // lock does not keep Set, GetTag and Remove from running concurrently on other threads.
   ALWAYS_INLINE  void Lock() ACQUIRE(allow_disallow_lock_);
   ALWAYS_INLINE void Unlock() RELEASE(allow_disallow_lock_);
   ALWAYS_INLINE void AssertLocked() ASSERT_CAPABILITY(allow_disallow_lock_);
@@ -131,6 +164,140 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
   virtual void HandleNullSweep(T tag ATTRIBUTE_UNUSED) {}
 
  private:
+  // Number of shards is 1 << kShardBits.
+  static constexpr size_t kShardBits = 4;
+  static constexpr size_t kShardCount = 1u << kShardBits;
+
+  // A slot of a shard. Free slots have a null root.
+  struct Entry {
+    art::GcRoot<art::mirror::Object> root;
+    T tag;
+  };
+
+  // Open-addressing hash table with linear probing, keyed by object address.
+  class Shard {
+   public:
+    Shard() : lock_("JVMTI weak table shard lock", art::LockLevel::kGenericBottomLock) {}
+
+    bool Find(art::mirror::Object* obj, /* out */ T* tag)
+        REQUIRES_SHARED(art::Locks::mutator_lock_)
+        REQUIRES(lock_) {
+      if (size_ == 0) {
+        return false;
+      }
+      const Entry& entry = slots_[FindSlot(obj)];
+      if (entry.root.IsNull()) {
+        return false;
+      }
+      *tag = entry.tag;
+      return true;
+    }
+
+    // Add a mapping, or replace the tag of an existing one if overwrite is set. Returns whether a
+    // mapping existed.
+    bool Insert(art::mirror::Object* obj, T tag, bool overwrite)
+        REQUIRES_SHARED(art::Locks::mutator_lock_)
+        REQUIRES(lock_);
+
+    bool Erase(art::mirror::Object* obj, /* out */ T* tag)
+        REQUIRES_SHARED(art::Locks::mutator_lock_)
+        REQUIRES(lock_);
+
+    // Give storage back after a sweep freed most of the entries.
+    void ShrinkIfSparse()
+        REQUIRES_SHARED(art::Locks::mutator_lock_)
+        REQUIRES(lock_);
+
+    template <typename Visitor>
+    void VisitEntries(const Visitor& visitor) REQUIRES(lock_) {
+      for (const Entry& entry : slots_) {
+        if (!entry.root.IsNull()) {
+          visitor(entry);
+        }
+      }
+    }
+
+    size_t Size() const REQUIRES(lock_) {
+      return size_;
+    }
+
+    // Incremented on every change, to tell whether a copy of the shard is still current.
+    uint64_t Modifications() const REQUIRES(lock_) {
+      return modifications_;
+    }
+
+    art::Mutex lock_ BOTTOM_MUTEX_ACQUIRED_AFTER;
+
+   private:
+    static constexpr size_t kMinCapacity = 16;
+
+    // Index of the slot holding obj, or of the free slot where its probe sequence ends.
+    size_t FindSlot(art::mirror::Object* obj) const
+        REQUIRES_SHARED(art::Locks::mutator_lock_)
+        REQUIRES(lock_) {
+      DCHECK(!slots_.empty());
+      size_t mask = slots_.size() - 1;
+      for (size_t i = HomeSlot(obj, slots_.size()); ; i = (i + 1) & mask) {
+        art::mirror::Object* current = slots_[i].root.template Read<art::kWithoutReadBarrier>();
+        if (current == obj || current == nullptr) {
+          return i;
+        }
+      }
+    }
+
+    void Resize(size_t capacity)
+        REQUIRES_SHARED(art::Locks::mutator_lock_)
+        REQUIRES(lock_);
+
+    std::vector<Entry, JvmtiAllocator<Entry>> slots_ GUARDED_BY(lock_);
+    size_t size_ GUARDED_BY(lock_) = 0;
+    uint64_t modifications_ GUARDED_BY(lock_) = 0;
+  };
+
+  // Fibonacci hashing of the address. The top kShardBits select the shard and the bits below
+  // them the home slot within the shard.
+  static uint64_t HashObject(art::mirror::Object* obj) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(obj)) *
+        UINT64_C(0x9E3779B97F4A7C15);
+  }
+
+  static size_t HomeSlot(art::mirror::Object* obj, size_t capacity) {
+    DCHECK(capacity != 0 && (capacity & (capacity - 1)) == 0);
+    return static_cast<size_t>(HashObject(obj) >> (64 - kShardBits - CTZ(capacity))) &
+        (capacity - 1);
+  }
+
+  Shard& GetShard(art::mirror::Object* obj) {
+    return shards_[HashObject(obj) >> (64 - kShardBits)];
+  }
+
+  // Whether weak access is allowed, checked without allow_disallow_lock_. This is stable while the
+  // caller stays runnable and does not pass a suspend point.
+  bool CanAccessWeaks(art::Thread* self) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    if (art::kUseReadBarrier) {
+      return self->GetWeakRefAccessEnabled();
+    }
+    return allow_new_weak_.load(std::memory_order_acquire);
+  }
+
+  // Block until weak access is allowed, taking allow_disallow_lock_ only if it is not.
+  void WaitUnlocked(art::Thread* self)
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(!allow_disallow_lock_) {
+    if (UNLIKELY(!CanAccessWeaks(self))) {
+      art::MutexLock mu(self, allow_disallow_lock_);
+      Wait(self);
+    }
+  }
+
+  // A lookup missed, but we might be storing from-pointers and be asked with a to-pointer.
+  bool NeedsReadBarrierUpdate(art::Thread* self) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    return art::kUseReadBarrier &&
+        self != nullptr &&
+        self->GetIsGcMarking() &&
+        !update_since_last_sweep_.load(std::memory_order_acquire);
+  }
+
   ALWAYS_INLINE
   bool SetLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, T tag)
       REQUIRES_SHARED(art::Locks::mutator_lock_)
@@ -144,18 +311,17 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
   bool GetTagLocked(art::Thread* self, art::ObjPtr<art::mirror::Object> obj, /* out */ T* result)
       REQUIRES_SHARED(art::Locks::mutator_lock_)
       REQUIRES(allow_disallow_lock_) {
-    auto it = tagged_objects_.find(art::GcRoot<art::mirror::Object>(obj));
-    if (it != tagged_objects_.end()) {
-      *result = it->second;
-      return true;
+    Shard& shard = GetShard(obj.Ptr());
+    {
+      art::MutexLock mu(self, shard.lock_);
+      if (shard.Find(obj.Ptr(), result)) {
+        return true;
+      }
     }
 
     // Performance optimization: To avoid multiple table updates, ensure that during GC we
     // only update once. See the comment on the implementation of GetTagSlowPath.
-    if (art::kUseReadBarrier &&
-        self != nullptr &&
-        self->GetIsGcMarking() &&
-        !update_since_last_sweep_) {
+    if (NeedsReadBarrierUpdate(self)) {
       return GetTagSlowPath(self, obj, result);
     }
 
@@ -192,34 +358,36 @@ class JvmtiWeakTable : public art::gc::SystemWeakHolder {
       REQUIRES_SHARED(art::Locks::mutator_lock_)
       REQUIRES(allow_disallow_lock_);
 
-  template <typename Storage, class Allocator = JvmtiAllocator<T>>
-  struct ReleasableContainer;
+  // Make tag_index_ current if it is worth it. The index is only rebuilt when a second tag lookup
+  // finds the table unchanged since the previous one, so that alternating SetTag and lookups keep
+  // the cost of a linear scan. Returns whether tag_index_ can be used.
+  bool UpdateTagIndex(art::Thread* self)
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
 
-  struct HashGcRoot {
-    size_t operator()(const art::GcRoot<art::mirror::Object>& r) const
-        REQUIRES_SHARED(art::Locks::mutator_lock_) {
-      return reinterpret_cast<uintptr_t>(r.Read<art::kWithoutReadBarrier>());
-    }
-  };
+  // Call visitor for every entry whose tag is in the sorted array tags, or for every entry if
+  // tags is null, without holding any shard lock.
+  template <typename Visitor>
+  void VisitTaggedEntries(art::Thread* self,
+                          const T* tags,
+                          size_t tag_count,
+                          const Visitor& visitor)
+      REQUIRES_SHARED(art::Locks::mutator_lock_)
+      REQUIRES(allow_disallow_lock_);
 
-  struct EqGcRoot {
-    bool operator()(const art::GcRoot<art::mirror::Object>& r1,
-                    const art::GcRoot<art::mirror::Object>& r2) const
-        REQUIRES_SHARED(art::Locks::mutator_lock_) {
-      return r1.Read<art::kWithoutReadBarrier>() == r2.Read<art::kWithoutReadBarrier>();
-    }
-  };
+  template <typename Storage, class Allocator = JvmtiAllocator<T>>
+  struct ReleasableContainer;
 
-  using TagAllocator = JvmtiAllocator<std::pair<const art::GcRoot<art::mirror::Object>, T>>;
-  std::unordered_map<art::GcRoot<art::mirror::Object>,
-                     T,
-                     HashGcRoot,
-                     EqGcRoot,
-                     TagAllocator> tagged_objects_
-      GUARDED_BY(allow_disallow_lock_)
-      GUARDED_BY(art::Locks::mutator_lock_);
+  std::array<Shard, kShardCount> shards_;
   // To avoid repeatedly scanning the whole table, remember if we did that since the last sweep.
-  bool update_since_last_sweep_;
+  std::atomic<bool> update_since_last_sweep_;
+  // Copy of allow_new_system_weak_ that can be read without allow_disallow_lock_.
+  std::atomic<bool> allow_new_weak_;
+
+  // All entries sorted by tag, and the shard modification counts they were copied at.
+  std::vector<Entry, JvmtiAllocator<Entry>> tag_index_ GUARDED_BY(allow_disallow_lock_);
+  std::array<uint64_t, kShardCount> tag_index_modifications_ GUARDED_BY(allow_disallow_lock_);
+  bool tag_index_valid_ GUARDED_BY(allow_disallow_lock_);
 };
 
 }  // namespace openjdkjvmti
@@ -46,6 +46,7 @@
 #include "ti_monitor.h"
 #include "ti_redefine.h"
 #include "ti_search.h"
+#include "ti_stack.h"
 #include "transform.h"
 
 #include "thread-inl.h"
@@ -200,6 +201,30 @@ jvmtiError ExtensionUtil::GetExtensionFunctions(jvmtiEnv* env,
     return error;
   }
 
+  error = add_extension(
+      reinterpret_cast<jvmtiExtensionFunction>(HeapExtensions::IterateThroughHeapParallel),
+      "com.android.art.heap.iterate_through_heap_parallel",
+      "Iterate through a heap like iterate_through_heap_ext, with the same callback signature, but"
+      " look up the tags, sizes and heap ids of the objects on up to 'thread_count' threads (0 for"
+      " one per CPU). The callbacks are still called on the calling thread, in the same order as"
+      " by iterate_through_heap_ext.",
+      {
+          { "heap_filter", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false},
+          { "klass", JVMTI_KIND_IN, JVMTI_TYPE_JCLASS, true},
+          { "callbacks", JVMTI_KIND_IN_PTR, JVMTI_TYPE_CVOID, false},
+          { "user_data", JVMTI_KIND_IN_PTR, JVMTI_TYPE_CVOID, true},
+          { "thread_count", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false},
+      },
+      {
+          ERR(MUST_POSSESS_CAPABILITY),
+          ERR(INVALID_CLASS),
+          ERR(NULL_POINTER),
+          ERR(ILLEGAL_ARGUMENT),
+      });
+  if (error != ERR(NONE)) {
+    return error;
+  }
+
   error = add_extension(
       reinterpret_cast<jvmtiExtensionFunction>(AllocUtil::GetGlobalJvmtiAllocationState),
       "com.android.art.alloc.get_global_jvmti_allocation_state",
@@ -215,6 +240,41 @@ jvmtiError ExtensionUtil::GetExtensionFunctions(jvmtiEnv* env,
     return error;
   }
 
+  // Stack sampling extension.
+  error = add_extension(
+      reinterpret_cast<jvmtiExtensionFunction>(StackUtil::SampleStackTraces),
+      "com.android.art.stack.sample_stack_traces",
+      "Samples the stacks of the 'thread_count' threads in 'threads', or of all live threads if"
+      " 'threads' is null, with a single checkpoint, and appends them to the ring buffer 'ring' of"
+      " 'ring_size' jlongs. ring[0] is the write position and ring[1] the read position, both"
+      " counted in records of two jlongs since the ring was zeroed; the agent consumes records and"
+      " advances ring[1], this function only advances ring[0]. Record n is stored at"
+      " ring[2 + 2 * (n % ((ring_size - 2) / 2))]. Each sample is a header record {key,"
+      " frame_count} followed by frame_count records {jmethodID, dex_pc or -1}, innermost frame"
+      " first, with at most 'max_frame_count' frames and never more than 512, the deepest stack"
+      " kept in a sample. The key is the index into 'threads', or the thread's tid when all"
+      " threads are sampled. Samples that do not fit in the free part of the ring are dropped"
+      " whole. Threads that are not alive are skipped. 'sample_count' returns the number of"
+      " samples appended. Unlike GetThreadListStackTraces this does not allocate any JVMTI"
+      " memory, and reuses its buffers, which never exceed the free part of the ring, between"
+      " calls made on the same thread.",
+      {
+          { "thread_count", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false },
+          { "threads", JVMTI_KIND_IN_BUF, JVMTI_TYPE_JTHREAD, true },
+          { "max_frame_count", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false },
+          { "ring_size", JVMTI_KIND_IN, JVMTI_TYPE_JINT, false },
+          { "ring", JVMTI_KIND_OUT_BUF, JVMTI_TYPE_JLONG, false },
+          { "sample_count", JVMTI_KIND_OUT, JVMTI_TYPE_JINT, false },
+      },
+      {
+          ERR(ILLEGAL_ARGUMENT),
+          ERR(NULL_POINTER),
+          ERR(INVALID_THREAD),
+      });
+  if (error != ERR(NONE)) {
+    return error;
+  }
+
   // DDMS extension
   error = add_extension(
       reinterpret_cast<jvmtiExtensionFunction>(DDMSUtil::HandleChunk),
@@ -16,8 +16,12 @@
 
 #include "ti_heap.h"
 
+#include <algorithm>
+#include <atomic>
 #include <ios>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "android-base/logging.h"
 #include "android-base/thread_annotations.h"
@@ -63,6 +67,7 @@
 #include "stack.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "ti_logging.h"
 #include "ti_stack.h"
 #include "ti_thread.h"
@@ -652,16 +657,16 @@ struct HeapFilter {
       return true;
     }
 
-    if ((tag == 0 && filter_out_untagged) || (tag != 0 && filter_out_tagged)) {
-      return false;
-    }
+    return ShouldReportByTag(tag) && ShouldReportByClassTag(class_tag);
+  }
 
-    if ((class_tag == 0 && filter_out_class_untagged) ||
-        (class_tag != 0 && filter_out_class_tagged)) {
-      return false;
-    }
+  bool ShouldReportByTag(jlong tag) const {
+    return !((tag == 0 && filter_out_untagged) || (tag != 0 && filter_out_tagged));
+  }
 
-    return true;
+  bool ShouldReportByClassTag(jlong class_tag) const {
+    return !((class_tag == 0 && filter_out_class_untagged) ||
+             (class_tag != 0 && filter_out_class_tagged));
   }
 
   const bool filter_out_tagged;
@@ -1612,6 +1617,290 @@ jvmtiError HeapExtensions::IterateThroughHeapExt(jvmtiEnv* env,
 
 namespace {
 
+// Upper bound on the threads of IterateThroughHeapParallel, including the calling thread.
+static constexpr size_t kMaxHeapWalkThreads = 16;
+// Number of consecutive heap objects handed to a thread at once.
+static constexpr size_t kHeapWalkChunkSize = 4096;
+// How many chunks each thread may gather ahead of the callbacks.
+static constexpr size_t kHeapWalkChunksPerThread = 4;
+
+// What IterateThroughHeapParallel needs to report an object that passed the filters.
+struct HeapWalkRecord {
+  art::mirror::Object* obj;
+  jlong tag;
+  jlong class_tag;
+  jlong size;
+  jint length;
+  jint heap_id;
+};
+
+// The filters of an IterateThroughHeapParallel call, shared by all of its chunks.
+struct HeapWalkFilter {
+  ObjectTagTable* tag_table;
+  const HeapFilter heap_filter;
+  // Raw pointer, as ObjPtr may not be shared between threads.
+  art::mirror::Class* filter_klass;
+};
+
+// A run of consecutive heap objects. The walking thread fills the chunk and queues it on the
+// thread pool, and whichever thread claims it first looks up the tags, sizes and heap ids of its
+// objects. The walking thread reports the chunks in the order they were filled, so the callbacks
+// see the objects in heap order no matter which thread gathered them.
+class HeapWalkChunk final : public art::Task {
+ public:
+  explicit HeapWalkChunk(const HeapWalkFilter* filter) : filter_(filter), state_(kFilling) {
+    objects_.reserve(kHeapWalkChunkSize);
+    records_.reserve(kHeapWalkChunkSize);
+  }
+
+  // Returns true once the chunk is full.
+  bool Add(art::mirror::Object* obj) {
+    objects_.push_back(obj);
+    return objects_.size() == kHeapWalkChunkSize;
+  }
+
+  bool IsEmpty() const {
+    return objects_.empty();
+  }
+
+  void Queue() {
+    state_.store(kQueued, std::memory_order_release);
+  }
+
+  // A reused chunk can be on the pool's queue more than once. Stale entries find it already
+  // claimed and do nothing.
+  void Run(art::Thread* self ATTRIBUTE_UNUSED) override {
+    Claim();
+  }
+
+  // Returns the records of the chunk, gathering them on this thread if no worker got to it yet.
+  const std::vector<HeapWalkRecord>& Await() {
+    if (!Claim()) {
+      while (state_.load(std::memory_order_acquire) != kDone) {
+        sched_yield();
+      }
+    }
+    return records_;
+  }
+
+  void Reset() {
+    state_.store(kFilling, std::memory_order_relaxed);
+    objects_.clear();
+    records_.clear();
+  }
+
+ private:
+  static constexpr uint32_t kFilling = 0;
+  static constexpr uint32_t kQueued = 1;
+  static constexpr uint32_t kClaimed = 2;
+  static constexpr uint32_t kDone = 3;
+
+  // The walking thread keeps the world suspended until every chunk is done, which makes it safe
+  // for the workers to read the objects without holding the mutator lock themselves.
+  bool Claim() NO_THREAD_SAFETY_ANALYSIS {
+    uint32_t expected = kQueued;
+    if (!state_.compare_exchange_strong(expected, kClaimed, std::memory_order_acquire)) {
+      return false;
+    }
+    Gather();
+    state_.store(kDone, std::memory_order_release);
+    return true;
+  }
+
+  void Gather() REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    for (art::mirror::Object* obj : objects_) {
+      art::ObjPtr<art::mirror::Class> klass = obj->GetClass();
+      if (filter_->filter_klass != nullptr && filter_->filter_klass != klass.Ptr()) {
+        continue;
+      }
+
+      // An object's tag can only change when the object itself is reported, so the tag filter
+      // can be applied here. Class tags may still change while earlier chunks are reported, the
+      // walking thread checks them.
+      jlong tag = 0;
+      filter_->tag_table->GetTag(obj, &tag);
+      if (!filter_->heap_filter.ShouldReportByTag(tag)) {
+        continue;
+      }
+
+      jlong class_tag = 0;
+      filter_->tag_table->GetTag(klass.Ptr(), &class_tag);
+
+      jint length = -1;
+      if (obj->IsArrayInstance()) {
+        length = obj->AsArray()->GetLength();
+      }
+
+      records_.push_back({ obj, tag, class_tag, static_cast<jlong>(obj->SizeOf()), length,
+                           GetHeapId(obj) });
+    }
+  }
+
+  const HeapWalkFilter* const filter_;
+  std::atomic<uint32_t> state_;
+  std::vector<art::mirror::Object*> objects_;
+  std::vector<HeapWalkRecord> records_;
+};
+
+}  // namespace
+
+jvmtiError HeapExtensions::IterateThroughHeapParallel(jvmtiEnv* env,
+                                                      jint heap_filter,
+                                                      jclass klass,
+                                                      const jvmtiHeapCallbacks* callbacks,
+                                                      const void* user_data,
+                                                      jint thread_count) {
+  if (ArtJvmTiEnv::AsArtJvmTiEnv(env)->capabilities.can_tag_objects != 1) {
+    return ERR(MUST_POSSESS_CAPABILITY);
+  }
+  if (callbacks == nullptr) {
+    return ERR(NULL_POINTER);
+  }
+  if (thread_count < 0) {
+    return ERR(ILLEGAL_ARGUMENT);
+  }
+
+  size_t num_threads =
+      thread_count != 0 ? static_cast<size_t>(thread_count) : std::thread::hardware_concurrency();
+  num_threads = std::clamp<size_t>(num_threads, 1, kMaxHeapWalkThreads);
+
+  art::Thread* self = art::Thread::Current();
+  ObjectTagTable* tag_table = ArtJvmTiEnv::AsArtJvmTiEnv(env)->object_tag_table.get();
+
+  // The calling thread gathers chunks too, whenever it catches up with the workers.
+  std::unique_ptr<art::ThreadPool> thread_pool;
+  if (num_threads > 1) {
+    thread_pool.reset(art::ThreadPool::Create("JVMTI heap walk", num_threads - 1));
+  }
+
+  art::gc::Heap* heap = art::Runtime::Current()->GetHeap();
+  if (heap->IsGcConcurrentAndMoving()) {
+    // Need to walk the heap while GC isn't running. See the comment in Heap::VisitObjects().
+    heap->IncrementDisableMovingGC(self);
+  }
+  {
+    art::ScopedObjectAccess soa(self);      // Now we know we have the shared lock.
+    art::ScopedThreadSuspension sts(self, art::ThreadState::kWaitingForVisitObjects);
+    art::ScopedSuspendAll ssa("IterateThroughHeapParallel");
+
+    const HeapWalkFilter filter = {
+        tag_table,
+        HeapFilter(heap_filter),
+        klass == nullptr
+            ? nullptr
+            : art::ObjPtr<art::mirror::Class>::DownCast(self->DecodeJObject(klass)).Ptr(),
+    };
+    std::vector<std::unique_ptr<HeapWalkChunk>> chunks;
+    for (size_t i = 0; i != num_threads * kHeapWalkChunksPerThread; ++i) {
+      chunks.push_back(std::make_unique<HeapWalkChunk>(&filter));
+    }
+    size_t queued = 0;
+    size_t reported = 0;
+    bool stop_reports = false;
+    // Set once the agent tags a class, after which the class tags gathered ahead are stale.
+    bool class_tags_changed = false;
+
+    auto report = [&](const HeapWalkRecord& record) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+      art::mirror::Object* obj = record.obj;
+      jlong class_tag = record.class_tag;
+      if (class_tags_changed) {
+        class_tag = 0;
+        tag_table->GetTag(obj->GetClass(), &class_tag);
+      }
+      if (!filter.heap_filter.ShouldReportByClassTag(class_tag)) {
+        return;
+      }
+
+      jlong tag = record.tag;
+      using ArtExtensionAPI = jint (*)(jlong, jlong, jlong*, jint length, void*, jint);
+      jint ret = reinterpret_cast<ArtExtensionAPI>(callbacks->heap_iteration_callback)(
+          class_tag, record.size, &tag, record.length, const_cast<void*>(user_data), record.heap_id);
+
+      if (tag != record.tag) {
+        tag_table->Set(obj, tag);
+      }
+
+      stop_reports = (ret & JVMTI_VISIT_ABORT) != 0;
+
+      if (!stop_reports) {
+        jint string_ret = ReportString(obj, env, tag_table, callbacks, user_data);
+        stop_reports = (string_ret & JVMTI_VISIT_ABORT) != 0;
+      }
+
+      if (!stop_reports) {
+        jint array_ret = ReportPrimitiveArray(obj, env, tag_table, callbacks, user_data);
+        stop_reports = (array_ret & JVMTI_VISIT_ABORT) != 0;
+      }
+
+      if (!stop_reports) {
+        stop_reports = ReportPrimitiveField::Report(obj, tag_table, callbacks, user_data);
+      }
+
+      if (!class_tags_changed && obj->IsClass()) {
+        jlong new_tag = 0;
+        tag_table->GetTag(obj, &new_tag);
+        class_tags_changed = new_tag != record.tag;
+      }
+    };
+    auto report_next_chunk = [&]() REQUIRES_SHARED(art::Locks::mutator_lock_) {
+      HeapWalkChunk* chunk = chunks[reported++ % chunks.size()].get();
+      for (const HeapWalkRecord& record : chunk->Await()) {
+        if (stop_reports) {
+          break;
+        }
+        report(record);
+      }
+      chunk->Reset();
+    };
+    auto queue_chunk = [&](HeapWalkChunk* chunk) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+      chunk->Queue();
+      ++queued;
+      if (thread_pool != nullptr) {
+        thread_pool->AddTask(self, chunk);
+      }
+      // Reporting the oldest chunk frees it up for the next objects.
+      if (queued - reported == chunks.size()) {
+        report_next_chunk();
+      }
+    };
+    auto visitor = [&](art::mirror::Object* obj) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+      // Early return, as we can't really stop visiting.
+      if (stop_reports) {
+        return;
+      }
+      HeapWalkChunk* chunk = chunks[queued % chunks.size()].get();
+      if (chunk->Add(obj)) {
+        queue_chunk(chunk);
+      }
+    };
+
+    if (thread_pool != nullptr) {
+      thread_pool->StartWorkers(self);
+    }
+    heap->VisitObjectsPaused(visitor);
+    HeapWalkChunk* last_chunk = chunks[queued % chunks.size()].get();
+    if (!stop_reports && !last_chunk->IsEmpty()) {
+      queue_chunk(last_chunk);
+    }
+    while (reported != queued) {
+      report_next_chunk();
+    }
+    if (thread_pool != nullptr) {
+      // Drop the stale queue entries of reused chunks before the chunks go away.
+      thread_pool->StopWorkers(self);
+      thread_pool->RemoveAllTasks(self);
+      thread_pool->Wait(self, /* do_work= */ false, /* may_hold_locks= */ true);
+    }
+  }
+  if (heap->IsGcConcurrentAndMoving()) {
+    heap->DecrementDisableMovingGC(self);
+  }
+
+  return ERR(NONE);
+}
+
+namespace {
+
 using ObjectPtr = art::ObjPtr<art::mirror::Object>;
 using ObjectMap = std::unordered_map<ObjectPtr, ObjectPtr, art::HashObjPtr>;
 
@@ -32,7 +32,9 @@
 #include "ti_stack.h"
 
 #include <algorithm>
+#include <atomic>
 #include <initializer_list>
+#include <limits>
 #include <list>
 #include <unordered_map>
 #include <vector>
@@ -694,6 +696,248 @@ jvmtiError StackUtil::GetThreadListStackTraces(jvmtiEnv* env,
   return ERR(NONE);
 }
 
+// Deepest stack kept in a sample. Deeper frames are not recorded, so that a sample of many threads
+// with a large ring stays bounded.
+static constexpr size_t kMaxSampleFrames = 512;
+
+// Storage reused by SampleStackTraces across calls on the same sampling thread, so that steady
+// state sampling does not allocate.
+struct StackSampleScratch {
+  // Thread to sample and its index in the thread list, sorted by thread. Only used with a list.
+  std::vector<std::pair<art::Thread*, size_t>> selected;
+  // Frames of all samples, one entry per ring record. Each sample claims its header record and
+  // frames from here, so this never holds more than the free part of the ring.
+  std::vector<jvmtiFrameInfo> frames;
+  // Offset of the frames of each slot, the entry after its header record.
+  std::vector<size_t> starts;
+  // Number of frames per slot, or kNoSample.
+  std::vector<size_t> counts;
+  // Value of the sample header for each slot.
+  std::vector<jlong> keys;
+
+  static constexpr size_t kNoSample = std::numeric_limits<size_t>::max();
+};
+
+static thread_local StackSampleScratch gStackSampleScratch;
+
+struct SampleStackTracesClosure : public art::Closure {
+  SampleStackTracesClosure(StackSampleScratch* scratch_in,
+                           const std::vector<art::Handle<art::mirror::Object>>* peers_in,
+                           size_t slot_count_in,
+                           size_t max_frames_in,
+                           size_t record_limit_in)
+      : barrier(0),
+        scratch(scratch_in),
+        peers(peers_in),
+        slot_count(slot_count_in),
+        max_frames(max_frames_in),
+        record_limit(record_limit_in),
+        next_slot(0),
+        next_record(0) {}
+
+  void Run(art::Thread* thread) override REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    art::Thread* self = art::Thread::Current();
+    Work(thread);
+    barrier.Pass(self);
+  }
+
+  void Work(art::Thread* thread) REQUIRES_SHARED(art::Locks::mutator_lock_) {
+    // Skip threads that are still starting.
+    if (thread->IsStillStarting()) {
+      return;
+    }
+
+    size_t slot;
+    if (peers == nullptr) {
+      // Sampling all threads: take the next slot, the sample is keyed by the tid.
+      slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+      if (slot >= slot_count) {
+        return;  // Started after the slots were sized.
+      }
+      scratch->keys[slot] = static_cast<jlong>(thread->GetTid());
+    } else {
+      auto it = std::lower_bound(scratch->selected.begin(),
+                                 scratch->selected.end(),
+                                 std::make_pair(thread, static_cast<size_t>(0)));
+      if (it == scratch->selected.end() || it->first != thread) {
+        return;
+      }
+      slot = it->second;
+      // The art::Thread might have been reused for another java thread since it was looked up.
+      if (thread->GetPeerFromOtherThread() != (*peers)[slot].Get()) {
+        return;
+      }
+    }
+
+    // Claim the records for the header and the deepest possible stack.
+    size_t start = next_record.load(std::memory_order_relaxed);
+    size_t claimed;
+    do {
+      if (start >= record_limit) {
+        return;  // The ring is full.
+      }
+      claimed = std::min(max_frames + 1, record_limit - start);
+    } while (!next_record.compare_exchange_weak(start, start + claimed, std::memory_order_relaxed));
+
+    // The claimed records are written by this thread only, and read after the barrier.
+    jvmtiFrameInfo* out = scratch->frames.data() + start + 1;
+    size_t room = claimed - 1;
+    size_t count = 0;
+    if (room != 0) {
+      auto frames_fn = [&](jvmtiFrameInfo info) {
+        out[count++] = info;
+      };
+      auto visitor = MakeStackTraceVisitor(thread, 0u, room, frames_fn);
+      visitor.WalkStack(/* include_transitions= */ false);
+    }
+
+    // A sample is written whole or not at all: drop it if the ring ran out before max_frames.
+    bool fits = room == max_frames || count < room;
+    size_t used = fits ? count + 1 : 0;
+    if (used < claimed) {
+      // Give back what was not used, unless another thread already claimed records after it.
+      size_t end = start + claimed;
+      next_record.compare_exchange_strong(end, start + used, std::memory_order_relaxed);
+    }
+    if (fits) {
+      scratch->starts[slot] = start + 1;
+      scratch->counts[slot] = count;
+    }
+  }
+
+  art::Barrier barrier;
+  StackSampleScratch* scratch;
+  const std::vector<art::Handle<art::mirror::Object>>* peers;
+  const size_t slot_count;
+  const size_t max_frames;
+  const size_t record_limit;
+  std::atomic<size_t> next_slot;
+  std::atomic<size_t> next_record;
+};
+
+jvmtiError StackUtil::SampleStackTraces(jvmtiEnv* env ATTRIBUTE_UNUSED,
+                                        jint thread_count,
+                                        const jthread* thread_list,
+                                        jint max_frame_count,
+                                        jint ring_size,
+                                        jlong* ring,
+                                        jint* sample_count_ptr) {
+  if (max_frame_count < 0 || thread_count < 0) {
+    return ERR(ILLEGAL_ARGUMENT);
+  }
+  if (ring == nullptr || sample_count_ptr == nullptr) {
+    return ERR(NULL_POINTER);
+  }
+  if (ring_size < 4) {
+    return ERR(ILLEGAL_ARGUMENT);
+  }
+
+  // ring[0] and ring[1] are the write and read positions, counted in records of two jlongs since
+  // the ring was set up; the agent only ever advances the read position, so the free part of the
+  // ring can only grow while the threads are sampled.
+  size_t capacity = static_cast<size_t>(ring_size - 2) / 2;
+  uint64_t write_pos = static_cast<uint64_t>(__atomic_load_n(&ring[0], __ATOMIC_RELAXED));
+  uint64_t read_pos = static_cast<uint64_t>(__atomic_load_n(&ring[1], __ATOMIC_ACQUIRE));
+  if (write_pos - read_pos > capacity) {
+    return ERR(ILLEGAL_ARGUMENT);
+  }
+  size_t free_records = capacity - static_cast<size_t>(write_pos - read_pos);
+
+  art::Thread* current = art::Thread::Current();
+  art::ScopedObjectAccess soa(current);
+
+  StackSampleScratch& scratch = gStackSampleScratch;
+  scratch.selected.clear();
+
+  // Keep the requested peers in handles, to check the threads found by the checkpoint.
+  art::VariableSizedHandleScope hs(current);
+  std::vector<art::Handle<art::mirror::Object>> peers;
+  size_t slot_count;
+  if (thread_list != nullptr) {
+    peers.reserve(thread_count);
+    art::MutexLock mu(current, *art::Locks::thread_list_lock_);
+    for (jint i = 0; i != thread_count; ++i) {
+      if (thread_list[i] == nullptr) {
+        return ERR(INVALID_THREAD);
+      }
+      art::Thread* thread;
+      jvmtiError thread_error = ERR(INTERNAL);
+      if (!ThreadUtil::GetAliveNativeThread(thread_list[i], soa, &thread, &thread_error)) {
+        if (thread_error != ERR(THREAD_NOT_ALIVE)) {
+          return thread_error;
+        }
+        thread = nullptr;  // Not alive, no sample.
+      }
+      peers.push_back(hs.NewHandle(soa.Decode<art::mirror::Object>(thread_list[i])));
+      if (thread != nullptr) {
+        scratch.selected.emplace_back(thread, static_cast<size_t>(i));
+      }
+    }
+    std::sort(scratch.selected.begin(), scratch.selected.end());
+    slot_count = static_cast<size_t>(thread_count);
+  } else {
+    art::MutexLock mu(current, *art::Locks::thread_list_lock_);
+    slot_count = art::Runtime::Current()->GetThreadList()->Size();
+  }
+
+  // Agents commonly ask for INT_MAX frames to mean all of them.
+  size_t max_frames = std::min(static_cast<size_t>(max_frame_count), kMaxSampleFrames);
+  size_t record_limit = std::min(free_records, slot_count * (max_frames + 1));
+  if (scratch.frames.capacity() > 4 * record_limit) {
+    // Do not keep a buffer sized for an earlier, larger call.
+    std::vector<jvmtiFrameInfo>().swap(scratch.frames);
+  }
+  if (scratch.frames.size() < record_limit) {
+    scratch.frames.resize(record_limit);
+  }
+  scratch.starts.resize(slot_count);
+  scratch.counts.assign(slot_count, StackSampleScratch::kNoSample);
+  scratch.keys.resize(slot_count);
+  if (thread_list != nullptr) {
+    for (size_t i = 0; i != slot_count; ++i) {
+      scratch.keys[i] = static_cast<jlong>(i);
+    }
+  }
+
+  SampleStackTracesClosure closure(&scratch,
+                                   thread_list != nullptr ? &peers : nullptr,
+                                   slot_count,
+                                   max_frames,
+                                   record_limit);
+  size_t barrier_count = art::Runtime::Current()->GetThreadList()->RunCheckpoint(&closure, nullptr);
+  if (barrier_count != 0) {
+    art::ScopedThreadStateChange tsc(current, art::ThreadState::kWaitingForCheckPointsToRun);
+    closure.barrier.Increment(current, barrier_count);
+  }
+
+  // Append to the ring. The samples claimed at most free_records records between them.
+  auto put = [&](jlong first, jlong second) {
+    jlong* record = &ring[2 + 2 * (write_pos % capacity)];
+    record[0] = first;
+    record[1] = second;
+    ++write_pos;
+  };
+
+  jint sample_count = 0;
+  for (size_t slot = 0; slot != slot_count; ++slot) {
+    size_t count = scratch.counts[slot];
+    if (count == StackSampleScratch::kNoSample) {
+      continue;
+    }
+    put(scratch.keys[slot], static_cast<jlong>(count));
+    const jvmtiFrameInfo* frames = scratch.frames.data() + scratch.starts[slot];
+    for (size_t i = 0; i != count; ++i) {
+      put(static_cast<jlong>(reinterpret_cast<uintptr_t>(frames[i].method)), frames[i].location);
+    }
+    ++sample_count;
+  }
+
+  // Publish the records.
+  __atomic_store_n(&ring[0], static_cast<jlong>(write_pos), __ATOMIC_RELEASE);
+  *sample_count_ptr = sample_count;
+  return ERR(NONE);
+}
+
 struct GetFrameCountClosure : public art::Closure {
  public:
   GetFrameCountClosure() : count(0) {}
@@ -71,6 +71,17 @@ class StackUtil {
                                              jint max_frame_count,
                                              jvmtiStackInfo** stack_info_ptr);
 
+  // Extension: sample the stacks of the given threads, or of all threads if thread_list is null,
+  // into the caller's ring of ring_size jlongs. See ti_extension.cc for the ring layout.
+  static jvmtiError SampleStackTraces(jvmtiEnv* env,
+                                      jint thread_count,
+                                      const jthread* thread_list,
+                                      jint max_frame_count,
+                                      jint ring_size,
+                                      jlong* ring,
+                                      jint* sample_count_ptr)
+      REQUIRES(!art::Locks::thread_list_lock_);
+
   static jvmtiError GetOwnedMonitorStackDepthInfo(jvmtiEnv* env,
                                                   jthread thread,
                                                   jint* info_cnt_ptr,
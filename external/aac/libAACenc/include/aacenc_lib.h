@@ -1381,6 +1381,19 @@ typedef enum {
                  bitreservoir, which would affect the audio quality by a large
                  amount. */
 
+  AACENC_NUM_THREADS =
+      0x0208, /*!< Number of threads used to process the channel elements of a
+                 frame. Psychoacoustic analysis including TNS and scalefactor
+                 estimation of the individual channel elements are run
+                 concurrently, while bit distribution, quantization loop and
+                 bitreservoir handling remain sequential. The generated
+                 bitstream is identical to single threaded operation. The
+                 value is limited internally to the number of channel elements
+                 of the configured channel mode.
+                   - 0, 1: Process all channel elements in the calling thread.
+                 (default)
+                   - 2 to 8: Number of threads including the calling thread. */
+
   AACENC_TRANSMUX = 0x0300, /*!< Transport type to be used. See ::TRANSPORT_TYPE
                                in FDK_audio.h. Following types can be configured
                                in encoder library:
@@ -148,6 +148,12 @@ PSY_DYNAMIC *GetRam_aacEnc_PsyDynamic(int n, UCHAR *dynamic_RAM) {
       dynamic_RAM + P_BUF_1 + n * sizeof(PSY_DYNAMIC)));
 }
 
+/*
+   Additional psych scratch memory for worker threads. Worker 0 (the calling
+   thread) keeps using the shared dynamic RAM above.
+*/
+C_ALLOC_MEM2(Ram_aacEnc_PsyDynamicWorker, PSY_DYNAMIC, 1, AACENC_MAX_THREADS)
+
 /*
    The structure PSY_OUT holds all psychoaccoustic data needed
    in quantization module
@@ -118,6 +118,7 @@ amm-info@iis.fraunhofer.de
 #include "bitenc.h"
 #include "bit_cnt.h"
 #include "psy_const.h"
+#include "aacenc_mt.h"
 
 #define OUTPUTBUFFER_SIZE                                                 \
   (8192) /*!< Output buffer size has to be at least 6144 bits per channel \
@@ -149,6 +150,14 @@ struct AAC_ENC {
   PSY_OUT *psyOut[(1)];
   PSY_INTERNAL *psyKernel;
 
+  /* parallel element processing */
+  HANDLE_AACENC_MT hMt;
+  INT nThreads;          /* number of workers the pool actually runs */
+  INT nThreadsRequested; /* request nThreads was opened for */
+  PSY_DYNAMIC *psyDynamic[AACENC_MAX_THREADS]; /* scratch memory per worker,
+                                                  [0] is psyKernel->psyDynamic
+                                                */
+
   /* lifetime vars */
 
   CHANNEL_MODE encoderMode;
@@ -226,6 +235,7 @@ H_ALLOC_MEM(Ram_aacEnc_PsyStatic, PSY_STATIC)
 H_ALLOC_MEM(Ram_aacEnc_PsyInputBuffer, INT_PCM)
 
 PSY_DYNAMIC *GetRam_aacEnc_PsyDynamic(int n, UCHAR *dynamic_RAM);
+H_ALLOC_MEM(Ram_aacEnc_PsyDynamicWorker, PSY_DYNAMIC)
 
 H_ALLOC_MEM(Ram_aacEnc_PsyOutChannel, PSY_OUT_CHANNEL)
 
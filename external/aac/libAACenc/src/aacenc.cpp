@@ -365,6 +365,7 @@ void FDKaacEnc_AacInitDefaultConfig(AACENC_CONFIG *config) {
   config->audioMuxVersion = -1; /* audio mux version not configured */
   config->downscaleFactor =
       1; /* downscale factor for ELD reduced delay mode, 1 is normal ELD */
+  config->nThreads = 1; /* process channel elements sequentially */
 }
 
 /*---------------------------------------------------------------------------
@@ -402,6 +403,9 @@ AAC_ENCODER_ERROR FDKaacEnc_Open(HANDLE_AAC_ENC *phAacEnc, const INT nElements,
   ErrorStatus =
       FDKaacEnc_PsyNew(&hAacEnc->psyKernel, nElements, nChannels, dynamicRAM);
   if (ErrorStatus != AAC_ENC_OK) goto bail;
+  hAacEnc->psyDynamic[0] = hAacEnc->psyKernel->psyDynamic;
+  hAacEnc->nThreads = 1;
+  hAacEnc->nThreadsRequested = 1;
 
   ErrorStatus = FDKaacEnc_PsyOutNew(hAacEnc->psyOut, nElements, nChannels,
                                     nSubFrames, dynamicRAM);
@@ -425,6 +429,48 @@ bail:
   return ErrorStatus;
 }
 
+/*---------------------------------------------------------------------------
+
+    functionname: FDKaacEnc_InitWorkers
+    description:  (re)create worker pool and per worker psych scratch memory
+    returns:      error code
+
+  ---------------------------------------------------------------------------*/
+static AAC_ENCODER_ERROR FDKaacEnc_InitWorkers(HANDLE_AAC_ENC hAacEnc,
+                                               const INT nThreads) {
+  AAC_ENCODER_ERROR ErrorStatus = AAC_ENC_OK;
+  INT w;
+
+  if (hAacEnc->nThreadsRequested == nThreads) {
+    return AAC_ENC_OK;
+  }
+
+  FDKaacEnc_MtClose(&hAacEnc->hMt);
+  for (w = 1; w < AACENC_MAX_THREADS; w++) {
+    FreeRam_aacEnc_PsyDynamicWorker(&hAacEnc->psyDynamic[w]);
+  }
+  hAacEnc->nThreads = 1;
+  hAacEnc->nThreadsRequested = 1;
+
+  if (nThreads > 1) {
+    ErrorStatus = FDKaacEnc_MtOpen(&hAacEnc->hMt, nThreads);
+    if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
+
+    for (w = 1; w < FDKaacEnc_MtGetThreads(hAacEnc->hMt); w++) {
+      if (NULL ==
+          (hAacEnc->psyDynamic[w] = GetRam_aacEnc_PsyDynamicWorker(w))) {
+        FDKaacEnc_MtClose(&hAacEnc->hMt);
+        return AAC_ENC_NO_MEMORY;
+      }
+    }
+    /* The pool may have started fewer threads than requested */
+    hAacEnc->nThreads = FDKaacEnc_MtGetThreads(hAacEnc->hMt);
+    hAacEnc->nThreadsRequested = nThreads;
+  }
+
+  return ErrorStatus;
+}
+
 AAC_ENCODER_ERROR FDKaacEnc_Initialize(
     HANDLE_AAC_ENC hAacEnc,
     AACENC_CONFIG *config, /* pre-initialized config struct */
@@ -546,6 +592,11 @@ AAC_ENCODER_ERROR FDKaacEnc_Initialize(
 
   cm = &hAacEnc->channelMapping;
 
+  /* more workers than channel elements would idle */
+  ErrorStatus = FDKaacEnc_InitWorkers(
+      hAacEnc, fixMax(1, fixMin(config->nThreads, cm->nElements)));
+  if (ErrorStatus != AAC_ENC_OK) goto bail;
+
   ErrorStatus = FDKaacEnc_DetermineBandWidth(
       config->bandWidth, config->bitRate - config->ancDataBitRate,
       hAacEnc->bitrateMode, config->sampleRate, config->framelength, cm,
@@ -759,6 +810,65 @@ bail:
   return ErrorStatus;
 }
 
+typedef struct {
+  HANDLE_AAC_ENC hAacEnc;
+  INT_PCM *inputBuffer;
+  UINT inputBufferBufSize;
+} AACENC_PSY_JOB;
+
+/*---------------------------------------------------------------------------
+
+    functionname: FDKaacEnc_PsyElementJob
+    description:  psychoacoustics and QC preparation of one channel element
+    returns:      error code
+
+  ---------------------------------------------------------------------------*/
+static AAC_ENCODER_ERROR FDKaacEnc_PsyElementJob(void *ctx, const INT el,
+                                                 const INT worker) {
+  AAC_ENCODER_ERROR ErrorStatus;
+  AACENC_PSY_JOB *psyJob = (AACENC_PSY_JOB *)ctx;
+  HANDLE_AAC_ENC hAacEnc = psyJob->hAacEnc;
+  CHANNEL_MAPPING *cm = &hAacEnc->channelMapping;
+  ELEMENT_INFO elInfo = cm->elInfo[el];
+  PSY_OUT *psyOut = hAacEnc->psyOut[0];
+  QC_OUT *qcOut = hAacEnc->qcOut[0];
+  int ch;
+
+  if ((elInfo.elType != ID_SCE) && (elInfo.elType != ID_CPE) &&
+      (elInfo.elType != ID_LFE)) {
+    return AAC_ENC_OK;
+  }
+
+  /* update pointer!*/
+  for (ch = 0; ch < elInfo.nChannelsInEl; ch++) {
+    PSY_OUT_CHANNEL *psyOutChan = psyOut->psyOutElement[el]->psyOutChannel[ch];
+    QC_OUT_CHANNEL *qcOutChan = qcOut->qcElement[el]->qcOutChannel[ch];
+
+    psyOutChan->mdctSpectrum = qcOutChan->mdctSpectrum;
+    psyOutChan->sfbSpreadEnergy = qcOutChan->sfbSpreadEnergy;
+    psyOutChan->sfbEnergy = qcOutChan->sfbEnergy;
+    psyOutChan->sfbEnergyLdData = qcOutChan->sfbEnergyLdData;
+    psyOutChan->sfbMinSnrLdData = qcOutChan->sfbMinSnrLdData;
+    psyOutChan->sfbThresholdLdData = qcOutChan->sfbThresholdLdData;
+  }
+
+  ErrorStatus = FDKaacEnc_psyMain(
+      elInfo.nChannelsInEl, hAacEnc->psyKernel->psyElement[el],
+      hAacEnc->psyDynamic[worker], hAacEnc->psyKernel->psyConf,
+      psyOut->psyOutElement[el], psyJob->inputBuffer,
+      psyJob->inputBufferBufSize, cm->elInfo[el].ChannelIndex, cm->nChannels);
+
+  if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
+
+  /* FormFactor, Pe and staticBitDemand calculation */
+  ErrorStatus = FDKaacEnc_QCMainPrepare(
+      &elInfo, hAacEnc->qcKernel->hAdjThr->adjThrStateElem[el],
+      psyOut->psyOutElement[el], qcOut->qcElement[el], hAacEnc->aot,
+      hAacEnc->config->syntaxFlags, hAacEnc->config->epConfig);
+
+  return ErrorStatus;
+}
+
 /*---------------------------------------------------------------------------
 
     functionname: FDKaacEnc_EncodeFrame
@@ -786,44 +896,26 @@ AAC_ENCODER_ERROR FDKaacEnc_EncodeFrame(
   qcOut->staticBits = 0;     /* sum up side info bits of each element */
   qcOut->totalNoRedPe = 0;   /* sum up PE */
 
-  /* advance psychoacoustics */
+  /* advance psychoacoustics, the channel elements are independent of each
+   * other and may be processed in parallel */
+  {
+    AACENC_PSY_JOB psyJob;
+
+    psyJob.hAacEnc = hAacEnc;
+    psyJob.inputBuffer = inputBuffer;
+    psyJob.inputBufferBufSize = inputBufferBufSize;
+
+    ErrorStatus = FDKaacEnc_MtRun(hAacEnc->hMt, FDKaacEnc_PsyElementJob,
+                                  &psyJob, cm->nElements);
+    if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
+  }
+
+  /* collect element results in bitstream order */
   for (el = 0; el < cm->nElements; el++) {
     ELEMENT_INFO elInfo = cm->elInfo[el];
 
     if ((elInfo.elType == ID_SCE) || (elInfo.elType == ID_CPE) ||
         (elInfo.elType == ID_LFE)) {
-      int ch;
-
-      /* update pointer!*/
-      for (ch = 0; ch < elInfo.nChannelsInEl; ch++) {
-        PSY_OUT_CHANNEL *psyOutChan =
-            psyOut->psyOutElement[el]->psyOutChannel[ch];
-        QC_OUT_CHANNEL *qcOutChan = qcOut->qcElement[el]->qcOutChannel[ch];
-
-        psyOutChan->mdctSpectrum = qcOutChan->mdctSpectrum;
-        psyOutChan->sfbSpreadEnergy = qcOutChan->sfbSpreadEnergy;
-        psyOutChan->sfbEnergy = qcOutChan->sfbEnergy;
-        psyOutChan->sfbEnergyLdData = qcOutChan->sfbEnergyLdData;
-        psyOutChan->sfbMinSnrLdData = qcOutChan->sfbMinSnrLdData;
-        psyOutChan->sfbThresholdLdData = qcOutChan->sfbThresholdLdData;
-      }
-
-      ErrorStatus = FDKaacEnc_psyMain(
-          elInfo.nChannelsInEl, hAacEnc->psyKernel->psyElement[el],
-          hAacEnc->psyKernel->psyDynamic, hAacEnc->psyKernel->psyConf,
-          psyOut->psyOutElement[el], inputBuffer, inputBufferBufSize,
-          cm->elInfo[el].ChannelIndex, cm->nChannels);
-
-      if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
-
-      /* FormFactor, Pe and staticBitDemand calculation */
-      ErrorStatus = FDKaacEnc_QCMainPrepare(
-          &elInfo, hAacEnc->qcKernel->hAdjThr->adjThrStateElem[el],
-          psyOut->psyOutElement[el], qcOut->qcElement[el], hAacEnc->aot,
-          hAacEnc->config->syntaxFlags, hAacEnc->config->epConfig);
-
-      if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
-
       /*-------------------------------------------- */
 
       qcOut->qcElement[el]->extBitsUsed = 0;
@@ -945,7 +1037,7 @@ AAC_ENCODER_ERROR FDKaacEnc_EncodeFrame(
     /*-------------------------------------------- */
 
     ErrorStatus = FDKaacEnc_QCMain(
-        hAacEnc->qcKernel, hAacEnc->psyOut, hAacEnc->qcOut, avgTotalBits, cm,
+        hAacEnc->qcKernel, hAacEnc->hMt, hAacEnc->psyOut, hAacEnc->qcOut, avgTotalBits, cm,
         hAacEnc->aot, hAacEnc->config->syntaxFlags, hAacEnc->config->epConfig);
 
     if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
@@ -1014,6 +1106,11 @@ void FDKaacEnc_Close(HANDLE_AAC_ENC *phAacEnc) /* encoder handle */
 
   if (hAacEnc->dynamic_RAM != NULL) FreeAACdynamic_RAM(&hAacEnc->dynamic_RAM);
 
+  FDKaacEnc_MtClose(&hAacEnc->hMt);
+  for (int w = 1; w < AACENC_MAX_THREADS; w++) {
+    FreeRam_aacEnc_PsyDynamicWorker(&hAacEnc->psyDynamic[w]);
+  }
+
   FDKaacEnc_PsyClose(&hAacEnc->psyKernel, hAacEnc->psyOut);
 
   FDKaacEnc_QCClose(&hAacEnc->qcKernel, hAacEnc->qcOut);
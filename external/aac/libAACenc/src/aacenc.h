@@ -252,6 +252,8 @@ struct AACENC_CONFIG {
   UCHAR useRequant; /* flag: use afterburner */
 
   UINT downscaleFactor;
+
+  INT nThreads; /* number of threads for channel element processing */
 };
 
 typedef struct {
@@ -2244,6 +2244,16 @@ AACENC_ERROR aacEncoder_SetParam(const HANDLE_AACENCODER hAacEncoder,
             AACENC_INIT_CONFIG | AACENC_INIT_STATES | AACENC_INIT_TRANSPORT;
       }
       break;
+    case AACENC_NUM_THREADS:
+      if (hAacEncoder->aacConfig.nThreads != (INT)value) {
+        if (value > 8) {
+          err = AACENC_INVALID_CONFIG;
+          break;
+        }
+        hAacEncoder->aacConfig.nThreads = fixMax((INT)value, 1);
+        hAacEncoder->InitFlags |= AACENC_INIT_CONFIG;
+      }
+      break;
     case AACENC_AFTERBURNER:
       if (settings->userAfterburner != value) {
         if (!((value == 0) || (value == 1))) {
@@ -2455,6 +2465,9 @@ UINT aacEncoder_GetParam(const HANDLE_AACENCODER hAacEncoder,
     case AACENC_AFTERBURNER:
       value = (UINT)hAacEncoder->aacConfig.useRequant;
       break;
+    case AACENC_NUM_THREADS:
+      value = (UINT)hAacEncoder->aacConfig.nThreads;
+      break;
     case AACENC_GRANULE_LENGTH:
       value = (UINT)hAacEncoder->aacConfig.framelength;
       break;
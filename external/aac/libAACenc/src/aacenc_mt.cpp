@@ -0,0 +1,287 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/**************************** AAC encoder library ******************************
+
+   Description: Worker pool for parallel channel element processing
+
+*******************************************************************************/
+
+#include "aacenc_mt.h"
+
+#include "genericStds.h"
+
+#if defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+#define AACENC_MT_PTHREAD
+#include <pthread.h>
+#endif
+
+#define AACENC_MT_MAX_JOBS ((8))
+
+#ifdef AACENC_MT_PTHREAD
+typedef struct {
+  struct AACENC_MT *hMt;
+  INT worker;
+} AACENC_MT_WORKER;
+#endif
+
+struct AACENC_MT {
+  INT nThreads; /* number of workers including the calling thread */
+
+  AACENC_MT_JOB job; /* job of the current run */
+  void *ctx;         /* context of the current run */
+  INT nJobs;         /* number of jobs of the current run */
+
+  AAC_ENCODER_ERROR err[AACENC_MT_MAX_JOBS]; /* per job result */
+
+#ifdef AACENC_MT_PTHREAD
+  pthread_t thread[AACENC_MAX_THREADS];
+  AACENC_MT_WORKER worker[AACENC_MAX_THREADS];
+  pthread_mutex_t lock;
+  pthread_cond_t start; /* signalled when a new run is posted */
+  pthread_cond_t done;  /* signalled when the last worker finished */
+  UINT generation;      /* run counter, wakes up the workers */
+  INT nPending;         /* spawned workers still busy with current run */
+  INT quit;
+#endif
+};
+
+static void FDKaacEnc_MtWork(HANDLE_AACENC_MT hMt, const INT worker) {
+  INT el;
+
+  for (el = worker; el < hMt->nJobs; el += hMt->nThreads) {
+    hMt->err[el] = hMt->job(hMt->ctx, el, worker);
+  }
+}
+
+#ifdef AACENC_MT_PTHREAD
+static void *FDKaacEnc_MtThread(void *arg) {
+  AACENC_MT_WORKER *pWorker = (AACENC_MT_WORKER *)arg;
+  HANDLE_AACENC_MT hMt = pWorker->hMt;
+  UINT seen = 0;
+
+  pthread_mutex_lock(&hMt->lock);
+  for (;;) {
+    while ((hMt->generation == seen) && !hMt->quit) {
+      pthread_cond_wait(&hMt->start, &hMt->lock);
+    }
+    if (hMt->quit) break;
+    seen = hMt->generation;
+    pthread_mutex_unlock(&hMt->lock);
+
+    FDKaacEnc_MtWork(hMt, pWorker->worker);
+
+    pthread_mutex_lock(&hMt->lock);
+    if (--hMt->nPending == 0) {
+      pthread_cond_signal(&hMt->done);
+    }
+  }
+  pthread_mutex_unlock(&hMt->lock);
+
+  return NULL;
+}
+#endif
+
+AAC_ENCODER_ERROR FDKaacEnc_MtOpen(HANDLE_AACENC_MT *phMt, const INT nThreads) {
+  HANDLE_AACENC_MT hMt;
+
+  hMt = (HANDLE_AACENC_MT)FDKcalloc(1, sizeof(struct AACENC_MT));
+  if (hMt == NULL) {
+    return AAC_ENC_NO_MEMORY;
+  }
+  hMt->nThreads = 1;
+
+#ifdef AACENC_MT_PTHREAD
+  pthread_mutex_init(&hMt->lock, NULL);
+  pthread_cond_init(&hMt->start, NULL);
+  pthread_cond_init(&hMt->done, NULL);
+
+  {
+    INT w, nRequested = fixMin(fixMax(nThreads, 1), AACENC_MAX_THREADS);
+
+    for (w = 1; w < nRequested; w++) {
+      hMt->worker[w].hMt = hMt;
+      hMt->worker[w].worker = w;
+      if (pthread_create(&hMt->thread[w], NULL, FDKaacEnc_MtThread,
+                         &hMt->worker[w]) != 0) {
+        break; /* continue with the workers we have */
+      }
+      hMt->nThreads++;
+    }
+  }
+#endif
+
+  *phMt = hMt;
+
+  return AAC_ENC_OK;
+}
+
+INT FDKaacEnc_MtGetThreads(const HANDLE_AACENC_MT hMt) {
+  return (hMt != NULL) ? hMt->nThreads : 1;
+}
+
+AAC_ENCODER_ERROR FDKaacEnc_MtRun(HANDLE_AACENC_MT hMt, AACENC_MT_JOB job,
+                                  void *ctx, const INT nJobs) {
+  INT el;
+
+  /* err[] only has room for AACENC_MT_MAX_JOBS results */
+  if ((hMt == NULL) || (hMt->nThreads <= 1) || (nJobs <= 1) ||
+      (nJobs > AACENC_MT_MAX_JOBS)) {
+    for (el = 0; el < nJobs; el++) {
+      AAC_ENCODER_ERROR ErrorStatus = job(ctx, el, 0);
+      if (ErrorStatus != AAC_ENC_OK) return ErrorStatus;
+    }
+    return AAC_ENC_OK;
+  }
+
+  hMt->job = job;
+  hMt->ctx = ctx;
+  hMt->nJobs = nJobs;
+
+#ifdef AACENC_MT_PTHREAD
+  pthread_mutex_lock(&hMt->lock);
+  hMt->nPending = hMt->nThreads - 1;
+  hMt->generation++;
+  pthread_cond_broadcast(&hMt->start);
+  pthread_mutex_unlock(&hMt->lock);
+#endif
+
+  /* the calling thread is worker 0 */
+  FDKaacEnc_MtWork(hMt, 0);
+
+#ifdef AACENC_MT_PTHREAD
+  pthread_mutex_lock(&hMt->lock);
+  while (hMt->nPending > 0) {
+    pthread_cond_wait(&hMt->done, &hMt->lock);
+  }
+  pthread_mutex_unlock(&hMt->lock);
+#endif
+
+  for (el = 0; el < nJobs; el++) {
+    if (hMt->err[el] != AAC_ENC_OK) return hMt->err[el];
+  }
+
+  return AAC_ENC_OK;
+}
+
+void FDKaacEnc_MtClose(HANDLE_AACENC_MT *phMt) {
+  HANDLE_AACENC_MT hMt;
+
+  if ((phMt == NULL) || (*phMt == NULL)) {
+    return;
+  }
+  hMt = *phMt;
+
+#ifdef AACENC_MT_PTHREAD
+  {
+    INT w;
+
+    pthread_mutex_lock(&hMt->lock);
+    hMt->quit = 1;
+    pthread_cond_broadcast(&hMt->start);
+    pthread_mutex_unlock(&hMt->lock);
+
+    for (w = 1; w < hMt->nThreads; w++) {
+      pthread_join(hMt->thread[w], NULL);
+    }
+
+    pthread_cond_destroy(&hMt->done);
+    pthread_cond_destroy(&hMt->start);
+    pthread_mutex_destroy(&hMt->lock);
+  }
+#endif
+
+  FDKfree(hMt);
+  *phMt = NULL;
+}
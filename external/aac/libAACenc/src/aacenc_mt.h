@@ -0,0 +1,169 @@
+/* -----------------------------------------------------------------------------
+Software License for The Fraunhofer FDK AAC Codec Library for Android
+
+© Copyright  1995 - 2018 Fraunhofer-Gesellschaft zur Förderung der angewandten
+Forschung e.V. All rights reserved.
+
+ 1.    INTRODUCTION
+The Fraunhofer FDK AAC Codec Library for Android ("FDK AAC Codec") is software
+that implements the MPEG Advanced Audio Coding ("AAC") encoding and decoding
+scheme for digital audio. This FDK AAC Codec software is intended to be used on
+a wide variety of Android devices.
+
+AAC's HE-AAC and HE-AAC v2 versions are regarded as today's most efficient
+general perceptual audio codecs. AAC-ELD is considered the best-performing
+full-bandwidth communications codec by independent studies and is widely
+deployed. AAC has been standardized by ISO and IEC as part of the MPEG
+specifications.
+
+Patent licenses for necessary patent claims for the FDK AAC Codec (including
+those of Fraunhofer) may be obtained through Via Licensing
+(www.vialicensing.com) or through the respective patent owners individually for
+the purpose of encoding or decoding bit streams in products that are compliant
+with the ISO/IEC MPEG audio standards. Please note that most manufacturers of
+Android devices already license these patent claims through Via Licensing or
+directly from the patent owners, and therefore FDK AAC Codec software may
+already be covered under those patent licenses when it is used for those
+licensed purposes only.
+
+Commercially-licensed AAC software libraries, including floating-point versions
+with enhanced sound quality, are also available from Fraunhofer. Users are
+encouraged to check the Fraunhofer website for additional applications
+information and documentation.
+
+2.    COPYRIGHT LICENSE
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted without payment of copyright license fees provided that you
+satisfy the following conditions:
+
+You must retain the complete text of this software license in redistributions of
+the FDK AAC Codec or your modifications thereto in source code form.
+
+You must retain the complete text of this software license in the documentation
+and/or other materials provided with redistributions of the FDK AAC Codec or
+your modifications thereto in binary form. You must make available free of
+charge copies of the complete source code of the FDK AAC Codec and your
+modifications thereto to recipients of copies in binary form.
+
+The name of Fraunhofer may not be used to endorse or promote products derived
+from this library without prior written permission.
+
+You may not charge copyright license fees for anyone to use, copy or distribute
+the FDK AAC Codec software or your modifications thereto.
+
+Your modified versions of the FDK AAC Codec must carry prominent notices stating
+that you changed the software and the date of any change. For modified versions
+of the FDK AAC Codec, the term "Fraunhofer FDK AAC Codec Library for Android"
+must be replaced by the term "Third-Party Modified Version of the Fraunhofer FDK
+AAC Codec Library for Android."
+
+3.    NO PATENT LICENSE
+
+NO EXPRESS OR IMPLIED LICENSES TO ANY PATENT CLAIMS, including without
+limitation the patents of Fraunhofer, ARE GRANTED BY THIS SOFTWARE LICENSE.
+Fraunhofer provides no warranty of patent non-infringement with respect to this
+software.
+
+You may use this FDK AAC Codec software or modifications thereto only for
+purposes that are authorized by appropriate patent licenses.
+
+4.    DISCLAIMER
+
+This FDK AAC Codec software is provided by Fraunhofer on behalf of the copyright
+holders and contributors "AS IS" and WITHOUT ANY EXPRESS OR IMPLIED WARRANTIES,
+including but not limited to the implied warranties of merchantability and
+fitness for a particular purpose. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE for any direct, indirect, incidental, special, exemplary,
+or consequential damages, including but not limited to procurement of substitute
+goods or services; loss of use, data, or profits, or business interruption,
+however caused and on any theory of liability, whether in contract, strict
+liability, or tort (including negligence), arising in any way out of the use of
+this software, even if advised of the possibility of such damage.
+
+5.    CONTACT INFORMATION
+
+Fraunhofer Institute for Integrated Circuits IIS
+Attention: Audio and Multimedia Departments - FDK AAC LL
+Am Wolfsmantel 33
+91058 Erlangen, Germany
+
+www.iis.fraunhofer.de/amm
+amm-info@iis.fraunhofer.de
+----------------------------------------------------------------------------- */
+
+/**************************** AAC encoder library ******************************
+
+   Description: Worker pool for parallel channel element processing
+
+*******************************************************************************/
+
+#ifndef AACENC_MT_H
+#define AACENC_MT_H
+
+#include "common_fix.h"
+
+#include "aacenc.h"
+
+/**
+ * Maximum number of threads (including the calling thread) used for channel
+ * element processing. More threads than channel elements are never useful.
+ */
+#define AACENC_MAX_THREADS ((8))
+
+typedef struct AACENC_MT *HANDLE_AACENC_MT;
+
+/**
+ * \brief Job callback executed once per channel element.
+ *
+ * \param ctx     Caller context passed to FDKaacEnc_MtRun().
+ * \param el      Channel element index, 0 <= el < nJobs.
+ * \param worker  Index of the executing worker, 0 <= worker < nThreads. Each
+ *                worker index is used by exactly one thread at a time and may
+ *                therefore select per-worker scratch memory.
+ * \return        AAC_ENC_OK on success, error code otherwise.
+ */
+typedef AAC_ENCODER_ERROR (*AACENC_MT_JOB)(void *ctx, const INT el,
+                                           const INT worker);
+
+/**
+ * \brief Create a worker pool.
+ *
+ * The calling thread always acts as worker 0, so nThreads-1 additional threads
+ * are spawned. If the platform provides no threads or thread creation fails,
+ * the pool silently degrades to fewer workers (down to serial execution).
+ *
+ * \param phMt      Pointer to pool handle, initialized on return.
+ * \param nThreads  Requested number of workers, limited to AACENC_MAX_THREADS.
+ * \return          AAC_ENC_OK on success, AAC_ENC_NO_MEMORY otherwise.
+ */
+AAC_ENCODER_ERROR FDKaacEnc_MtOpen(HANDLE_AACENC_MT *phMt, const INT nThreads);
+
+/**
+ * \brief Number of workers actually available in the pool.
+ */
+INT FDKaacEnc_MtGetThreads(const HANDLE_AACENC_MT hMt);
+
+/**
+ * \brief Run job for all elements 0..nJobs-1 and wait for completion.
+ *
+ * Jobs are statically assigned to workers (el modulo nThreads), so the
+ * scheduling does not depend on timing. If several jobs fail, the error of the
+ * lowest element index is returned, which equals the error the sequential loop
+ * would have reported.
+ *
+ * \param hMt    Pool handle, may be NULL for sequential execution.
+ * \param job    Job callback.
+ * \param ctx    Context forwarded to the callback.
+ * \param nJobs  Number of jobs. More than ((8)) are run sequentially.
+ * \return       AAC_ENC_OK or the first error in element order.
+ */
+AAC_ENCODER_ERROR FDKaacEnc_MtRun(HANDLE_AACENC_MT hMt, AACENC_MT_JOB job,
+                                  void *ctx, const INT nJobs);
+
+/**
+ * \brief Stop all workers and free the pool.
+ */
+void FDKaacEnc_MtClose(HANDLE_AACENC_MT *phMt);
+
+#endif /* AACENC_MT_H */
@@ -785,8 +785,35 @@ static AAC_ENCODER_ERROR FDKaacEnc_BitResRedistribution(
   return AAC_ENC_OK;
 }
 
-AAC_ENCODER_ERROR FDKaacEnc_QCMain(QC_STATE* RESTRICT hQC, PSY_OUT** psyOut,
-                                   QC_OUT** qcOut, INT avgTotalBits,
+typedef struct {
+  PSY_OUT_ELEMENT** psyOutElement;
+  QC_OUT_ELEMENT** qcElement;
+  CHANNEL_MAPPING* cm;
+  INT invQuant;
+  INT dZoneQuantEnable;
+} QC_SCF_JOB;
+
+/* Turn thresholds into scalefactors of one channel element. */
+static AAC_ENCODER_ERROR FDKaacEnc_EstimateScaleFactorsJob(void* ctx,
+                                                           const INT el,
+                                                           const INT worker) {
+  QC_SCF_JOB* scfJob = (QC_SCF_JOB*)ctx;
+  ELEMENT_INFO* elInfo = &scfJob->cm->elInfo[el];
+
+  if ((elInfo->elType == ID_SCE) || (elInfo->elType == ID_CPE) ||
+      (elInfo->elType == ID_LFE)) {
+    FDKaacEnc_EstimateScaleFactors(
+        scfJob->psyOutElement[el]->psyOutChannel,
+        scfJob->qcElement[el]->qcOutChannel, scfJob->invQuant,
+        scfJob->dZoneQuantEnable, elInfo->nChannelsInEl);
+  }
+
+  return AAC_ENC_OK;
+}
+
+AAC_ENCODER_ERROR FDKaacEnc_QCMain(QC_STATE* RESTRICT hQC, HANDLE_AACENC_MT hMt,
+                                   PSY_OUT** psyOut, QC_OUT** qcOut,
+                                   INT avgTotalBits,
                                    CHANNEL_MAPPING* cm,
                                    const AUDIO_OBJECT_TYPE aot,
                                    UINT syntaxFlags, SCHAR epConfig) {
@@ -859,19 +886,28 @@ AAC_ENCODER_ERROR FDKaacEnc_QCMain(QC_STATE* RESTRICT hQC, PSY_OUT** psyOut,
 
   /* for ( all sub frames ) ... */
   for (c = 0; c < nSubFrames; c++) {
+    /* Turn thresholds into scalefactors, optimize bit consumption and verify
+     * conformance. Elements are independent, estimate them in parallel. */
+    QC_SCF_JOB scfJob;
+
+    scfJob.psyOutElement = psyOut[c]->psyOutElement;
+    scfJob.qcElement = qcElement[c];
+    scfJob.cm = cm;
+    scfJob.invQuant = hQC->invQuant;
+    scfJob.dZoneQuantEnable = hQC->dZoneQuantEnable;
+
+    ErrorStatus = FDKaacEnc_MtRun(hMt, FDKaacEnc_EstimateScaleFactorsJob,
+                                  &scfJob, cm->nElements);
+    if (ErrorStatus != AAC_ENC_OK) {
+      return ErrorStatus;
+    }
+
     for (i = 0; i < cm->nElements; i++) {
       ELEMENT_INFO elInfo = cm->elInfo[i];
       INT ch, nChannels = elInfo.nChannelsInEl;
 
       if ((elInfo.elType == ID_SCE) || (elInfo.elType == ID_CPE) ||
           (elInfo.elType == ID_LFE)) {
-        /* Turn thresholds into scalefactors, optimize bit consumption and
-         * verify conformance */
-        FDKaacEnc_EstimateScaleFactors(
-            psyOut[c]->psyOutElement[i]->psyOutChannel,
-            qcElement[c][i]->qcOutChannel, hQC->invQuant, hQC->dZoneQuantEnable,
-            cm->elInfo[i].nChannelsInEl);
-
         /*-------------------------------------------- */
         constraintsFulfilled[c][i] = 1;
         iterations[c][i] = 0;
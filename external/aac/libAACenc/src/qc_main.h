@@ -108,6 +108,7 @@ amm-info@iis.fraunhofer.de
 #include "interface.h"
 #include "psy_main.h"
 #include "tpenc_lib.h"
+#include "aacenc_mt.h"
 
 /* Quantizing & coding stage */
 
@@ -130,8 +131,9 @@ AAC_ENCODER_ERROR FDKaacEnc_QCMainPrepare(
     QC_OUT_ELEMENT *RESTRICT qcOutElement, /* returns error code       */
     AUDIO_OBJECT_TYPE aot, UINT syntaxFlags, SCHAR epConfig);
 
-AAC_ENCODER_ERROR FDKaacEnc_QCMain(QC_STATE *RESTRICT hQC, PSY_OUT **psyOut,
-                                   QC_OUT **qcOut, INT avgTotalBits,
+AAC_ENCODER_ERROR FDKaacEnc_QCMain(QC_STATE *RESTRICT hQC, HANDLE_AACENC_MT hMt,
+                                   PSY_OUT **psyOut, QC_OUT **qcOut,
+                                   INT avgTotalBits,
                                    CHANNEL_MAPPING *cm, AUDIO_OBJECT_TYPE aot,
                                    UINT syntaxFlags, SCHAR epConfig);
 
@@ -0,0 +1,181 @@
+/* Address range index for libdwfl.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+
+/* A range boundary, sorted by address and then by range index.  */
+struct boundary
+{
+  GElf_Addr addr;
+  size_t idx;
+};
+
+static int
+compare_boundaries (const void *a, const void *b)
+{
+  const struct boundary *l = a;
+  const struct boundary *r = b;
+  if (l->addr != r->addr)
+    return l->addr < r->addr ? -1 : 1;
+  if (l->idx != r->idx)
+    return l->idx < r->idx ? -1 : 1;
+  return 0;
+}
+
+/* Return the position of IDX in the sorted ACTIVE array, or where it
+   should be inserted.  */
+static size_t
+active_pos (const size_t *active, size_t nactive, size_t idx)
+{
+  size_t l = 0, u = nactive;
+  while (l < u)
+    {
+      size_t m = (l + u) / 2;
+      if (active[m] < idx)
+	l = m + 1;
+      else
+	u = m;
+    }
+  return l;
+}
+
+bool
+internal_function
+__libdwfl_addrindex_build (const struct dwfl_addrindex_range *ranges,
+			   size_t n, bool (*better) (size_t, size_t, void *),
+			   void *arg, struct dwfl_addrindex_seg **segsp,
+			   size_t *nsegsp)
+{
+  *segsp = NULL;
+  *nsegsp = 0;
+  if (n == 0)
+    return true;
+
+  struct boundary *starts = malloc (n * sizeof *starts);
+  struct boundary *ends = malloc (n * sizeof *ends);
+  size_t *active = malloc (n * sizeof *active);
+  size_t maxsegs = n + 1;
+  struct dwfl_addrindex_seg *segs = malloc (maxsegs * sizeof *segs);
+  if (unlikely (starts == NULL || ends == NULL || active == NULL
+		|| segs == NULL))
+    goto fail;
+
+  size_t nstarts = 0, nends = 0;
+  for (size_t i = 0; i < n; ++i)
+    if (ranges[i].start < ranges[i].end)
+      {
+	starts[nstarts++] = (struct boundary) { ranges[i].start, i };
+	ends[nends++] = (struct boundary) { ranges[i].end, i };
+      }
+  qsort (starts, nstarts, sizeof *starts, compare_boundaries);
+  qsort (ends, nends, sizeof *ends, compare_boundaries);
+
+  /* Sweep over all boundaries, keeping the ranges covering the current
+     address in ACTIVE in array order.  Deeply nested or stacked ranges
+     make this quadratic, give up when it gets out of hand.  */
+  size_t budget = 64 * n + 65536;
+  size_t nactive = 0, nsegs = 0;
+  size_t si = 0, ei = 0;
+  while (si < nstarts || ei < nends)
+    {
+      GElf_Addr addr = (si < nstarts && starts[si].addr < ends[ei].addr
+			? starts[si].addr : ends[ei].addr);
+
+      for (; ei < nends && ends[ei].addr == addr; ++ei)
+	{
+	  size_t pos = active_pos (active, nactive, ends[ei].idx);
+	  memmove (&active[pos], &active[pos + 1],
+		   (--nactive - pos) * sizeof *active);
+	}
+      for (; si < nstarts && starts[si].addr == addr; ++si)
+	{
+	  size_t pos = active_pos (active, nactive, starts[si].idx);
+	  memmove (&active[pos + 1], &active[pos],
+		   (nactive++ - pos) * sizeof *active);
+	  active[pos] = starts[si].idx;
+	}
+
+      if (nactive > budget)
+	goto fail;
+      budget -= nactive;
+
+      size_t winner = (size_t) -1;
+      for (size_t i = 0; i < nactive; ++i)
+	if (winner == (size_t) -1 || better (active[i], winner, arg))
+	  winner = active[i];
+
+      if (nsegs > 0 && segs[nsegs - 1].winner == winner)
+	continue;
+      if (nsegs == maxsegs)
+	{
+	  maxsegs *= 2;
+	  struct dwfl_addrindex_seg *newsegs
+	    = realloc (segs, maxsegs * sizeof *segs);
+	  if (unlikely (newsegs == NULL))
+	    goto fail;
+	  segs = newsegs;
+	}
+      segs[nsegs++] = (struct dwfl_addrindex_seg) { addr, winner };
+    }
+
+  free (starts);
+  free (ends);
+  free (active);
+  *segsp = segs;
+  *nsegsp = nsegs;
+  return true;
+
+ fail:
+  free (starts);
+  free (ends);
+  free (active);
+  free (segs);
+  return false;
+}
+
+size_t
+internal_function
+__libdwfl_addrindex_find (const struct dwfl_addrindex_seg *segs,
+			  size_t nsegs, GElf_Addr addr)
+{
+  /* Find the last segment starting at or before ADDR.  */
+  size_t l = 0, u = nsegs;
+  while (l < u)
+    {
+      size_t m = (l + u) / 2;
+      if (segs[m].start <= addr)
+	l = m + 1;
+      else
+	u = m;
+    }
+  return l == 0 ? (size_t) -1 : segs[l - 1].winner;
+}
@@ -68,6 +68,12 @@ __libdwfl_module_free (Dwfl_Module *mod)
   if (mod->aranges != NULL)
     free (mod->aranges);
 
+  for (size_t i = 0; i < 2; ++i)
+    if (mod->symindex[i] != NULL && mod->symindex[i] != (void *) -1l)
+      __libdwfl_free_symindex (mod->symindex[i]);
+  if (mod->scopeindex != NULL)
+    __libdwfl_free_scopeindex (mod->scopeindex);
+
   if (mod->cu != NULL)
     {
       for (size_t i = 0; i < mod->ncu; ++i)
@@ -105,6 +111,10 @@ __libdwfl_module_free (Dwfl_Module *mod)
 	}
     }
 
+  /* The CFI search tables pointed into the cache, so it goes last.  */
+  if (mod->symcache != NULL)
+    __libdwfl_free_symcache (mod->symcache);
+
   if (mod->ebl != NULL)
     ebl_closebackend (mod->ebl);
 
@@ -0,0 +1,237 @@
+/* Bulk address lookups in a module.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+#include <dwarf.h>
+
+/* Sorted index of the address ranges of all function scopes in the
+   module's DWARF, relative to its bias.  When the ranges overlap too
+   much to be indexed, RANGES is kept instead of SEGS and searched.  */
+struct dwfl_scopeindex
+{
+  Dwarf_Die *dies;		/* One for every range.  */
+  unsigned int *depths;
+  struct dwfl_addrindex_seg *segs;
+  size_t nsegs;
+  struct dwfl_addrindex_range *ranges;
+  size_t nranges;
+};
+
+struct scope_collector
+{
+  Dwarf_Die *dies;
+  unsigned int *depths;
+  struct dwfl_addrindex_range *ranges;
+  size_t n;
+  size_t max;
+};
+
+void
+internal_function
+__libdwfl_free_scopeindex (struct dwfl_scopeindex *index)
+{
+  free (index->dies);
+  free (index->depths);
+  free (index->segs);
+  free (index->ranges);
+  free (index);
+}
+
+/* Deeper scopes are further inside.  */
+static bool
+scope_better (size_t a, size_t b, void *arg)
+{
+  const unsigned int *depths = arg;
+  return depths[a] > depths[b];
+}
+
+static bool
+add_scope (struct scope_collector *c, Dwarf_Die *die, unsigned int depth)
+{
+  Dwarf_Addr base, start, end;
+  ptrdiff_t offset = 0;
+  while ((offset = INTUSE(dwarf_ranges) (die, offset, &base,
+					 &start, &end)) > 0)
+    {
+      if (c->n == c->max)
+	{
+	  c->max = 2 * c->max + 256;
+	  Dwarf_Die *dies = realloc (c->dies, c->max * sizeof dies[0]);
+	  if (unlikely (dies == NULL))
+	    return false;
+	  c->dies = dies;
+	  unsigned int *depths = realloc (c->depths,
+					  c->max * sizeof depths[0]);
+	  if (unlikely (depths == NULL))
+	    return false;
+	  c->depths = depths;
+	  struct dwfl_addrindex_range *ranges
+	    = realloc (c->ranges, c->max * sizeof ranges[0]);
+	  if (unlikely (ranges == NULL))
+	    return false;
+	  c->ranges = ranges;
+	}
+      c->dies[c->n] = *die;
+      c->depths[c->n] = depth;
+      c->ranges[c->n].start = start;
+      c->ranges[c->n].end = end;
+      ++c->n;
+    }
+  return true;
+}
+
+static bool
+collect_scopes (struct scope_collector *c, Dwarf_Die *parent,
+		unsigned int depth)
+{
+  Dwarf_Die child;
+  int res = INTUSE(dwarf_child) (parent, &child);
+  while (res == 0)
+    {
+      int tag = INTUSE(dwarf_tag) (&child);
+      if ((tag == DW_TAG_subprogram || tag == DW_TAG_inlined_subroutine)
+	  && ! add_scope (c, &child, depth))
+	return false;
+
+      if (INTUSE(dwarf_haschildren) (&child)
+	  && ! collect_scopes (c, &child, depth + 1))
+	return false;
+
+      res = INTUSE(dwarf_siblingof) (&child, &child);
+    }
+  /* Just index what we could read of a broken tree.  */
+  return true;
+}
+
+static struct dwfl_scopeindex *
+scopeindex_build (Dwfl_Module *mod)
+{
+  struct scope_collector c = { NULL, NULL, NULL, 0, 0 };
+  struct dwfl_scopeindex *index = calloc (1, sizeof *index);
+  if (unlikely (index == NULL))
+    return NULL;
+
+  struct dwfl_cu *cu = NULL;
+  while (__libdwfl_nextcu (mod, cu, &cu) == DWFL_E_NOERROR && cu != NULL)
+    if (! collect_scopes (&c, &cu->die, 1))
+      goto fail;
+
+  if (__libdwfl_addrindex_build (c.ranges, c.n, scope_better, c.depths,
+				 &index->segs, &index->nsegs))
+    free (c.ranges);
+  else
+    {
+      index->ranges = c.ranges;
+      index->nranges = c.n;
+    }
+
+  index->dies = c.dies;
+  index->depths = c.depths;
+  return index;
+
+ fail:
+  free (c.dies);
+  free (c.depths);
+  free (c.ranges);
+  free (index);
+  return NULL;
+}
+
+/* Returns NULL if out of memory, the next call tries again.  */
+static struct dwfl_scopeindex *
+module_scopeindex (Dwfl_Module *mod)
+{
+  if (mod->scopeindex == NULL)
+    mod->scopeindex = scopeindex_build (mod);
+  return mod->scopeindex;
+}
+
+/* The innermost scope containing ADDR, or -1.  */
+static size_t
+scopeindex_find (const struct dwfl_scopeindex *index, Dwarf_Addr addr)
+{
+  if (index->ranges == NULL)
+    return __libdwfl_addrindex_find (index->segs, index->nsegs, addr);
+
+  /* Same choice as the index: the first of the deepest ranges.  */
+  size_t winner = (size_t) -1;
+  for (size_t i = 0; i < index->nranges; ++i)
+    if (index->ranges[i].start <= addr && addr < index->ranges[i].end
+	&& (winner == (size_t) -1
+	    || scope_better (i, winner, index->depths)))
+      winner = i;
+  return winner;
+}
+
+int
+dwfl_module_addrinfo_batch (Dwfl_Module *mod, const GElf_Addr *addrs,
+			    size_t naddrs, Dwfl_Addrinfo *infos)
+{
+  if (mod == NULL)
+    return -1;
+
+  /* Without a symbol table or DWARF the lookups below just come up
+     empty.  */
+  __libdwfl_addrsym_index (mod);
+  Dwarf_Addr bias;
+  Dwarf *dw = INTUSE(dwfl_module_getdwarf) (mod, &bias);
+  struct dwfl_scopeindex *scopes = NULL;
+  if (dw != NULL)
+    {
+      scopes = module_scopeindex (mod);
+      if (unlikely (scopes == NULL))
+	{
+	  __libdwfl_seterrno (DWFL_E_NOMEM);
+	  return -1;
+	}
+    }
+
+  for (size_t i = 0; i < naddrs; ++i)
+    {
+      Dwfl_Addrinfo *info = &infos[i];
+      info->name = INTUSE(dwfl_module_addrinfo) (mod, addrs[i],
+						 &info->offset, &info->sym,
+						 &info->shndx, &info->elf,
+						 &info->bias);
+      info->line = dw != NULL ? INTUSE(dwfl_module_getsrc) (mod, addrs[i])
+			      : NULL;
+      info->scope = NULL;
+      if (scopes != NULL)
+	{
+	  size_t winner = scopeindex_find (scopes, addrs[i] - bias);
+	  if (winner != (size_t) -1)
+	    info->scope = &scopes->dies[winner];
+	}
+    }
+
+  return 0;
+}
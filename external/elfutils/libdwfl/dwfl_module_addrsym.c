@@ -234,6 +234,314 @@ search_table (struct search_state *state, int start, int end)
 	}
 }
 
+/* Number of lookups in a module after which the symbol index is built.  */
+#define SYMINDEX_MIN_LOOKUPS 16
+
+/* A candidate value for a symbol with a nonzero size, as tried by
+   search_table.  ADJUSTED is set for the adjusted st_value variant.  */
+struct dwfl_symindex_sym
+{
+  GElf_Addr value;
+  GElf_Xword size;
+  int ndx;
+  int binding;
+  bool adjusted;
+};
+
+/* The highest end of the symbols starting at or below VALUE.  */
+struct dwfl_symindex_bound
+{
+  GElf_Addr value;
+  GElf_Addr maxend;
+};
+
+/* Sorted index of the address ranges covered by the sized symbols.
+   For every address range it has the symbol search_table would pick
+   from the globals and from the locals.  Lookups only fall back to
+   the full search when the answer depends on sizeless symbols.  */
+struct dwfl_symindex
+{
+  struct dwfl_symindex_sym *syms;
+  struct dwfl_addrindex_seg *globals;
+  size_t nglobals;
+  struct dwfl_addrindex_seg *locals;
+  size_t nlocals;
+
+  /* Sorted values of the sizeless global symbols.  */
+  GElf_Addr *global_labels;
+  size_t nglobal_labels;
+
+  /* Sorted values of all sizeless symbols.  */
+  GElf_Addr *labels;
+  size_t nlabels;
+
+  /* Running maximum of the symbol ends, the min_label of search_state
+     for addresses not covered by any sized symbol.  */
+  struct dwfl_symindex_bound *bounds;
+  size_t nbounds;
+};
+
+/* The try_sym_value preference between two symbols that both contain
+   the address.  */
+static bool
+symindex_better (size_t a, size_t b, void *arg)
+{
+  const struct dwfl_symindex_sym *syms = arg;
+  const struct dwfl_symindex_sym *sym = &syms[a];
+  const struct dwfl_symindex_sym *closest = &syms[b];
+
+  if (closest->value < sym->value || closest->binding < sym->binding)
+    return true;
+  return (closest->value == sym->value
+	  && ((closest->size > sym->size
+	       && closest->binding <= sym->binding)
+	      || (closest->size >= sym->size
+		  && closest->binding < sym->binding)));
+}
+
+static int
+compare_addr (const void *a, const void *b)
+{
+  GElf_Addr l = *(const GElf_Addr *) a;
+  GElf_Addr r = *(const GElf_Addr *) b;
+  return l < r ? -1 : l > r;
+}
+
+/* Return the number of elements of the sorted array of N elements of
+   SIZE bytes at BASE whose first GElf_Addr is at or below ADDR.  */
+static size_t
+count_at_or_below (const void *base, size_t n, size_t size, GElf_Addr addr)
+{
+  size_t l = 0, u = n;
+  while (l < u)
+    {
+      size_t m = (l + u) / 2;
+      if (*(const GElf_Addr *) ((const char *) base + m * size) <= addr)
+	l = m + 1;
+      else
+	u = m;
+    }
+  return l;
+}
+
+void
+internal_function
+__libdwfl_free_symindex (struct dwfl_symindex *index)
+{
+  free (index->syms);
+  free (index->globals);
+  free (index->locals);
+  free (index->global_labels);
+  free (index->labels);
+  free (index->bounds);
+  free (index);
+}
+
+/* Collect the values search_table would try for the symbols [START, END)
+   into INDEX->syms and RANGES (sized) or INDEX->labels (sizeless), and
+   all of them into INDEX->bounds.  There is room for two values per
+   symbol.  */
+static void
+symindex_collect (Dwfl_Module *mod, struct dwfl_symindex *index,
+		  struct dwfl_addrindex_range *ranges, size_t *nsyms,
+		  int start, int end, bool adjust_st_value)
+{
+  for (int i = start; i < end; ++i)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      GElf_Word shndx;
+      Elf *elf;
+      bool resolved;
+      const char *name = __libdwfl_getsym (mod, i, &sym, &value, &shndx,
+					   &elf, NULL, &resolved,
+					   adjust_st_value);
+      if (name == NULL || name[0] == '\0'
+	  || sym.st_shndx == SHN_UNDEF
+	  || GELF_ST_TYPE (sym.st_info) == STT_SECTION
+	  || GELF_ST_TYPE (sym.st_info) == STT_FILE
+	  || GELF_ST_TYPE (sym.st_info) == STT_TLS)
+	continue;
+
+      GElf_Addr values[2] = { value, value };
+      int nvalues = 1;
+      if (resolved && mod->e_type != ET_REL)
+	{
+	  values[1] = dwfl_adjusted_st_value (mod, elf, sym.st_value);
+	  if (values[1] != value)
+	    nvalues = 2;
+	}
+
+      for (int v = 0; v < nvalues; ++v)
+	{
+	  GElf_Addr symend = (values[v] + sym.st_size < values[v]
+			      ? (GElf_Addr) -1 : values[v] + sym.st_size);
+	  index->bounds[index->nbounds++]
+	    = (struct dwfl_symindex_bound) { values[v], symend };
+
+	  if (sym.st_size == 0)
+	    {
+	      index->labels[index->nlabels++] = values[v];
+	      continue;
+	    }
+
+	  ranges[*nsyms].start = values[v];
+	  ranges[*nsyms].end = symend;
+	  index->syms[*nsyms] = (struct dwfl_symindex_sym)
+	    {
+	      .value = values[v],
+	      .size = sym.st_size,
+	      .ndx = i,
+	      .binding = binding_value (&sym),
+	      .adjusted = v == 1
+	    };
+	  ++*nsyms;
+	}
+    }
+}
+
+static int
+compare_bounds (const void *a, const void *b)
+{
+  const struct dwfl_symindex_bound *l = a;
+  const struct dwfl_symindex_bound *r = b;
+  return l->value < r->value ? -1 : l->value > r->value;
+}
+
+static struct dwfl_symindex *
+symindex_build (Dwfl_Module *mod, int syments, int first_global,
+		bool adjust_st_value)
+{
+  struct dwfl_symindex *index = calloc (1, sizeof *index);
+  if (unlikely (index == NULL))
+    return NULL;
+
+  /* Every symbol can be tried with two values.  */
+  size_t maxvalues = 2 * (size_t) syments;
+  struct dwfl_addrindex_range *ranges = malloc (maxvalues * sizeof ranges[0]);
+  index->syms = malloc (maxvalues * sizeof index->syms[0]);
+  index->labels = malloc (maxvalues * sizeof index->labels[0]);
+  index->bounds = malloc (maxvalues * sizeof index->bounds[0]);
+  if (unlikely (ranges == NULL || index->syms == NULL
+		|| index->labels == NULL || index->bounds == NULL))
+    goto fail;
+
+  /* Same table ranges as __libdwfl_addrsym.  */
+  size_t nglobals = 0;
+  symindex_collect (mod, index, ranges, &nglobals,
+		    first_global == 0 ? 1 : first_global, syments,
+		    adjust_st_value);
+  size_t nglobal_labels = index->nlabels;
+  size_t nsyms = nglobals;
+  if (first_global > 1)
+    symindex_collect (mod, index, ranges, &nsyms, 1, first_global,
+		      adjust_st_value);
+
+  if (! __libdwfl_addrindex_build (ranges, nglobals, symindex_better,
+				   index->syms, &index->globals,
+				   &index->nglobals)
+      || ! __libdwfl_addrindex_build (&ranges[nglobals], nsyms - nglobals,
+				      symindex_better, &index->syms[nglobals],
+				      &index->locals, &index->nlocals))
+    goto fail;
+  for (size_t i = 0; i < index->nlocals; ++i)
+    if (index->locals[i].winner != (size_t) -1)
+      index->locals[i].winner += nglobals;
+
+  index->global_labels = malloc ((nglobal_labels ?: 1)
+				 * sizeof index->global_labels[0]);
+  if (unlikely (index->global_labels == NULL))
+    goto fail;
+  memcpy (index->global_labels, index->labels,
+	  nglobal_labels * sizeof index->labels[0]);
+  index->nglobal_labels = nglobal_labels;
+  qsort (index->global_labels, index->nglobal_labels,
+	 sizeof index->global_labels[0], compare_addr);
+  qsort (index->labels, index->nlabels, sizeof index->labels[0],
+	 compare_addr);
+
+  qsort (index->bounds, index->nbounds, sizeof index->bounds[0],
+	 compare_bounds);
+  for (size_t i = 1; i < index->nbounds; ++i)
+    if (index->bounds[i].maxend < index->bounds[i - 1].maxend)
+      index->bounds[i].maxend = index->bounds[i - 1].maxend;
+
+  free (ranges);
+  return index;
+
+ fail:
+  free (ranges);
+  __libdwfl_free_symindex (index);
+  return NULL;
+}
+
+/* Return the symbol index of MOD for ADJUST_ST_VALUE, building it once
+   the module has seen enough lookups (or right away if FORCE).  */
+static struct dwfl_symindex *
+module_symindex (Dwfl_Module *mod, int syments, int first_global,
+		 bool adjust_st_value, bool force)
+{
+  struct dwfl_symindex **indexp = &mod->symindex[adjust_st_value];
+  if (*indexp == NULL
+      && (force || ++mod->addrsym_lookups >= SYMINDEX_MIN_LOOKUPS))
+    {
+      *indexp = symindex_build (mod, syments, first_global, adjust_st_value);
+      if (*indexp == NULL)
+	*indexp = (void *) -1l;
+    }
+  return *indexp == (void *) -1l ? NULL : *indexp;
+}
+
+/* Look up ADDR in INDEX.  Returns 1 and sets *SYMP to the candidate
+   search_table would end up with, 0 if no symbol would be found and -1
+   if only the full search can tell.  */
+static int
+symindex_lookup (const struct dwfl_symindex *index, GElf_Addr addr,
+		 const struct dwfl_symindex_sym **symp)
+{
+  size_t winner = __libdwfl_addrindex_find (index->globals, index->nglobals,
+					    addr);
+  if (winner != (size_t) -1)
+    {
+      *symp = &index->syms[winner];
+      return 1;
+    }
+
+  /* A sizeless global exactly at ADDR could mean the locals are not
+     searched at all.  */
+  if (bsearch (&addr, index->global_labels, index->nglobal_labels,
+	       sizeof index->global_labels[0], compare_addr) != NULL)
+    return -1;
+
+  winner = __libdwfl_addrindex_find (index->locals, index->nlocals, addr);
+  if (winner != (size_t) -1)
+    {
+      *symp = &index->syms[winner];
+      return 1;
+    }
+
+  /* Nothing with a size contains ADDR.  A sizeless symbol is only used
+     if it is not below the end of any symbol tried.  */
+  size_t nlabels = count_at_or_below (index->labels, index->nlabels,
+				      sizeof index->labels[0], addr);
+  size_t nbounds = count_at_or_below (index->bounds, index->nbounds,
+				      sizeof index->bounds[0], addr);
+  if (nlabels > 0
+      && index->labels[nlabels - 1] >= index->bounds[nbounds - 1].maxend)
+    return -1;
+  return 0;
+}
+
+void
+internal_function
+__libdwfl_addrsym_index (Dwfl_Module *mod)
+{
+  int syments = INTUSE(dwfl_module_getsymtab) (mod);
+  int first_global = INTUSE (dwfl_module_getsymtab_first_global) (mod);
+  if (syments > 0 && first_global >= 0)
+    module_symindex (mod, syments, first_global, false, true);
+}
+
 /* Returns the name of the symbol "closest" to ADDR.
    Never returns symbols at addresses above ADDR.
 
@@ -281,6 +589,42 @@ __libdwfl_addrsym (Dwfl_Module *_mod, GElf_Addr _addr, GElf_Off *off,
   int first_global = INTUSE (dwfl_module_getsymtab_first_global) (state.mod);
   if (first_global < 0)
     return NULL;
+
+  /* Modules with many lookups get an index of the sized symbols.  */
+  struct dwfl_symindex *index = module_symindex (_mod, syments, first_global,
+						 _adjust_st_value, false);
+  const struct dwfl_symindex_sym *found;
+  int indexed = index != NULL ? symindex_lookup (index, _addr, &found) : -1;
+  if (indexed == 1)
+    {
+      Elf *elf;
+      GElf_Word shndx;
+      GElf_Addr value;
+      bool resolved;
+      const char *name = __libdwfl_getsym (_mod, found->ndx, _closest_sym,
+					   &value, &shndx, &elf, NULL,
+					   &resolved, _adjust_st_value);
+      *off = _addr - found->value;
+      if (shndxp != NULL)
+	*shndxp = shndx;
+      if (elfp != NULL)
+	*elfp = elf;
+      if (biasp != NULL)
+	*biasp = dwfl_adjusted_st_value (_mod, elf, 0);
+      return name;
+    }
+  if (indexed == 0)
+    {
+      *off = _addr;
+      if (shndxp != NULL)
+	*shndxp = SHN_UNDEF;
+      if (elfp != NULL)
+	*elfp = NULL;
+      if (biasp != NULL)
+	*biasp = dwfl_adjusted_st_value (_mod, NULL, 0);
+      return NULL;
+    }
+
   search_table (&state, first_global == 0 ? 1 : first_global, syments);
 
   /* If we found nothing searching the global symbols, then try the locals.
@@ -0,0 +1,795 @@
+/* Symbolization cache of a module, keyed by build ID.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <system.h>
+
+#include "libdwflP.h"
+#include "../libdw/cfi.h"
+#include <byteswap.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The cache file is a header followed by flat tables, in the host's
+   byte order and layout so that it is used straight from its mapping.
+   A file written by a different host or version is just rewritten.  */
+
+#define SYMCACHE_MAGIC		"ELFSYMC"
+#define SYMCACHE_VERSION	1
+#define SYMCACHE_BYTE_ORDER	0x01020304
+#define SYMCACHE_MAX_BUILD_ID	64
+
+/* Set in the header when the module had DWARF when the cache was
+   written, so a cache without line tables is not used once it has.  */
+#define SYMCACHE_HAVE_DWARF	1
+
+/* String offset for no string.  */
+#define SYMCACHE_NO_STRING	((uint32_t) -1)
+
+enum
+{
+  SYMCACHE_ARANGES,		/* struct symcache_arange */
+  SYMCACHE_CUS,			/* struct symcache_cu */
+  SYMCACHE_LINES,		/* struct symcache_line */
+  SYMCACHE_STRINGS,		/* char */
+  SYMCACHE_EH_FDES,		/* struct symcache_fde */
+  SYMCACHE_DEBUG_FDES,		/* struct symcache_fde */
+  SYMCACHE_NTABLES
+};
+
+struct symcache_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t flags;
+  uint32_t build_id_len;
+  unsigned char build_id[SYMCACHE_MAX_BUILD_ID];
+  struct
+  {
+    uint64_t offset;
+    uint64_t count;
+  } tables[SYMCACHE_NTABLES];
+};
+
+/* An entry of dwarf_getaranges.  */
+struct symcache_arange
+{
+  uint64_t addr;
+  uint64_t length;
+  uint64_t offset;
+};
+
+/* A CU the aranges refer to, sorted by the offset of its DIE.  */
+struct symcache_cu
+{
+  uint64_t offset;
+  uint64_t first_line;
+  uint64_t nlines;
+  uint32_t comp_dir;
+  uint32_t pad;
+};
+
+/* A row of the line table of a CU, which is sorted by address.  */
+struct symcache_line
+{
+  uint64_t addr;
+  uint32_t file;
+  uint32_t line;
+  uint32_t column;
+  uint32_t end_sequence;
+};
+
+/* An entry of a search table in .eh_frame_hdr format.  Both values are
+   DW_EH_PE_udata8 in the byte order of the CFI.  */
+struct symcache_fde
+{
+  uint64_t start;
+  uint64_t fde;
+};
+
+static const size_t symcache_entsize[SYMCACHE_NTABLES] =
+  {
+    [SYMCACHE_ARANGES] = sizeof (struct symcache_arange),
+    [SYMCACHE_CUS] = sizeof (struct symcache_cu),
+    [SYMCACHE_LINES] = sizeof (struct symcache_line),
+    [SYMCACHE_STRINGS] = 1,
+    [SYMCACHE_EH_FDES] = sizeof (struct symcache_fde),
+    [SYMCACHE_DEBUG_FDES] = sizeof (struct symcache_fde),
+  };
+
+struct dwfl_symcache
+{
+  void *map;
+  size_t size;
+
+  const struct symcache_arange *aranges;
+  size_t naranges;
+  const struct symcache_cu *cus;
+  size_t ncus;
+  const struct symcache_line *lines;
+  size_t nlines;
+  const char *strings;
+  size_t nstrings;
+  const struct symcache_fde *fdes[2];	/* .eh_frame, .debug_frame.  */
+  size_t nfdes[2];
+};
+
+void
+internal_function
+__libdwfl_free_symcache (struct dwfl_symcache *cache)
+{
+  munmap (cache->map, cache->size);
+  free (cache);
+}
+
+/* Map the cache file FD and check that it is one we can use for the
+   module with this build ID.  Returns NULL if it is not.  */
+static struct dwfl_symcache *
+symcache_map (int fd, const unsigned char *build_id, int build_id_len,
+	      bool have_dwarf)
+{
+  struct stat st;
+  if (fstat (fd, &st) != 0
+      || (uint64_t) st.st_size < sizeof (struct symcache_header)
+      || (uint64_t) st.st_size > SIZE_MAX)
+    return NULL;
+
+  size_t size = st.st_size;
+  void *map = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const struct symcache_header *header = map;
+  if (memcmp (header->magic, SYMCACHE_MAGIC, sizeof header->magic) != 0
+      || header->version != SYMCACHE_VERSION
+      || header->byte_order != SYMCACHE_BYTE_ORDER
+      || header->build_id_len != (uint32_t) build_id_len
+      || memcmp (header->build_id, build_id, build_id_len) != 0
+      || (have_dwarf && !(header->flags & SYMCACHE_HAVE_DWARF)))
+    goto unusable;
+
+  const void *tables[SYMCACHE_NTABLES];
+  for (size_t i = 0; i < SYMCACHE_NTABLES; ++i)
+    {
+      uint64_t offset = header->tables[i].offset;
+      uint64_t count = header->tables[i].count;
+      if (offset % 8 != 0 || offset > size
+	  || count > (size - offset) / symcache_entsize[i])
+	goto unusable;
+      tables[i] = map + offset;
+    }
+
+  /* Every string is terminated within the table.  */
+  const char *strings = tables[SYMCACHE_STRINGS];
+  size_t nstrings = header->tables[SYMCACHE_STRINGS].count;
+  if (nstrings > 0 && strings[nstrings - 1] != '\0')
+    goto unusable;
+
+  struct dwfl_symcache *cache = malloc (sizeof *cache);
+  if (cache == NULL)
+    goto unusable;
+
+  cache->map = map;
+  cache->size = size;
+  cache->aranges = tables[SYMCACHE_ARANGES];
+  cache->naranges = header->tables[SYMCACHE_ARANGES].count;
+  cache->cus = tables[SYMCACHE_CUS];
+  cache->ncus = header->tables[SYMCACHE_CUS].count;
+  cache->lines = tables[SYMCACHE_LINES];
+  cache->nlines = header->tables[SYMCACHE_LINES].count;
+  cache->strings = strings;
+  cache->nstrings = nstrings;
+  cache->fdes[0] = tables[SYMCACHE_EH_FDES];
+  cache->nfdes[0] = header->tables[SYMCACHE_EH_FDES].count;
+  cache->fdes[1] = tables[SYMCACHE_DEBUG_FDES];
+  cache->nfdes[1] = header->tables[SYMCACHE_DEBUG_FDES].count;
+  return cache;
+
+ unusable:
+  munmap (map, size);
+  return NULL;
+}
+
+/* A table being collected for the cache file.  */
+struct symcache_buf
+{
+  char *data;
+  size_t size;
+  size_t alloc;
+};
+
+static bool
+buf_add (struct symcache_buf *buf, const void *data, size_t size)
+{
+  if (buf->alloc - buf->size < size)
+    {
+      size_t alloc = buf->alloc * 2 ?: 4096;
+      while (alloc - buf->size < size)
+	alloc *= 2;
+      char *newdata = realloc (buf->data, alloc);
+      if (newdata == NULL)
+	return false;
+      buf->data = newdata;
+      buf->alloc = alloc;
+    }
+  memcpy (buf->data + buf->size, data, size);
+  buf->size += size;
+  return true;
+}
+
+/* The string table, with a hash table of the offsets of the strings
+   already in it so that each file name is stored once.  */
+struct symcache_strtab
+{
+  struct symcache_buf *buf;
+  uint32_t *slots;		/* SYMCACHE_NO_STRING when free.  */
+  size_t nslots;
+  size_t nused;
+};
+
+static size_t
+strtab_hash (const char *str)
+{
+  size_t hash = 5381;
+  while (*str != '\0')
+    hash = hash * 33 + (unsigned char) *str++;
+  return hash;
+}
+
+static bool
+strtab_grow (struct symcache_strtab *tab)
+{
+  size_t nslots = tab->nslots * 2 ?: 1024;
+  uint32_t *slots = malloc (nslots * sizeof slots[0]);
+  if (slots == NULL)
+    return false;
+  memset (slots, 0xff, nslots * sizeof slots[0]);
+
+  for (size_t i = 0; i < tab->nslots; ++i)
+    if (tab->slots[i] != SYMCACHE_NO_STRING)
+      {
+	size_t j = strtab_hash (tab->buf->data + tab->slots[i]) & (nslots - 1);
+	while (slots[j] != SYMCACHE_NO_STRING)
+	  j = (j + 1) & (nslots - 1);
+	slots[j] = tab->slots[i];
+      }
+
+  free (tab->slots);
+  tab->slots = slots;
+  tab->nslots = nslots;
+  return true;
+}
+
+/* Store the offset of STR in the string table in *OFFSET, adding it if
+   it is not there yet.  */
+static bool
+strtab_add (struct symcache_strtab *tab, const char *str, uint32_t *offset)
+{
+  if (str == NULL)
+    {
+      *offset = SYMCACHE_NO_STRING;
+      return true;
+    }
+
+  if (tab->nused >= tab->nslots / 2 && !strtab_grow (tab))
+    return false;
+
+  size_t i = strtab_hash (str) & (tab->nslots - 1);
+  while (tab->slots[i] != SYMCACHE_NO_STRING)
+    {
+      if (strcmp (tab->buf->data + tab->slots[i], str) == 0)
+	{
+	  *offset = tab->slots[i];
+	  return true;
+	}
+      i = (i + 1) & (tab->nslots - 1);
+    }
+
+  size_t len = strlen (str) + 1;
+  if (tab->buf->size >= SYMCACHE_NO_STRING - len
+      || !buf_add (tab->buf, str, len))
+    return false;
+
+  *offset = tab->slots[i] = tab->buf->size - len;
+  ++tab->nused;
+  return true;
+}
+
+static int
+compare_offsets (const void *a, const void *b)
+{
+  const Dwarf_Off *p1 = a, *p2 = b;
+  return *p1 < *p2 ? -1 : *p1 > *p2;
+}
+
+/* Collect the aranges of DW, and the line tables of all the CUs they
+   refer to as dwfl_module_getsrc would see them.  */
+static Dwfl_Error
+collect_lines (Dwarf *dw, struct symcache_buf *tables,
+	       struct symcache_strtab *strtab)
+{
+  Dwarf_Aranges *aranges;
+  size_t naranges;
+  if (INTUSE(dwarf_getaranges) (dw, &aranges, &naranges) != 0)
+    return DWFL_E_LIBDW;
+  if (naranges == 0)
+    return DWFL_E_NOERROR;
+
+  Dwarf_Off *offsets = malloc (naranges * sizeof offsets[0]);
+  if (offsets == NULL)
+    return DWFL_E_NOMEM;
+
+  uint32_t *files = NULL;
+  size_t nfiles = 0;
+
+  for (size_t i = 0; i < naranges; ++i)
+    {
+      const struct symcache_arange arange =
+	{
+	  .addr = aranges->info[i].addr,
+	  .length = aranges->info[i].length,
+	  .offset = aranges->info[i].offset
+	};
+      if (! buf_add (&tables[SYMCACHE_ARANGES], &arange, sizeof arange))
+	goto nomem;
+      offsets[i] = aranges->info[i].offset;
+    }
+
+  qsort (offsets, naranges, sizeof offsets[0], &compare_offsets);
+
+  uint64_t nlines = 0;
+  for (size_t i = 0; i < naranges; ++i)
+    {
+      if (i > 0 && offsets[i] == offsets[i - 1])
+	continue;
+
+      struct symcache_cu cu =
+	{
+	  .offset = offsets[i],
+	  .first_line = nlines,
+	  .comp_dir = SYMCACHE_NO_STRING
+	};
+
+      Dwarf_Die cudie;
+      Dwarf_Lines *lines;
+      size_t n;
+      if (INTUSE(dwarf_offdie) (dw, offsets[i], &cudie) != NULL)
+	{
+	  Dwarf_Attribute attr;
+	  if (! strtab_add (strtab,
+			    INTUSE(dwarf_formstring)
+			    (INTUSE(dwarf_attr) (&cudie, DW_AT_comp_dir,
+						 &attr)),
+			    &cu.comp_dir))
+	    goto nomem;
+
+	  if (INTUSE(dwarf_getsrclines) (&cudie, &lines, &n) == 0 && n > 0)
+	    {
+	      /* The file names of this CU, interned as they come up.  */
+	      Dwarf_Files *dwfiles = lines->info[0].files;
+	      if (dwfiles->nfiles > nfiles)
+		{
+		  free (files);
+		  nfiles = dwfiles->nfiles;
+		  files = malloc (nfiles * sizeof files[0]);
+		  if (files == NULL)
+		    goto nomem;
+		}
+	      memset (files, 0xff, dwfiles->nfiles * sizeof files[0]);
+
+	      for (size_t j = 0; j < n; ++j)
+		{
+		  const Dwarf_Line *info = &lines->info[j];
+		  struct symcache_line line =
+		    {
+		      .addr = info->addr,
+		      .file = SYMCACHE_NO_STRING,
+		      .line = info->line,
+		      .column = info->column,
+		      .end_sequence = info->end_sequence
+		    };
+		  if (info->file < dwfiles->nfiles)
+		    {
+		      if (files[info->file] == SYMCACHE_NO_STRING
+			  && ! strtab_add (strtab,
+					   dwfiles->info[info->file].name,
+					   &files[info->file]))
+			goto nomem;
+		      line.file = files[info->file];
+		    }
+		  if (! buf_add (&tables[SYMCACHE_LINES], &line, sizeof line))
+		    goto nomem;
+		}
+	      cu.nlines = n;
+	      nlines += n;
+	    }
+	}
+
+      if (! buf_add (&tables[SYMCACHE_CUS], &cu, sizeof cu))
+	goto nomem;
+    }
+
+  free (files);
+  free (offsets);
+  return DWFL_E_NOERROR;
+
+ nomem:
+  free (files);
+  free (offsets);
+  return DWFL_E_NOMEM;
+}
+
+static int
+compare_fdes (const void *a, const void *b)
+{
+  const struct symcache_fde *p1 = a, *p2 = b;
+  if (p1->start != p2->start)
+    return p1->start < p2->start ? -1 : 1;
+  return p1->fde < p2->fde ? -1 : p1->fde > p2->fde;
+}
+
+/* Collect a search table of all the FDEs in CFI, unless it already
+   has one from .eh_frame_hdr.  */
+static Dwfl_Error
+collect_fdes (Dwarf_CFI *cfi, struct symcache_buf *buf)
+{
+  if (cfi == NULL || cfi->search_table != NULL)
+    return DWFL_E_NOERROR;
+
+  Dwarf_Off offset = 0;
+  while (true)
+    {
+      Dwarf_Off next_offset;
+      Dwarf_CFI_Entry entry;
+      int result = INTUSE(dwarf_next_cfi) (cfi->e_ident, &cfi->data->d,
+					   CFI_IS_EH (cfi), offset,
+					   &next_offset, &entry);
+      if (result > 0 || (result < 0 && next_offset == offset))
+	break;
+
+      if (result == 0 && ! dwarf_cfi_cie_p (&entry))
+	{
+	  struct dwarf_fde *fde = __libdw_fde_by_offset (cfi, offset);
+	  if (fde != NULL)
+	    {
+	      const struct symcache_fde search =
+		{
+		  .start = fde->start,
+		  .fde = cfi->frame_vaddr + offset
+		};
+	      if (! buf_add (buf, &search, sizeof search))
+		return DWFL_E_NOMEM;
+	    }
+	}
+
+      offset = next_offset;
+    }
+
+  struct symcache_fde *fdes = (struct symcache_fde *) buf->data;
+  size_t nfdes = buf->size / sizeof fdes[0];
+  qsort (fdes, nfdes, sizeof fdes[0], &compare_fdes);
+
+  /* binary_search_fde reads the table in the byte order of the CFI.  */
+  if (cfi->other_byte_order)
+    for (size_t i = 0; i < nfdes; ++i)
+      {
+	fdes[i].start = bswap_64 (fdes[i].start);
+	fdes[i].fde = bswap_64 (fdes[i].fde);
+      }
+
+  return DWFL_E_NOERROR;
+}
+
+/* Write the cache of MOD to a new file that replaces PATH, and map it.  */
+static Dwfl_Error
+symcache_write (Dwfl_Module *mod, Dwarf *dw, const char *dir,
+		const char *path, const unsigned char *build_id,
+		int build_id_len, struct dwfl_symcache **cachep)
+{
+  struct symcache_buf tables[SYMCACHE_NTABLES];
+  memset (tables, 0, sizeof tables);
+  struct symcache_strtab strtab = { .buf = &tables[SYMCACHE_STRINGS] };
+
+  Dwfl_Error error = DWFL_E_NOERROR;
+  Dwarf_Addr bias;
+  if (dw != NULL)
+    error = collect_lines (dw, tables, &strtab);
+  if (error == DWFL_E_NOERROR)
+    error = collect_fdes (INTUSE(dwfl_module_eh_cfi) (mod, &bias),
+			  &tables[SYMCACHE_EH_FDES]);
+  if (error == DWFL_E_NOERROR && dw != NULL)
+    error = collect_fdes (INTUSE(dwfl_module_dwarf_cfi) (mod, &bias),
+			  &tables[SYMCACHE_DEBUG_FDES]);
+  free (strtab.slots);
+
+  char *tmppath = NULL;
+  int fd = -1;
+  if (error != DWFL_E_NOERROR)
+    goto out;
+
+  struct symcache_header header;
+  memset (&header, 0, sizeof header);
+  memcpy (header.magic, SYMCACHE_MAGIC, sizeof header.magic);
+  header.version = SYMCACHE_VERSION;
+  header.byte_order = SYMCACHE_BYTE_ORDER;
+  header.flags = dw != NULL ? SYMCACHE_HAVE_DWARF : 0;
+  header.build_id_len = build_id_len;
+  memcpy (header.build_id, build_id, build_id_len);
+
+  uint64_t size = (sizeof header + 7) & -8;
+  for (size_t i = 0; i < SYMCACHE_NTABLES; ++i)
+    {
+      header.tables[i].offset = size;
+      header.tables[i].count = tables[i].size / symcache_entsize[i];
+      size = (size + tables[i].size + 7) & -8;
+    }
+
+  if (mkdir (dir, 0700) != 0 && errno != EEXIST)
+    goto errno_out;
+
+  if (asprintf (&tmppath, "%s.XXXXXX", path) < 0)
+    {
+      tmppath = NULL;
+      error = DWFL_E_NOMEM;
+      goto out;
+    }
+
+  fd = mkstemp (tmppath);
+  if (fd < 0)
+    goto errno_out;
+
+  if (ftruncate (fd, size) != 0
+      || pwrite_retry (fd, &header, sizeof header, 0) != sizeof header)
+    goto errno_unlink;
+  for (size_t i = 0; i < SYMCACHE_NTABLES; ++i)
+    if (tables[i].size > 0
+	&& (pwrite_retry (fd, tables[i].data, tables[i].size,
+			  header.tables[i].offset)
+	    != (ssize_t) tables[i].size))
+      goto errno_unlink;
+
+  if (rename (tmppath, path) != 0)
+    goto errno_unlink;
+
+  *cachep = symcache_map (fd, build_id, build_id_len, dw != NULL);
+  if (*cachep == NULL)
+    error = DWFL_E_NOMEM;
+  goto out;
+
+ errno_unlink:
+  error = DWFL_E (ERRNO, errno);
+  unlink (tmppath);
+  goto out;
+
+ errno_out:
+  error = DWFL_E (ERRNO, errno);
+ out:
+  if (fd >= 0)
+    close (fd);
+  free (tmppath);
+  for (size_t i = 0; i < SYMCACHE_NTABLES; ++i)
+    free (tables[i].data);
+  return error;
+}
+
+/* Let CFI use the search table FDES if it has none of its own.  */
+static void
+install_fdes (Dwarf_CFI *cfi, const struct symcache_fde *fdes, size_t nfdes)
+{
+  if (cfi == NULL || cfi->search_table != NULL || nfdes == 0)
+    return;
+
+  cfi->search_table = (const uint8_t *) fdes;
+  cfi->search_table_len = nfdes * sizeof fdes[0];
+  cfi->search_table_vaddr = 0;
+  cfi->search_table_entries = nfdes;
+  cfi->search_table_encoding = DW_EH_PE_udata8;
+}
+
+int
+dwfl_module_symcache (Dwfl_Module *mod, const char *dir)
+{
+  if (mod == NULL)
+    return -1;
+
+  if (mod->symcache != NULL)
+    return 0;
+
+  Dwarf_Addr bias;
+  if (INTUSE(dwfl_module_getelf) (mod, &bias) == NULL)
+    return -1;
+
+  const unsigned char *build_id;
+  GElf_Addr build_id_vaddr;
+  int build_id_len = INTUSE(dwfl_module_build_id) (mod, &build_id,
+						   &build_id_vaddr);
+  if (build_id_len < 0)
+    return -1;
+  if (build_id_len == 0 || build_id_len > SYMCACHE_MAX_BUILD_ID)
+    {
+      __libdwfl_seterrno (DWFL_E_NO_BUILD_ID);
+      return -1;
+    }
+
+  /* A module without DWARF still gets its .eh_frame search table.  */
+  Dwarf *dw = INTUSE(dwfl_module_getdwarf) (mod, &bias);
+
+  char hex[2 * SYMCACHE_MAX_BUILD_ID + 1];
+  for (int i = 0; i < build_id_len; ++i)
+    sprintf (&hex[2 * i], "%02x", build_id[i]);
+
+  char *path;
+  if (asprintf (&path, "%s/%s", dir, hex) < 0)
+    {
+      __libdwfl_seterrno (DWFL_E_NOMEM);
+      return -1;
+    }
+
+  struct dwfl_symcache *cache = NULL;
+  int fd = open (path, O_RDONLY);
+  if (fd >= 0)
+    {
+      cache = symcache_map (fd, build_id, build_id_len, dw != NULL);
+      close (fd);
+    }
+
+  Dwfl_Error error = DWFL_E_NOERROR;
+  if (cache == NULL)
+    error = symcache_write (mod, dw, dir, path, build_id, build_id_len,
+			    &cache);
+  free (path);
+  if (error != DWFL_E_NOERROR)
+    {
+      __libdwfl_seterrno (error);
+      return -1;
+    }
+
+  mod->symcache = cache;
+
+  /* Unless libdw has read them already, give it the aranges.  */
+  if (dw != NULL && dw->aranges == NULL && cache->naranges > 0)
+    {
+      Dwarf_Aranges *aranges
+	= libdw_alloc (dw, Dwarf_Aranges,
+		       sizeof (Dwarf_Aranges)
+		       + cache->naranges * sizeof (Dwarf_Arange), 1);
+      aranges->dbg = dw;
+      aranges->naranges = cache->naranges;
+      for (size_t i = 0; i < cache->naranges; ++i)
+	{
+	  aranges->info[i].addr = cache->aranges[i].addr;
+	  aranges->info[i].length = cache->aranges[i].length;
+	  aranges->info[i].offset = cache->aranges[i].offset;
+	}
+      dw->aranges = aranges;
+    }
+
+  install_fdes (INTUSE(dwfl_module_eh_cfi) (mod, &bias),
+		cache->fdes[0], cache->nfdes[0]);
+  if (dw != NULL)
+    install_fdes (INTUSE(dwfl_module_dwarf_cfi) (mod, &bias),
+		  cache->fdes[1], cache->nfdes[1]);
+
+  return 0;
+}
+
+static const char *
+symcache_string (struct dwfl_symcache *cache, uint32_t offset)
+{
+  return offset < cache->nstrings ? &cache->strings[offset] : NULL;
+}
+
+/* Find the CU whose DIE is at OFFSET.  */
+static const struct symcache_cu *
+symcache_cu (struct dwfl_symcache *cache, Dwarf_Off offset)
+{
+  size_t l = 0, u = cache->ncus;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (offset < cache->cus[idx].offset)
+	u = idx;
+      else if (offset > cache->cus[idx].offset)
+	l = idx + 1;
+      else
+	return &cache->cus[idx];
+    }
+  return NULL;
+}
+
+const char *
+dwfl_module_symcache_getsrc (Dwfl_Module *mod, Dwarf_Addr addr,
+			     int *lineno, int *column, const char **comp_dir)
+{
+  if (mod == NULL)
+    return NULL;
+
+  struct dwfl_symcache *cache = mod->symcache;
+  if (cache == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_INVALID_ARGUMENT);
+      return NULL;
+    }
+
+  Dwarf_Addr bias;
+  if (INTUSE(dwfl_module_getdwarf) (mod, &bias) == NULL)
+    return NULL;
+
+  struct dwfl_cu *cu;
+  Dwfl_Error error = __libdwfl_addrcu (mod, addr, &cu);
+  if (likely (error == DWFL_E_NOERROR))
+    {
+      const struct symcache_cu *scu
+	= symcache_cu (cache, INTUSE(dwarf_dieoffset) (&cu->die));
+      if (scu != NULL && scu->nlines > 0
+	  && scu->first_line <= cache->nlines
+	  && scu->nlines <= cache->nlines - scu->first_line)
+	{
+	  const struct symcache_line *lines = &cache->lines[scu->first_line];
+
+	  /* Now we look at the module-relative address.  */
+	  addr -= bias;
+
+	  /* Same search as dwfl_module_getsrc.  */
+	  size_t l = 0, u = scu->nlines - 1;
+	  while (l < u)
+	    {
+	      size_t idx = u - (u - l) / 2;
+	      if (addr < lines[idx].addr)
+		u = idx - 1;
+	      else
+		l = idx;
+	    }
+
+	  const struct symcache_line *line = &lines[l];
+	  const char *file = symcache_string (cache, line->file);
+	  if (! line->end_sequence && line->addr <= addr && file != NULL)
+	    {
+	      if (lineno != NULL)
+		*lineno = line->line;
+	      if (column != NULL)
+		*column = line->column;
+	      if (comp_dir != NULL)
+		*comp_dir = symcache_string (cache, scu->comp_dir);
+	      return file;
+	    }
+	}
+
+      error = DWFL_E_ADDR_OUTOFRANGE;
+    }
+
+  __libdwfl_seterrno (error);
+  return NULL;
+}
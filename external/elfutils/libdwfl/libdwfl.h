@@ -590,6 +590,60 @@ extern Dwarf_Line *dwfl_dwarf_line (Dwfl_Line *line, Dwarf_Addr *bias);
 /* Return the compilation directory (AT_comp_dir) from this line's CU.  */
 extern const char *dwfl_line_comp_dir (Dwfl_Line *line);
 
+/* Symbol, source line and function scope of one address, as filled in
+   by dwfl_module_addrinfo_batch.  */
+typedef struct
+{
+  /* As returned and filled in by dwfl_module_addrinfo, NAME is NULL
+     when no symbol was found.  */
+  const char *name;
+  GElf_Off offset;
+  GElf_Sym sym;
+  GElf_Word shndx;
+  Elf *elf;
+  Dwarf_Addr bias;
+
+  /* As returned by dwfl_module_getsrc, or NULL.  */
+  Dwfl_Line *line;
+
+  /* The innermost DW_TAG_subprogram or DW_TAG_inlined_subroutine DIE
+     whose ranges contain the address, or NULL.  Valid as long as the
+     module is.  */
+  Dwarf_Die *scope;
+} Dwfl_Addrinfo;
+
+/* Look up each of the NADDRS addresses in ADDRS and fill in the
+   corresponding element of INFOS.  On the first call the module gets
+   sorted indexes of its symbols and function scopes, after which every
+   lookup is a binary search.  Addresses that are not found just have
+   NULL fields.  Returns -1 for errors, zero otherwise.  */
+extern int dwfl_module_addrinfo_batch (Dwfl_Module *mod,
+				       const GElf_Addr *addrs, size_t naddrs,
+				       Dwfl_Addrinfo *infos)
+  __nonnull_attribute__ (2, 4);
+
+/* Load the symbolization cache of the module from the file named after
+   its build ID in directory DIR, or create that file from the module's
+   DWARF and CFI when there is none yet or it is unusable.  The cache
+   holds the address ranges of the CUs, their line tables and, for CFI
+   that has no .eh_frame_hdr search table, a sorted table of the FDEs.
+   Once loaded, dwarf_getaranges and CFI lookups for the module use it
+   without reading the DWARF sections again.  Returns -1 for errors,
+   e.g. when the module has no build ID, zero otherwise.  */
+extern int dwfl_module_symcache (Dwfl_Module *mod, const char *dir)
+  __nonnull_attribute__ (2);
+
+/* Look up the source line of ADDR in the symbolization cache loaded by
+   dwfl_module_symcache, the same line dwfl_module_getsrc would find.
+   Returns the source file name and fills in *LINENO and *COLUMN when
+   they are not NULL, and *COMP_DIR with the compilation directory of
+   the CU (or NULL if it had none).  The strings live as long as the
+   module.  Returns NULL when there is no cache or no line for ADDR.  */
+extern const char *dwfl_module_symcache_getsrc (Dwfl_Module *mod,
+						Dwarf_Addr addr,
+						int *lineno, int *column,
+						const char **comp_dir);
+
 
 /*** Machine backend access functions ***/
 
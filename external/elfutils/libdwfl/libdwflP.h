@@ -91,7 +91,8 @@ typedef struct Dwfl_Process Dwfl_Process;
   DWFL_ERROR (NO_ATTACH_STATE, N_("Dwfl has no attached state"))	      \
   DWFL_ERROR (NO_UNWIND, N_("Unwinding not supported for this architecture")) \
   DWFL_ERROR (INVALID_ARGUMENT, N_("Invalid argument"))			      \
-  DWFL_ERROR (NO_CORE_FILE, N_("Not an ET_CORE ELF file"))
+  DWFL_ERROR (NO_CORE_FILE, N_("Not an ET_CORE ELF file"))		      \
+  DWFL_ERROR (NO_BUILD_ID, N_("No build ID found"))
 
 #define DWFL_ERROR(name, text) DWFL_E_##name,
 typedef enum { DWFL_ERRORS DWFL_E_NUM } Dwfl_Error;
@@ -206,6 +207,16 @@ struct Dwfl_Module
 
   struct dwfl_arange *aranges;	/* Mapping of addresses in module to CUs.  */
 
+  /* Address indexes of the symbol table (one for each adjust_st_value
+     mode of __libdwfl_addrsym) and of the function scopes in the
+     DWARF, built lazily.  (void *) -1 if they could not be built.  */
+  struct dwfl_symindex *symindex[2];
+  struct dwfl_scopeindex *scopeindex;
+  unsigned int addrsym_lookups;	/* Symbol lookups without an index.  */
+
+  /* Mapped symbolization cache, see dwfl_module_symcache.  */
+  struct dwfl_symcache *symcache;
+
   void *build_id_bits;		/* malloc'd copy of build ID bits.  */
   GElf_Addr build_id_vaddr;	/* Address where they reside, 0 if unknown.  */
   int build_id_len;		/* -1 for prior failure, 0 if unset.  */
@@ -463,6 +474,50 @@ extern const char *__libdwfl_getsym (Dwfl_Module *mod, int ndx, GElf_Sym *sym,
 
 extern void __libdwfl_module_free (Dwfl_Module *mod) internal_function;
 
+/* An address range [START, END) in an address index.  */
+struct dwfl_addrindex_range
+{
+  GElf_Addr start;
+  GElf_Addr end;
+};
+
+/* Addresses from START up to the START of the next segment are covered
+   by the range with index WINNER, or by no range if WINNER is -1.  */
+struct dwfl_addrindex_seg
+{
+  GElf_Addr start;
+  size_t winner;
+};
+
+/* Split the addresses covered by the N RANGES into segments.  For each
+   segment the ranges covering it are visited in array order and the
+   first one is replaced by every later one for which BETTER (later,
+   current, ARG) returns true.  Returns false if out of memory or if
+   the ranges overlap so much that the index would not pay off.  */
+extern bool __libdwfl_addrindex_build (const struct dwfl_addrindex_range *ranges,
+				       size_t n,
+				       bool (*better) (size_t, size_t, void *),
+				       void *arg,
+				       struct dwfl_addrindex_seg **segsp,
+				       size_t *nsegsp)
+  internal_function;
+
+/* Return the WINNER of the segment ADDR falls in, or -1.  */
+extern size_t __libdwfl_addrindex_find (const struct dwfl_addrindex_seg *segs,
+					size_t nsegs, GElf_Addr addr)
+  internal_function;
+
+/* Build the symbol index used by dwfl_module_addrinfo now, instead of
+   after a number of lookups.  */
+extern void __libdwfl_addrsym_index (Dwfl_Module *mod) internal_function;
+
+extern void __libdwfl_free_symindex (struct dwfl_symindex *index)
+  internal_function;
+extern void __libdwfl_free_scopeindex (struct dwfl_scopeindex *index)
+  internal_function;
+extern void __libdwfl_free_symcache (struct dwfl_symcache *cache)
+  internal_function;
+
 /* Find the main ELF file, update MOD->elferr and/or MOD->main.elf.  */
 extern void __libdwfl_getelf (Dwfl_Module *mod) internal_function;
 
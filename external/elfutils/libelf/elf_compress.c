@@ -35,12 +35,15 @@
 #include "libelfP.h"
 #include "common.h"
 
+#include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <zlib.h>
 
+#include "atomics.h"
+
 /* Cleanup and return result.  Don't leak memory.  */
 static void *
 do_deflate_cleanup (void *result, z_stream *z, void *out_buf,
@@ -56,6 +59,253 @@ do_deflate_cleanup (void *result, z_stream *z, void *out_buf,
 #define deflate_cleanup(result, cdata) \
     do_deflate_cleanup(result, &z, out_buf, cdata)
 
+/* Sections are split into blocks of this size when they are compressed
+   by several threads.  Each block is primed with the last DICT_SIZE
+   bytes of the block before it, so little compression is lost.  */
+#define PARALLEL_BLOCK_SIZE (256 * 1024)
+#define DICT_SIZE 32768
+
+struct deflate_block
+{
+  void *buf;
+  size_t size;
+  uLong adler;
+};
+
+struct parallel_deflate
+{
+  Elf *elf;
+  Elf_Data *data;
+  int ei_data;
+  bool convert;
+
+  /* Size of one element of data, blocks never split elements.  */
+  size_t fsize;
+  size_t block_size;
+  size_t nblocks;
+  struct deflate_block *blocks;
+
+  atomic_size_t next;
+  atomic_int error;
+};
+
+/* Deflate block NDX of PD into a raw deflate stream.  All but the last
+   block end in a sync flush, so the blocks can simply be concatenated.
+   Returns zero or an ELF_E error code.  */
+static int
+deflate_block (struct parallel_deflate *pd, size_t ndx)
+{
+  Elf_Data *data = pd->data;
+  size_t start = ndx * pd->block_size;
+  size_t len = MIN (pd->block_size, data->d_size - start);
+  size_t dict_len = MIN (start, DICT_SIZE - DICT_SIZE % pd->fsize);
+  bool last = ndx == pd->nblocks - 1;
+
+  /* Convert just this block (and its dictionary) to file byte order,
+     never the whole section.  */
+  void *conv_buf = NULL;
+  const unsigned char *in = data->d_buf + start - dict_len;
+  if (pd->convert)
+    {
+      conv_buf = malloc (dict_len + len);
+      if (conv_buf == NULL)
+	return ELF_E_NOMEM;
+
+      Elf_Data src = *data;
+      src.d_buf = (void *) in;
+      src.d_size = dict_len + len;
+      Elf_Data dst = src;
+      dst.d_buf = conv_buf;
+      if (gelf_xlatetof (pd->elf, &dst, &src, pd->ei_data) == NULL)
+	{
+	  free (conv_buf);
+	  return ELF_E_INVALID_DATA;
+	}
+      in = conv_buf;
+    }
+
+  z_stream z;
+  z.zalloc = Z_NULL;
+  z.zfree = Z_NULL;
+  z.opaque = Z_NULL;
+  if (deflateInit2 (&z, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+		    Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      free (conv_buf);
+      return ELF_E_COMPRESS_ERROR;
+    }
+
+  int result = 0;
+  if (dict_len > 0 && deflateSetDictionary (&z, in, dict_len) != Z_OK)
+    {
+      result = ELF_E_COMPRESS_ERROR;
+      goto out;
+    }
+
+  /* Room for the worst case plus the empty stored block of the sync
+     flush; grown below should zlib ever need more.  */
+  size_t out_size = deflateBound (&z, len) + 16;
+  unsigned char *out_buf = malloc (out_size);
+  if (out_buf == NULL)
+    {
+      result = ELF_E_NOMEM;
+      goto out;
+    }
+
+  z.next_in = (Bytef *) in + dict_len;
+  z.avail_in = len;
+  size_t used = 0;
+  int zrc;
+  do
+    {
+      if (used == out_size)
+	{
+	  unsigned char *bigger = realloc (out_buf, out_size + len / 8 + 64);
+	  if (bigger == NULL)
+	    {
+	      free (out_buf);
+	      result = ELF_E_NOMEM;
+	      goto out;
+	    }
+	  out_buf = bigger;
+	  out_size += len / 8 + 64;
+	}
+      z.next_out = out_buf + used;
+      z.avail_out = out_size - used;
+      zrc = deflate (&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+      used = out_size - z.avail_out;
+    }
+  while (zrc == Z_OK && z.avail_out == 0);
+
+  if (zrc != (last ? Z_STREAM_END : Z_OK))
+    {
+      free (out_buf);
+      result = ELF_E_COMPRESS_ERROR;
+      goto out;
+    }
+
+  pd->blocks[ndx].buf = out_buf;
+  pd->blocks[ndx].size = used;
+  pd->blocks[ndx].adler = adler32 (adler32 (0L, Z_NULL, 0),
+				   in + dict_len, len);
+
+ out:
+  deflateEnd (&z);
+  free (conv_buf);
+  return result;
+}
+
+static void *
+deflate_worker (void *arg)
+{
+  struct parallel_deflate *pd = arg;
+  size_t ndx;
+  while (atomic_load (&pd->error) == 0
+	 && (ndx = atomic_fetch_add (&pd->next, 1)) < pd->nblocks)
+    {
+      int err = deflate_block (pd, ndx);
+      if (err != 0)
+	atomic_store (&pd->error, err);
+    }
+  return NULL;
+}
+
+/* Like __libelf_compress, but for a section with a single Elf_Data
+   which is compressed in blocks by up to THREADS threads.  The
+   concatenated blocks are wrapped in a zlib header and the combined
+   adler32 checksum, so the result is one regular zlib stream.  */
+static void *
+parallel_compress (Elf_Scn *scn, Elf_Data *data, size_t hsize, int ei_data,
+		   unsigned int threads, size_t orig_size, size_t *new_size,
+		   bool force)
+{
+  struct parallel_deflate pd;
+  pd.elf = scn->elf;
+  pd.data = data;
+  pd.ei_data = ei_data;
+  pd.convert = ei_data != MY_ELFDATA;
+  pd.fsize = 1;
+  if (pd.convert)
+    {
+      pd.fsize = gelf_fsize (scn->elf, data->d_type, 1, EV_CURRENT);
+      if (pd.fsize == 0)
+	return NULL;
+    }
+  pd.block_size = PARALLEL_BLOCK_SIZE - PARALLEL_BLOCK_SIZE % pd.fsize;
+  pd.nblocks = (data->d_size + pd.block_size - 1) / pd.block_size;
+  pd.blocks = calloc (pd.nblocks, sizeof (struct deflate_block));
+  if (pd.blocks == NULL)
+    {
+      __libelf_seterrno (ELF_E_NOMEM);
+      return NULL;
+    }
+  atomic_init (&pd.next, 0);
+  atomic_init (&pd.error, 0);
+
+  /* The calling thread is one of the workers.  If a thread cannot be
+     started the others just do more of the blocks.  */
+  if (threads > pd.nblocks)
+    threads = pd.nblocks;
+  pthread_t *tids = malloc ((threads - 1) * sizeof (pthread_t));
+  unsigned int started = 0;
+  while (tids != NULL && started < threads - 1
+	 && pthread_create (&tids[started], NULL, deflate_worker, &pd) == 0)
+    started++;
+  deflate_worker (&pd);
+  for (unsigned int i = 0; i < started; i++)
+    pthread_join (tids[i], NULL);
+  free (tids);
+
+  void *out_buf = NULL;
+  int err = atomic_load (&pd.error);
+  if (err != 0)
+    {
+      __libelf_seterrno (err);
+      goto out;
+    }
+
+  /* Two bytes zlib header, the blocks, four bytes adler32 trailer.  */
+  size_t size = hsize + 2 + 4;
+  for (size_t i = 0; i < pd.nblocks; i++)
+    size += pd.blocks[i].size;
+
+  if (!force && size >= orig_size)
+    {
+      out_buf = (void *) -1;
+      goto out;
+    }
+
+  out_buf = malloc (size);
+  if (out_buf == NULL)
+    {
+      __libelf_seterrno (ELF_E_NOMEM);
+      goto out;
+    }
+
+  /* Deflate, 32K window, maximum compression level.  */
+  unsigned char *p = out_buf + hsize;
+  *p++ = 0x78;
+  *p++ = 0xda;
+  uLong adler = adler32 (0L, Z_NULL, 0);
+  for (size_t i = 0; i < pd.nblocks; i++)
+    {
+      size_t len = MIN (pd.block_size, data->d_size - i * pd.block_size);
+      p = mempcpy (p, pd.blocks[i].buf, pd.blocks[i].size);
+      adler = adler32_combine (adler, pd.blocks[i].adler, len);
+    }
+  *p++ = adler >> 24;
+  *p++ = adler >> 16;
+  *p++ = adler >> 8;
+  *p++ = adler;
+  *new_size = size;
+
+ out:
+  for (size_t i = 0; i < pd.nblocks; i++)
+    free (pd.blocks[i].buf);
+  free (pd.blocks);
+  return out_buf;
+}
+
 /* Given a section, uses the (in-memory) Elf_Data to extract the
    original data size (including the given header size) and data
    alignment.  Returns a buffer that has at least hsize bytes (for the
@@ -91,6 +341,13 @@ __libelf_compress (Elf_Scn *scn, size_t hsize, int ei_data,
   *orig_addralign = data->d_align;
   *orig_size = data->d_size;
 
+  /* A large single buffer can be split over several threads.  */
+  unsigned int threads = scn->elf->compress_threads;
+  if (next_data == NULL && threads > 1
+      && data->d_size >= 2 * PARALLEL_BLOCK_SIZE)
+    return parallel_compress (scn, data, hsize, ei_data, threads,
+			      *orig_size, new_size, force);
+
   /* Guess an output block size. 1/8th of the original Elf_Data plus
      hsize.  Make the first chunk twice that size (25%), then increase
      by a block (12.5%) when necessary.  */
@@ -337,6 +594,23 @@ __libelf_reset_rawdata (Elf_Scn *scn, void *buf, size_t size, size_t align,
   __libelf_set_data_list_rdlock (scn, 1);
 }
 
+int
+elf_compress_threads (Elf *elf, unsigned int threads)
+{
+  if (elf == NULL)
+    return -1;
+
+  if (elf->kind != ELF_K_ELF)
+    {
+      __libelf_seterrno (ELF_E_INVALID_HANDLE);
+      return -1;
+    }
+
+  int result = elf->compress_threads;
+  elf->compress_threads = threads;
+  return result;
+}
+
 int
 elf_compress (Elf_Scn *scn, int type, unsigned int flags)
 {
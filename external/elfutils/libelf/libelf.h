@@ -390,6 +390,15 @@ extern Elf64_Chdr *elf64_getchdr (Elf_Scn *__scn);
 extern int elf_compress (Elf_Scn *scn, int type, unsigned int flags);
 extern int elf_compress_gnu (Elf_Scn *scn, int compress, unsigned int flags);
 
+/* Set the number of threads elf_compress and elf_compress_gnu may use
+   to compress the data of one section of ELF.  Large sections are
+   then split into blocks that are deflated concurrently and joined
+   into a single zlib stream, so the result decompresses like any
+   other compressed section.  Zero or one (the default) compresses
+   with just the calling thread.  Returns the previous setting or -1
+   on error.  */
+extern int elf_compress_threads (Elf *__elf, unsigned int __threads);
+
 /* Set or clear flags for ELF file.  */
 extern unsigned int elf_flagelf (Elf *__elf, Elf_Cmd __cmd,
 				 unsigned int __flags);
@@ -307,6 +307,9 @@ struct Elf
   /* Reference counting for the descriptor.  */
   int ref_count;
 
+  /* Number of threads elf_compress may use for one section.  */
+  unsigned int compress_threads;
+
   /* Lock to handle multithreaded programs.  */
   rwlock_define (,lock);
 
@@ -50,6 +50,7 @@ ARGP_PROGRAM_BUG_ADDRESS_DEF = PACKAGE_BUGREPORT;
 /* Values for the parameters which have no short form.  */
 #define OPT_DEMANGLER 0x100
 #define OPT_PRETTY 0x101  /* 'p' is already used to select the process.  */
+#define OPT_CACHE 0x102
 
 /* Definitions of arguments for argp functions.  */
 static const struct argp_option options[] =
@@ -76,6 +77,8 @@ static const struct argp_option options[] =
     N_("Print all information on one line, and indent inlines"), 0 },
 
   { NULL, 0, NULL, 0, N_("Miscellaneous:"), 0 },
+  { "cache", OPT_CACHE, "DIR", 0,
+    N_("Keep address ranges and line tables of modules in DIR, keyed by build-id"), 0 },
   /* Unsupported options.  */
   { "target", 'b', "ARG", OPTION_HIDDEN, NULL, 0 },
   { "demangler", OPT_DEMANGLER, "ARG", OPTION_HIDDEN, NULL, 0 },
@@ -104,6 +107,10 @@ static const struct argp argp =
 /* Handle ADDR.  */
 static int handle_address (const char *addr, Dwfl *dwfl);
 
+/* Load the symbolization cache of a module.  */
+static int load_symcache (Dwfl_Module *mod, void **userdata, const char *name,
+			  Dwarf_Addr start, void *arg);
+
 /* True when we should print the address for each entry.  */
 static bool print_addresses;
 
@@ -137,6 +144,9 @@ static bool demangle;
 /* True if all information should be printed on one line.  */
 static bool pretty;
 
+/* If non-null, directory of the symbolization caches of the modules.  */
+static const char *cache_dir;
+
 #ifdef USE_DEMANGLE
 static size_t demangle_buffer_len = 0;
 static char *demangle_buffer = NULL;
@@ -167,6 +177,9 @@ main (int argc, char *argv[])
   (void) argp_parse (&argp, argc, argv, 0, &remaining, &dwfl);
   assert (dwfl != NULL);
 
+  if (cache_dir != NULL)
+    (void) dwfl_getmodules (dwfl, &load_symcache, NULL, 0);
+
   /* Now handle the addresses.  In case none are given on the command
      line, read from stdin.  */
   if (remaining == argc)
@@ -265,6 +278,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
       pretty = true;
       break;
 
+    case OPT_CACHE:
+      cache_dir = arg;
+      break;
+
     default:
       return ARGP_ERR_UNKNOWN;
     }
@@ -457,6 +474,18 @@ print_addrsym (Dwfl_Module *mod, GElf_Addr addr)
     }
 }
 
+static int
+load_symcache (Dwfl_Module *mod,
+	       void **userdata __attribute__ ((unused)),
+	       const char *name __attribute__ ((unused)),
+	       Dwarf_Addr start __attribute__ ((unused)),
+	       void *arg __attribute__ ((unused)))
+{
+  /* Modules without a build-id are just looked up without a cache.  */
+  (void) dwfl_module_symcache (mod, cache_dir);
+  return DWARF_CB_OK;
+}
+
 static int
 see_one_module (Dwfl_Module *mod,
 		void **userdata __attribute__ ((unused)),
@@ -552,20 +581,15 @@ adjust_to_section (const char *name, uintmax_t *addr, Dwfl *dwfl)
 }
 
 static void
-print_src (const char *src, int lineno, int linecol, Dwarf_Die *cu)
+print_src_comp_dir (const char *src, int lineno, int linecol,
+		    const char *comp_dir)
 {
-  const char *comp_dir = "";
-  const char *comp_dir_sep = "";
+  const char *comp_dir_sep = "/";
 
   if (only_basenames)
     src = basename (src);
-  else if (use_comp_dir && src[0] != '/')
-    {
-      Dwarf_Attribute attr;
-      comp_dir = dwarf_formstring (dwarf_attr (cu, DW_AT_comp_dir, &attr));
-      if (comp_dir != NULL)
-	comp_dir_sep = "/";
-    }
+  if (only_basenames || !use_comp_dir || src[0] == '/' || comp_dir == NULL)
+    comp_dir = comp_dir_sep = "";
 
   if (linecol != 0)
     printf ("%s%s%s:%d:%d",
@@ -575,6 +599,20 @@ print_src (const char *src, int lineno, int linecol, Dwarf_Die *cu)
 	    comp_dir, comp_dir_sep, src, lineno);
 }
 
+static void
+print_src (const char *src, int lineno, int linecol, Dwarf_Die *cu)
+{
+  const char *comp_dir = NULL;
+
+  if (!only_basenames && use_comp_dir && src[0] != '/')
+    {
+      Dwarf_Attribute attr;
+      comp_dir = dwarf_formstring (dwarf_attr (cu, DW_AT_comp_dir, &attr));
+    }
+
+  print_src_comp_dir (src, lineno, linecol, comp_dir);
+}
+
 static int
 get_addr_width (Dwfl_Module *mod)
 {
@@ -697,11 +735,23 @@ handle_address (const char *string, Dwfl *dwfl)
   if ((show_functions || show_symbols) && pretty)
     printf ("at ");
 
-  Dwfl_Line *line = dwfl_module_getsrc (mod, addr);
-
   const char *src;
   int lineno, linecol;
 
+  /* The cache only knows the file and line, not the flags or the
+     address of the line that --inlines starts from.  */
+  const char *comp_dir;
+  if (cache_dir != NULL && !show_flags && !show_inlines
+      && (src = dwfl_module_symcache_getsrc (mod, addr, &lineno, &linecol,
+					     &comp_dir)) != NULL)
+    {
+      print_src_comp_dir (src, lineno, linecol, comp_dir);
+      putchar ('\n');
+      return 0;
+    }
+
+  Dwfl_Line *line = dwfl_module_getsrc (mod, addr);
+
   if (line != NULL && (src = dwfl_lineinfo (line, &addr, &lineno, &linecol,
 					    NULL, NULL)) != NULL)
     {
@@ -17,6 +17,7 @@
 
 #include <config.h>
 #include <assert.h>
+#include <errno.h>
 #include <argp.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -47,6 +48,10 @@ static int verbose = 0; /* < 0, no warnings, > 0 extra verbosity.  */
 static bool force = false;
 static bool permissive = false;
 static const char *foutput = NULL;
+static unsigned int concurrency = 1;
+
+/* argp key value for --concurrency, non-ascii.  */
+#define OPT_CONCURRENCY 0x100
 
 #define T_UNSET 0
 #define T_DECOMPRESS 1    /* none */
@@ -133,6 +138,17 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
 	argp_error (state, N_("unknown compression type '%s'"), arg);
       break;
 
+    case OPT_CONCURRENCY:
+      {
+	char *endp;
+	errno = 0;
+	unsigned long int num = strtoul (arg, &endp, 10);
+	if (errno != 0 || *endp != '\0' || num == 0 || num > 1024)
+	  argp_error (state, N_("invalid concurrency '%s'"), arg);
+	concurrency = num;
+      }
+      break;
+
     case ARGP_KEY_SUCCESS:
       if (type == T_UNSET)
 	type = T_COMPRESS_ZLIB;
@@ -315,6 +331,10 @@ process_file (const char *fname)
       goto cleanup;
     }
 
+  /* Sections are compressed in place in the input descriptor before
+     being copied to the output.  */
+  elf_compress_threads (elf, concurrency);
+
   /* We don't handle ar files (or anything else), we probably should.  */
   Elf_Kind kind = elf_kind (elf);
   if (kind != ELF_K_ELF)
@@ -1324,6 +1344,9 @@ main (int argc, char **argv)
       { "quiet", 'q', NULL, 0,
 	N_("Be silent when a section cannot be compressed"),
 	0 },
+      { "concurrency", OPT_CONCURRENCY, "NUM", 0,
+	N_("Compress large sections with NUM threads"),
+	0 },
       { NULL, 0, NULL, 0, NULL, 0 }
     };
 
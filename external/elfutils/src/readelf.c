@@ -42,6 +42,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <signal.h>
 
 #include <libeu.h>
@@ -87,6 +88,9 @@ ARGP_PROGRAM_BUG_ADDRESS_DEF = PACKAGE_BUGREPORT;
 /* argp key value for --dyn-syms, non-ascii.  */
 #define PRINT_DYNSYM_TABLE 258
 
+/* argp key value for --concurrency, non-ascii.  */
+#define DWARF_CONCURRENCY 259
+
 /* Terrible hack for hooking unrelated skeleton/split compile units,
    see __libdw_link_skel_split in print_debug.  */
 static bool do_not_close_dwfl = false;
@@ -147,6 +151,9 @@ static const struct argp_option options[] =
     N_("Ignored for compatibility (lines always wide)"), 0 },
   { "decompress", 'z', NULL, 0,
     N_("Show compression information for compressed sections (when used with -S); decompress section before dumping data (when used with -p or -x)"), 0 },
+  { "concurrency", DWARF_CONCURRENCY, "NUM", 0,
+    N_("Decode the units of the info, line and loclists DWARF sections in "
+       "NUM worker processes; output stays in unit order"), 0 },
   { NULL, 0, NULL, 0, NULL, 0 }
 };
 
@@ -243,6 +250,10 @@ static bool print_decompress = false;
 /* True if we want to show split compile units for debug_info skeletons.  */
 static bool show_split_units = false;
 
+/* Number of worker processes decoding the units of .debug_info,
+   .debug_types, .debug_line and .debug_loclists.  */
+static unsigned int dwarf_concurrency = 1;
+
 /* Select printing of debugging sections.  */
 static enum section_e
 {
@@ -600,6 +611,16 @@ parse_opt (int key, char *arg,
     case DWARF_SKELETON:
       dwarf_skeleton = arg;
       break;
+    case DWARF_CONCURRENCY:
+      {
+	char *endp;
+	errno = 0;
+	unsigned long int num = strtoul (arg, &endp, 10);
+	if (errno != 0 || *endp != '\0' || num == 0 || num > 1024)
+	  argp_error (state, _("invalid concurrency '%s'"), arg);
+	dwarf_concurrency = num;
+      }
+      break;
     default:
       return ARGP_ERR_UNKNOWN;
     }
@@ -5086,6 +5107,310 @@ listptr_attr (struct listptr_table *table, size_t idxp,
   return false;
 }
 
+/* Parallel dumping of the units of a section.  libdw caches are not
+   safe to share between threads, so each chunk of units is decoded in
+   a forked worker process that writes its output and any listptrs it
+   noticed into temporary files.  The parent replays those in unit
+   order, so the result is the same as a sequential dump.  */
+
+/* Dumps the units [FIRST, LAST) of a section.  Returns false if the
+   dump of the section stops before LAST.  */
+typedef bool (*dump_units_fn) (void *arg, size_t first, size_t last);
+
+static struct listptr_table *const dump_units_tables[] =
+  {
+    &known_locsptr, &known_loclistsptr, &known_rangelistptr,
+    &known_rnglistptr, &known_addrbases, &known_stroffbases
+  };
+#define NDUMP_UNITS_TABLES \
+  (sizeof dump_units_tables / sizeof dump_units_tables[0])
+
+struct dump_units_chunk
+{
+  size_t first;
+  pid_t pid;
+  int status;
+  bool done;
+  FILE *out;
+  FILE *err;
+  FILE *lists;
+};
+
+static void
+close_dump_units_chunk (struct dump_units_chunk *chunk)
+{
+  if (chunk->out != NULL)
+    fclose (chunk->out);
+  if (chunk->err != NULL)
+    fclose (chunk->err);
+  if (chunk->lists != NULL)
+    fclose (chunk->lists);
+  chunk->out = chunk->err = chunk->lists = NULL;
+}
+
+static void
+__attribute__ ((noreturn))
+dump_units_worker (struct dump_units_chunk *chunk, size_t last,
+		   dump_units_fn dump, void *arg)
+{
+  size_t known[NDUMP_UNITS_TABLES];
+  for (size_t i = 0; i < NDUMP_UNITS_TABLES; ++i)
+    known[i] = dump_units_tables[i]->n;
+  unsigned int errors = error_message_count;
+
+  if (dup2 (fileno (chunk->out), STDOUT_FILENO) < 0
+      || dup2 (fileno (chunk->err), STDERR_FILENO) < 0)
+    _exit (EXIT_FAILURE);
+
+  bool more = dump (arg, chunk->first, last);
+
+  errors = error_message_count - errors;
+  bool ok = (fwrite (&errors, sizeof errors, 1, chunk->lists) == 1
+	     && fwrite (&more, sizeof more, 1, chunk->lists) == 1);
+  for (size_t i = 0; ok && i < NDUMP_UNITS_TABLES; ++i)
+    {
+      struct listptr_table *table = dump_units_tables[i];
+      size_t n = table->n - known[i];
+      ok = (fwrite (&n, sizeof n, 1, chunk->lists) == 1
+	    && fwrite (&table->table[known[i]], sizeof table->table[0], n,
+		       chunk->lists) == n);
+    }
+
+  if (!ok || fflush (chunk->lists) != 0
+      || fflush (stdout) != 0 || fflush (stderr) != 0)
+    _exit (EXIT_FAILURE);
+  _exit (EXIT_SUCCESS);
+}
+
+static void
+copy_dump_units_output (FILE *from, FILE *to)
+{
+  char buf[BUFSIZ];
+  size_t n;
+
+  rewind (from);
+  while ((n = fread (buf, 1, sizeof buf, from)) > 0)
+    fwrite (buf, 1, n, to);
+}
+
+/* Replays the output of a finished worker.  Returns false if the dump
+   of the section should stop after it.  */
+static bool
+emit_dump_units_chunk (struct dump_units_chunk *chunk)
+{
+  copy_dump_units_output (chunk->out, stdout);
+  fflush (stdout);
+  copy_dump_units_output (chunk->err, stderr);
+
+  if (!WIFEXITED (chunk->status) || WEXITSTATUS (chunk->status) != 0)
+    {
+      error (0, 0, _("worker process dumping DWARF units failed"));
+      return false;
+    }
+
+  unsigned int errors;
+  bool more;
+  rewind (chunk->lists);
+  if (fread (&errors, sizeof errors, 1, chunk->lists) != 1
+      || fread (&more, sizeof more, 1, chunk->lists) != 1)
+    goto invalid;
+  error_message_count += errors;
+
+  for (size_t i = 0; i < NDUMP_UNITS_TABLES; ++i)
+    {
+      struct listptr_table *table = dump_units_tables[i];
+      size_t n;
+      if (fread (&n, sizeof n, 1, chunk->lists) != 1)
+	goto invalid;
+      if (n == 0)
+	continue;
+
+      if (table->n + n > table->alloc)
+	{
+	  table->alloc = MAX (table->n + n, 2 * table->alloc);
+	  table->table = xrealloc (table->table,
+				   table->alloc * sizeof table->table[0]);
+	}
+      if (fread (&table->table[table->n], sizeof table->table[0], n,
+		 chunk->lists) != n)
+	goto invalid;
+      table->n += n;
+    }
+
+  return more;
+
+ invalid:
+  error (0, 0, _("cannot read result of worker process dumping DWARF units"));
+  return false;
+}
+
+/* Dumps NUNITS units with DUMP, distributed over dwarf_concurrency
+   worker processes.  OFFSETS holds the start of every unit and the
+   end of the last one, it is used to give the workers chunks of about
+   the same size.  */
+static void
+dump_units (Dwfl_Module *dwflmod, size_t nunits, const Dwarf_Off *offsets,
+	    dump_units_fn dump, void *arg)
+{
+  /* Use a few chunks per worker so one large unit doesn't leave the
+     other workers idle.  */
+  size_t nchunks = MIN (nunits, 4 * (size_t) dwarf_concurrency);
+  if (dwarf_concurrency <= 1 || nchunks < 2)
+    {
+      dump (arg, 0, nunits);
+      return;
+    }
+
+  /* Load the symbol table once instead of in every worker.  */
+  if (print_address_names && !print_unresolved_addresses)
+    (void) dwfl_module_getsymtab (dwflmod);
+
+  struct dump_units_chunk *chunks = xcalloc (nchunks + 1, sizeof *chunks);
+  Dwarf_Off chunk_size = (offsets[nunits] - offsets[0]) / nchunks;
+  size_t n = 0;
+  size_t unit = 0;
+  for (size_t cnt = 0; cnt < nchunks; ++cnt)
+    {
+      Dwarf_Off start = offsets[0] + cnt * chunk_size;
+      while (unit < nunits && offsets[unit] < start)
+	++unit;
+      if (unit < nunits && (n == 0 || unit > chunks[n - 1].first))
+	chunks[n++].first = unit;
+    }
+  nchunks = n;
+  chunks[nchunks].first = nunits;
+
+  size_t next = 0;
+  size_t emitted = 0;
+  unsigned int running = 0;
+  bool more = true;
+  bool failed = false;
+  while (emitted < nchunks)
+    {
+      while (more && !failed && next < nchunks
+	     && running < dwarf_concurrency)
+	{
+	  struct dump_units_chunk *chunk = &chunks[next];
+	  chunk->out = tmpfile ();
+	  chunk->err = tmpfile ();
+	  chunk->lists = tmpfile ();
+	  if (chunk->out == NULL || chunk->err == NULL || chunk->lists == NULL)
+	    {
+	      close_dump_units_chunk (chunk);
+	      failed = true;
+	      break;
+	    }
+
+	  /* Don't let the worker inherit (and write out again) anything
+	     still buffered.  */
+	  fflush (stdout);
+	  fflush (stderr);
+	  chunk->pid = fork ();
+	  if (chunk->pid < 0)
+	    {
+	      close_dump_units_chunk (chunk);
+	      failed = true;
+	      break;
+	    }
+	  if (chunk->pid == 0)
+	    dump_units_worker (chunk, chunks[next + 1].first, dump, arg);
+
+	  ++running;
+	  ++next;
+	}
+
+      /* Nothing left in flight.  */
+      if (emitted == next)
+	break;
+
+      while (!chunks[emitted].done)
+	{
+	  int status;
+	  pid_t pid = waitpid (-1, &status, 0);
+	  if (pid < 0)
+	    {
+	      if (errno == EINTR)
+		continue;
+	      error (EXIT_FAILURE, errno, _("cannot wait for worker process"));
+	    }
+	  for (size_t cnt = emitted; cnt < next; ++cnt)
+	    if (chunks[cnt].pid == pid)
+	      {
+		chunks[cnt].status = status;
+		chunks[cnt].done = true;
+		--running;
+		break;
+	      }
+	}
+
+      while (emitted < next && chunks[emitted].done)
+	{
+	  if (more)
+	    {
+	      more = emit_dump_units_chunk (&chunks[emitted]);
+	      /* The rest of the section is not going to be shown.  */
+	      if (!more)
+		for (size_t cnt = emitted + 1; cnt < next; ++cnt)
+		  if (!chunks[cnt].done)
+		    kill (chunks[cnt].pid, SIGKILL);
+	    }
+	  close_dump_units_chunk (&chunks[emitted]);
+	  ++emitted;
+	}
+    }
+
+  /* If we could not start a worker do the rest ourselves.  */
+  if (more && emitted < nchunks)
+    dump (arg, chunks[emitted].first, nunits);
+
+  free (chunks);
+}
+
+/* Collects the offsets of the units of a section in which every unit
+   starts with an initial length, like .debug_line and .debug_loclists.
+   Stops at the first unit header that doesn't fit, the rest of the
+   section is then taken as one last unit so dumping it reports the
+   error.  Returns the number of units and sets *OFFSETSP to their
+   start offsets followed by the size of the section.  */
+static size_t
+scan_unit_offsets (Dwarf *dbg, Elf_Data *data, Dwarf_Word min_length,
+		   Dwarf_Off **offsetsp)
+{
+  const unsigned char *readp = (const unsigned char *) data->d_buf;
+  const unsigned char *const dataend = readp + data->d_size;
+  size_t n = 0;
+  size_t max = 64;
+  Dwarf_Off *offsets = xmalloc ((max + 1) * sizeof (Dwarf_Off));
+
+  while (readp < dataend)
+    {
+      if (n == max)
+	{
+	  max *= 2;
+	  offsets = xrealloc (offsets, (max + 1) * sizeof (Dwarf_Off));
+	}
+      offsets[n++] = readp - (const unsigned char *) data->d_buf;
+
+      if (unlikely (readp > dataend - 4))
+	break;
+      Dwarf_Word unit_length = read_4ubyte_unaligned_inc (dbg, readp);
+      if (unlikely (unit_length == 0xffffffff))
+	{
+	  if (unlikely (readp > dataend - 8))
+	    break;
+	  unit_length = read_8ubyte_unaligned_inc (dbg, readp);
+	}
+      if (unit_length < min_length
+	  || unit_length > (Dwarf_Word) (dataend - readp))
+	break;
+      readp += unit_length;
+    }
+
+  offsets[n] = data->d_size;
+  *offsetsp = offsets;
+  return n;
+}
+
 static void
 print_debug_abbrev_section (Dwfl_Module *dwflmod __attribute__ ((unused)),
 			    Ebl *ebl, GElf_Ehdr *ehdr __attribute__ ((unused)),
@@ -7723,24 +8048,15 @@ attr_callback (Dwarf_Attribute *attrp, void *arg)
   return DWARF_CB_OK;
 }
 
-static void
-print_debug_units (Dwfl_Module *dwflmod,
-		   Ebl *ebl, GElf_Ehdr *ehdr __attribute__ ((unused)),
-		   Elf_Scn *scn, GElf_Shdr *shdr,
-		   Dwarf *dbg, bool debug_types)
+/* Prints the units following CU up to, but not including, STOP (or
+   the end of the section).  Returns false if printing stopped before
+   STOP.  */
+static bool
+print_debug_units_range (Dwfl_Module *dwflmod, Dwarf *dbg,
+			 const char *secname, bool silent, bool debug_types,
+			 Dwarf_CU *cu, Dwarf_CU *stop)
 {
-  const bool silent = !(print_debug_sections & section_info) && !debug_types;
-  const char *secname = section_name (ebl, shdr);
-
-  if (!silent)
-    printf (_("\
-\nDWARF section [%2zu] '%s' at offset %#" PRIx64 ":\n [Offset]\n"),
-	    elf_ndxscn (scn), secname, (uint64_t) shdr->sh_offset);
-
-  /* If the section is empty we don't have to do anything.  */
-  if (!silent && shdr->sh_size == 0)
-    return;
-
+  bool more = false;
   int maxdies = 20;
   Dwarf_Die *dies = xmalloc (maxdies * sizeof (Dwarf_Die));
 
@@ -7755,25 +8071,9 @@ print_debug_units (Dwfl_Module *dwflmod,
   Dwarf_Off subdie_off;
 
   int unit_res;
-  Dwarf_CU *cu;
-  Dwarf_CU cu_mem;
   uint8_t unit_type;
   Dwarf_Die cudie;
 
-  /* We cheat a little because we want to see only the CUs from .debug_info
-     or .debug_types.  We know the Dwarf_CU struct layout.  Set it up at
-     the end of .debug_info if we want .debug_types only.  Check the returned
-     Dwarf_CU is still in the expected section.  */
-  if (debug_types)
-    {
-      cu_mem.dbg = dbg;
-      cu_mem.end = dbg->sectiondata[IDX_debug_info]->d_size;
-      cu_mem.sec_idx = IDX_debug_info;
-      cu = &cu_mem;
-    }
-  else
-    cu = NULL;
-
  next_cu:
   unit_res = dwarf_get_units (dbg, cu, &cu, &version, &unit_type,
 			      &cudie, NULL);
@@ -7787,6 +8087,12 @@ print_debug_units (Dwfl_Module *dwflmod,
       goto do_return;
     }
 
+  if (cu == stop)
+    {
+      more = true;
+      goto do_return;
+    }
+
   if (cu->sec_idx != (size_t) (debug_types ? IDX_debug_types : IDX_debug_info))
     goto do_return;
 
@@ -8008,6 +8314,130 @@ print_debug_units (Dwfl_Module *dwflmod,
 
  do_return:
   free (dies);
+  return more;
+}
+
+struct debug_units_args
+{
+  Dwfl_Module *dwflmod;
+  Dwarf *dbg;
+  const char *secname;
+  bool silent;
+  bool debug_types;
+  Dwarf_CU *start;
+  Dwarf_CU **cus;
+  size_t ncus;
+};
+
+static bool
+print_debug_units_chunk (void *arg, size_t first, size_t last)
+{
+  struct debug_units_args *args = arg;
+  return print_debug_units_range (args->dwflmod, args->dbg, args->secname,
+				  args->silent, args->debug_types,
+				  first == 0 ? args->start : args->cus[first - 1],
+				  last < args->ncus ? args->cus[last] : NULL);
+}
+
+static void
+print_debug_units (Dwfl_Module *dwflmod,
+		   Ebl *ebl, GElf_Ehdr *ehdr __attribute__ ((unused)),
+		   Elf_Scn *scn, GElf_Shdr *shdr,
+		   Dwarf *dbg, bool debug_types)
+{
+  const bool silent = !(print_debug_sections & section_info) && !debug_types;
+  const char *secname = section_name (ebl, shdr);
+
+  if (!silent)
+    printf (_("\
+\nDWARF section [%2zu] '%s' at offset %#" PRIx64 ":\n [Offset]\n"),
+	    elf_ndxscn (scn), secname, (uint64_t) shdr->sh_offset);
+
+  /* If the section is empty we don't have to do anything.  */
+  if (!silent && shdr->sh_size == 0)
+    return;
+
+  Dwarf_CU *start;
+  Dwarf_CU cu_mem;
+
+  /* We cheat a little because we want to see only the CUs from .debug_info
+     or .debug_types.  We know the Dwarf_CU struct layout.  Set it up at
+     the end of .debug_info if we want .debug_types only.  Check the returned
+     Dwarf_CU is still in the expected section.  */
+  if (debug_types)
+    {
+      cu_mem.dbg = dbg;
+      cu_mem.end = dbg->sectiondata[IDX_debug_info]->d_size;
+      cu_mem.sec_idx = IDX_debug_info;
+      start = &cu_mem;
+    }
+  else
+    start = NULL;
+
+  if (dwarf_concurrency <= 1)
+    {
+      print_debug_units_range (dwflmod, dbg, secname, silent, debug_types,
+			       start, NULL);
+      return;
+    }
+
+  /* Read all unit headers up front, the workers then share the Dwarf_CU
+     structures (and the listptrs pointing to them) with us.  Split units
+     found through skeletons are only created while printing, so leave
+     files with skeleton units to the sequential dump.  */
+  size_t ncus = 0;
+  size_t maxcus = 64;
+  Dwarf_CU **cus = xmalloc (maxcus * sizeof (Dwarf_CU *));
+  Dwarf_Off *offsets = xmalloc ((maxcus + 1) * sizeof (Dwarf_Off));
+  bool parallel = true;
+  Dwarf_CU *cu = start;
+  uint8_t unit_type;
+  int unit_res;
+  while ((unit_res = dwarf_get_units (dbg, cu, &cu, NULL, &unit_type,
+				      NULL, NULL)) == 0)
+    {
+      if (cu->sec_idx != (size_t) (debug_types
+				   ? IDX_debug_types : IDX_debug_info))
+	break;
+      if (unit_type == DW_UT_skeleton)
+	{
+	  parallel = false;
+	  break;
+	}
+      if (ncus == maxcus)
+	{
+	  maxcus *= 2;
+	  cus = xrealloc (cus, maxcus * sizeof (Dwarf_CU *));
+	  offsets = xrealloc (offsets, (maxcus + 1) * sizeof (Dwarf_Off));
+	}
+      offsets[ncus] = cu->start;
+      cus[ncus++] = cu;
+      offsets[ncus] = cu->end;
+    }
+  if (unit_res == -1)
+    parallel = false;
+
+  if (parallel && ncus > 0)
+    {
+      struct debug_units_args args =
+	{
+	  .dwflmod = dwflmod,
+	  .dbg = dbg,
+	  .secname = secname,
+	  .silent = silent,
+	  .debug_types = debug_types,
+	  .start = start,
+	  .cus = cus,
+	  .ncus = ncus
+	};
+      dump_units (dwflmod, ncus, offsets, print_debug_units_chunk, &args);
+    }
+  else
+    print_debug_units_range (dwflmod, dbg, secname, silent, debug_types,
+			     start, NULL);
+
+  free (offsets);
+  free (cus);
 }
 
 static void
@@ -8386,40 +8816,20 @@ run_advance_pc (unsigned int op_advance,
   *op_index = advanced_op_index % max_ops_per_instr;
 }
 
-static void
-print_debug_line_section (Dwfl_Module *dwflmod, Ebl *ebl, GElf_Ehdr *ehdr,
-			  Elf_Scn *scn, GElf_Shdr *shdr, Dwarf *dbg)
+/* Prints the line number programs between offsets START and END of
+   the .debug_line DATA.  Returns false if the data is too broken to
+   go on.  */
+static bool
+print_debug_line_units (Dwfl_Module *dwflmod, Ebl *ebl, Elf_Scn *scn,
+			GElf_Shdr *shdr, Dwarf *dbg, Elf_Data *data,
+			Dwarf_Off start, Dwarf_Off end)
 {
-  if (decodedline)
-    {
-      print_decoded_line_section (dwflmod, ebl, ehdr, scn, shdr, dbg);
-      return;
-    }
-
-  printf (_("\
-\nDWARF section [%2zu] '%s' at offset %#" PRIx64 ":\n"),
-	  elf_ndxscn (scn), section_name (ebl, shdr),
-	  (uint64_t) shdr->sh_offset);
-
-  if (shdr->sh_size == 0)
-    return;
-
-  /* There is no functionality in libdw to read the information in the
-     way it is represented here.  Hardcode the decoder.  */
-  Elf_Data *data = (dbg->sectiondata[IDX_debug_line]
-		    ?: elf_rawdata (scn, NULL));
-  if (unlikely (data == NULL))
-    {
-      error (0, 0, _("cannot get line data section data: %s"),
-	     elf_errmsg (-1));
-      return;
-    }
-
-  const unsigned char *linep = (const unsigned char *) data->d_buf;
+  const unsigned char *linep = (const unsigned char *) data->d_buf + start;
+  const unsigned char *const unitsendp
+    = (const unsigned char *) data->d_buf + end;
   const unsigned char *lineendp;
 
-  while (linep
-	 < (lineendp = (const unsigned char *) data->d_buf + data->d_size))
+  while (linep < (lineendp = unitsendp))
     {
       size_t start_offset = linep - (const unsigned char *) data->d_buf;
 
@@ -8436,7 +8846,7 @@ print_debug_line_section (Dwfl_Module *dwflmod, Ebl *ebl, GElf_Ehdr *ehdr,
 	    invalid_data:
 	      error (0, 0, _("invalid data in section [%zu] '%s'"),
 		     elf_ndxscn (scn), section_name (ebl, shdr));
-	      return;
+	      return false;
 	    }
 	  unit_length = read_8ubyte_unaligned_inc (dbg, linep);
 	  length = 8;
@@ -9130,39 +9540,97 @@ print_debug_line_section (Dwfl_Module *dwflmod, Ebl *ebl, GElf_Ehdr *ehdr,
 	}
     }
 
-  /* There must only be one data block.  */
-  assert (elf_getdata (scn, data) == NULL);
+  return true;
 }
 
+struct debug_line_args
+{
+  Dwfl_Module *dwflmod;
+  Ebl *ebl;
+  Elf_Scn *scn;
+  GElf_Shdr *shdr;
+  Dwarf *dbg;
+  Elf_Data *data;
+  const Dwarf_Off *offsets;
+};
+
+static bool
+print_debug_line_chunk (void *arg, size_t first, size_t last)
+{
+  struct debug_line_args *args = arg;
+  return print_debug_line_units (args->dwflmod, args->ebl, args->scn,
+				 args->shdr, args->dbg, args->data,
+				 args->offsets[first], args->offsets[last]);
+}
 
 static void
-print_debug_loclists_section (Dwfl_Module *dwflmod,
-			      Ebl *ebl,
-			      GElf_Ehdr *ehdr __attribute__ ((unused)),
-			      Elf_Scn *scn, GElf_Shdr *shdr,
-			      Dwarf *dbg)
+print_debug_line_section (Dwfl_Module *dwflmod, Ebl *ebl, GElf_Ehdr *ehdr,
+			  Elf_Scn *scn, GElf_Shdr *shdr, Dwarf *dbg)
 {
+  if (decodedline)
+    {
+      print_decoded_line_section (dwflmod, ebl, ehdr, scn, shdr, dbg);
+      return;
+    }
+
   printf (_("\
 \nDWARF section [%2zu] '%s' at offset %#" PRIx64 ":\n"),
 	  elf_ndxscn (scn), section_name (ebl, shdr),
 	  (uint64_t) shdr->sh_offset);
 
-  Elf_Data *data = (dbg->sectiondata[IDX_debug_loclists]
+  if (shdr->sh_size == 0)
+    return;
+
+  /* There is no functionality in libdw to read the information in the
+     way it is represented here.  Hardcode the decoder.  */
+  Elf_Data *data = (dbg->sectiondata[IDX_debug_line]
 		    ?: elf_rawdata (scn, NULL));
   if (unlikely (data == NULL))
     {
-      error (0, 0, _("cannot get .debug_loclists content: %s"),
+      error (0, 0, _("cannot get line data section data: %s"),
 	     elf_errmsg (-1));
       return;
     }
 
-  /* For the listptr to get the base address/CU.  */
-  sort_listptr (&known_loclistsptr, "loclistsptr");
+  if (dwarf_concurrency <= 1)
+    print_debug_line_units (dwflmod, ebl, scn, shdr, dbg, data,
+			    0, data->d_size);
+  else
+    {
+      Dwarf_Off *offsets;
+      size_t nunits = scan_unit_offsets (dbg, data, 0, &offsets);
+      struct debug_line_args args =
+	{
+	  .dwflmod = dwflmod,
+	  .ebl = ebl,
+	  .scn = scn,
+	  .shdr = shdr,
+	  .dbg = dbg,
+	  .data = data,
+	  .offsets = offsets
+	};
+      dump_units (dwflmod, nunits, offsets, print_debug_line_chunk, &args);
+      free (offsets);
+    }
+
+  /* There must only be one data block.  */
+  assert (elf_getdata (scn, data) == NULL);
+}
+
+
+/* Prints the location list tables between offsets START and END of
+   the .debug_loclists DATA.  Returns false if the data is too broken
+   to go on.  Assumes known_loclistsptr has been sorted.  */
+static bool
+print_debug_loclists_units (Dwfl_Module *dwflmod, Ebl *ebl, Elf_Scn *scn,
+			    GElf_Shdr *shdr, Dwarf *dbg, Elf_Data *data,
+			    Dwarf_Off start, Dwarf_Off end)
+{
   size_t listptr_idx = 0;
 
-  const unsigned char *readp = data->d_buf;
+  const unsigned char *readp = (unsigned char *) data->d_buf + start;
   const unsigned char *const dataend = ((unsigned char *) data->d_buf
-					+ data->d_size);
+					+ end);
   while (readp < dataend)
     {
       if (unlikely (readp > dataend - 4))
@@ -9170,7 +9638,7 @@ print_debug_loclists_section (Dwfl_Module *dwflmod,
 	invalid_data:
 	  error (0, 0, _("invalid data in section [%zu] '%s'"),
 		 elf_ndxscn (scn), section_name (ebl, shdr));
-	  return;
+	  return false;
 	}
 
       ptrdiff_t offset = readp - (unsigned char *) data->d_buf;
@@ -9597,6 +10065,78 @@ print_debug_loclists_section (Dwfl_Module *dwflmod,
 	  readp = nexthdr;
 	}
     }
+
+  return true;
+}
+
+struct debug_loclists_args
+{
+  Dwfl_Module *dwflmod;
+  Ebl *ebl;
+  Elf_Scn *scn;
+  GElf_Shdr *shdr;
+  Dwarf *dbg;
+  Elf_Data *data;
+  const Dwarf_Off *offsets;
+};
+
+static bool
+print_debug_loclists_chunk (void *arg, size_t first, size_t last)
+{
+  struct debug_loclists_args *args = arg;
+  return print_debug_loclists_units (args->dwflmod, args->ebl, args->scn,
+				     args->shdr, args->dbg, args->data,
+				     args->offsets[first],
+				     args->offsets[last]);
+}
+
+static void
+print_debug_loclists_section (Dwfl_Module *dwflmod,
+			      Ebl *ebl,
+			      GElf_Ehdr *ehdr __attribute__ ((unused)),
+			      Elf_Scn *scn, GElf_Shdr *shdr,
+			      Dwarf *dbg)
+{
+  printf (_("\
+\nDWARF section [%2zu] '%s' at offset %#" PRIx64 ":\n"),
+	  elf_ndxscn (scn), section_name (ebl, shdr),
+	  (uint64_t) shdr->sh_offset);
+
+  Elf_Data *data = (dbg->sectiondata[IDX_debug_loclists]
+		    ?: elf_rawdata (scn, NULL));
+  if (unlikely (data == NULL))
+    {
+      error (0, 0, _("cannot get .debug_loclists content: %s"),
+	     elf_errmsg (-1));
+      return;
+    }
+
+  /* For the listptr to get the base address/CU.  */
+  sort_listptr (&known_loclistsptr, "loclistsptr");
+
+  if (dwarf_concurrency <= 1)
+    print_debug_loclists_units (dwflmod, ebl, scn, shdr, dbg, data,
+				0, data->d_size);
+  else
+    {
+      /* Every table starts with at least an 8 byte header after the
+	 unit length.  */
+      Dwarf_Off *offsets;
+      size_t nunits = scan_unit_offsets (dbg, data, 8, &offsets);
+      struct debug_loclists_args args =
+	{
+	  .dwflmod = dwflmod,
+	  .ebl = ebl,
+	  .scn = scn,
+	  .shdr = shdr,
+	  .dbg = dbg,
+	  .data = data,
+	  .offsets = offsets
+	};
+      dump_units (dwflmod, nunits, offsets, print_debug_loclists_chunk,
+		  &args);
+      free (offsets);
+    }
 }
 
 
@@ -40,6 +40,7 @@ ARGP_PROGRAM_BUG_ADDRESS_DEF = PACKAGE_BUGREPORT;
 /* non-printable argp options.  */
 #define OPT_DEBUGINFO	0x100
 #define OPT_COREFILE	0x101
+#define OPT_CACHE	0x102
 
 static bool show_activation = false;
 static bool show_module = false;
@@ -73,6 +74,7 @@ static int core_fd = -1;
 static Elf *core = NULL;
 static const char *exec = NULL;
 static char *debuginfo_path = NULL;
+static const char *cache_dir = NULL;
 
 static const Dwfl_Callbacks proc_callbacks =
   {
@@ -174,6 +176,17 @@ module_callback (Dwfl_Module *mod, void **userdata __attribute__((unused)),
   return DWARF_CB_OK;
 }
 
+static int
+symcache_callback (Dwfl_Module *mod, void **userdata __attribute__((unused)),
+		   const char *name __attribute__((unused)),
+		   Dwarf_Addr start __attribute__((unused)),
+		   void *arg __attribute__((unused)))
+{
+  /* Modules without a build-id are just looked up without a cache.  */
+  (void) dwfl_module_symcache (mod, cache_dir);
+  return DWARF_CB_OK;
+}
+
 static int
 frame_callback (Dwfl_Frame *state, void *arg)
 {
@@ -300,9 +313,15 @@ print_frame (int nr, Dwarf_Addr pc, bool isactivation,
 	}
       else
 	{
-	  Dwfl_Line *lineobj = dwfl_module_getsrc(mod, pc_adjusted);
-	  if (lineobj)
-	    sname = dwfl_lineinfo (lineobj, NULL, &line, &col, NULL, NULL);
+	  if (cache_dir != NULL)
+	    sname = dwfl_module_symcache_getsrc (mod, pc_adjusted,
+						 &line, &col, NULL);
+	  if (sname == NULL)
+	    {
+	      Dwfl_Line *lineobj = dwfl_module_getsrc(mod, pc_adjusted);
+	      if (lineobj)
+		sname = dwfl_lineinfo (lineobj, NULL, &line, &col, NULL, NULL);
+	    }
 	}
 
       if (sname != NULL)
@@ -505,6 +524,10 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
       debuginfo_path = arg;
       break;
 
+    case OPT_CACHE:
+      cache_dir = arg;
+      break;
+
     case 'm':
       show_module = true;
       break;
@@ -648,6 +671,8 @@ main (int argc, char **argv)
       {  "executable", 'e', "EXEC", 0, N_("(optional) EXECUTABLE that produced COREFILE"), 0 },
       { "debuginfo-path", OPT_DEBUGINFO, "PATH", 0,
 	N_("Search path for separate debuginfo files"), 0 },
+      { "cache", OPT_CACHE, "DIR", 0,
+	N_("Keep address ranges, line tables and CFI search tables of modules in DIR, keyed by build-id"), 0 },
 
       { NULL, 0, NULL, 0, N_("Output selection options:"), 0 },
       { "activation",  'a', NULL, 0,
@@ -694,6 +719,10 @@ invoked with bad or missing arguments it will exit with return code 64.")
 
   argp_parse (&argp, argc, argv, 0, NULL, NULL);
 
+  /* Load the caches before unwinding, which uses their CFI tables.  */
+  if (cache_dir != NULL)
+    dwfl_getmodules (dwfl, symcache_callback, NULL, 0);
+
   if (show_modules)
     {
       printf ("PID %lld - %s module memory map\n", (long long) dwfl_pid (dwfl),
@@ -62,6 +62,7 @@ ARGP_PROGRAM_BUG_ADDRESS_DEF = PACKAGE_BUGREPORT;
 #define OPT_RELOC_DEBUG 	0x103
 #define OPT_KEEP_SECTION 	0x104
 #define OPT_RELOC_DEBUG_ONLY    0x105
+#define OPT_CONCURRENCY		0x106
 
 
 /* Definitions of arguments for argp functions.  */
@@ -91,6 +92,8 @@ static const struct argp_option options[] =
   { "keep-section", OPT_KEEP_SECTION, "SECTION", 0, N_("Keep the named section.  SECTION is an extended wildcard pattern.  May be given more than once."), 0 },
   { "permissive", OPT_PERMISSIVE, NULL, 0,
     N_("Relax a few rules to handle slightly broken ELF files"), 0 },
+  { "concurrency", OPT_CONCURRENCY, "NUM", 0,
+    N_("Recompress large debug sections with NUM threads"), 0 },
   { NULL, 0, NULL, 0, NULL, 0 }
 };
 
@@ -159,6 +162,9 @@ static bool remove_shdrs;
 /* If true relax some ELF rules for input files.  */
 static bool permissive;
 
+/* Number of threads used to recompress a debug section.  */
+static unsigned int concurrency = 1;
+
 /* If true perform relocations between debug sections.  */
 static bool reloc_debug;
 
@@ -327,6 +333,20 @@ parse_opt (int key, char *arg, struct argp_state *state)
       remove_comment = true;
       break;
 
+    case OPT_CONCURRENCY:
+      {
+	char *endp;
+	errno = 0;
+	unsigned long int num = strtoul (arg, &endp, 10);
+	if (errno != 0 || *endp != '\0' || num == 0 || num > 1024)
+	  {
+	    error (0, 0, _("invalid concurrency '%s'"), arg);
+	    return EINVAL;
+	  }
+	concurrency = num;
+      }
+      break;
+
     case 'R':
       if (fnmatch (arg, ".comment", FNM_EXTMATCH) == 0)
 	remove_comment = true;
@@ -570,6 +590,8 @@ static void
 remove_debug_relocations (Ebl *ebl, Elf *elf, GElf_Ehdr *ehdr,
 			  const char *fname, size_t shstrndx)
 {
+  elf_compress_threads (elf, concurrency);
+
   Elf_Scn *scn = NULL;
   while ((scn = elf_nextscn (elf, scn)) != NULL)
     {
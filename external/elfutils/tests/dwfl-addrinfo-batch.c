@@ -0,0 +1,198 @@
+/* Test program for dwfl_module_addrinfo_batch.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include ELFUTILS_HEADER(dwfl)
+#include <dwarf.h>
+#include "system.h"
+
+/* Checks that the indexed lookups of dwfl_module_addrinfo_batch give
+   the same results as the plain dwfl_module_addrinfo, dwfl_module_getsrc
+   and dwarf_getscopes lookups.  */
+
+static const Dwfl_Callbacks offline_callbacks =
+  {
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+    .section_address = dwfl_offline_section_address,
+  };
+
+/* dwfl_module_addrinfo builds an index itself after a number of lookups,
+   so the reference lookups use a fresh Dwfl every few addresses.  */
+#define REFERENCE_LOOKUPS 8
+
+static Dwfl_Module *
+report (Dwfl **dwflp, const char *file)
+{
+  *dwflp = dwfl_begin (&offline_callbacks);
+  assert (*dwflp != NULL);
+  Dwfl_Module *mod = dwfl_report_offline (*dwflp, file, file, -1);
+  if (mod == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_report_offline: %s", dwfl_errmsg (-1));
+  dwfl_report_end (*dwflp, NULL, NULL);
+  return mod;
+}
+
+static void
+add_addr (GElf_Addr **addrs, size_t *naddrs, size_t *maxaddrs,
+	  GElf_Addr addr)
+{
+  if (*naddrs == *maxaddrs)
+    {
+      *maxaddrs = 2 * *maxaddrs + 1024;
+      *addrs = realloc (*addrs, *maxaddrs * sizeof (GElf_Addr));
+      assert (*addrs != NULL);
+    }
+  (*addrs)[(*naddrs)++] = addr;
+}
+
+static Dwarf_Off
+innermost_scope (Dwfl_Module *mod, GElf_Addr addr)
+{
+  Dwarf_Addr bias;
+  Dwarf_Die *cudie = dwfl_module_addrdie (mod, addr, &bias);
+  if (cudie == NULL)
+    return 0;
+
+  Dwarf_Die *scopes;
+  int nscopes = dwarf_getscopes (cudie, addr - bias, &scopes);
+  Dwarf_Off off = 0;
+  for (int i = 0; i < nscopes; ++i)
+    if (dwarf_tag (&scopes[i]) == DW_TAG_subprogram
+	|| dwarf_tag (&scopes[i]) == DW_TAG_inlined_subroutine)
+      {
+	off = dwarf_dieoffset (&scopes[i]);
+	break;
+      }
+  if (nscopes > 0)
+    free (scopes);
+  return off;
+}
+
+static int
+line_differs (Dwfl_Line *a, Dwfl_Line *b)
+{
+  if (a == NULL || b == NULL)
+    return a != b;
+
+  Dwarf_Addr aaddr, baddr;
+  int aline, bline, acol, bcol;
+  const char *afile = dwfl_lineinfo (a, &aaddr, &aline, &acol, NULL, NULL);
+  const char *bfile = dwfl_lineinfo (b, &baddr, &bline, &bcol, NULL, NULL);
+  return (aaddr != baddr || aline != bline || acol != bcol
+	  || strcmp (afile, bfile) != 0);
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc != 2)
+    error (EXIT_FAILURE, 0, "usage: %s FILE", argv[0]);
+
+  Dwfl *dwfl;
+  Dwfl_Module *mod = report (&dwfl, argv[1]);
+
+  /* Probe the boundaries of all symbols and addresses spread over the
+     whole module.  */
+  GElf_Addr *addrs = NULL;
+  size_t naddrs = 0, maxaddrs = 0;
+  int syms = dwfl_module_getsymtab (mod);
+  for (int ndx = 0; ndx < syms; ++ndx)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      if (dwfl_module_getsym_info (mod, ndx, &sym, &value,
+				   NULL, NULL, NULL) == NULL)
+	continue;
+      add_addr (&addrs, &naddrs, &maxaddrs, value - 1);
+      add_addr (&addrs, &naddrs, &maxaddrs, value);
+      add_addr (&addrs, &naddrs, &maxaddrs, value + 1);
+      add_addr (&addrs, &naddrs, &maxaddrs, value + sym.st_size - 1);
+      add_addr (&addrs, &naddrs, &maxaddrs, value + sym.st_size);
+    }
+  Dwarf_Addr low, high;
+  dwfl_module_info (mod, NULL, &low, &high, NULL, NULL, NULL, NULL);
+  for (Dwarf_Addr addr = low; addr < high; addr += (high - low) / 4096 + 1)
+    add_addr (&addrs, &naddrs, &maxaddrs, addr);
+
+  Dwfl_Addrinfo *infos = malloc (naddrs * sizeof infos[0]);
+  assert (infos != NULL);
+  if (dwfl_module_addrinfo_batch (mod, addrs, naddrs, infos) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_module_addrinfo_batch: %s",
+	   dwfl_errmsg (-1));
+
+  int result = 0;
+  Dwfl *refdwfl = NULL;
+  Dwfl_Module *refmod = NULL;
+  for (size_t i = 0; i < naddrs; ++i)
+    {
+      if (i % REFERENCE_LOOKUPS == 0)
+	{
+	  if (refdwfl != NULL)
+	    dwfl_end (refdwfl);
+	  refmod = report (&refdwfl, argv[1]);
+	}
+
+      GElf_Off off;
+      GElf_Sym sym;
+      GElf_Word shndx;
+      Elf *elf;
+      Dwarf_Addr bias;
+      const char *name = dwfl_module_addrinfo (refmod, addrs[i], &off, &sym,
+					       &shndx, &elf, &bias);
+      const Dwfl_Addrinfo *info = &infos[i];
+      if (name == NULL || info->name == NULL
+	  ? name != info->name
+	  : (strcmp (name, info->name) != 0 || off != info->offset
+	     || sym.st_value != info->sym.st_value
+	     || sym.st_size != info->sym.st_size
+	     || sym.st_info != info->sym.st_info
+	     || shndx != info->shndx || bias != info->bias))
+	{
+	  printf ("%#" PRIx64 ": symbol %s+%#" PRIx64 " instead of %s+%#"
+		  PRIx64 "\n", addrs[i], info->name ?: "<none>",
+		  info->offset, name ?: "<none>", off);
+	  result = 1;
+	}
+
+      if (line_differs (info->line, dwfl_module_getsrc (refmod, addrs[i])))
+	{
+	  printf ("%#" PRIx64 ": different source line\n", addrs[i]);
+	  result = 1;
+	}
+
+      Dwarf_Off scope = innermost_scope (mod, addrs[i]);
+      if (scope != (info->scope != NULL ? dwarf_dieoffset (info->scope) : 0))
+	{
+	  printf ("%#" PRIx64 ": scope [%" PRIx64 "] instead of [%" PRIx64
+		  "]\n", addrs[i],
+		  info->scope != NULL ? dwarf_dieoffset (info->scope) : 0,
+		  scope);
+	  result = 1;
+	}
+    }
+
+  if (refdwfl != NULL)
+    dwfl_end (refdwfl);
+  dwfl_end (dwfl);
+  free (infos);
+  free (addrs);
+  return result;
+}
@@ -0,0 +1,80 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# See run-addr2line-i-test.sh and run-stack-d-test.sh
+testfiles testfile-inlines testfiledwarfinlines testfiledwarfinlines.core
+
+tempfiles addrs nocache.out cache.out
+
+cachedir=$(pwd)/symcache
+rm -rf $cachedir
+
+cat > addrs <<\EOF
+0x00000000000005a0
+0x00000000000005a1
+0x00000000000005b0
+0x00000000000005b1
+0x00000000000005c0
+0x00000000000005d0
+0x00000000000005e0
+0x00000000000005e1
+0x00000000000005f0
+0x00000000000005f1
+0x00000000000005f2
+0x0000000000000400
+0x0000000000001000
+EOF
+
+# The first run creates the cache, the second one uses it, and both
+# must agree with addr2line without a cache.
+for opts in "-a -f" "-A -s" "--pretty-print -a -f -s"; do
+  testrun ${abs_top_builddir}/src/addr2line $opts -e testfile-inlines \
+    < addrs > nocache.out
+  for run in create use; do
+    testrun ${abs_top_builddir}/src/addr2line --cache=$cachedir $opts \
+      -e testfile-inlines < addrs > cache.out
+    cmp nocache.out cache.out
+  done
+done
+
+test -f $cachedir/2135fd61aca50b90333a956bec1ecfed572dd588
+
+# A damaged cache is replaced.
+echo garbage > $cachedir/2135fd61aca50b90333a956bec1ecfed572dd588
+testrun ${abs_top_builddir}/src/addr2line -a -f -e testfile-inlines \
+  < addrs > nocache.out
+testrun ${abs_top_builddir}/src/addr2line --cache=$cachedir -a -f \
+  -e testfile-inlines < addrs > cache.out
+cmp nocache.out cache.out
+test $(wc -c < $cachedir/2135fd61aca50b90333a956bec1ecfed572dd588) -gt 100
+
+# Unwinding and source lines in eu-stack.
+testrun ${abs_top_builddir}/src/stack -v -n 3 -e testfiledwarfinlines \
+  --core testfiledwarfinlines.core > nocache.out 2>&1 || true
+for run in create use; do
+  testrun ${abs_top_builddir}/src/stack --cache=$cachedir -v -n 3 \
+    -e testfiledwarfinlines --core testfiledwarfinlines.core \
+    > cache.out 2>&1 || true
+  cmp nocache.out cache.out
+done
+
+test -f $cachedir/b602505bce411b1c8e602f6fe03545dae0eefcb0
+
+rm -rf $cachedir
+
+exit 0
@@ -0,0 +1,28 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# Compare the indexed lookups with the plain ones.
+testfiles testfile-dwarf-5 testfile66
+
+for file in testfile-dwarf-5 testfile66; do
+  testrun ${abs_builddir}/dwfl-addrinfo-batch $file
+done
+
+testrun_on_self ${abs_builddir}/dwfl-addrinfo-batch
+
+exit 0
@@ -0,0 +1,45 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# The debug sections of our own libraries are big enough to be split
+# in blocks.  Compress them with several threads and check that they
+# decompress to the original data again.
+for file in $self_test_files_lib; do
+  uncompressedfile=self.uncompressed
+  tempfiles $uncompressedfile
+  testrun ${abs_top_builddir}/src/elfcompress -q -t none \
+    -o $uncompressedfile $file
+
+  for t in zlib gnu; do
+    compressedfile=self.$t
+    roundtripfile=self.$t.uncompressed
+    tempfiles $compressedfile $roundtripfile
+    echo "compress $t $file"
+    testrun ${abs_top_builddir}/src/elfcompress -q -t $t --concurrency=4 \
+      -o $compressedfile $uncompressedfile
+    testrun ${abs_top_builddir}/src/elflint --gnu-ld $compressedfile
+    test $(stat -c%s $compressedfile) -lt $(stat -c%s $uncompressedfile) ||
+      { echo "*** failure $compressedfile not smaller"; exit 1; }
+
+    testrun ${abs_top_builddir}/src/elfcompress -q -t none \
+      -o $roundtripfile $compressedfile
+    testrun ${abs_top_builddir}/src/elfcmp $uncompressedfile $roundtripfile
+  done
+done
+
+exit 0
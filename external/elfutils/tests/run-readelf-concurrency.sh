@@ -0,0 +1,37 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# --concurrency decodes the units in worker processes, the output
+# (and the listptrs noticed for the loc/ranges sections) must be the
+# same as that of a sequential dump.
+testfiles testfile-dwarf-4 testfile-dwarf-5 testfile-splitdwarf-5
+testfiles testfile-debug-types testfileloc
+
+tempfiles readelf.out.1 readelf.out.2
+
+for file in testfile-dwarf-4 testfile-dwarf-5 testfile-splitdwarf-5 \
+	    testfile-debug-types testfileloc $self_test_files_lib; do
+  for opt in -w --debug-dump=line --debug-dump=loc; do
+    testrun ${abs_top_builddir}/src/readelf -N $opt $file > readelf.out.1
+    testrun ${abs_top_builddir}/src/readelf -N --concurrency=3 $opt $file \
+      > readelf.out.2
+    diff -u readelf.out.1 readelf.out.2 || exit 1
+  done
+done
+
+exit 0
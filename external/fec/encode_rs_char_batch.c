@@ -0,0 +1,291 @@
+/* Reed-Solomon encoder for many codewords at once
+ *
+ * The codewords are encoded side by side, one per byte lane of a vector
+ * register. Multiplication by each generator coefficient is done with a
+ * pair of 16-entry tables indexed by the low and high nibble of the
+ * feedback (PSHUFB on x86), so a whole row of feedback symbols is
+ * multiplied in a few instructions. Only 8-bit symbols take the SIMD path;
+ * other symbol sizes fall back to encode_rs_char() one codeword at a time.
+ *
+ * May be used under the terms of the GNU Lesser General Public License (LGPL)
+ */
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "char.h"
+#include "rs-common.h"
+#include "fec.h"
+
+/* Largest number of codewords encoded side by side */
+#define LANES 32
+
+/* Upper bound of threads used by encode_rs_char_batch() */
+#define MAX_THREADS 64
+
+/* Multiplication tables for the generator coefficients:
+ * GENPOLY[j] times x is lo[j][x & 15] ^ hi[j][x >> 4]
+ */
+struct rs_tables {
+  unsigned char lo[256][16];
+  unsigned char hi[256][16];
+};
+
+/* One row of symbols per code position, rows are stride bytes apart */
+struct rs_cols {
+  unsigned char *data;
+  unsigned char *parity;
+  size_t stride;
+  int ncols;
+};
+
+/* Best instruction set for encode_cols(), set up by init_tables() */
+static enum {SIMD_UNKNOWN=0,SIMD_PORT,SIMD_SSSE3,SIMD_AVX2} simd_mode;
+
+static void init_tables(struct rs *rs,struct rs_tables *t){
+  int j,x;
+
+  if(simd_mode == SIMD_UNKNOWN){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+      simd_mode = SIMD_AVX2;
+    else if(__builtin_cpu_supports("ssse3"))
+      simd_mode = SIMD_SSSE3;
+    else
+#endif
+      simd_mode = SIMD_PORT;
+  }
+
+  /* Same products as the feedback term of encode_rs.h */
+  for(j=0;j<=NROOTS;j++){
+    for(x=0;x<16;x++){
+      t->lo[j][x] = x ? ALPHA_TO[MODNN(INDEX_OF[x] + GENPOLY[j])] : 0;
+      t->hi[j][x] = x ? ALPHA_TO[MODNN(INDEX_OF[x << 4] + GENPOLY[j])] : 0;
+    }
+  }
+}
+
+/* Portable version, one column at a time */
+static void encode_cols_port(struct rs *rs,struct rs_tables *t,struct rs_cols *c,int first){
+  unsigned char par[256];
+  int b,i,j;
+  unsigned char f;
+
+  for(b=first;b<c->ncols;b++){
+    memset(par,0,sizeof(par));
+    for(i=0;i<NN-NROOTS-PAD;i++){
+      f = c->data[i*c->stride + b] ^ par[0];
+      /* par[NROOTS] stays zero and feeds the last parity symbol */
+      for(j=0;j<NROOTS;j++)
+	par[j] = par[j+1] ^ t->lo[NROOTS-1-j][f & 15] ^ t->hi[NROOTS-1-j][f >> 4];
+    }
+    for(j=0;j<NROOTS;j++)
+      c->parity[j*c->stride + b] = par[j];
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("ssse3")))
+static void encode_cols_ssse3(struct rs *rs,struct rs_tables *t,struct rs_cols *c){
+  __m128i par[256];
+  __m128i mask = _mm_set1_epi8(0x0f);
+  __m128i f,flo,fhi;
+  int b,i,j;
+
+  for(b=0;b+16<=c->ncols;b+=16){
+    for(j=0;j<=NROOTS;j++)
+      par[j] = _mm_setzero_si128();
+    for(i=0;i<NN-NROOTS-PAD;i++){
+      f = _mm_loadu_si128((__m128i *)&c->data[i*c->stride + b]);
+      f = _mm_xor_si128(f,par[0]);
+      flo = _mm_and_si128(f,mask);
+      fhi = _mm_and_si128(_mm_srli_epi16(f,4),mask);
+      for(j=0;j<NROOTS;j++){
+	par[j] = _mm_xor_si128(par[j+1],
+	    _mm_xor_si128(_mm_shuffle_epi8(_mm_loadu_si128((__m128i *)t->lo[NROOTS-1-j]),flo),
+			  _mm_shuffle_epi8(_mm_loadu_si128((__m128i *)t->hi[NROOTS-1-j]),fhi)));
+      }
+    }
+    for(j=0;j<NROOTS;j++)
+      _mm_storeu_si128((__m128i *)&c->parity[j*c->stride + b],par[j]);
+  }
+  encode_cols_port(rs,t,c,b);
+}
+
+__attribute__((target("avx2")))
+static void encode_cols_avx2(struct rs *rs,struct rs_tables *t,struct rs_cols *c){
+  __m256i par[256];
+  __m256i mask = _mm256_set1_epi8(0x0f);
+  __m256i f,flo,fhi;
+  int b,i,j;
+
+  for(b=0;b+32<=c->ncols;b+=32){
+    for(j=0;j<=NROOTS;j++)
+      par[j] = _mm256_setzero_si256();
+    for(i=0;i<NN-NROOTS-PAD;i++){
+      f = _mm256_loadu_si256((__m256i *)&c->data[i*c->stride + b]);
+      f = _mm256_xor_si256(f,par[0]);
+      flo = _mm256_and_si256(f,mask);
+      fhi = _mm256_and_si256(_mm256_srli_epi16(f,4),mask);
+      for(j=0;j<NROOTS;j++){
+	par[j] = _mm256_xor_si256(par[j+1],
+	    _mm256_xor_si256(_mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)t->lo[NROOTS-1-j])),flo),
+			     _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i *)t->hi[NROOTS-1-j])),fhi)));
+      }
+    }
+    for(j=0;j<NROOTS;j++)
+      _mm256_storeu_si256((__m256i *)&c->parity[j*c->stride + b],par[j]);
+  }
+  encode_cols_ssse3(rs,t,&(struct rs_cols){c->data + b,c->parity + b,c->stride,c->ncols - b});
+}
+
+#endif
+
+static void encode_cols(struct rs *rs,struct rs_tables *t,struct rs_cols *c){
+  switch(simd_mode){
+#if defined(__x86_64__) || defined(__i386__)
+  case SIMD_AVX2:
+    encode_cols_avx2(rs,t,c);
+    return;
+  case SIMD_SSSE3:
+    encode_cols_ssse3(rs,t,c);
+    return;
+#endif
+  default:
+    encode_cols_port(rs,t,c,0);
+    return;
+  }
+}
+
+/* Encode ncols interleaved codewords: symbol i of codeword b is
+ * data[i*stride + b], parity symbol j goes to parity[j*stride + b]
+ */
+void encode_rs_char_interleaved(void *p,data_t *data,data_t *parity,int ncols,int stride){
+  struct rs *rs = (struct rs *)p;
+  struct rs_tables *t;
+  struct rs_cols c = {data,parity,stride,ncols};
+  data_t cw[256];
+  int b,i;
+
+  if(MM != 8 || (t = malloc(sizeof(*t))) == NULL){
+    for(b=0;b<ncols;b++){
+      for(i=0;i<NN-NROOTS-PAD;i++)
+	cw[i] = data[i*stride + b];
+      encode_rs_char(rs,cw,&cw[NN-NROOTS-PAD]);
+      for(i=0;i<NROOTS;i++)
+	parity[i*stride + b] = cw[NN-NROOTS-PAD+i];
+    }
+    return;
+  }
+  init_tables(rs,t);
+  encode_cols(rs,t,&c);
+  free(t);
+}
+
+/* Work shared by the threads of encode_rs_char_batch() */
+struct rs_batch {
+  struct rs *rs;
+  struct rs_tables t;
+  data_t *data;
+  data_t *parity;
+};
+
+/* Encode contiguous codewords [first,last), LANES at a time through a
+ * transposed copy
+ */
+static void encode_blocks(struct rs_batch *bt,int first,int last){
+  struct rs *rs = bt->rs;
+  data_t in[255*LANES],out[255*LANES];
+  struct rs_cols c = {in,out,LANES,LANES};
+  int k = NN-NROOTS-PAD;
+  int b,n,i,l;
+
+  for(b=first;b<last;b+=n){
+    n = last - b < LANES ? last - b : LANES;
+    for(l=0;l<n;l++)
+      for(i=0;i<k;i++)
+	in[i*LANES + l] = bt->data[(size_t)(b+l)*k + i];
+    c.ncols = n;
+    encode_cols(rs,&bt->t,&c);
+    for(l=0;l<n;l++)
+      for(i=0;i<NROOTS;i++)
+	bt->parity[(size_t)(b+l)*NROOTS + i] = out[i*LANES + l];
+  }
+}
+
+#ifndef _WIN32
+struct rs_batch_thread {
+  pthread_t tid;
+  struct rs_batch *bt;
+  int first,last;
+};
+
+static void *encode_blocks_thread(void *arg){
+  struct rs_batch_thread *th = arg;
+
+  encode_blocks(th->bt,th->first,th->last);
+  return NULL;
+}
+#endif
+
+/* Encode nblocks codewords stored one after another, as if by calling
+ * encode_rs_char() on each: codeword b is at data + b*(NN-NROOTS-PAD) and
+ * its parity goes to parity + b*NROOTS. Up to nthreads threads are used.
+ */
+void encode_rs_char_batch(void *p,data_t *data,data_t *parity,int nblocks,int nthreads){
+  struct rs *rs = (struct rs *)p;
+  struct rs_batch *bt;
+  int b,per;
+
+  if(MM != 8 || (bt = malloc(sizeof(*bt))) == NULL){
+    for(b=0;b<nblocks;b++)
+      encode_rs_char(rs,&data[(size_t)b*(NN-NROOTS-PAD)],&parity[(size_t)b*NROOTS]);
+    return;
+  }
+  bt->rs = rs;
+  bt->data = data;
+  bt->parity = parity;
+  init_tables(rs,&bt->t);
+
+  if(nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  /* Give each thread whole groups of LANES codewords */
+  per = (nblocks + LANES - 1) / LANES;
+  if(nthreads > per)
+    nthreads = per;
+
+#ifndef _WIN32
+  if(nthreads > 1){
+    struct rs_batch_thread th[MAX_THREADS];
+    int i,started;
+
+    per = (per + nthreads - 1) / nthreads * LANES;
+    for(i=0;i<nthreads;i++){
+      th[i].bt = bt;
+      th[i].first = i*per < nblocks ? i*per : nblocks;
+      th[i].last = (i+1)*per < nblocks ? (i+1)*per : nblocks;
+    }
+    /* The calling thread takes the first share */
+    for(started=1;started<nthreads;started++)
+      if(pthread_create(&th[started].tid,NULL,encode_blocks_thread,&th[started]) != 0)
+	break;
+    encode_blocks(bt,th[0].first,th[0].last);
+    for(i=1;i<started;i++)
+      pthread_join(th[i].tid,NULL);
+    /* Shares whose thread could not be started */
+    for(;started<nthreads;started++)
+      encode_blocks(bt,th[started].first,th[started].last);
+    free(bt);
+    return;
+  }
+#endif
+  encode_blocks(bt,0,nblocks);
+  free(bt);
+}
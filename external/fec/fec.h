@@ -234,6 +234,19 @@ void *init_rs_char(int symsize,int gfpoly,
 		   int pad);
 void free_rs_char(void *rs);
 
+/* Encode many codewords with the RS codec from init_rs_char(). The batch
+ * form takes nblocks codewords stored one after another, exactly as a loop
+ * over encode_rs_char() would, and uses up to nthreads threads. The
+ * interleaved form takes symbol i of codeword b at data[i*stride+b] and
+ * writes parity symbol j to parity[j*stride+b].
+ * encode_rs_char() itself stays scalar: one codeword is a serial LFSR, so
+ * the SIMD kernels are only reached through these two entry points.
+ */
+void encode_rs_char_batch(void *rs,unsigned char *data,unsigned char *parity,
+			  int nblocks,int nthreads);
+void encode_rs_char_interleaved(void *rs,unsigned char *data,unsigned char *parity,
+				int ncols,int stride);
+
 /* General purpose RS codec, integer symbols */
 void encode_rs_int(void *rs,int *data,int *parity);
 int decode_rs_int(void *rs,int *data,int *eras_pos,int no_eras);
@@ -8,6 +8,7 @@
 
 int main(){
   unsigned char block[255];
+  unsigned char *data,*parity;
   int i;
   void *rs;
   struct rusage start,finish;
@@ -49,6 +50,29 @@ int main(){
   printf("Execution time for %d Reed-Solomon blocks using CCSDS decoder: %.2f sec\n",trials,extime);
   printf("decoder speed: %g bits/s\n",trials*223*8/extime);
 
+  data = malloc(trials*223);
+  parity = malloc(trials*32);
+  for(i=0;i<trials*223;i++)
+    data[i] = random();
+
+  getrusage(RUSAGE_SELF,&start);
+  for(i=0;i<trials;i++)
+    encode_rs_char(rs,&data[i*223],&parity[i*32]);
+  getrusage(RUSAGE_SELF,&finish);
+  extime = finish.ru_utime.tv_sec - start.ru_utime.tv_sec + 1e-6*(finish.ru_utime.tv_usec - start.ru_utime.tv_usec);
+  printf("Execution time for %d Reed-Solomon blocks using general encoder: %.2f sec\n",trials,extime);
+  printf("encoder speed: %g bits/s\n",trials*223*8/extime);
+
+  getrusage(RUSAGE_SELF,&start);
+  encode_rs_char_batch(rs,data,parity,trials,1);
+  getrusage(RUSAGE_SELF,&finish);
+  extime = finish.ru_utime.tv_sec - start.ru_utime.tv_sec + 1e-6*(finish.ru_utime.tv_usec - start.ru_utime.tv_usec);
+  printf("Execution time for %d Reed-Solomon blocks using batch encoder: %.2f sec\n",trials,extime);
+  printf("encoder speed: %g bits/s\n",trials*223*8/extime);
+
+  free(data);
+  free(parity);
+
   exit(0);
 }
 
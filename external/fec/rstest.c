@@ -40,6 +40,7 @@ struct etab {
 };
 
 int exercise_char(struct etab *e);
+int exercise_batch(void *rs,int kk,int nroots);
 int exercise_int(struct etab *e);
 int exercise_8(void);
 
@@ -213,10 +214,48 @@ int exercise_char(struct etab *e){
     }
   }
 
+  if(e->symsize == 8)
+    decoder_errors += exercise_batch(rs,kk,e->nroots);
+
   free_rs_char(rs);
   return 0;
 }
 
+/* Check the batch and interleaved encoders against encode_rs_char() */
+int exercise_batch(void *rs,int kk,int nroots){
+  int nblocks = 100;
+  unsigned char data[nblocks*kk],parity[nblocks*nroots],want[nblocks*nroots];
+  unsigned char idata[kk*nblocks],iparity[nroots*nblocks];
+  int b,i;
+  int errors = 0;
+
+  for(i=0;i<nblocks*kk;i++)
+    data[i] = random() & 255;
+  for(b=0;b<nblocks;b++){
+    encode_rs_char(rs,&data[b*kk],&want[b*nroots]);
+    for(i=0;i<kk;i++)
+      idata[i*nblocks + b] = data[b*kk + i];
+  }
+
+  encode_rs_char_batch(rs,data,parity,nblocks,3);
+  if(memcmp(parity,want,sizeof(want)) != 0){
+    printf("(255,%d) batch encoder output differs from encode_rs_char\n",kk);
+    errors++;
+  }
+  encode_rs_char_interleaved(rs,idata,iparity,nblocks,nblocks);
+  for(b=0;b<nblocks;b++){
+    for(i=0;i<nroots;i++){
+      if(iparity[i*nblocks + b] != want[b*nroots + i]){
+	printf("(255,%d) interleaved encoder output differs from encode_rs_char\n",kk);
+	errors++;
+	b = nblocks;
+	break;
+      }
+    }
+  }
+  return errors;
+}
+
 int exercise_int(struct etab *e){
   int nn = (1<<e->symsize) - 1;
   int block[nn],tblock[nn];
@@ -22,7 +22,11 @@ struct rtnl_handle {
 	FILE		       *dump_fp;
 #define RTNL_HANDLE_F_LISTEN_ALL_NSID		0x01
 #define RTNL_HANDLE_F_SUPPRESS_NLERR		0x02
+/* rtnl_listen() returns once the (O_NONBLOCK) socket is drained */
+#define RTNL_HANDLE_F_NONBLOCK			0x04
 	int			flags;
+	struct rtnl_pipeline	*pipe;
+	struct rtnl_cache	*cache;
 };
 
 struct nlmsg_list {
@@ -106,6 +110,24 @@ int rtnl_send(struct rtnl_handle *rth, const void *buf, int)
 int rtnl_send_check(struct rtnl_handle *rth, const void *buf, int)
 	__attribute__((warn_unused_result));
 
+/* Pipelined mode for batches: rtnl_talk() without an answer queues the
+ * request and returns, at most WINDOW requests wait for their ACK.
+ * Failures are reported against the value of *LINENO when the request
+ * was queued.  Any other use of the handle flushes the pipeline first.
+ */
+int rtnl_pipeline_start(struct rtnl_handle *rth, unsigned int window,
+			const char *name, const int *lineno);
+int rtnl_pipeline_flush(struct rtnl_handle *rth);
+int rtnl_pipeline_push(void);
+int rtnl_pipeline_errors(struct rtnl_handle *rth);
+int rtnl_pipeline_stop(struct rtnl_handle *rth);
+
+/* Answer link, route and neighbour dumps from an "ip monitor cache"
+ * daemon listening on the unix socket PATH.
+ */
+int rtnl_cache_open(struct rtnl_handle *rth, const char *path);
+void rtnl_cache_close(struct rtnl_handle *rth);
+
 int addattr(struct nlmsghdr *n, int maxlen, int type);
 int addattr8(struct nlmsghdr *n, int maxlen, int type, __u8 data);
 int addattr16(struct nlmsghdr *n, int maxlen, int type, __u16 data);
@@ -39,6 +39,8 @@ int force;
 int max_flush_loops = 10;
 int batch_mode;
 bool do_all;
+static unsigned int pipeline;
+static const char *cache_path;
 
 struct rtnl_handle rth = { .fd = -1 };
 
@@ -48,7 +50,7 @@ static void usage(void)
 {
 	fprintf(stderr,
 "Usage: ip [ OPTIONS ] OBJECT { COMMAND | help }\n"
-"       ip [ -force ] -batch filename\n"
+"       ip [ -force ] [ -pipeline depth ] -batch filename\n"
 "where  OBJECT := { link | address | addrlabel | route | rule | neigh | ntable |\n"
 "                   tunnel | tuntap | maddress | mroute | mrule | monitor | xfrm |\n"
 "                   netns | l2tp | fou | macsec | tcp_metrics | token | netconf | ila |\n"
@@ -59,7 +61,8 @@ static void usage(void)
 "                    -4 | -6 | -I | -D | -B | -0 |\n"
 "                    -l[oops] { maximum-addr-flush-attempts } | -br[ief] |\n"
 "                    -o[neline] | -t[imestamp] | -ts[hort] | -b[atch] [filename] |\n"
-"                    -rc[vbuf] [size] | -n[etns] name | -a[ll] | -c[olor]}\n");
+"                    -rc[vbuf] [size] | -n[etns] name | -a[ll] | -c[olor] |\n"
+"                    -cache socket }\n");
 	exit(-1);
 }
 
@@ -69,17 +72,22 @@ static int do_help(int argc, char **argv)
 	return 0;
 }
 
+/* Objects marked pipelined only change the kernel through rtnetlink
+ * requests and look up devices through ll_map, so their requests can be
+ * queued in batch mode.
+ */
 static const struct cmd {
 	const char *cmd;
 	int (*func)(int argc, char **argv);
+	bool pipelined;
 } cmds[] = {
-	{ "address",	do_ipaddr },
+	{ "address",	do_ipaddr,	true },
 	{ "addrlabel",	do_ipaddrlabel },
 	{ "maddress",	do_multiaddr },
-	{ "route",	do_iproute },
-	{ "rule",	do_iprule },
-	{ "neighbor",	do_ipneigh },
-	{ "neighbour",	do_ipneigh },
+	{ "route",	do_iproute,	true },
+	{ "rule",	do_iprule,	true },
+	{ "neighbor",	do_ipneigh,	true },
+	{ "neighbour",	do_ipneigh,	true },
 	{ "ntable",	do_ipntable },
 	{ "ntbl",	do_ipntable },
 	{ "link",	do_iplink },
@@ -106,14 +114,23 @@ static const struct cmd {
 	{ 0 }
 };
 
-static int do_cmd(const char *argv0, int argc, char **argv)
+static const struct cmd *find_cmd(const char *argv0)
 {
 	const struct cmd *c;
 
 	for (c = cmds; c->cmd; ++c) {
 		if (matches(argv0, c->cmd) == 0)
-			return -(c->func(argc-1, argv+1));
+			return c;
 	}
+	return NULL;
+}
+
+static int do_cmd(const char *argv0, int argc, char **argv)
+{
+	const struct cmd *c = find_cmd(argv0);
+
+	if (c)
+		return -(c->func(argc-1, argv+1));
 
 	fprintf(stderr, "Object \"%s\" is unknown, try \"ip help\".\n", argv0);
 	return EXIT_FAILURE;
@@ -142,8 +159,18 @@ static int batch(const char *name)
 		return EXIT_FAILURE;
 	}
 
+	if (cache_path)
+		rtnl_cache_open(&rth, cache_path);
+
+	if (pipeline && rtnl_pipeline_start(&rth, pipeline, name, &cmdlineno)) {
+		fprintf(stderr, "Cannot set up the netlink pipeline\n");
+		rtnl_close(&rth);
+		return EXIT_FAILURE;
+	}
+
 	cmdlineno = 0;
 	while (getcmdline(&line, &len, stdin) != -1) {
+		const struct cmd *c;
 		char *largv[100];
 		int largc;
 
@@ -153,6 +180,11 @@ static int batch(const char *name)
 		if (largc == 0)
 			continue;	/* blank line */
 
+		/* Everything else runs after the queued requests are done. */
+		c = find_cmd(largv[0]);
+		if (!c || !c->pipelined)
+			rtnl_pipeline_flush(&rth);
+
 		if (do_cmd(largv[0], largc, largv)) {
 			fprintf(stderr, "Command failed %s:%d\n",
 				name, cmdlineno);
@@ -160,10 +192,18 @@ static int batch(const char *name)
 			if (!force)
 				break;
 		}
+
+		if (rtnl_pipeline_errors(&rth)) {
+			ret = EXIT_FAILURE;
+			if (!force)
+				break;
+		}
 	}
 	if (line)
 		free(line);
 
+	if (rtnl_pipeline_stop(&rth))
+		ret = EXIT_FAILURE;
 	rtnl_close(&rth);
 	return ret;
 }
@@ -256,6 +296,17 @@ int main(int argc, char **argv)
 			if (argc <= 1)
 				usage();
 			batch_file = argv[1];
+		} else if (matches(opt, "-pipeline") == 0) {
+			argc--;
+			argv++;
+			if (argc <= 1)
+				usage();
+			if (get_unsigned(&pipeline, argv[1], 0) ||
+			    pipeline == 0) {
+				fprintf(stderr, "Invalid pipeline depth '%s'\n",
+					argv[1]);
+				exit(-1);
+			}
 		} else if (matches(opt, "-brief") == 0) {
 			++brief;
 		} else if (matches(opt, "-json") == 0) {
@@ -275,6 +326,9 @@ int main(int argc, char **argv)
 			rcvbuf = size;
 		} else if (matches(opt, "-color") == 0) {
 			enable_color();
+		} else if (matches(opt, "-cache") == 0) {
+			NEXT_ARG();
+			cache_path = argv[1];
 		} else if (matches(opt, "-help") == 0) {
 			usage();
 		} else if (matches(opt, "-netns") == 0) {
@@ -303,6 +357,10 @@ int main(int argc, char **argv)
 	if (rtnl_open(&rth, 0) < 0)
 		exit(1);
 
+	/* Without the daemon dumps simply go to the kernel */
+	if (cache_path)
+		rtnl_cache_open(&rth, cache_path);
+
 	if (strlen(basename) > 2)
 		return do_cmd(basename+2, argc, argv);
 
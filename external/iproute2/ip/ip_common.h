@@ -74,6 +74,7 @@ int do_iptuntap(int argc, char **argv);
 int do_iplink(int argc, char **argv);
 int do_ipmacsec(int argc, char **argv);
 int do_ipmonitor(int argc, char **argv);
+int do_ipmonitor_cache(const char *path);
 int do_multiaddr(int argc, char **argv);
 int do_multiroute(int argc, char **argv);
 int do_multirule(int argc, char **argv);
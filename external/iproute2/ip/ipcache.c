@@ -0,0 +1,579 @@
+/*
+ * ipcache.c		"ip monitor cache": links, routes and neighbours kept
+ *			up to date from rtnetlink events and handed out to
+ *			"ip -cache" clients over a unix socket.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <linux/if.h>
+
+#include "utils.h"
+#include "list.h"
+#include "ip_common.h"
+
+enum {
+	CACHE_LINK,
+	CACHE_ROUTE,
+	CACHE_NEIGH,
+	CACHE_MAX
+};
+
+/* Identity of an object, as the kernel uses it for replace and delete.
+ * The first BASE bytes are hashed; routes sharing them (same prefix,
+ * different nexthop) land in one chain so NLM_F_REPLACE can find them.
+ */
+struct cache_key {
+	unsigned char	data[64];
+	int		len;
+	int		base;
+};
+
+struct cache_ent {
+	struct hlist_node	hash;
+	struct list_head	list;
+	struct cache_key	key;
+	struct nlmsghdr		*n;
+};
+
+struct cache_table {
+	struct hlist_head	*hash;
+	unsigned int		size;
+	unsigned int		count;
+	struct list_head	list;
+};
+
+static struct cache_table tables[CACHE_MAX];
+static unsigned int resync;
+static volatile sig_atomic_t stop;
+
+#define CACHE_HASH_SIZE	1024
+#define CACHE_BUF_SIZE	32768
+#define CACHE_SEND_TIMEOUT	1	/* seconds a client may stall one record */
+
+static void key_put(struct cache_key *k, const void *data, int len)
+{
+	if (k->len + len > sizeof(k->data))
+		return;
+	memcpy(k->data + k->len, data, len);
+	k->len += len;
+}
+
+static void key_put_attr(struct cache_key *k, struct rtattr *rta)
+{
+	unsigned char len = rta ? RTA_PAYLOAD(rta) : 0;
+
+	key_put(k, &len, 1);
+	if (rta)
+		key_put(k, RTA_DATA(rta), len);
+}
+
+static unsigned int key_hash(const struct cache_key *k)
+{
+	unsigned int h = 2166136261U;
+	int i;
+
+	for (i = 0; i < k->base; i++)
+		h = (h ^ k->data[i]) * 16777619U;
+	return h;
+}
+
+static bool key_equal(const struct cache_key *a, const struct cache_key *b,
+		      int len)
+{
+	return a->len >= len && b->len >= len &&
+	       memcmp(a->data, b->data, len) == 0;
+}
+
+/* Returns the table of a message and fills in its key, or -1 for
+ * messages the cache does not keep.
+ */
+static int cache_key_get(struct nlmsghdr *n, struct cache_key *k)
+{
+	int len = n->nlmsg_len;
+
+	memset(k, 0, sizeof(*k));
+
+	switch (n->nlmsg_type) {
+	case RTM_NEWLINK:
+	case RTM_DELLINK: {
+		struct ifinfomsg *ifi = NLMSG_DATA(n);
+
+		if (len < NLMSG_LENGTH(sizeof(*ifi)))
+			return -1;
+		/* AF_BRIDGE port events carry the ifindex of the real link */
+		if (ifi->ifi_family != AF_UNSPEC)
+			return -1;
+		key_put(k, &ifi->ifi_index, sizeof(ifi->ifi_index));
+		k->base = k->len;
+		return CACHE_LINK;
+	}
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE: {
+		struct rtmsg *r = NLMSG_DATA(n);
+		struct rtattr *tb[RTA_MAX+1];
+		__u32 table;
+
+		len -= NLMSG_LENGTH(sizeof(*r));
+		if (len < 0)
+			return -1;
+		if (r->rtm_family != AF_INET && r->rtm_family != AF_INET6)
+			return -1;
+		if (r->rtm_flags & RTM_F_CLONED)
+			return -1;
+
+		parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+		table = rtm_get_table(r, tb);
+
+		key_put(k, &r->rtm_family, 1);
+		key_put(k, &r->rtm_dst_len, 1);
+		key_put(k, &r->rtm_tos, 1);
+		key_put(k, &table, sizeof(table));
+		key_put_attr(k, tb[RTA_PRIORITY]);
+		key_put_attr(k, tb[RTA_DST]);
+		k->base = k->len;
+		key_put_attr(k, tb[RTA_OIF]);
+		key_put_attr(k, tb[RTA_GATEWAY]);
+		return CACHE_ROUTE;
+	}
+	case RTM_NEWNEIGH:
+	case RTM_DELNEIGH: {
+		struct ndmsg *r = NLMSG_DATA(n);
+		struct rtattr *tb[NDA_MAX+1];
+
+		len -= NLMSG_LENGTH(sizeof(*r));
+		if (len < 0)
+			return -1;
+		if (r->ndm_family != AF_INET && r->ndm_family != AF_INET6)
+			return -1;
+
+		parse_rtattr(tb, NDA_MAX, NDA_RTA(r), len);
+
+		key_put(k, &r->ndm_family, 1);
+		key_put(k, &r->ndm_ifindex, sizeof(r->ndm_ifindex));
+		key_put_attr(k, tb[NDA_DST]);
+		k->base = k->len;
+		return CACHE_NEIGH;
+	}
+	}
+	return -1;
+}
+
+static void cache_resize(struct cache_table *t, unsigned int size)
+{
+	struct hlist_head *hash;
+	struct cache_ent *e;
+
+	hash = calloc(size, sizeof(*hash));
+	if (!hash) {
+		fprintf(stderr, "ip: cache: out of memory\n");
+		exit(1);
+	}
+
+	free(t->hash);
+	t->hash = hash;
+	t->size = size;
+
+	list_for_each_entry(e, &t->list, list)
+		hlist_add_head(&e->hash,
+			       &t->hash[key_hash(&e->key) & (size - 1)]);
+}
+
+static void cache_ent_free(struct cache_table *t, struct cache_ent *e)
+{
+	hlist_del(&e->hash);
+	list_del(&e->list);
+	free(e->n);
+	free(e);
+	t->count--;
+}
+
+static void cache_flush(struct cache_table *t)
+{
+	struct cache_ent *e, *tmp;
+
+	list_for_each_entry_safe(e, tmp, &t->list, list)
+		cache_ent_free(t, e);
+}
+
+static int cache_update(const struct sockaddr_nl *who,
+			struct rtnl_ctrl_data *ctrl,
+			struct nlmsghdr *n, void *arg)
+{
+	struct cache_ent *e, *found = NULL;
+	struct hlist_node *pos, *tmp;
+	struct cache_table *t;
+	struct cache_key key;
+	struct nlmsghdr *copy;
+	int type = n->nlmsg_type;
+	int idx;
+
+	idx = cache_key_get(n, &key);
+
+	/* Prefix routes may go away without a notification */
+	if ((type == RTM_DELLINK && idx >= 0) || type == RTM_DELADDR)
+		resync |= 1 << CACHE_ROUTE;
+	if (type == RTM_DELLINK && idx >= 0)
+		resync |= 1 << CACHE_NEIGH;
+
+	if (idx < 0)
+		return 0;
+	t = &tables[idx];
+
+	hlist_for_each_safe(pos, tmp, &t->hash[key_hash(&key) & (t->size - 1)]) {
+		e = container_of(pos, struct cache_ent, hash);
+		if (type == RTM_NEWROUTE && (n->nlmsg_flags & NLM_F_REPLACE) &&
+		    key_equal(&e->key, &key, key.base)) {
+			cache_ent_free(t, e);
+			continue;
+		}
+		if (e->key.len == key.len &&
+		    key_equal(&e->key, &key, key.len))
+			found = e;
+	}
+
+	if (type == RTM_DELLINK || type == RTM_DELROUTE ||
+	    type == RTM_DELNEIGH) {
+		if (found)
+			cache_ent_free(t, found);
+		return 0;
+	}
+
+	if (idx == CACHE_LINK && found) {
+		struct ifinfomsg *old = NLMSG_DATA(found->n);
+		struct ifinfomsg *new = NLMSG_DATA(n);
+
+		/* Routes over a device that went down are not announced */
+		if ((old->ifi_flags ^ new->ifi_flags) & (IFF_UP | IFF_RUNNING))
+			resync |= 1 << CACHE_ROUTE;
+	}
+
+	copy = malloc(n->nlmsg_len);
+	if (!copy) {
+		fprintf(stderr, "ip: cache: out of memory\n");
+		exit(1);
+	}
+	memcpy(copy, n, n->nlmsg_len);
+	copy->nlmsg_flags = 0;
+
+	if (found) {
+		free(found->n);
+		found->n = copy;
+		return 0;
+	}
+
+	e = calloc(1, sizeof(*e));
+	if (!e) {
+		fprintf(stderr, "ip: cache: out of memory\n");
+		exit(1);
+	}
+	e->key = key;
+	e->n = copy;
+	list_add_tail(&e->list, &t->list);
+	hlist_add_head(&e->hash, &t->hash[key_hash(&key) & (t->size - 1)]);
+	if (++t->count > t->size)
+		cache_resize(t, t->size * 2);
+	return 0;
+}
+
+static int cache_dump_msg(const struct sockaddr_nl *who,
+			  struct nlmsghdr *n, void *arg)
+{
+	return cache_update(who, NULL, n, arg);
+}
+
+static const int cache_dump_type[CACHE_MAX] = {
+	[CACHE_LINK]	= RTM_GETLINK,
+	[CACHE_ROUTE]	= RTM_GETROUTE,
+	[CACHE_NEIGH]	= RTM_GETNEIGH,
+};
+
+static int cache_resync(unsigned int mask)
+{
+	int i;
+
+	for (i = 0; i < CACHE_MAX; i++) {
+		if (!(mask & (1 << i)))
+			continue;
+
+		cache_flush(&tables[i]);
+		if (rtnl_wilddump_request(&rth, AF_UNSPEC,
+					  cache_dump_type[i]) < 0) {
+			perror("Cannot send dump request");
+			return -1;
+		}
+		if (rtnl_dump_filter(&rth, cache_dump_msg, NULL) < 0) {
+			fprintf(stderr, "Dump terminated\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Client sockets carry SO_SNDTIMEO, so a client that stops reading makes
+ * this fail with EAGAIN after CACHE_SEND_TIMEOUT and gets dropped instead
+ * of stalling the loop for everybody else.
+ */
+static int cache_send(int fd, char *buf, int len)
+{
+	int ret;
+
+	do {
+		ret = send(fd, buf, len, MSG_NOSIGNAL);
+	} while (ret < 0 && errno == EINTR && !stop);
+
+	return ret == len ? 0 : -1;
+}
+
+/* Answer one dump request in the netlink wire format: the cached
+ * messages, packed into CACHE_BUF_SIZE records, and NLMSG_DONE.
+ */
+static int cache_serve(int fd)
+{
+	char req[1024];
+	char *buf;
+	struct nlmsghdr *n = (struct nlmsghdr *)req;
+	struct nlmsghdr *h;
+	struct cache_table *t;
+	struct cache_ent *e;
+	int family, len, used = 0;
+	int err = -1;
+
+	len = recv(fd, req, sizeof(req), MSG_DONTWAIT);
+	if (len <= 0 || !NLMSG_OK(n, len) ||
+	    n->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtgenmsg)))
+		return -1;
+
+	switch (n->nlmsg_type) {
+	case RTM_GETLINK:
+		t = &tables[CACHE_LINK];
+		break;
+	case RTM_GETROUTE:
+		t = &tables[CACHE_ROUTE];
+		break;
+	case RTM_GETNEIGH:
+		t = &tables[CACHE_NEIGH];
+		break;
+	default:
+		return -1;
+	}
+	family = ((struct rtgenmsg *)NLMSG_DATA(n))->rtgen_family;
+	if (t == &tables[CACHE_LINK])
+		family = AF_UNSPEC;
+
+	buf = malloc(CACHE_BUF_SIZE);
+	if (!buf)
+		return -1;
+
+	list_for_each_entry(e, &t->list, list) {
+		int size = NLMSG_ALIGN(e->n->nlmsg_len);
+
+		/* Every table keeps the family in the first byte */
+		if (family != AF_UNSPEC &&
+		    *(unsigned char *)NLMSG_DATA(e->n) != family)
+			continue;
+
+		if (used + size > CACHE_BUF_SIZE) {
+			if (used && cache_send(fd, buf, used) < 0)
+				goto out;
+			used = 0;
+		}
+		if (size > CACHE_BUF_SIZE) {
+			e->n->nlmsg_seq = n->nlmsg_seq;
+			e->n->nlmsg_pid = n->nlmsg_pid;
+			e->n->nlmsg_flags = NLM_F_MULTI;
+			if (cache_send(fd, (char *)e->n, e->n->nlmsg_len) < 0)
+				goto out;
+			continue;
+		}
+
+		h = (struct nlmsghdr *)(buf + used);
+		memcpy(h, e->n, e->n->nlmsg_len);
+		h->nlmsg_seq = n->nlmsg_seq;
+		h->nlmsg_pid = n->nlmsg_pid;
+		h->nlmsg_flags = NLM_F_MULTI;
+		used += size;
+	}
+
+	if (used + NLMSG_LENGTH(sizeof(int)) > CACHE_BUF_SIZE) {
+		if (cache_send(fd, buf, used) < 0)
+			goto out;
+		used = 0;
+	}
+	h = (struct nlmsghdr *)(buf + used);
+	memset(h, 0, NLMSG_LENGTH(sizeof(int)));
+	h->nlmsg_len = NLMSG_LENGTH(sizeof(int));
+	h->nlmsg_type = NLMSG_DONE;
+	h->nlmsg_flags = NLM_F_MULTI;
+	h->nlmsg_seq = n->nlmsg_seq;
+	h->nlmsg_pid = n->nlmsg_pid;
+	used += NLMSG_ALIGN(h->nlmsg_len);
+
+	err = cache_send(fd, buf, used);
+out:
+	free(buf);
+	return err;
+}
+
+static void cache_stop(int sig)
+{
+	stop = 1;
+}
+
+int do_ipmonitor_cache(const char *path)
+{
+	struct sockaddr_un sun = { .sun_family = AF_UNIX };
+	struct rtnl_handle mon = { .fd = -1 };
+	struct pollfd *pfd;
+	unsigned int groups = 0;
+	int nfds = 2, maxfds = 16;
+	struct sigaction sa = { .sa_handler = cache_stop };
+	int i, fd, err;
+
+	if (strlen(path) >= sizeof(sun.sun_path)) {
+		fprintf(stderr, "Cache socket path \"%s\" is too long\n", path);
+		return -1;
+	}
+	strcpy(sun.sun_path, path);
+
+	for (i = 0; i < CACHE_MAX; i++) {
+		INIT_LIST_HEAD(&tables[i].list);
+		cache_resize(&tables[i], CACHE_HASH_SIZE);
+	}
+
+	groups |= nl_mgrp(RTNLGRP_LINK);
+	groups |= nl_mgrp(RTNLGRP_IPV4_IFADDR);
+	groups |= nl_mgrp(RTNLGRP_IPV6_IFADDR);
+	groups |= nl_mgrp(RTNLGRP_IPV4_ROUTE);
+	groups |= nl_mgrp(RTNLGRP_IPV6_ROUTE);
+	groups |= nl_mgrp(RTNLGRP_NEIGH);
+
+	/* Subscribe before the initial dump so no change is missed.  The
+	 * dumps go through the rth main() opened, never through a cache.
+	 */
+	if (rtnl_open(&mon, groups) < 0)
+		exit(1);
+	rtnl_cache_close(&rth);
+	if (fcntl(mon.fd, F_SETFL, O_NONBLOCK) < 0) {
+		perror("fcntl");
+		exit(1);
+	}
+	mon.flags |= RTNL_HANDLE_F_NONBLOCK;
+
+	if (cache_resync((1 << CACHE_MAX) - 1) < 0)
+		exit(1);
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		perror("Cannot open cache socket");
+		exit(1);
+	}
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0 ||
+	    listen(fd, 64) < 0) {
+		fprintf(stderr, "Cannot listen on \"%s\": %s\n",
+			path, strerror(errno));
+		exit(1);
+	}
+
+	pfd = calloc(maxfds, sizeof(*pfd));
+	if (!pfd) {
+		fprintf(stderr, "ip: cache: out of memory\n");
+		exit(1);
+	}
+	pfd[0].fd = mon.fd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = fd;
+	pfd[1].events = POLLIN;
+
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (!stop) {
+		if (poll(pfd, nfds, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		/* Apply pending events before answering anybody */
+		if (pfd[0].revents) {
+			err = rtnl_listen(&mon, cache_update, NULL);
+			if (err == -ENOBUFS)
+				resync = (1 << CACHE_MAX) - 1;
+			else if (err < 0)
+				break;
+		}
+		if (resync) {
+			unsigned int mask = resync;
+
+			resync = 0;
+			if (cache_resync(mask) < 0)
+				break;
+		}
+
+		for (i = 2; i < nfds; i++) {
+			if (!pfd[i].revents)
+				continue;
+			if (cache_serve(pfd[i].fd) < 0) {
+				close(pfd[i].fd);
+				pfd[i--] = pfd[--nfds];
+			}
+		}
+
+		if (pfd[1].revents) {
+			struct timeval tv = { .tv_sec = CACHE_SEND_TIMEOUT };
+			int cfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+
+			if (cfd < 0)
+				continue;
+			if (setsockopt(cfd, SOL_SOCKET, SO_SNDTIMEO,
+				       &tv, sizeof(tv)) < 0) {
+				close(cfd);
+				continue;
+			}
+			if (nfds == maxfds) {
+				struct pollfd *p;
+
+				p = realloc(pfd, 2 * maxfds * sizeof(*pfd));
+				if (!p) {
+					close(cfd);
+					continue;
+				}
+				pfd = p;
+				maxfds *= 2;
+			}
+			pfd[nfds].fd = cfd;
+			pfd[nfds].events = POLLIN;
+			pfd[nfds].revents = 0;
+			nfds++;
+		}
+	}
+
+	for (i = 2; i < nfds; i++)
+		close(pfd[i].fd);
+	free(pfd);
+	close(fd);
+	unlink(path);
+	for (i = 0; i < CACHE_MAX; i++) {
+		cache_flush(&tables[i]);
+		free(tables[i].hash);
+	}
+	rtnl_close(&mon);
+	return stop ? 0 : 1;
+}
@@ -31,6 +31,7 @@ int listen_all_nsid;
 static void usage(void)
 {
 	fprintf(stderr, "Usage: ip monitor [ all | LISTofOBJECTS ] [ FILE ] [ label ] [all-nsid] [dev DEVICE]\n");
+	fprintf(stderr, "       ip monitor cache SOCKET\n");
 	fprintf(stderr, "LISTofOBJECTS := link | address | route | mroute | prefix |\n");
 	fprintf(stderr, "                 neigh | netconf | rule | nsid\n");
 	fprintf(stderr, "FILE := file FILENAME\n");
@@ -178,8 +179,6 @@ int do_ipmonitor(int argc, char **argv)
 	groups |= nl_mgrp(RTNLGRP_NSID);
 	groups |= nl_mgrp(RTNLGRP_MPLS_NETCONF);
 
-	rtnl_close(&rth);
-
 	while (argc > 0) {
 		if (matches(*argv, "file") == 0) {
 			NEXT_ARG();
@@ -219,6 +218,9 @@ int do_ipmonitor(int argc, char **argv)
 			listen_all_nsid = 1;
 		} else if (matches(*argv, "help") == 0) {
 			usage();
+		} else if (strcmp(*argv, "cache") == 0) {
+			NEXT_ARG();
+			return do_ipmonitor_cache(*argv);
 		} else if (strcmp(*argv, "dev") == 0) {
 			NEXT_ARG();
 
@@ -298,6 +300,8 @@ int do_ipmonitor(int argc, char **argv)
 		return err;
 	}
 
+	/* "cache" above keeps the handle main() opened for its dumps */
+	rtnl_close(&rth);
 	if (rtnl_open(&rth, groups) < 0)
 		exit(1);
 	if (listen_all_nsid && rtnl_listen_all_nsid(&rth) < 0)
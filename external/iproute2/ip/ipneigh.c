@@ -446,6 +446,9 @@ static int do_show_or_flush(int argc, char **argv, int flush)
 		filter.flushp = 0;
 		filter.flushe = sizeof(flushb);
 
+		/* Each round has to see what is left in the kernel */
+		rtnl_cache_close(&rth);
+
 		while (round < MAX_ROUNDS) {
 			if (rtnl_dump_request_n(&rth, &req.n) < 0) {
 				perror("Cannot send dump request");
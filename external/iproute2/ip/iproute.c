@@ -1608,6 +1608,9 @@ static int iproute_list_flush_or_save(int argc, char **argv, int action)
 		filter.flushp = 0;
 		filter.flushe = sizeof(flushb);
 
+		/* Each round has to see what is left in the kernel */
+		rtnl_cache_close(&rth);
+
 		for (;;) {
 			if (rtnl_wilddump_request(&rth, do_ipv6, RTM_GETROUTE) < 0) {
 				perror("Cannot send dump request");
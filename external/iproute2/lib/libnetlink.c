@@ -22,7 +22,9 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <poll.h>
 #include <sys/uio.h>
+#include <sys/un.h>
 
 #include "libnetlink.h"
 
@@ -126,8 +128,122 @@ static int nl_dump_ext_err(const struct nlmsghdr *nlh, nl_ext_ack_fn_t errfn)
 }
 #endif
 
+/* Link, route and neighbour dumps may be answered by an "ip monitor cache"
+ * daemon.  It speaks the netlink wire format over a SOCK_SEQPACKET unix
+ * socket, so rtnl_dump_filter() only has to switch file descriptors.
+ */
+struct rtnl_cache {
+	int	fd;
+	int	active;
+};
+
+int rtnl_cache_open(struct rtnl_handle *rth, const char *path)
+{
+	struct sockaddr_un sun = { .sun_family = AF_UNIX };
+	struct rtnl_cache *c;
+
+	if (strlen(path) >= sizeof(sun.sun_path)) {
+		fprintf(stderr, "Cache socket path \"%s\" is too long\n", path);
+		return -1;
+	}
+	strcpy(sun.sun_path, path);
+
+	c = calloc(1, sizeof(*c));
+	if (!c)
+		return -1;
+
+	c->fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (c->fd < 0) {
+		perror("Cannot open cache socket");
+		goto err;
+	}
+	if (connect(c->fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		fprintf(stderr, "Cannot connect to cache \"%s\": %s\n",
+			path, strerror(errno));
+		close(c->fd);
+		goto err;
+	}
+
+	rtnl_cache_close(rth);
+	rth->cache = c;
+	return 0;
+err:
+	free(c);
+	return -1;
+}
+
+void rtnl_cache_close(struct rtnl_handle *rth)
+{
+	struct rtnl_cache *c = rth->cache;
+
+	if (!c)
+		return;
+
+	close(c->fd);
+	free(c);
+	rth->cache = NULL;
+}
+
+/* Returns 1 when the dump request went to the cache, 0 when it must be
+ * sent to the kernel.  A daemon that went away is dropped silently.
+ */
+static int rtnl_cache_send(struct rtnl_handle *rth, struct nlmsghdr *n)
+{
+	struct rtnl_cache *c = rth->cache;
+	int family;
+
+	if (!c || n->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtgenmsg)))
+		return 0;
+
+	/* Only what the daemon keeps: no bridge port or MPLS dumps, and
+	 * no kernel side neighbour filters.
+	 */
+	family = ((struct rtgenmsg *)NLMSG_DATA(n))->rtgen_family;
+	switch (n->nlmsg_type) {
+	case RTM_GETLINK:
+		if (family != AF_UNSPEC && family != AF_PACKET)
+			return 0;
+		break;
+	case RTM_GETROUTE:
+		if (family != AF_INET && family != AF_INET6)
+			return 0;
+		break;
+	case RTM_GETNEIGH:
+		if (family != AF_UNSPEC && family != AF_INET &&
+		    family != AF_INET6)
+			return 0;
+		if (n->nlmsg_len > NLMSG_LENGTH(sizeof(struct ndmsg)))
+			return 0;
+		/* The daemon dumps with a bare rtgenmsg: no proxy entries,
+		 * and no state or device filter.
+		 */
+		if (n->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ndmsg))) {
+			struct ndmsg *ndm = NLMSG_DATA(n);
+
+			if (ndm->ndm_flags || ndm->ndm_state ||
+			    ndm->ndm_ifindex)
+				return 0;
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	n->nlmsg_pid = rth->local.nl_pid;
+	if (send(c->fd, n, n->nlmsg_len, MSG_NOSIGNAL) < 0) {
+		rtnl_cache_close(rth);
+		return 0;
+	}
+
+	c->active = 1;
+	return 1;
+}
+
 void rtnl_close(struct rtnl_handle *rth)
 {
+	rtnl_pipeline_stop(rth);
+	rtnl_cache_close(rth);
+
 	if (rth->fd >= 0) {
 		close(rth->fd);
 		rth->fd = -1;
@@ -224,6 +340,12 @@ int rtnl_wilddump_req_filter(struct rtnl_handle *rth, int family, int type,
 		.ext_filter_mask = filt_mask,
 	};
 
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
+	if (rtnl_cache_send(rth, &req.nlh))
+		return sizeof(req);
+
 	return send(rth->fd, &req, sizeof(req), 0);
 }
 
@@ -250,6 +372,12 @@ int rtnl_wilddump_req_filter_fn(struct rtnl_handle *rth, int family, int type,
 	if (err)
 		return err;
 
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
+	if (rtnl_cache_send(rth, &req.nlh))
+		return req.nlh.nlmsg_len;
+
 	return send(rth->fd, &req, req.nlh.nlmsg_len, 0);
 }
 
@@ -270,11 +398,17 @@ int rtnl_wilddump_stats_req_filter(struct rtnl_handle *rth, int fam, int type,
 	req.ifsm.family = fam;
 	req.ifsm.filter_mask = filt_mask;
 
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
 	return send(rth->fd, &req, sizeof(req), 0);
 }
 
 int rtnl_send(struct rtnl_handle *rth, const void *buf, int len)
 {
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
 	return send(rth->fd, buf, len, 0);
 }
 
@@ -284,6 +418,9 @@ int rtnl_send_check(struct rtnl_handle *rth, const void *buf, int len)
 	int status;
 	char resp[1024];
 
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
 	status = send(rth->fd, buf, len, 0);
 	if (status < 0)
 		return status;
@@ -332,6 +469,9 @@ int rtnl_dump_request(struct rtnl_handle *rth, int type, void *req, int len)
 		.msg_iovlen = 2,
 	};
 
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
 	return sendmsg(rth->fd, &msg, 0);
 }
 
@@ -353,6 +493,12 @@ int rtnl_dump_request_n(struct rtnl_handle *rth, struct nlmsghdr *n)
 	n->nlmsg_pid = 0;
 	n->nlmsg_seq = rth->dump = ++rth->seq;
 
+	if (rtnl_pipeline_flush(rth) < 0)
+		return -1;
+
+	if (rtnl_cache_send(rth, n))
+		return n->nlmsg_len;
+
 	return sendmsg(rth->fd, &msg, 0);
 }
 
@@ -404,10 +550,52 @@ static void rtnl_dump_error(const struct rtnl_handle *rth,
 	}
 }
 
+/* Size the receive buffer for the next message in the socket queue.
+ * Dump replies are usually no larger than 32K, but the kernel is free to
+ * batch more into one skb (e.g. large min_dump_alloc), so peek at the real
+ * length first and grow the buffer instead of truncating.  Only EINTR is
+ * retried here; EAGAIN goes back to the caller like in rtnl_recvmsg().
+ */
+static int rtnl_recvmsg_len(int fd, struct msghdr *msg, char **buf,
+			    size_t *buf_len)
+{
+	struct iovec *iov = msg->msg_iov;
+	int len;
+
+	iov->iov_base = NULL;
+	iov->iov_len = 0;
+
+	do {
+		len = recvmsg(fd, msg, MSG_PEEK | MSG_TRUNC);
+	} while (len < 0 && errno == EINTR);
+
+	if (len > 0 && (size_t)len > *buf_len) {
+		size_t new_len = *buf_len;
+		char *new_buf;
+
+		while (new_len < (size_t)len)
+			new_len *= 2;
+		new_buf = realloc(*buf, new_len);
+		if (!new_buf) {
+			errno = ENOMEM;
+			return -1;
+		}
+		*buf = new_buf;
+		*buf_len = new_len;
+	}
+
+	iov->iov_base = *buf;
+	iov->iov_len = *buf_len;
+	return len;
+}
+
 int rtnl_dump_filter_l(struct rtnl_handle *rth,
 		       const struct rtnl_dump_filter_arg *arg)
 {
-	struct sockaddr_nl nladdr;
+	struct rtnl_cache *c = rth->cache && rth->cache->active ?
+			       rth->cache : NULL;
+	int fd = c ? c->fd : rth->fd;
+	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
 	struct iovec iov;
 	struct msghdr msg = {
 		.msg_name = &nladdr,
@@ -415,30 +603,51 @@ int rtnl_dump_filter_l(struct rtnl_handle *rth,
 		.msg_iov = &iov,
 		.msg_iovlen = 1,
 	};
-	char buf[32768];
+	size_t buf_len = 32768;
+	char *buf;
 	int dump_intr = 0;
+	int ret = -1;
+
+	/* The cache peer is a unix socket, its address is of no interest */
+	if (c) {
+		msg.msg_name = NULL;
+		msg.msg_namelen = 0;
+	}
+
+	buf = malloc(buf_len);
+	if (!buf) {
+		perror("malloc");
+		goto out;
+	}
 
-	iov.iov_base = buf;
 	while (1) {
 		int status;
 		const struct rtnl_dump_filter_arg *a;
 		int found_done = 0;
 		int msglen = 0;
 
-		iov.iov_len = sizeof(buf);
-		status = recvmsg(rth->fd, &msg, 0);
+		status = rtnl_recvmsg_len(fd, &msg, &buf, &buf_len);
+		if (status > 0)
+			status = recvmsg(fd, &msg, 0);
 
 		if (status < 0) {
-			if (errno == EINTR || errno == EAGAIN)
+			if (errno == EINTR)
 				continue;
+			/* Non-blocking handle: wait for the rest of the dump */
+			if (errno == EAGAIN) {
+				struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+				if (poll(&pfd, 1, -1) >= 0 || errno == EINTR)
+					continue;
+			}
 			fprintf(stderr, "netlink receive error %s (%d)\n",
 				strerror(errno), errno);
-			return -1;
+			goto out;
 		}
 
 		if (status == 0) {
 			fprintf(stderr, "EOF on netlink\n");
-			return -1;
+			goto out;
 		}
 
 		if (rth->dump_fp)
@@ -465,7 +674,7 @@ int rtnl_dump_filter_l(struct rtnl_handle *rth,
 				if (h->nlmsg_type == NLMSG_DONE) {
 					err = rtnl_dump_done(h);
 					if (err < 0)
-						return -1;
+						goto out;
 
 					found_done = 1;
 					break; /* process next filter */
@@ -473,13 +682,15 @@ int rtnl_dump_filter_l(struct rtnl_handle *rth,
 
 				if (h->nlmsg_type == NLMSG_ERROR) {
 					rtnl_dump_error(rth, h);
-					return -1;
+					goto out;
 				}
 
 				if (!rth->dump_fp) {
 					err = a->filter(&nladdr, h, a->arg1);
-					if (err < 0)
-						return err;
+					if (err < 0) {
+						ret = err;
+						goto out;
+					}
 				}
 
 skip_it:
@@ -491,7 +702,8 @@ skip_it:
 			if (dump_intr)
 				fprintf(stderr,
 					"Dump was interrupted and may be inconsistent.\n");
-			return 0;
+			ret = 0;
+			goto out;
 		}
 
 		if (msg.msg_flags & MSG_TRUNC) {
@@ -503,6 +715,12 @@ skip_it:
 			exit(1);
 		}
 	}
+
+out:
+	if (c)
+		c->active = 0;
+	free(buf);
+	return ret;
 }
 
 int rtnl_dump_filter_nc(struct rtnl_handle *rth,
@@ -527,6 +745,243 @@ static void rtnl_talk_error(struct nlmsghdr *h, struct nlmsgerr *err,
 		strerror(-err->error));
 }
 
+/* Requests of a pipelined handle are packed into buf and sent together.
+ * Up to window of them may wait for their ACK; each one remembers the
+ * batch line it came from so a failure can be reported against it.
+ */
+struct rtnl_pipeline_req {
+	__u32		seq;
+	int		lineno;
+};
+
+struct rtnl_pipeline {
+	const char	*name;
+	const int	*lineno;
+	unsigned int	window;
+	unsigned int	outstanding;
+	int		errors;
+	int		len;
+	char		buf[16384];
+	struct rtnl_pipeline_req reqs[];
+};
+
+static struct rtnl_handle *rtnl_pipelined;
+
+/* Returns 1 if an ACK datagram was processed, 0 if none was waiting
+ * (only with MSG_DONTWAIT) and -1 on failure.
+ */
+static int rtnl_pipeline_recv(struct rtnl_handle *rtnl, int flags)
+{
+	struct rtnl_pipeline *p = rtnl->pipe;
+	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
+	char buf[32768];
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = sizeof(buf)
+	};
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	struct nlmsghdr *h;
+	int status;
+
+	status = recvmsg(rtnl->fd, &msg, flags);
+	if (status < 0) {
+		if (errno == EINTR)
+			return 1;
+		if (errno == EAGAIN && (flags & MSG_DONTWAIT))
+			return 0;
+		fprintf(stderr, "netlink receive error %s (%d)\n",
+			strerror(errno), errno);
+		return -1;
+	}
+	if (status == 0) {
+		fprintf(stderr, "EOF on netlink\n");
+		return -1;
+	}
+	if (msg.msg_flags & MSG_TRUNC) {
+		fprintf(stderr, "Message truncated\n");
+		return -1;
+	}
+
+	for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, status);
+	     h = NLMSG_NEXT(h, status)) {
+		struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(h);
+		struct rtnl_pipeline_req *req;
+
+		if (nladdr.nl_pid != 0 ||
+		    h->nlmsg_pid != rtnl->local.nl_pid ||
+		    h->nlmsg_type != NLMSG_ERROR)
+			continue;
+
+		req = &p->reqs[h->nlmsg_seq % p->window];
+		if (req->seq != h->nlmsg_seq || p->outstanding == 0)
+			continue;
+		req->seq = 0;
+		p->outstanding--;
+
+		if (h->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr)))
+			fprintf(stderr, "ERROR truncated\n");
+		else if (!err->error)
+			continue;
+		else
+			rtnl_talk_error(h, err, NULL);
+
+		fprintf(stderr, "Command failed %s:%d\n", p->name, req->lineno);
+		p->errors++;
+	}
+
+	return 1;
+}
+
+/* Send the packed requests, plus N if it did not fit, and pick up
+ * whatever ACKs are already there.
+ */
+static int rtnl_pipeline_send(struct rtnl_handle *rtnl, struct nlmsghdr *n)
+{
+	struct rtnl_pipeline *p = rtnl->pipe;
+	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
+	struct iovec iov[2] = {
+		{ .iov_base = p->buf, .iov_len = p->len },
+		{ .iov_base = n, .iov_len = n ? n->nlmsg_len : 0 }
+	};
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = iov,
+		.msg_iovlen = 2,
+	};
+	int ret;
+
+	if (p->len == 0 && n == NULL)
+		return 0;
+
+	ret = sendmsg(rtnl->fd, &msg, 0);
+	p->len = 0;
+	if (ret < 0) {
+		perror("Cannot talk to rtnetlink");
+		return -1;
+	}
+
+	while ((ret = rtnl_pipeline_recv(rtnl, MSG_DONTWAIT)) > 0)
+		;
+	return ret;
+}
+
+static int rtnl_pipeline_queue(struct rtnl_handle *rtnl, struct nlmsghdr *n)
+{
+	struct rtnl_pipeline *p = rtnl->pipe;
+	struct rtnl_pipeline_req *req;
+	int len = NLMSG_ALIGN(n->nlmsg_len);
+
+	if (p->outstanding >= p->window &&
+	    rtnl_pipeline_send(rtnl, NULL) < 0)
+		goto err;
+	while (p->outstanding >= p->window) {
+		if (rtnl_pipeline_recv(rtnl, 0) < 0)
+			goto err;
+	}
+
+	if (p->len + len > sizeof(p->buf) &&
+	    rtnl_pipeline_send(rtnl, NULL) < 0)
+		goto err;
+
+	n->nlmsg_seq = ++rtnl->seq;
+	n->nlmsg_flags |= NLM_F_ACK;
+
+	req = &p->reqs[n->nlmsg_seq % p->window];
+	req->seq = n->nlmsg_seq;
+	req->lineno = *p->lineno;
+	p->outstanding++;
+
+	if (len > sizeof(p->buf))
+		return rtnl_pipeline_send(rtnl, n) < 0 ? -1 : 0;
+
+	memcpy(p->buf + p->len, n, n->nlmsg_len);
+	memset(p->buf + p->len + n->nlmsg_len, 0, len - n->nlmsg_len);
+	p->len += len;
+	return 0;
+
+err:
+	p->outstanding = 0;
+	p->errors++;
+	return -1;
+}
+
+int rtnl_pipeline_start(struct rtnl_handle *rth, unsigned int window,
+			const char *name, const int *lineno)
+{
+	struct rtnl_pipeline *p;
+
+	if (window == 0 || rtnl_pipelined)
+		return -1;
+
+	p = calloc(1, sizeof(*p) + window * sizeof(p->reqs[0]));
+	if (!p)
+		return -1;
+
+	p->name = name;
+	p->lineno = lineno;
+	p->window = window;
+	rth->pipe = p;
+	rtnl_pipelined = rth;
+	return 0;
+}
+
+int rtnl_pipeline_flush(struct rtnl_handle *rth)
+{
+	struct rtnl_pipeline *p = rth->pipe;
+
+	if (!p)
+		return 0;
+
+	if (rtnl_pipeline_send(rth, NULL) < 0)
+		goto err;
+	while (p->outstanding > 0) {
+		if (rtnl_pipeline_recv(rth, 0) < 0)
+			goto err;
+	}
+	return 0;
+
+err:
+	p->outstanding = 0;
+	p->errors++;
+	return -1;
+}
+
+int rtnl_pipeline_push(void)
+{
+	struct rtnl_handle *rth = rtnl_pipelined;
+
+	if (!rth || rth->pipe->len == 0)
+		return 0;
+
+	return rtnl_pipeline_send(rth, NULL) < 0 ? -1 : 1;
+}
+
+int rtnl_pipeline_errors(struct rtnl_handle *rth)
+{
+	return rth->pipe ? rth->pipe->errors : 0;
+}
+
+int rtnl_pipeline_stop(struct rtnl_handle *rth)
+{
+	int errors;
+
+	if (!rth->pipe)
+		return 0;
+
+	rtnl_pipeline_flush(rth);
+	errors = rth->pipe->errors;
+	free(rth->pipe);
+	rth->pipe = NULL;
+	rtnl_pipelined = NULL;
+	return errors;
+}
+
 static int __rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n,
 		       struct nlmsghdr *answer, size_t maxlen,
 		       bool show_rtnl_err, nl_ext_ack_fn_t errfn)
@@ -547,6 +1002,12 @@ static int __rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n,
 	};
 	char   buf[32768] = {};
 
+	if (rtnl->pipe && answer == NULL && show_rtnl_err)
+		return rtnl_pipeline_queue(rtnl, n);
+
+	if (rtnl_pipeline_flush(rtnl) < 0)
+		return -1;
+
 	n->nlmsg_seq = seq = ++rtnl->seq;
 
 	if (answer == NULL)
@@ -711,8 +1172,15 @@ int rtnl_listen(struct rtnl_handle *rtnl,
 		status = recvmsg(rtnl->fd, &msg, 0);
 
 		if (status < 0) {
+			if (errno == EAGAIN &&
+			    (rtnl->flags & RTNL_HANDLE_F_NONBLOCK))
+				return 0;
 			if (errno == EINTR || errno == EAGAIN)
 				continue;
+			/* Lost events, let the caller resynchronize */
+			if (errno == ENOBUFS &&
+			    (rtnl->flags & RTNL_HANDLE_F_NONBLOCK))
+				return -ENOBUFS;
 			fprintf(stderr, "netlink receive error %s (%d)\n",
 				strerror(errno), errno);
 			if (errno == ENOBUFS)
@@ -196,6 +196,9 @@ unsigned ll_name_to_index(const char *name)
 		return im->index;
 
 	idx = if_nametoindex(name);
+	/* The link may be created by a request still queued for sending. */
+	if (idx == 0 && rtnl_pipeline_push() > 0)
+		idx = if_nametoindex(name);
 	if (idx == 0)
 		sscanf(name, "if%u", &idx);
 	return idx;
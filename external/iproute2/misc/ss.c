@@ -343,33 +343,89 @@ static FILE *generic_proc_open(const char *env, const char *name)
 #define ephemeral_ports_open()	generic_proc_open("PROC_IP_LOCAL_PORT_RANGE", \
 					"sys/net/ipv4/ip_local_port_range")
 
+/* Process name and context are shared by all sockets of a pid. */
+struct user_proc {
+	struct user_proc *next;
+	char		process[16];
+	char		*process_ctx;
+};
+
 struct user_ent {
 	struct user_ent	*next;
 	unsigned int	ino;
 	int		pid;
 	int		fd;
-	char		*process;
-	char		*process_ctx;
+	struct user_proc *proc;
 	char		*socket_ctx;
 };
 
+/* The hash grows with the number of sockets found under /proc; it is
+ * only built once the first socket needs its users printed.
+ */
 #define USER_ENT_HASH_SIZE	256
-struct user_ent *user_ent_hash[USER_ENT_HASH_SIZE];
+static struct user_ent **user_ent_hash;
+static unsigned int user_ent_hash_size;
+static unsigned int user_ent_cnt;
+static struct user_proc *user_proc_list;
+
+static unsigned int user_ent_hashfn(unsigned int ino)
+{
+	unsigned int val = (ino >> 24) ^ (ino >> 16) ^ (ino >> 8) ^ ino;
+
+	return val & (user_ent_hash_size - 1);
+}
 
-static int user_ent_hashfn(unsigned int ino)
+static void user_ent_hash_resize(unsigned int size)
 {
-	int val = (ino >> 24) ^ (ino >> 16) ^ (ino >> 8) ^ ino;
+	struct user_ent **old = user_ent_hash;
+	unsigned int old_size = user_ent_hash_size;
+	unsigned int i;
 
-	return val & (USER_ENT_HASH_SIZE - 1);
+	user_ent_hash = calloc(size, sizeof(*user_ent_hash));
+	if (!user_ent_hash) {
+		fprintf(stderr, "ss: failed to malloc buffer\n");
+		abort();
+	}
+	user_ent_hash_size = size;
+
+	for (i = 0; i < old_size; i++) {
+		struct user_ent *p, *p_next, **pp;
+
+		for (p = old[i]; p; p = p_next) {
+			p_next = p->next;
+			pp = &user_ent_hash[user_ent_hashfn(p->ino)];
+			p->next = *pp;
+			*pp = p;
+		}
+	}
+	free(old);
+}
+
+static struct user_proc *user_proc_add(const char *process, char *proc_ctx)
+{
+	struct user_proc *u;
+
+	u = malloc(sizeof(*u));
+	if (!u) {
+		fprintf(stderr, "ss: failed to malloc buffer\n");
+		abort();
+	}
+	strlcpy(u->process, process, sizeof(u->process));
+	u->process_ctx = proc_ctx;
+	u->next = user_proc_list;
+	user_proc_list = u;
+	return u;
 }
 
-static void user_ent_add(unsigned int ino, char *process,
+static void user_ent_add(unsigned int ino, struct user_proc *proc,
 					int pid, int fd,
-					char *proc_ctx,
 					char *sock_ctx)
 {
 	struct user_ent *p, **pp;
 
+	if (user_ent_cnt >= user_ent_hash_size)
+		user_ent_hash_resize(user_ent_hash_size * 2);
+
 	p = malloc(sizeof(struct user_ent));
 	if (!p) {
 		fprintf(stderr, "ss: failed to malloc buffer\n");
@@ -379,25 +435,24 @@ static void user_ent_add(unsigned int ino, char *process,
 	p->ino = ino;
 	p->pid = pid;
 	p->fd = fd;
-	p->process = strdup(process);
-	p->process_ctx = strdup(proc_ctx);
-	p->socket_ctx = strdup(sock_ctx);
+	p->proc = proc;
+	p->socket_ctx = sock_ctx;
 
 	pp = &user_ent_hash[user_ent_hashfn(ino)];
 	p->next = *pp;
 	*pp = p;
+	user_ent_cnt++;
 }
 
 static void user_ent_destroy(void)
 {
 	struct user_ent *p, *p_next;
-	int cnt = 0;
+	struct user_proc *u, *u_next;
+	unsigned int cnt = 0;
 
-	while (cnt != USER_ENT_HASH_SIZE) {
+	while (cnt != user_ent_hash_size) {
 		p = user_ent_hash[cnt];
 		while (p) {
-			free(p->process);
-			free(p->process_ctx);
 			free(p->socket_ctx);
 			p_next = p->next;
 			free(p);
@@ -405,6 +460,13 @@ static void user_ent_destroy(void)
 		}
 		cnt++;
 	}
+	free(user_ent_hash);
+
+	for (u = user_proc_list; u; u = u_next) {
+		u_next = u->next;
+		free(u->process_ctx);
+		free(u);
+	}
 }
 
 static void user_ent_hash_build(void)
@@ -424,6 +486,7 @@ static void user_ent_hash_build(void)
 		return;
 
 	user_ent_hash_build_init = 1;
+	user_ent_hash_resize(USER_ENT_HASH_SIZE);
 
 	strlcpy(name, root, sizeof(name));
 
@@ -437,9 +500,8 @@ static void user_ent_hash_build(void)
 		return;
 
 	while ((d = readdir(dir)) != NULL) {
+		struct user_proc *proc = NULL;
 		struct dirent *d1;
-		char process[16];
-		char *p;
 		int pid, pos;
 		DIR *dir1;
 		char crap;
@@ -447,18 +509,10 @@ static void user_ent_hash_build(void)
 		if (sscanf(d->d_name, "%d%c", &pid, &crap) != 1)
 			continue;
 
-		if (getpidcon(pid, &pid_context) != 0)
-			pid_context = strdup(no_ctx);
-
 		snprintf(name + nameoff, sizeof(name) - nameoff, "%d/fd/", pid);
 		pos = strlen(name);
-		if ((dir1 = opendir(name)) == NULL) {
-			free(pid_context);
+		if ((dir1 = opendir(name)) == NULL)
 			continue;
-		}
-
-		process[0] = '\0';
-		p = process;
 
 		while ((d1 = readdir(dir1)) != NULL) {
 			const char *pattern = "socket:[";
@@ -483,28 +537,36 @@ static void user_ent_hash_build(void)
 
 			sscanf(lnk, "socket:[%u]", &ino);
 
-			snprintf(tmp, sizeof(tmp), "%s/%d/fd/%s",
-					root, pid, d1->d_name);
+			sock_context = NULL;
+			if (show_sock_ctx) {
+				snprintf(tmp, sizeof(tmp), "%s/%d/fd/%s",
+						root, pid, d1->d_name);
 
-			if (getfilecon(tmp, &sock_context) <= 0)
-				sock_context = strdup(no_ctx);
+				if (getfilecon(tmp, &sock_context) <= 0)
+					sock_context = strdup(no_ctx);
+			}
 
-			if (*p == '\0') {
+			if (!proc) {
+				char process[16] = "";
 				FILE *fp;
 
 				snprintf(tmp, sizeof(tmp), "%s/%d/stat",
 					root, pid);
 				if ((fp = fopen(tmp, "r")) != NULL) {
-					if (fscanf(fp, "%*d (%[^)])", p) < 1)
+					if (fscanf(fp, "%*d (%15[^)])", process) < 1)
 						; /* ignore */
 					fclose(fp);
 				}
+
+				pid_context = NULL;
+				if (show_proc_ctx &&
+				    getpidcon(pid, &pid_context) != 0)
+					pid_context = strdup(no_ctx);
+
+				proc = user_proc_add(process, pid_context);
 			}
-			user_ent_add(ino, p, pid, fd,
-					pid_context, sock_context);
-			free(sock_context);
+			user_ent_add(ino, proc, pid, fd, sock_context);
 		}
-		free(pid_context);
 		closedir(dir1);
 	}
 	closedir(dir);
@@ -530,6 +592,8 @@ static int find_entry(unsigned int ino, char **buf, int type)
 	if (!ino)
 		return 0;
 
+	user_ent_hash_build();
+
 	p = user_ent_hash[user_ent_hashfn(ino)];
 	ptr = *buf = NULL;
 	while (p) {
@@ -542,19 +606,19 @@ static int find_entry(unsigned int ino, char **buf, int type)
 			case USERS:
 				len = snprintf(ptr, buf_len - buf_used,
 					"(\"%s\",pid=%d,fd=%d),",
-					p->process, p->pid, p->fd);
+					p->proc->process, p->pid, p->fd);
 				break;
 			case PROC_CTX:
 				len = snprintf(ptr, buf_len - buf_used,
 					"(\"%s\",pid=%d,proc_ctx=%s,fd=%d),",
-					p->process, p->pid,
-					p->process_ctx, p->fd);
+					p->proc->process, p->pid,
+					p->proc->process_ctx, p->fd);
 				break;
 			case PROC_SOCK_CTX:
 				len = snprintf(ptr, buf_len - buf_used,
 					"(\"%s\",pid=%d,proc_ctx=%s,fd=%d,sock_ctx=%s),",
-					p->process, p->pid,
-					p->process_ctx, p->fd,
+					p->proc->process, p->pid,
+					p->proc->process_ctx, p->fd,
 					p->socket_ctx);
 				break;
 			default:
@@ -3946,7 +4010,7 @@ static void _usage(FILE *dest)
 "   -A, --query=QUERY, --socket=QUERY\n"
 "       QUERY := {all|inet|tcp|udp|raw|unix|unix_dgram|unix_stream|unix_seqpacket|packet|netlink}[,QUERY]\n"
 "\n"
-"   -D, --diag=FILE     Dump raw information about TCP sockets to FILE\n"
+"   -D, --diag=FILE     Dump raw information about inet sockets to FILE\n"
 "   -F, --filter=FILE   read filter information from FILE\n"
 "       FILTER := [ state STATE-FILTER ] [ EXPRESSION ]\n"
 "       STATE-FILTER := {all|connected|synchronized|bucket|big|TCP-STATES}\n"
@@ -4091,7 +4155,6 @@ int main(int argc, char *argv[])
 			break;
 		case 'p':
 			show_users++;
-			user_ent_hash_build();
 			break;
 		case 'b':
 			show_options = 1;
@@ -4250,7 +4313,6 @@ int main(int argc, char *argv[])
 				exit(1);
 			}
 			show_proc_ctx++;
-			user_ent_hash_build();
 			break;
 		case 'N':
 			if (netns_switch(optarg))
@@ -4324,28 +4386,46 @@ int main(int argc, char *argv[])
 		exit(0);
 	}
 
+	if (ssfilter_parse(&current_filter.f, argc, argv, filter_fp))
+		usage();
+
 	if (dump_tcpdiag) {
+		static const struct {
+			int db;
+			int protocol;
+		} diag_dbs[] = {
+			{ TCP_DB,  IPPROTO_TCP },
+			{ DCCP_DB, IPPROTO_DCCP },
+			{ SCTP_DB, IPPROTO_SCTP },
+			{ UDP_DB,  IPPROTO_UDP },
+			{ RAW_DB,  IPPROTO_RAW },
+		};
 		FILE *dump_fp = stdout;
+		unsigned int i;
 
-		if (!(current_filter.dbs & (1<<TCP_DB))) {
-			fprintf(stderr, "ss: tcpdiag dump requested and no tcp in filter.\n");
+		if (!(current_filter.dbs & INET_DBM)) {
+			fprintf(stderr, "ss: sockdiag dump requested and no inet sockets in filter.\n");
 			exit(0);
 		}
 		if (dump_tcpdiag[0] != '-') {
 			dump_fp = fopen(dump_tcpdiag, "w");
-			if (!dump_tcpdiag) {
+			if (!dump_fp) {
 				perror("fopen dump file");
 				exit(-1);
 			}
 		}
-		inet_show_netlink(&current_filter, dump_fp, IPPROTO_TCP);
+		/* The filter is compiled to bytecode and runs in the kernel,
+		 * so only matching sockets are copied out and written.
+		 */
+		for (i = 0; i < ARRAY_SIZE(diag_dbs); i++) {
+			if (current_filter.dbs & (1 << diag_dbs[i].db))
+				inet_show_netlink(&current_filter, dump_fp,
+						  diag_dbs[i].protocol);
+		}
 		fflush(dump_fp);
 		exit(0);
 	}
 
-	if (ssfilter_parse(&current_filter.f, argc, argv, filter_fp))
-		usage();
-
 	netid_width = 0;
 	if (current_filter.dbs&(current_filter.dbs-1))
 		netid_width = 5;
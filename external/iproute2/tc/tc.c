@@ -44,6 +44,7 @@ int force;
 bool use_names;
 
 static char *conf_file;
+static unsigned int pipeline;
 
 struct rtnl_handle rth;
 
@@ -187,7 +188,7 @@ noexist:
 static void usage(void)
 {
 	fprintf(stderr, "Usage: tc [ OPTIONS ] OBJECT { COMMAND | help }\n"
-			"       tc [-force] -batch filename\n"
+			"       tc [-force] [-pipeline depth] -batch filename\n"
 			"where  OBJECT := { qdisc | class | filter | action | monitor | exec }\n"
 	                "       OPTIONS := { -s[tatistics] | -d[etails] | -r[aw] | -p[retty] | -b[atch] [filename] | -n[etns] name |\n"
 			"                    -nm | -nam[es] | { -cf | -conf } path }\n");
@@ -217,6 +218,13 @@ static int do_cmd(int argc, char **argv)
 	return -1;
 }
 
+/* These objects only talk rtnetlink, so their requests can be queued. */
+static bool pipelined_cmd(const char *obj)
+{
+	return matches(obj, "qdisc") == 0 || matches(obj, "class") == 0 ||
+	       matches(obj, "filter") == 0 || matches(obj, "actions") == 0;
+}
+
 static int batch(const char *name)
 {
 	char *line = NULL;
@@ -239,6 +247,12 @@ static int batch(const char *name)
 		return -1;
 	}
 
+	if (pipeline && rtnl_pipeline_start(&rth, pipeline, name, &cmdlineno)) {
+		fprintf(stderr, "Cannot set up the netlink pipeline\n");
+		rtnl_close(&rth);
+		return -1;
+	}
+
 	cmdlineno = 0;
 	while (getcmdline(&line, &len, stdin) != -1) {
 		char *largv[100];
@@ -248,16 +262,27 @@ static int batch(const char *name)
 		if (largc == 0)
 			continue;	/* blank line */
 
+		if (!pipelined_cmd(largv[0]))
+			rtnl_pipeline_flush(&rth);
+
 		if (do_cmd(largc, largv)) {
 			fprintf(stderr, "Command failed %s:%d\n", name, cmdlineno);
 			ret = 1;
 			if (!force)
 				break;
 		}
+
+		if (rtnl_pipeline_errors(&rth)) {
+			ret = 1;
+			if (!force)
+				break;
+		}
 	}
 	if (line)
 		free(line);
 
+	if (rtnl_pipeline_stop(&rth))
+		ret = 1;
 	rtnl_close(&rth);
 	return ret;
 }
@@ -297,6 +322,16 @@ int main(int argc, char **argv)
 			if (argc <= 1)
 				usage();
 			batch_file = argv[1];
+		} else if (matches(argv[1], "-pipeline") == 0) {
+			argc--;	argv++;
+			if (argc <= 1)
+				usage();
+			if (get_unsigned(&pipeline, argv[1], 0) ||
+			    pipeline == 0) {
+				fprintf(stderr, "Invalid pipeline depth '%s'\n",
+					argv[1]);
+				return -1;
+			}
 		} else if (matches(argv[1], "-netns") == 0) {
 			NEXT_ARG();
 			if (netns_switch(argv[1]))
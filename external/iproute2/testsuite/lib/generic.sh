@@ -75,6 +75,31 @@ ts_ip()
 	fi
 }
 
+ts_ss()
+{
+	SCRIPT=$1; shift
+	DESC=$1; shift
+
+	$SS $@ 2> $STD_ERR > $STD_OUT
+	RET=$?
+
+	if [ -s $STD_ERR ] || [ "$RET" != "0" ]; then
+		ts_err "${SCRIPT}: ${DESC} failed:"
+		ts_err "command: $SS $@"
+		ts_err "stderr output:"
+		ts_err_cat $STD_ERR
+		if [ -s $STD_OUT ]; then
+			ts_err "stdout output:"
+			ts_err_cat $STD_OUT
+		fi
+	elif [ -s $STD_OUT ]; then
+		echo "${SCRIPT}: ${DESC} succeeded with output:"
+		cat $STD_OUT
+	else
+		echo "${SCRIPT}: ${DESC} succeeded"
+	fi
+}
+
 ts_qdisc_available()
 {
 	HELPOUT=`$TC qdisc add $1 help 2>&1`
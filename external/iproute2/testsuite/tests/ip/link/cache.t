@@ -0,0 +1,37 @@
+#!/bin/sh
+
+. lib/generic.sh
+
+ts_log "[Testing link listings served by ip monitor cache]"
+
+DEV="$(rand_dev)"
+BR="$(rand_dev)"
+SOCK=`mktemp -u`
+
+ts_ip "$0" "Add $DEV dummy interface" link add dev $DEV type dummy
+ts_ip "$0" "Add $BR bridge" link add dev $BR type bridge
+
+$IP monitor cache $SOCK &
+CACHE_PID=$!
+sleep 1
+
+# Bridge port notifications (AF_BRIDGE) share the ifindex of $DEV
+ts_ip "$0" "Enslave $DEV to $BR" link set $DEV master $BR
+sleep 1
+ts_ip "$0" "Show $DEV from the cache" -cache $SOCK link show dev $DEV
+test_on "$DEV.*master $BR"
+test_lines_count 2
+
+ts_ip "$0" "Release $DEV from $BR" link set $DEV nomaster
+sleep 1
+ts_ip "$0" "Show links from the cache" -cache $SOCK link show
+test_on "$DEV"
+ts_ip "$0" "Show $DEV from the cache" -cache $SOCK link show dev $DEV
+test_on_not "master"
+test_lines_count 2
+
+kill $CACHE_PID
+wait $CACHE_PID
+
+ts_ip "$0" "Del $BR bridge" link del dev $BR
+ts_ip "$0" "Del $DEV dummy interface" link del dev $DEV
@@ -0,0 +1,41 @@
+#!/bin/sh
+
+. lib/generic.sh
+
+ts_log "[Testing route listings served by ip monitor cache]"
+
+DEV="$(rand_dev)"
+SOCK=`mktemp -u`
+
+ts_ip "$0" "Add $DEV dummy interface" link add dev $DEV type dummy
+ts_ip "$0" "Enable $DEV" link set $DEV up
+ts_ip "$0" "Add address to $DEV" addr add 1.1.1.1/24 dev $DEV
+
+$IP monitor cache $SOCK &
+CACHE_PID=$!
+sleep 1
+
+ts_ip "$0" "Add route while the cache runs" route add 2.2.2.0/24 via 1.1.1.2
+sleep 1
+ts_ip "$0" "Show routes from the cache" -cache $SOCK route show dev $DEV
+test_on "2.2.2.0/24 via 1.1.1.2"
+test_lines_count 2
+
+ts_ip "$0" "Delete route" route del 2.2.2.0/24
+sleep 1
+ts_ip "$0" "Show routes from the cache" -cache $SOCK route show dev $DEV
+test_on_not "2.2.2.0/24"
+test_lines_count 1
+
+# Proxy entries are not in the daemon's dump, the kernel answers
+ts_ip "$0" "Add neighbour" neigh add 1.1.1.3 lladdr 02:00:00:00:00:03 dev $DEV
+ts_ip "$0" "Add proxy neighbour" neigh add proxy 1.1.1.5 dev $DEV
+sleep 1
+ts_ip "$0" "Show proxy neighbours" -cache $SOCK neigh show proxy
+test_on "1.1.1.5 dev $DEV"
+test_on_not "1.1.1.3"
+
+kill $CACHE_PID
+wait $CACHE_PID
+
+ts_ip "$0" "Del $DEV dummy interface" link del dev $DEV
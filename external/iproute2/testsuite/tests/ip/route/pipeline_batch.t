@@ -0,0 +1,48 @@
+#!/bin/sh
+
+. lib/generic.sh
+
+ts_log "[Testing routes in pipelined batch mode]"
+
+DEV="$(rand_dev)"
+BATCHFILE=`mktemp`
+
+echo "link add $DEV type dummy" >> $BATCHFILE
+echo "link set up dev $DEV" >> $BATCHFILE
+echo "addr add 1.1.1.1/24 dev $DEV" >> $BATCHFILE
+for i in `seq 1 200`; do
+	echo "route add 2.2.$i.0/24 via 1.1.1.2" >> $BATCHFILE
+done
+echo "route show dev $DEV" >> $BATCHFILE
+ts_ip "$0" "Add $DEV and 200 routes in pipelined batch mode" \
+	-pipeline 16 -batch $BATCHFILE
+test_on "2.2.200.0/24 via 1.1.1.2"
+test_lines_count 201
+rm -f $BATCHFILE
+
+# One failing line in the middle of a pipelined window: its error must be
+# reported against that line, and the requests around it still applied
+BATCHFILE=`mktemp`
+for i in `seq 1 20`; do
+	echo "route add 3.3.$i.0/24 via 1.1.1.2" >> $BATCHFILE
+done
+echo "route add 2.2.100.0/24 via 1.1.1.2" >> $BATCHFILE
+for i in `seq 21 40`; do
+	echo "route add 3.3.$i.0/24 via 1.1.1.2" >> $BATCHFILE
+done
+echo -n "$0: Add 40 routes and a duplicate on line 21 in pipelined batch mode"
+if $IP -force -pipeline 16 -batch $BATCHFILE > /dev/null 2> $STD_OUT; then
+	pr_failed
+else
+	pr_success
+fi
+test_on "^Command failed $BATCHFILE:21$"
+test_lines_count 2
+rm -f $BATCHFILE
+
+ts_ip "$0" "Show routes added around the failure" route show root 3.3.0.0/16
+test_on "3.3.20.0/24 via 1.1.1.2"
+test_on "3.3.21.0/24 via 1.1.1.2"
+test_lines_count 40
+
+ts_ip "$0" "Del $DEV dummy interface" link del dev $DEV
@@ -0,0 +1,51 @@
+#!/bin/sh
+
+. lib/generic.sh
+
+ts_log "[Testing ss on dumps larger than one receive buffer]"
+
+# Each listener takes ~100 bytes of sock_diag reply, so 2000 of them span
+# several 32K batches from the kernel
+NSOCKS=2000
+BASE=20000
+
+command -v python3 > /dev/null || ts_skip
+
+python3 - $BASE $NSOCKS <<'PY' &
+import socket, sys, time
+base, n = int(sys.argv[1]), int(sys.argv[2])
+socks = []
+for port in range(base, base + n):
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.bind(("127.0.0.1", port))
+    s.listen(1)
+    socks.append(s)
+time.sleep(30)
+PY
+LISTEN_PID=$!
+
+ts_ip "$0" "Enable lo" link set lo up
+sleep 2
+
+ts_ss "$0" "Show all listeners" -Htln
+test_lines_count $NSOCKS
+test_on "127.0.0.1:$BASE "
+test_on "127.0.0.1:$((BASE + NSOCKS - 1)) "
+
+ts_ss "$0" "Show one listener through a kernel filter" -Htln sport = :$((BASE + 1234))
+test_lines_count 1
+test_on "127.0.0.1:$((BASE + 1234)) "
+
+DUMP=`mktemp`
+ts_ss "$0" "Dump one listener raw" -tl -D $DUMP sport = :$((BASE + 1234))
+echo -n "test on raw dump size: "
+# One inet_diag_msg and the trailing NLMSG_DONE, nothing else
+if [ -s $DUMP ] && [ `wc -c < $DUMP` -lt 512 ]; then
+	pr_success
+else
+	pr_failed
+fi
+rm -f $DUMP
+
+kill $LISTEN_PID
+wait $LISTEN_PID 2> /dev/null
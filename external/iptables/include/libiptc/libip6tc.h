@@ -148,6 +148,9 @@ int ip6tc_set_counter(const xt_chainlabel chain,
 /* Makes the actual changes. */
 int ip6tc_commit(struct xtc_handle *handle);
 
+/* Does the table in the kernel still match the handle? */
+int ip6tc_is_current(struct xtc_handle *handle);
+
 /* Get raw socket. */
 int ip6tc_get_raw_socket(void);
 
@@ -154,6 +154,9 @@ int iptc_set_counter(const xt_chainlabel chain,
 /* Makes the actual changes. */
 int iptc_commit(struct xtc_handle *handle);
 
+/* Does the table in the kernel still match the handle? */
+int iptc_is_current(struct xtc_handle *handle);
+
 /* Get raw socket. */
 int iptc_get_raw_socket(void);
 
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include "iptables.h"
 #include "ip6tables.h"
 #include "xshared.h"
@@ -20,7 +21,7 @@
 #include "iptables-multi.h"
 #include "ip6tables-multi.h"
 
-static int counters, verbose, noflush, wait;
+static int counters, verbose, noflush, wait, daemon_mode;
 
 static struct timeval wait_interval = {
 	.tv_sec	= 1,
@@ -38,18 +39,20 @@ static const struct option options[] = {
 	{.name = "table",         .has_arg = 1, .val = 'T'},
 	{.name = "wait",          .has_arg = 2, .val = 'w'},
 	{.name = "wait-interval", .has_arg = 2, .val = 'W'},
+	{.name = "daemon",        .has_arg = 0, .val = 'D'},
 	{NULL},
 };
 
 static void print_usage(const char *name, const char *version)
 {
-	fprintf(stderr, "Usage: %s [-c] [-v] [-V] [-t] [-h] [-n] [-w secs] [-W usecs] [-T table] [-M command] [file]\n"
+	fprintf(stderr, "Usage: %s [-c] [-v] [-V] [-t] [-h] [-n] [-D] [-w secs] [-W usecs] [-T table] [-M command] [file]\n"
 			"	   [ --counters ]\n"
 			"	   [ --verbose ]\n"
 			"	   [ --version]\n"
 			"	   [ --test ]\n"
 			"	   [ --help ]\n"
 			"	   [ --noflush ]\n"
+			"	   [ --daemon ]\n"
 			"	   [ --wait=<seconds>\n"
 			"	   [ --wait-interval=<usecs>\n"
 			"	   [ --table=<TABLE> ]\n"
@@ -89,6 +92,89 @@ create_handle(const struct iptables_restore_cb *cb, const char *tablename)
 	return handle;
 }
 
+/* Handles kept between transactions in daemon mode */
+#define TABLE_CACHE_SIZE	8
+
+static struct {
+	char name[XT_TABLE_MAXNAMELEN + 1];
+	struct xtc_handle *handle;
+} table_cache[TABLE_CACHE_SIZE];
+
+/* Take the cached handle of a table if the kernel has not moved on */
+static struct xtc_handle *
+get_cached_handle(const struct iptables_restore_cb *cb, const char *tablename)
+{
+	struct xtc_handle *handle;
+	int i;
+
+	for (i = 0; i < TABLE_CACHE_SIZE; i++) {
+		if (!table_cache[i].handle ||
+		    strcmp(table_cache[i].name, tablename) != 0)
+			continue;
+
+		handle = table_cache[i].handle;
+		table_cache[i].handle = NULL;
+		if (cb->ops->is_current(handle))
+			return handle;
+
+		DEBUGP("table '%s' changed, reloading\n", tablename);
+		cb->ops->free(handle);
+		break;
+	}
+
+	return NULL;
+}
+
+static void
+put_cached_handle(const struct iptables_restore_cb *cb, const char *tablename,
+		  struct xtc_handle *handle)
+{
+	int i;
+
+	for (i = 0; i < TABLE_CACHE_SIZE; i++) {
+		if (table_cache[i].handle)
+			continue;
+
+		strcpy(table_cache[i].name, tablename);
+		table_cache[i].handle = handle;
+		return;
+	}
+
+	cb->ops->free(handle);
+}
+
+static void
+free_cached_handles(const struct iptables_restore_cb *cb)
+{
+	int i;
+
+	for (i = 0; i < TABLE_CACHE_SIZE; i++) {
+		if (table_cache[i].handle)
+			cb->ops->free(table_cache[i].handle);
+		table_cache[i].handle = NULL;
+	}
+}
+
+/* Tell whoever feeds us how the transaction went */
+static void
+report_commit(const char *tablename, int ok, int cached,
+	      const struct timespec *start)
+{
+	struct timespec now;
+	long usecs;
+
+	if (!ok) {
+		printf("# COMMIT %s: failed\n", tablename);
+	} else {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		usecs = (now.tv_sec - start->tv_sec) * 1000000 +
+			(now.tv_nsec - start->tv_nsec) / 1000;
+		printf("# COMMIT %s: %ld us, %s\n", tablename, usecs,
+		       cached ? "cached" : "reloaded");
+	}
+	fflush(stdout);
+}
+
 static int
 ip46tables_restore_main(const struct iptables_restore_cb *cb,
 			int argc, char *argv[])
@@ -100,12 +186,14 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 	char curtable[XT_TABLE_MAXNAMELEN + 1] = {};
 	FILE *in;
 	int in_table = 0, testing = 0;
+	int discard = 0, cached = 0;
+	struct timespec start = {};
 	const char *tablename = NULL;
 
 	line = 0;
 	lock = XT_LOCK_NOT_ACQUIRED;
 
-	while ((c = getopt_long(argc, argv, "bcvVthnwWM:T:", options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "bcvVthnDwWM:T:", options, NULL)) != -1) {
 		switch (c) {
 			case 'b':
 				fprintf(stderr, "-b/--binary option is not implemented\n");
@@ -131,6 +219,9 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 			case 'n':
 				noflush = 1;
 				break;
+			case 'D':
+				daemon_mode = 1;
+				break;
 			case 'w':
 				wait = parse_wait_time(argc, argv);
 				break;
@@ -175,6 +266,14 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 		int ret = 0;
 
 		line++;
+		if (discard) {
+			/* skip the rest of a failed transaction */
+			if (strcmp(buffer, "COMMIT\n") == 0) {
+				report_commit(curtable, 0, 0, NULL);
+				discard = 0;
+			}
+			continue;
+		}
 		if (buffer[0] == '\n')
 			continue;
 		else if (buffer[0] == '#') {
@@ -187,7 +286,10 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 			if (!testing) {
 				DEBUGP("Calling commit\n");
 				ret = cb->ops->commit(handle);
-				cb->ops->free(handle);
+				if (daemon_mode && ret)
+					put_cached_handle(cb, curtable, handle);
+				else
+					cb->ops->free(handle);
 				handle = NULL;
 			} else {
 				DEBUGP("Not calling commit, testing\n");
@@ -201,7 +303,11 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 			}
 
 			in_table = 0;
+			if (daemon_mode)
+				report_commit(curtable, ret, cached, &start);
 		} else if ((buffer[0] == '*') && (!in_table)) {
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
 			/* Acquire a lock before we create a new table handle */
 			lock = xtables_lock_or_exit(wait, &wait_interval);
 
@@ -228,7 +334,12 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 			if (handle)
 				cb->ops->free(handle);
 
-			handle = create_handle(cb, table);
+			handle = NULL;
+			if (daemon_mode && !testing)
+				handle = get_cached_handle(cb, table);
+			cached = handle != NULL;
+			if (!handle)
+				handle = create_handle(cb, table);
 			if (noflush == 0) {
 				DEBUGP("Cleaning all chains of table '%s'\n",
 					table);
@@ -346,15 +457,29 @@ ip46tables_restore_main(const struct iptables_restore_cb *cb,
 		if (!ret) {
 			fprintf(stderr, "%s: line %u failed\n",
 					xt_params->program_name, line);
-			exit(1);
+			if (!daemon_mode)
+				exit(1);
+
+			/* The kernel still has the old table, drop ours. */
+			if (handle) {
+				cb->ops->free(handle);
+				handle = NULL;
+			}
+			if (lock >= 0) {
+				xtables_unlock(lock);
+				lock = XT_LOCK_NOT_ACQUIRED;
+			}
+			discard = in_table;
+			in_table = 0;
 		}
 	}
-	if (in_table) {
+	if (in_table || discard) {
 		fprintf(stderr, "%s: COMMIT expected at line %u\n",
 				xt_params->program_name, line + 1);
 		exit(1);
 	}
 
+	free_cached_handles(cb);
 	fclose(in);
 	return 0;
 }
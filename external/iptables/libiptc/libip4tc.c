@@ -87,6 +87,7 @@ typedef unsigned int socklen_t;
 #define TC_INIT			iptc_init
 #define TC_FREE			iptc_free
 #define TC_COMMIT		iptc_commit
+#define TC_IS_CURRENT		iptc_is_current
 #define TC_STRERROR		iptc_strerror
 #define TC_NUM_RULES		iptc_num_rules
 #define TC_GET_RULE		iptc_get_rule
@@ -209,6 +210,33 @@ is_same(const STRUCT_ENTRY *a, const STRUCT_ENTRY *b, unsigned char *matchmask)
 	return mptr;
 }
 
+static uint32_t
+head_hash(const STRUCT_ENTRY *e)
+{
+	unsigned char iface[2 * IFNAMSIZ];
+	uint32_t hash = 2166136261u;
+	unsigned int i;
+
+	hash = iptcc_hash(hash, &e->ip.src, sizeof(e->ip.src));
+	hash = iptcc_hash(hash, &e->ip.dst, sizeof(e->ip.dst));
+	hash = iptcc_hash(hash, &e->ip.smsk, sizeof(e->ip.smsk));
+	hash = iptcc_hash(hash, &e->ip.dmsk, sizeof(e->ip.dmsk));
+	hash = iptcc_hash(hash, &e->ip.proto, sizeof(e->ip.proto));
+	hash = iptcc_hash(hash, &e->ip.flags, sizeof(e->ip.flags));
+	hash = iptcc_hash(hash, &e->ip.invflags, sizeof(e->ip.invflags));
+
+	for (i = 0; i < IFNAMSIZ; i++) {
+		iface[i] = e->ip.iniface[i] & e->ip.iniface_mask[i];
+		iface[IFNAMSIZ + i] = e->ip.outiface[i] & e->ip.outiface_mask[i];
+	}
+	hash = iptcc_hash(hash, iface, sizeof(iface));
+	hash = iptcc_hash(hash, e->ip.iniface_mask, IFNAMSIZ);
+	hash = iptcc_hash(hash, e->ip.outiface_mask, IFNAMSIZ);
+
+	hash = iptcc_hash(hash, &e->target_offset, sizeof(e->target_offset));
+	return iptcc_hash(hash, &e->next_offset, sizeof(e->next_offset));
+}
+
 #if 0
 /***************************** DEBUGGING ********************************/
 static inline int
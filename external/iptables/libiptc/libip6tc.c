@@ -85,6 +85,7 @@ typedef unsigned int socklen_t;
 #define TC_INIT			ip6tc_init
 #define TC_FREE			ip6tc_free
 #define TC_COMMIT		ip6tc_commit
+#define TC_IS_CURRENT		ip6tc_is_current
 #define TC_STRERROR		ip6tc_strerror
 #define TC_NUM_RULES		ip6tc_num_rules
 #define TC_GET_RULE		ip6tc_get_rule
@@ -244,6 +245,34 @@ is_same(const STRUCT_ENTRY *a, const STRUCT_ENTRY *b,
 	return mptr;
 }
 
+static uint32_t
+head_hash(const STRUCT_ENTRY *e)
+{
+	unsigned char iface[2 * IFNAMSIZ];
+	uint32_t hash = 2166136261u;
+	unsigned int i;
+
+	hash = iptcc_hash(hash, &e->ipv6.src, sizeof(e->ipv6.src));
+	hash = iptcc_hash(hash, &e->ipv6.dst, sizeof(e->ipv6.dst));
+	hash = iptcc_hash(hash, &e->ipv6.smsk, sizeof(e->ipv6.smsk));
+	hash = iptcc_hash(hash, &e->ipv6.dmsk, sizeof(e->ipv6.dmsk));
+	hash = iptcc_hash(hash, &e->ipv6.proto, sizeof(e->ipv6.proto));
+	hash = iptcc_hash(hash, &e->ipv6.tos, sizeof(e->ipv6.tos));
+	hash = iptcc_hash(hash, &e->ipv6.flags, sizeof(e->ipv6.flags));
+	hash = iptcc_hash(hash, &e->ipv6.invflags, sizeof(e->ipv6.invflags));
+
+	for (i = 0; i < IFNAMSIZ; i++) {
+		iface[i] = e->ipv6.iniface[i] & e->ipv6.iniface_mask[i];
+		iface[IFNAMSIZ + i] = e->ipv6.outiface[i] & e->ipv6.outiface_mask[i];
+	}
+	hash = iptcc_hash(hash, iface, sizeof(iface));
+	hash = iptcc_hash(hash, e->ipv6.iniface_mask, IFNAMSIZ);
+	hash = iptcc_hash(hash, e->ipv6.outiface_mask, IFNAMSIZ);
+
+	hash = iptcc_hash(hash, &e->target_offset, sizeof(e->target_offset));
+	return iptcc_hash(hash, &e->next_offset, sizeof(e->next_offset));
+}
+
 #if 0
 /* All zeroes == unconditional rule. */
 static inline int
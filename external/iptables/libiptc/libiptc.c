@@ -29,6 +29,7 @@
  * 	- performance work: speedup initial ruleset parsing.
  * 	- sponsored by ComX Networks A/S (http://www.comx.dk/)
  */
+#include <stddef.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
@@ -100,6 +101,9 @@ struct rule_head
 	enum iptcc_rule_type type;
 	struct chain_head *jump;	/* jump target, if IPTCC_R_JUMP */
 
+	struct list_head hash_list;	/* bucket in chain's rule index */
+	uint32_t hash;			/* iptcc_rule_hash() of entry */
+
 	unsigned int size;		/* size of entry data */
 	STRUCT_ENTRY entry[0];
 };
@@ -122,6 +126,12 @@ struct chain_head
 	unsigned int head_offset;	/* offset in rule blob */
 	unsigned int foot_index;	/* index (needed for counter_map) */
 	unsigned int foot_offset;	/* offset in rule blob */
+
+	int changed;			/* modified since last compile */
+	int reuse;			/* blob can be copied from entries */
+
+	struct list_head *rule_hash;	/* rule index, built on demand */
+	unsigned int rule_hash_sz;	/* number of buckets (power of 2) */
 };
 
 struct xtc_handle {
@@ -143,8 +153,11 @@ struct xtc_handle {
 			     * possible to bsearch offsets using chain_index.
 			     */
 
+	struct list_head ext_masks;	/* learned from delete/check masks */
+
 	STRUCT_GETINFO info;
 	STRUCT_GET_ENTRIES *entries;
+	STRUCT_REPLACE *committed;	/* last blob pushed, replaces entries */
 };
 
 enum bsearch_type {
@@ -177,10 +190,26 @@ static struct rule_head *iptcc_alloc_rule(struct chain_head *c, unsigned int siz
 
 	r->chain = c;
 	r->size = size;
+	INIT_LIST_HEAD(&r->hash_list);
 
 	return r;
 }
 
+/* the table as we last read or committed it */
+static inline void *iptcb_blob(struct xtc_handle *h)
+{
+	if (h->committed)
+		return h->committed->entries;
+	return h->entries->entrytable;
+}
+
+static inline unsigned int iptcb_blob_size(struct xtc_handle *h)
+{
+	if (h->committed)
+		return h->committed->size;
+	return h->entries->size;
+}
+
 /* notify us that the ruleset has been modified by the user */
 static inline void
 set_changed(struct xtc_handle *h)
@@ -188,6 +217,14 @@ set_changed(struct xtc_handle *h)
 	h->changed = 1;
 }
 
+/* notify us that the blob of a chain has to be compiled again */
+static inline void
+set_chain_changed(struct xtc_handle *h, struct chain_head *c)
+{
+	c->changed = 1;
+	set_changed(h);
+}
+
 /**********************************************************************
  * iptc blob utility functions (iptcb_*)
  **********************************************************************/
@@ -220,7 +257,7 @@ iptcb_get_entry_n(STRUCT_ENTRY *i,
 static inline STRUCT_ENTRY *
 iptcb_get_entry(struct xtc_handle *h, unsigned int offset)
 {
-	return (STRUCT_ENTRY *)((char *)h->entries->entrytable + offset);
+	return (STRUCT_ENTRY *)((char *)iptcb_blob(h) + offset);
 }
 
 static unsigned int
@@ -228,10 +265,10 @@ iptcb_entry2index(struct xtc_handle *const h, const STRUCT_ENTRY *seek)
 {
 	unsigned int pos = 0;
 
-	if (ENTRY_ITERATE(h->entries->entrytable, h->entries->size,
+	if (ENTRY_ITERATE(iptcb_blob(h), iptcb_blob_size(h),
 			  iptcb_get_number, seek, &pos) == 0) {
 		fprintf(stderr, "ERROR: offset %u not an entry!\n",
-			(unsigned int)((char *)seek - (char *)h->entries->entrytable));
+			(unsigned int)((char *)seek - (char *)iptcb_blob(h)));
 		abort();
 	}
 	return pos;
@@ -240,14 +277,14 @@ iptcb_entry2index(struct xtc_handle *const h, const STRUCT_ENTRY *seek)
 static inline STRUCT_ENTRY *
 iptcb_offset2entry(struct xtc_handle *h, unsigned int offset)
 {
-	return (STRUCT_ENTRY *) ((void *)h->entries->entrytable+offset);
+	return (STRUCT_ENTRY *) ((void *)iptcb_blob(h)+offset);
 }
 
 
 static inline unsigned long
 iptcb_entry2offset(struct xtc_handle *const h, const STRUCT_ENTRY *e)
 {
-	return (void *)e - (void *)h->entries->entrytable;
+	return (void *)e - (void *)iptcb_blob(h);
 }
 
 static inline unsigned int
@@ -627,6 +664,226 @@ static int iptcc_chain_index_delete_chain(struct chain_head *c, struct xtc_handl
 }
 
 
+/**********************************************************************
+ * Rule index (cache utility) functions
+ **********************************************************************
+ * Deleting or checking a rule by its specification has to find an
+ * equal rule in the chain.  Equal means the same header, matches and
+ * target, but only for the match and target data bytes set in the
+ * matchmask iptables passes along (kernel private parts are excluded).
+ *
+ * Large chains get a hash over exactly those bytes, so the lookup only
+ * compares rules in one bucket.  The hash must not depend on the mask
+ * of a particular request, thus the data masks are remembered per
+ * extension the first time they are seen.  Learning a new mask drops
+ * all rule indexes, they are rebuilt on the next lookup.
+ */
+#ifndef RULE_HASH_MIN_RULES
+#define RULE_HASH_MIN_RULES 16
+#endif
+
+struct iptcc_ext_mask {
+	struct list_head list;
+	char name[XT_EXTENSION_MAXNAMELEN];
+	bool target;
+	unsigned int size;		/* match/target size incl. header */
+	unsigned char mask[0];		/* for the data part */
+};
+
+/* FNV-1a */
+static inline uint32_t iptcc_hash(uint32_t hash, const void *data,
+				  unsigned int len)
+{
+	const unsigned char *p = data;
+
+	while (len--)
+		hash = (hash ^ *p++) * 16777619;
+	return hash;
+}
+
+static inline uint32_t iptcc_hash_masked(uint32_t hash,
+					 const unsigned char *data,
+					 const unsigned char *mask,
+					 unsigned int len)
+{
+	while (len--)
+		hash = (hash ^ (*data++ & *mask++)) * 16777619;
+	return hash;
+}
+
+/* Hash what is_same() always compares, defined per protocol */
+static uint32_t head_hash(const STRUCT_ENTRY *e);
+
+static struct iptcc_ext_mask *
+iptcc_find_ext_mask(struct xtc_handle *h, const char *name, bool target,
+		    unsigned int size)
+{
+	struct iptcc_ext_mask *m;
+
+	list_for_each_entry(m, &h->ext_masks, list) {
+		if (m->size == size && m->target == target
+		    && strcmp(m->name, name) == 0)
+			return m;
+	}
+	return NULL;
+}
+
+/* Hash an extension (match or target, same layout) */
+static uint32_t iptcc_ext_hash(struct xtc_handle *h, uint32_t hash,
+			       const STRUCT_ENTRY_MATCH *m, bool target)
+{
+	unsigned int hdr = target ? sizeof(STRUCT_ENTRY_TARGET)
+				  : ALIGN(sizeof(*m));
+	struct iptcc_ext_mask *em;
+
+	hash = iptcc_hash(hash, m->u.user.name, strlen(m->u.user.name));
+	hash = iptcc_hash(hash, &m->u.match_size, sizeof(m->u.match_size));
+
+	/* Without a known mask the data can't be part of the hash */
+	em = iptcc_find_ext_mask(h, m->u.user.name, target, m->u.match_size);
+	if (em)
+		hash = iptcc_hash_masked(hash, (const void *)m + hdr, em->mask,
+					 m->u.match_size - hdr);
+	return hash;
+}
+
+static uint32_t iptcc_rule_hash(struct xtc_handle *h, struct rule_head *r)
+{
+	STRUCT_ENTRY *e = r->entry;
+	STRUCT_STANDARD_TARGET *t;
+	unsigned int off;
+	uint32_t hash;
+
+	hash = head_hash(e);
+
+	for (off = sizeof(STRUCT_ENTRY); off < e->target_offset;) {
+		const STRUCT_ENTRY_MATCH *m = (const void *)e + off;
+
+		hash = iptcc_ext_hash(h, hash, m, false);
+		off += m->u.match_size;
+	}
+
+	hash = iptcc_hash(hash, &r->type, sizeof(r->type));
+	switch (r->type) {
+	case IPTCC_R_FALLTHROUGH:
+		break;
+	case IPTCC_R_JUMP:
+		hash = iptcc_hash(hash, &r->jump, sizeof(r->jump));
+		break;
+	case IPTCC_R_STANDARD:
+		t = (STRUCT_STANDARD_TARGET *)GET_TARGET(e);
+		hash = iptcc_hash(hash, &t->verdict, sizeof(t->verdict));
+		break;
+	case IPTCC_R_MODULE:
+		hash = iptcc_ext_hash(h, hash, (const void *)GET_TARGET(e),
+				      true);
+		break;
+	}
+
+	return hash;
+}
+
+static void iptcc_rule_hash_free(struct chain_head *c)
+{
+	free(c->rule_hash);
+	c->rule_hash = NULL;
+	c->rule_hash_sz = 0;
+}
+
+static int iptcc_rule_hash_build(struct xtc_handle *h, struct chain_head *c)
+{
+	unsigned int i, sz = 16;
+	struct rule_head *r;
+
+	while (sz < c->num_rules)
+		sz <<= 1;
+
+	iptcc_rule_hash_free(c);
+	c->rule_hash = malloc(sz * sizeof(struct list_head));
+	if (!c->rule_hash)
+		return -ENOMEM;
+	c->rule_hash_sz = sz;
+
+	for (i = 0; i < sz; i++)
+		INIT_LIST_HEAD(&c->rule_hash[i]);
+
+	list_for_each_entry(r, &c->rules, list) {
+		r->hash = iptcc_rule_hash(h, r);
+		list_add_tail(&r->hash_list, &c->rule_hash[r->hash & (sz - 1)]);
+	}
+
+	return 0;
+}
+
+/* Keep the index of the chain current after adding rule r */
+static void iptcc_rule_hash_add(struct xtc_handle *h, struct chain_head *c,
+				struct rule_head *r)
+{
+	if (!c->rule_hash)
+		return;
+
+	if (c->num_rules > 2 * c->rule_hash_sz) {
+		/* the next lookup builds a larger one */
+		iptcc_rule_hash_free(c);
+		return;
+	}
+
+	r->hash = iptcc_rule_hash(h, r);
+	list_add_tail(&r->hash_list, &c->rule_hash[r->hash & (c->rule_hash_sz - 1)]);
+}
+
+/* Remember the data masks of the extensions in e */
+static void iptcc_learn_masks(struct xtc_handle *h, const STRUCT_ENTRY *e,
+			      const unsigned char *matchmask, bool target)
+{
+	const STRUCT_ENTRY_MATCH *m;
+	struct iptcc_ext_mask *em;
+	struct chain_head *c;
+	unsigned int off, hdr, len;
+	bool learned = false;
+
+	for (off = sizeof(STRUCT_ENTRY); off < e->next_offset;
+	     off += m->u.match_size) {
+		bool is_target = off >= e->target_offset;
+
+		m = (const void *)e + off;
+		if (is_target && !target)
+			break;
+		hdr = is_target ? sizeof(STRUCT_ENTRY_TARGET)
+				: ALIGN(sizeof(*m));
+
+		if (m->u.match_size < hdr)
+			break;
+		len = m->u.match_size - hdr;
+
+		em = iptcc_find_ext_mask(h, m->u.user.name, is_target,
+					 m->u.match_size);
+		if (em && memcmp(em->mask, matchmask + off + hdr, len) == 0)
+			continue;
+
+		if (!em) {
+			em = malloc(sizeof(*em) + len);
+			if (!em)
+				break;
+			memset(em->name, 0, sizeof(em->name));
+			memcpy(em->name, m->u.user.name,
+			       sizeof(m->u.user.name));
+			em->target = is_target;
+			em->size = m->u.match_size;
+			list_add(&em->list, &h->ext_masks);
+		}
+		memcpy(em->mask, matchmask + off + hdr, len);
+		learned = true;
+	}
+
+	if (!learned)
+		return;
+
+	list_for_each_entry(c, &h->chains, list)
+		iptcc_rule_hash_free(c);
+}
+
+
 /**********************************************************************
  * iptc cache utility functions (iptcc_*)
  **********************************************************************/
@@ -786,6 +1043,8 @@ static void iptcc_delete_rule(struct rule_head *r)
 		r->jump->references--;
 
 	list_del(&r->list);
+	if (r->chain->rule_hash)
+		list_del(&r->hash_list);
 	free(r);
 }
 
@@ -1125,6 +1384,37 @@ static inline int iptcc_compile_rule (struct xtc_handle *h, STRUCT_REPLACE *repl
 	return 1;
 }
 
+/* copy an unmodified chain from the previous blob */
+static int iptcc_copy_chain(struct xtc_handle *h, STRUCT_REPLACE *repl, struct chain_head *c)
+{
+	struct rule_head *r;
+
+	memcpy((char *)repl->entries + c->head_offset,
+	       (char *)iptcb_blob(h) + c->head_offset,
+	       c->foot_offset + IPTCB_CHAIN_FOOT_SIZE - c->head_offset);
+
+	if (iptcc_is_builtin(c)) {
+		repl->hook_entry[c->hooknum-1] = c->head_offset;
+		repl->underflow[c->hooknum-1] = c->foot_offset;
+	}
+
+	list_for_each_entry(r, &c->rules, list) {
+		STRUCT_STANDARD_TARGET *t;
+
+		if (r->type != IPTCC_R_JUMP)
+			continue;
+
+		t = (STRUCT_STANDARD_TARGET *)GET_TARGET(r->entry);
+		t->verdict = r->jump->head_offset + IPTCB_CHAIN_START_SIZE;
+		t = (STRUCT_STANDARD_TARGET *)
+			GET_TARGET((STRUCT_ENTRY *)((char *)repl->entries
+						    + r->offset));
+		t->verdict = r->jump->head_offset + IPTCB_CHAIN_START_SIZE;
+	}
+
+	return 0;
+}
+
 /* compile chain from cache into blob */
 static int iptcc_compile_chain(struct xtc_handle *h, STRUCT_REPLACE *repl, struct chain_head *c)
 {
@@ -1133,6 +1423,10 @@ static int iptcc_compile_chain(struct xtc_handle *h, STRUCT_REPLACE *repl, struc
 	struct iptcb_chain_start *head;
 	struct iptcb_chain_foot *foot;
 
+	/* untouched chains keep their blob, only jumps may have moved */
+	if (c->reuse)
+		return iptcc_copy_chain(h, repl, c);
+
 	/* only user-defined chains have heaer */
 	if (!iptcc_is_builtin(c)) {
 		/* put chain header in place */
@@ -1180,6 +1474,9 @@ static int iptcc_compile_chain_offsets(struct xtc_handle *h, struct chain_head *
 {
 	struct rule_head *r;
 
+	/* The blob of an unmodified chain at the same place is the one
+	 * we read from the kernel or committed last time */
+	c->reuse = !c->changed && c->head_offset == *offset;
 	c->head_offset = *offset;
 	DEBUGP("%s: chain_head %u, offset=%u\n", c->name, *num, *offset);
 
@@ -1274,6 +1571,7 @@ alloc_handle(STRUCT_GETINFO *infop)
 	}
 	memset(h, 0, sizeof(*h));
 	INIT_LIST_HEAD(&h->chains);
+	INIT_LIST_HEAD(&h->ext_masks);
 	strcpy(h->info.name, infop->name);
 
 	h->entries = malloc(sizeof(STRUCT_GET_ENTRIES) + infop->size);
@@ -1371,9 +1669,100 @@ error:
 	return NULL;
 }
 
+/* Compare matches and target of two entries. The kernel only copies
+ * extension names up to their terminating NUL. */
+static int iptcb_elems_equal(const STRUCT_ENTRY *k, const STRUCT_ENTRY *e)
+{
+	unsigned int off = sizeof(STRUCT_ENTRY);
+
+	while (off < k->next_offset) {
+		const STRUCT_ENTRY_MATCH *a = (const void *)k + off;
+		const STRUCT_ENTRY_MATCH *b = (const void *)e + off;
+
+		if (a->u.match_size != b->u.match_size
+		    || a->u.match_size < sizeof(STRUCT_ENTRY_MATCH)
+		    || a->u.match_size > k->next_offset - off
+		    || strncmp(a->u.user.name, b->u.user.name,
+			       sizeof(a->u.user.name))
+		    || a->u.user.revision != b->u.user.revision
+		    || memcmp(a->data, b->data,
+			      a->u.match_size - sizeof(STRUCT_ENTRY_MATCH)))
+			return 0;
+
+		off += a->u.match_size;
+	}
+
+	return 1;
+}
+
+/* Is the table in the kernel still the one we read or committed last?
+ * Neither counters nor the loop detection marks of the kernel count. */
+int
+TC_IS_CURRENT(struct xtc_handle *h)
+{
+	STRUCT_GET_ENTRIES *entries;
+	STRUCT_GETINFO info;
+	unsigned int offset, tmp;
+	socklen_t s;
+	int i, ret = 0;
+
+	iptc_fn = TC_IS_CURRENT;
+
+	if (h->changed)
+		return 0;
+
+	s = sizeof(info);
+	strcpy(info.name, h->info.name);
+	if (getsockopt(h->sockfd, TC_IPPROTO, SO_GET_INFO, &info, &s) < 0)
+		return 0;
+
+	if (info.valid_hooks != h->info.valid_hooks
+	    || info.num_entries != h->info.num_entries
+	    || info.size != h->info.size)
+		return 0;
+
+	for (i = 0; i < NUMHOOKS; i++) {
+		if (!(info.valid_hooks & (1 << i)))
+			continue;
+		if (info.hook_entry[i] != h->info.hook_entry[i]
+		    || info.underflow[i] != h->info.underflow[i])
+			return 0;
+	}
+
+	tmp = sizeof(STRUCT_GET_ENTRIES) + info.size;
+	entries = malloc(tmp);
+	if (!entries)
+		return 0;
+	strcpy(entries->name, info.name);
+	entries->size = info.size;
+
+	if (getsockopt(h->sockfd, TC_IPPROTO, SO_GET_ENTRIES, entries,
+		       &tmp) < 0)
+		goto out;
+
+	for (offset = 0; offset < info.size; ) {
+		STRUCT_ENTRY *k = (void *)entries->entrytable + offset;
+		STRUCT_ENTRY *e = iptcb_blob(h) + offset;
+
+		if (k->next_offset != e->next_offset
+		    || k->next_offset < sizeof(STRUCT_ENTRY)
+		    || k->next_offset > info.size - offset
+		    || memcmp(k, e, offsetof(STRUCT_ENTRY, comefrom))
+		    || !iptcb_elems_equal(k, e))
+			goto out;
+
+		offset += k->next_offset;
+	}
+	ret = 1;
+out:
+	free(entries);
+	return ret;
+}
+
 void
 TC_FREE(struct xtc_handle *h)
 {
+	struct iptcc_ext_mask *m, *mtmp;
 	struct chain_head *c, *tmp;
 
 	iptc_fn = TC_FREE;
@@ -1386,12 +1775,17 @@ TC_FREE(struct xtc_handle *h)
 			free(r);
 		}
 
+		iptcc_rule_hash_free(c);
 		free(c);
 	}
 
+	list_for_each_entry_safe(m, mtmp, &h->ext_masks, list)
+		free(m);
+
 	iptcc_chain_index_free(h);
 
 	free(h->entries);
+	free(h->committed);
 	free(h);
 }
 
@@ -1410,7 +1804,7 @@ TC_DUMP_ENTRIES(struct xtc_handle *const handle)
 	iptc_fn = TC_DUMP_ENTRIES;
 
 	printf("libiptc v%s. %u bytes.\n",
-	       XTABLES_VERSION, handle->entries->size);
+	       XTABLES_VERSION, iptcb_blob_size(handle));
 	printf("Table `%s'\n", handle->info.name);
 	printf("Hooks: pre/in/fwd/out/post = %x/%x/%x/%x/%x\n",
 	       handle->info.hook_entry[HOOK_PRE_ROUTING],
@@ -1425,7 +1819,7 @@ TC_DUMP_ENTRIES(struct xtc_handle *const handle)
 	       handle->info.underflow[HOOK_LOCAL_OUT],
 	       handle->info.underflow[HOOK_POST_ROUTING]);
 
-	ENTRY_ITERATE(handle->entries->entrytable, handle->entries->size,
+	ENTRY_ITERATE(iptcb_blob(handle), iptcb_blob_size(handle),
 		      dump_entry, handle);
 }
 
@@ -1783,8 +2177,9 @@ TC_INSERT_ENTRY(const IPT_CHAINLABEL chain,
 
 	list_add_tail(&r->list, prev);
 	c->num_rules++;
+	iptcc_rule_hash_add(handle, c, r);
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -1833,8 +2228,9 @@ TC_REPLACE_ENTRY(const IPT_CHAINLABEL chain,
 
 	list_add(&r->list, &old->list);
 	iptcc_delete_rule(old);
+	iptcc_rule_hash_add(handle, c, r);
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -1873,8 +2269,9 @@ TC_APPEND_ENTRY(const IPT_CHAINLABEL chain,
 
 	list_add_tail(&r->list, &c->rules);
 	c->num_rules++;
+	iptcc_rule_hash_add(handle, c, r);
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -1949,6 +2346,53 @@ is_same(const STRUCT_ENTRY *a,
 
 
 /* find the first rule in `chain' which matches `fw' and remove it unless dry_run is set */
+static inline int
+rule_same(struct rule_head *a, struct rule_head *b, unsigned char *matchmask)
+{
+	unsigned char *mask;
+
+	mask = is_same(a->entry, b->entry, matchmask);
+	return mask && target_same(a, b, mask);
+}
+
+/* Find the first rule in c equal to r. With any set, every equal
+ * rule will do. */
+static struct rule_head *
+iptcc_find_same_rule(struct xtc_handle *h, struct chain_head *c,
+		     struct rule_head *r, unsigned char *matchmask, bool any)
+{
+	struct rule_head *i, *found = NULL;
+	struct list_head *bucket;
+
+	if (c->num_rules < RULE_HASH_MIN_RULES)
+		goto scan;
+
+	iptcc_learn_masks(h, r->entry, matchmask, r->type == IPTCC_R_MODULE);
+	if (!c->rule_hash && iptcc_rule_hash_build(h, c) < 0)
+		goto scan;
+
+	r->hash = iptcc_rule_hash(h, r);
+	bucket = &c->rule_hash[r->hash & (c->rule_hash_sz - 1)];
+	list_for_each_entry(i, bucket, hash_list) {
+		if (i->hash != r->hash || !rule_same(r, i, matchmask))
+			continue;
+		if (any)
+			return i;
+		/* the bucket isn't in chain order, duplicates are */
+		if (found)
+			goto scan;
+		found = i;
+	}
+	return found;
+
+scan:
+	list_for_each_entry(i, &c->rules, list) {
+		if (rule_same(r, i, matchmask))
+			return i;
+	}
+	return NULL;
+}
+
 static int delete_entry(const IPT_CHAINLABEL chain, const STRUCT_ENTRY *origfw,
 			unsigned char *matchmask, struct xtc_handle *handle,
 			bool dry_run)
@@ -1985,16 +2429,8 @@ static int delete_entry(const IPT_CHAINLABEL chain, const STRUCT_ENTRY *origfw,
 			r->jump->references--;
 	}
 
-	list_for_each_entry(i, &c->rules, list) {
-		unsigned char *mask;
-
-		mask = is_same(r->entry, i->entry, matchmask);
-		if (!mask)
-			continue;
-
-		if (!target_same(r, i, mask))
-			continue;
-
+	i = iptcc_find_same_rule(handle, c, r, matchmask, dry_run);
+	if (i) {
 		/* if we are just doing a dry run, we simply skip the rest */
 		if (dry_run){
 			free(r);
@@ -2013,7 +2449,7 @@ static int delete_entry(const IPT_CHAINLABEL chain, const STRUCT_ENTRY *origfw,
 		c->num_rules--;
 		iptcc_delete_rule(i);
 
-		set_changed(handle);
+		set_chain_changed(handle, c);
 		free(r);
 		return 1;
 	}
@@ -2078,7 +2514,7 @@ TC_DELETE_NUM_ENTRY(const IPT_CHAINLABEL chain,
 	c->num_rules--;
 	iptcc_delete_rule(r);
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -2102,7 +2538,7 @@ TC_FLUSH_ENTRIES(const IPT_CHAINLABEL chain, struct xtc_handle *handle)
 
 	c->num_rules = 0;
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -2272,7 +2708,7 @@ TC_CREATE_CHAIN(const IPT_CHAINLABEL chain, struct xtc_handle *handle)
 		iptcc_chain_index_rebuild(handle);
 	}
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -2342,6 +2778,7 @@ TC_DELETE_CHAIN(const IPT_CHAINLABEL chain, struct xtc_handle *handle)
 
 	//list_del(&c->list); /* Done in iptcc_chain_index_delete_chain() */
 	iptcc_chain_index_delete_chain(c, handle);
+	iptcc_rule_hash_free(c);
 	free(c);
 
 	DEBUGP("chain `%s' deleted\n", chain);
@@ -2390,7 +2827,7 @@ int TC_RENAME_CHAIN(const IPT_CHAINLABEL oldname,
 	/* Insert sorted into to list again */
 	iptc_insert_chain(handle, c);
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -2435,7 +2872,7 @@ TC_SET_POLICY(const IPT_CHAINLABEL chain,
 		c->counter_map.maptype = COUNTER_MAP_NOMAP;
 	}
 
-	set_changed(handle);
+	set_chain_changed(handle, c);
 
 	return 1;
 }
@@ -2505,6 +2942,56 @@ static void counters_map_set(STRUCT_COUNTERS_INFO *newcounters,
 	DEBUGP_C("SET\n");
 }
 
+/* The handle stays usable after a commit: it now describes what is in
+ * the kernel, so take over the blob we pushed and map counters 1:1 again.
+ * The kernel already has the new table, so nothing here may fail. */
+static void iptcc_commit_done(struct xtc_handle *h, STRUCT_REPLACE *repl,
+			      STRUCT_COUNTERS_INFO *newcounters)
+{
+	struct chain_head *c;
+
+	free(h->entries);
+	h->entries = NULL;
+	free(h->committed);
+	h->committed = repl;
+	free(repl->counters);
+	repl->counters = NULL;
+
+	h->info.num_entries = repl->num_entries;
+	h->info.size = repl->size;
+	memcpy(h->info.hook_entry, repl->hook_entry, sizeof(repl->hook_entry));
+	memcpy(h->info.underflow, repl->underflow, sizeof(repl->underflow));
+
+	list_for_each_entry(c, &h->chains, list) {
+		struct rule_head *r;
+
+		if (iptcc_is_builtin(c)) {
+			c->counters = newcounters->counters[c->foot_index];
+			c->counter_map.maptype = COUNTER_MAP_NORMAL_MAP;
+			c->counter_map.mappos = c->foot_index;
+		}
+
+		/* What we added is the "original read" for COUNTER_MAP_ZEROED */
+		list_for_each_entry(r, &c->rules, list) {
+			r->entry->counters = newcounters->counters[r->index];
+			r->counter_map.maptype = COUNTER_MAP_NORMAL_MAP;
+			r->counter_map.mappos = r->index;
+		}
+
+		c->changed = 0;
+	}
+
+	h->changed = 0;
+}
+
+/* The chain offsets no longer describe the blob we have */
+static void iptcc_commit_failed(struct xtc_handle *h)
+{
+	struct chain_head *c;
+
+	list_for_each_entry(c, &h->chains, list)
+		c->changed = 1;
+}
 
 int
 TC_COMMIT(struct xtc_handle *handle)
@@ -2668,8 +3155,7 @@ TC_COMMIT(struct xtc_handle *handle)
 	if (ret < 0)
 		goto out_free_newcounters;
 
-	free(repl->counters);
-	free(repl);
+	iptcc_commit_done(handle, repl, newcounters);
 	free(newcounters);
 
 finished:
@@ -2682,6 +3168,7 @@ out_free_repl_counters:
 out_free_repl:
 	free(repl);
 out_zero:
+	iptcc_commit_failed(handle);
 	return 0;
 }
 
@@ -2748,4 +3235,5 @@ const struct xtc_ops TC_OPS = {
 	.get_policy    = TC_GET_POLICY,
 	.set_policy    = TC_SET_POLICY,
 	.strerror      = TC_STRERROR,
+	.is_current    = TC_IS_CURRENT,
 };
@@ -191,7 +191,8 @@ extern "C" {
 	struct nl_list_head	ce_list;	\
 	int			ce_msgtype;	\
 	int			ce_flags;	\
-	uint64_t		ce_mask;
+	uint64_t		ce_mask;	\
+	uint64_t		ce_digest;
 
 struct nl_object
 {
@@ -367,8 +368,20 @@ struct nl_object_ops
 	 * Get key attributes by family function
 	 */
 	uint32_t   (*oo_id_attrs_get)(struct nl_object *);
+
+	/**
+	 * Released objects kept for reuse by nl_object_alloc(), see
+	 * nl_object_pool_reserve(). Managed by the library.
+	 */
+	struct nl_list_head	oo_pool;
+	unsigned int		oo_pool_len;
+	unsigned int		oo_pool_reserved;
 };
 
+extern void			nl_object_pool_reserve(struct nl_object_ops *,
+						       int);
+extern void			nl_object_pool_drain(struct nl_object_ops *);
+
 /** @} */
 
 #ifdef __cplusplus
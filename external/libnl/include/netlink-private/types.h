@@ -101,6 +101,7 @@ struct nl_cache
 	unsigned int		c_flags;
 	struct nl_hash_table *	hashtable;
 	struct nl_cache_ops *   c_ops;
+	uint64_t		c_digest;
 };
 
 struct nl_cache_assoc
@@ -44,6 +44,14 @@ typedef void (*change_func_v2_t)(struct nl_cache *, struct nl_object *old_obj,
  */
 #define NL_CACHE_AF_ITER	0x0001
 
+/**
+ * @ingroup cache
+ * Remember a digest of the message each object was parsed from and skip
+ * messages identical to it when resyncing the cache. Objects in such a
+ * cache must not be modified in place.
+ */
+#define NL_CACHE_SKIP_UNCHANGED	0x0002
+
 /* Access Functions */
 extern int			nl_cache_nitems(struct nl_cache *);
 extern int			nl_cache_nitems_filter(struct nl_cache *,
@@ -29,6 +29,7 @@ typedef struct nl_hash_node {
 typedef struct nl_hash_table {
     int 			size;
     nl_hash_node_t **		nodes;
+    int				nelems;
 } nl_hash_table_t;
 
 /* Default hash table size */
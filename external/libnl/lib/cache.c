@@ -55,6 +55,7 @@
 #include <netlink/cache.h>
 #include <netlink/object.h>
 #include <netlink/hashtable.h>
+#include <netlink/hash.h>
 #include <netlink/utils.h>
 
 /**
@@ -437,6 +438,8 @@ static int __cache_add(struct nl_cache *cache, struct nl_object *obj)
 	int ret;
 
 	obj->ce_cache = cache;
+	if (cache->c_digest)
+		obj->ce_digest = cache->c_digest;
 
 	if (cache->hashtable) {
 		ret = nl_hash_table_add(cache->hashtable, obj);
@@ -658,17 +661,121 @@ static int nl_cache_request_full_dump(struct nl_sock *sk,
 }
 
 /** @cond SKIP */
+struct digest_index {
+	struct nl_object **	di_slots;
+	unsigned int		di_mask;
+};
+
 struct update_xdata {
 	struct nl_cache_ops *ops;
 	struct nl_parser_param *params;
+	struct nl_cache *cache;
+	struct digest_index *index;
 };
 
+static uint64_t msg_digest(struct nlmsghdr *nlh)
+{
+	void *data = nlmsg_data(nlh);
+	int len = nlmsg_datalen(nlh);
+	uint64_t digest;
+
+	/* Sequence number, port id and flags differ between dumps */
+	digest = ((uint64_t) nl_hash_any(data, len, nlh->nlmsg_type) << 32) |
+		 nl_hash_any(data, len, ~nlh->nlmsg_type);
+
+	/* A digest of 0 marks objects not parsed from a single message */
+	return digest ? digest : 1;
+}
+
+/*
+ * Index all objects of the cache by the digest of the message they were
+ * parsed from. Holds a reference to every indexed object so the index can
+ * not point to freed objects while the cache is being updated.
+ */
+static void digest_index_build(struct nl_cache *cache, struct digest_index *di)
+{
+	struct nl_object *obj;
+	unsigned int size = 16, i;
+
+	while (size < 2 * (unsigned int) cache->c_nitems)
+		size <<= 1;
+
+	di->di_slots = calloc(size, sizeof(*di->di_slots));
+	if (!di->di_slots)
+		return;
+	di->di_mask = size - 1;
+
+	nl_list_for_each_entry(obj, &cache->c_items, ce_list) {
+		if (!obj->ce_digest)
+			continue;
+
+		i = obj->ce_digest & di->di_mask;
+		while (di->di_slots[i])
+			i = (i + 1) & di->di_mask;
+
+		nl_object_get(obj);
+		di->di_slots[i] = obj;
+	}
+}
+
+static void digest_index_free(struct digest_index *di)
+{
+	unsigned int i;
+
+	if (!di->di_slots)
+		return;
+
+	for (i = 0; i <= di->di_mask; i++)
+		nl_object_put(di->di_slots[i]);
+
+	free(di->di_slots);
+	di->di_slots = NULL;
+}
+
+/*
+ * Unmark all objects still in the cache which were parsed from a message
+ * identical to the one with the given digest. Returns the number of such
+ * objects.
+ */
+static int digest_index_unmark(struct digest_index *di, struct nl_cache *cache,
+			       uint64_t digest)
+{
+	struct nl_object *obj;
+	unsigned int i;
+	int found = 0;
+
+	if (!di->di_slots)
+		return 0;
+
+	for (i = digest & di->di_mask; (obj = di->di_slots[i]);
+	     i = (i + 1) & di->di_mask) {
+		if (obj->ce_digest == digest && obj->ce_cache == cache) {
+			nl_object_unmark(obj);
+			found++;
+		}
+	}
+
+	return found;
+}
+
 static int update_msg_parser(struct nl_msg *msg, void *arg)
 {
 	struct update_xdata *x = arg;
+	struct nl_cache *cache = x->cache;
 	int ret = 0;
 
+	if (cache->c_flags & NL_CACHE_SKIP_UNCHANGED) {
+		uint64_t digest = msg_digest(msg->nm_nlh);
+
+		if (x->index && digest_index_unmark(x->index, cache, digest))
+			return NL_SKIP;
+
+		/* Objects added to the cache while parsing inherit it */
+		cache->c_digest = digest;
+	}
+
 	ret = nl_cache_parse(x->ops, &msg->nm_src, msg->nm_nlh, x->params);
+	cache->c_digest = 0;
 	if (ret == -NLE_EXIST)
 		return NL_SKIP;
 	else
@@ -683,13 +790,16 @@ static int update_msg_parser(struct nl_msg *msg, void *arg)
  * @arg param		Parser parameters
  */
 static int __cache_pickup(struct nl_sock *sk, struct nl_cache *cache,
-			  struct nl_parser_param *param)
+			  struct nl_parser_param *param,
+			  struct digest_index *index)
 {
 	int err;
 	struct nl_cb *cb;
 	struct update_xdata x = {
 		.ops = cache->c_ops,
 		.params = param,
+		.cache = cache,
+		.index = index,
 	};
 
 	NL_DBG(2, "Picking up answer for cache %p <%s>\n",
@@ -748,7 +858,7 @@ static int __nl_cache_pickup(struct nl_sock *sk, struct nl_cache *cache,
 	if (sk->s_proto != cache->c_ops->co_protocol)
 		return -NLE_PROTO_MISMATCH;
 
-	return __cache_pickup(sk, cache, &p);
+	return __cache_pickup(sk, cache, &p, NULL);
 }
 
 /**
@@ -925,6 +1035,7 @@ int nl_cache_resync(struct nl_sock *sk, struct nl_cache *cache,
 		.pp_cb = resync_cb,
 		.pp_arg = &ca,
 	};
+	struct digest_index index = { NULL };
 	int err;
 
 	if (sk->s_proto != cache->c_ops->co_protocol)
@@ -935,6 +1046,9 @@ int nl_cache_resync(struct nl_sock *sk, struct nl_cache *cache,
 	/* Mark all objects so we can see if some of them are obsolete */
 	nl_cache_mark_all(cache);
 
+	if (cache->c_flags & NL_CACHE_SKIP_UNCHANGED)
+		digest_index_build(cache, &index);
+
 	grp = cache->c_ops->co_groups;
 	do {
 		if (grp && grp->ag_group &&
@@ -946,7 +1060,7 @@ restart:
 		if (err < 0)
 			goto errout;
 
-		err = __cache_pickup(sk, cache, &p);
+		err = __cache_pickup(sk, cache, &p, &index);
 		if (err == -NLE_DUMP_INTR)
 			goto restart;
 		else if (err < 0)
@@ -971,6 +1085,7 @@ restart:
 
 	err = 0;
 errout:
+	digest_index_free(&index);
 	return err;
 }
 
@@ -1040,12 +1155,17 @@ int nl_cache_parse_and_add(struct nl_cache *cache, struct nl_msg *msg)
  */
 int nl_cache_refill(struct nl_sock *sk, struct nl_cache *cache)
 {
+	struct nl_object_ops *obj_ops = cache->c_ops->co_obj_ops;
 	struct nl_af_group *grp;
-	int err;
+	int reserved, err;
 
 	if (sk->s_proto != cache->c_ops->co_protocol)
 		return -NLE_PROTO_MISMATCH;
 
+	/* Keep the cleared objects around to parse the dump into */
+	reserved = cache->c_nitems;
+	nl_object_pool_reserve(obj_ops, reserved);
+
 	nl_cache_clear(cache);
 	grp = cache->c_ops->co_groups;
 	do {
@@ -1056,7 +1176,7 @@ int nl_cache_refill(struct nl_sock *sk, struct nl_cache *cache)
 restart:
 		err = nl_cache_request_full_dump(sk, cache);
 		if (err < 0)
-			return err;
+			break;
 
 		NL_DBG(2, "Updating cache %p <%s> for family %u, request sent, waiting for reply\n",
 		       cache, nl_cache_name(cache), grp ? grp->ag_family : AF_UNSPEC);
@@ -1073,6 +1193,8 @@ restart:
 	} while (grp && grp->ag_group &&
 			(cache->c_flags & NL_CACHE_AF_ITER));
 
+	nl_object_pool_reserve(obj_ops, -reserved);
+
 	return err;
 }
 
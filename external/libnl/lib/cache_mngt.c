@@ -309,6 +309,9 @@ int nl_cache_mngt_unregister(struct nl_cache_ops *ops)
 	NL_DBG(1, "Unregistered cache operations %s\n", ops->co_name);
 
 	*tp = t->co_next;
+
+	if (ops->co_obj_ops)
+		nl_object_pool_drain(ops->co_obj_ops);
 errout:
 	nl_write_unlock(&cache_ops_lock);
 
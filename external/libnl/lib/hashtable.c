@@ -74,6 +74,42 @@ void nl_hash_table_free(nl_hash_table_t *ht)
 	free(ht);
 }
 
+/*
+ * Grow the table once chains get this long on average so that lookups and
+ * the duplicate check on add stay cheap for caches far larger than the
+ * initial size.
+ */
+#define NL_HASH_MAX_LOAD	2
+
+static void nl_hash_table_grow(nl_hash_table_t *ht)
+{
+	nl_hash_node_t **nodes, *node, *next;
+	uint32_t key_hash;
+	int i, size;
+
+	size = ht->size * 4;
+	nodes = calloc(size, sizeof (*nodes));
+	if (!nodes)
+		return;
+
+	for (i = 0; i < ht->size; i++) {
+		for (node = ht->nodes[i]; node; node = next) {
+			next = node->next;
+			nl_object_keygen(node->obj, &key_hash, size);
+			node->key = key_hash;
+			node->next = nodes[key_hash];
+			nodes[key_hash] = node;
+		}
+	}
+
+	NL_DBG(3, "Grew hashtable %p from %d to %d entries\n",
+	       ht, ht->size, size);
+
+	free(ht->nodes);
+	ht->nodes = nodes;
+	ht->size = size;
+}
+
 /**
  * Lookup identical object in hashtable
  * @arg ht		Hashtable
@@ -144,6 +180,9 @@ int nl_hash_table_add(nl_hash_table_t *ht, struct nl_object *obj)
 	node->next = ht->nodes[key_hash];
 	ht->nodes[key_hash] = node;
 
+	if (++ht->nelems > NL_HASH_MAX_LOAD * ht->size)
+		nl_hash_table_grow(ht);
+
 	return 0;
 }
 
@@ -180,6 +219,7 @@ int nl_hash_table_del(nl_hash_table_t *ht, struct nl_object *obj)
 		       prev->next = node->next;
 
 	           free(node);
+	           ht->nelems--;
 
 	           return 0;
 		}
@@ -42,6 +42,114 @@ static inline struct nl_object_ops *obj_ops(struct nl_object *obj)
 	return obj->ce_ops;
 }
 
+/**
+ * @name Object Pool
+ * @{
+ */
+
+/**
+ * Number of released objects kept per object type in addition to the
+ * ones reserved via nl_object_pool_reserve()
+ */
+#define NL_OBJECT_POOL_MIN	64
+
+static NL_LOCK(pool_lock);
+
+static struct nl_object *pool_get(struct nl_object_ops *ops)
+{
+	struct nl_object *obj = NULL;
+
+	nl_lock(&pool_lock);
+	if (ops->oo_pool_len > 0) {
+		obj = nl_list_first_entry(&ops->oo_pool, struct nl_object,
+					  ce_list);
+		nl_list_del(&obj->ce_list);
+		ops->oo_pool_len--;
+	}
+	nl_unlock(&pool_lock);
+
+	if (obj)
+		memset(obj, 0, ops->oo_size);
+
+	return obj;
+}
+
+static int pool_put(struct nl_object_ops *ops, struct nl_object *obj)
+{
+	int pooled = 0;
+
+	nl_lock(&pool_lock);
+	if (ops->oo_pool_len < NL_OBJECT_POOL_MIN + ops->oo_pool_reserved) {
+		if (!ops->oo_pool.next)
+			nl_init_list_head(&ops->oo_pool);
+
+		nl_list_add_head(&obj->ce_list, &ops->oo_pool);
+		ops->oo_pool_len++;
+		pooled = 1;
+	}
+	nl_unlock(&pool_lock);
+
+	return pooled;
+}
+
+static void pool_trim(struct nl_object_ops *ops, unsigned int limit)
+{
+	struct nl_object *obj, *tmp;
+	NL_LIST_HEAD(released);
+
+	nl_lock(&pool_lock);
+	while (ops->oo_pool_len > limit) {
+		obj = nl_list_first_entry(&ops->oo_pool, struct nl_object,
+					  ce_list);
+		nl_list_del(&obj->ce_list);
+		nl_list_add_tail(&obj->ce_list, &released);
+		ops->oo_pool_len--;
+	}
+	nl_unlock(&pool_lock);
+
+	nl_list_for_each_entry_safe(obj, tmp, &released, ce_list)
+		free(obj);
+}
+
+/**
+ * Adjust number of released objects kept for reuse
+ * @arg ops		object operations
+ * @arg nobjs		number of objects to reserve (positive) or to
+ *			give back (negative)
+ *
+ * Objects released via nl_object_free() are kept on a per type free list
+ * and handed out again by nl_object_alloc(). Reservations are cumulative,
+ * e.g. a cache refill reserves room for the number of objects it is about
+ * to clear and gives the reservation back once the new objects have been
+ * allocated. Giving back a reservation frees surplus objects.
+ */
+void nl_object_pool_reserve(struct nl_object_ops *ops, int nobjs)
+{
+	unsigned int limit;
+
+	nl_lock(&pool_lock);
+	if (nobjs < 0 && (unsigned int) -nobjs > ops->oo_pool_reserved)
+		ops->oo_pool_reserved = 0;
+	else
+		ops->oo_pool_reserved += nobjs;
+	limit = NL_OBJECT_POOL_MIN + ops->oo_pool_reserved;
+	nl_unlock(&pool_lock);
+
+	if (nobjs < 0)
+		pool_trim(ops, limit);
+}
+
+/**
+ * Free all released objects kept for reuse
+ * @arg ops		object operations
+ */
+void nl_object_pool_drain(struct nl_object_ops *ops)
+{
+	pool_trim(ops, 0);
+}
+
+/** @} */
+
 /**
  * @name Object Creation/Deletion
  * @{
@@ -59,7 +167,9 @@ struct nl_object *nl_object_alloc(struct nl_object_ops *ops)
 	if (ops->oo_size < sizeof(*new))
 		BUG();
 
-	new = calloc(1, ops->oo_size);
+	new = pool_get(ops);
+	if (!new)
+		new = calloc(1, ops->oo_size);
 	if (!new)
 		return NULL;
 
@@ -155,9 +265,15 @@ struct nl_object *nl_object_clone(struct nl_object *obj)
 int nl_object_update(struct nl_object *dst, struct nl_object *src)
 {
 	struct nl_object_ops *ops = obj_ops(dst);
-
-	if (ops->oo_update)
-		return ops->oo_update(dst, src);
+	int err;
+
+	if (ops->oo_update) {
+		err = ops->oo_update(dst, src);
+		/* The merged object no longer matches a single message */
+		if (err == 0)
+			dst->ce_digest = 0;
+		return err;
+	}
 
 	return -NLE_OPNOTSUPP;
 }
@@ -188,7 +304,8 @@ void nl_object_free(struct nl_object *obj)
 
 	NL_DBG(4, "Freed object %p\n", obj);
 
-	free(obj);
+	if (!pool_put(ops, obj))
+		free(obj);
 }
 
 /** @} */
@@ -215,6 +215,7 @@ static void neigh_keygen(struct nl_object *obj, uint32_t *hashkey,
 		uint16_t	n_vlan;
 		char		n_addr[0];
 	} __attribute__((packed)) *nkey;
+	char nkey_buf[sizeof(*nkey) + 16];
 #ifdef NL_DEBUG
 	char buf[INET6_ADDRSTRLEN+5];
 #endif
@@ -230,7 +231,12 @@ static void neigh_keygen(struct nl_object *obj, uint32_t *hashkey,
 	if (addr)
 		nkey_sz += nl_addr_get_len(addr);
 
-	nkey = calloc(1, nkey_sz);
+	/* Avoid a heap allocation per lookup for the common address sizes */
+	if (nkey_sz <= sizeof(nkey_buf)) {
+		nkey = (void *) nkey_buf;
+		memset(nkey, 0, nkey_sz);
+	} else
+		nkey = calloc(1, nkey_sz);
 	if (!nkey) {
 		*hashkey = 0;
 		return;
@@ -257,7 +263,8 @@ static void neigh_keygen(struct nl_object *obj, uint32_t *hashkey,
 		nl_addr2str(addr, buf, sizeof(buf)),
 		nkey_sz, *hashkey);
 
-	free(nkey);
+	if (nkey != (void *) nkey_buf)
+		free(nkey);
 
 	return;
 }
@@ -317,6 +317,7 @@ static void route_keygen(struct nl_object *obj, uint32_t *hashkey,
 		uint32_t	rt_prio;
 		char 		rt_addr[0];
 	} __attribute__((packed)) *rkey;
+	char rkey_buf[sizeof(*rkey) + 16];
 #ifdef NL_DEBUG
 	char buf[INET6_ADDRSTRLEN+5];
 #endif
@@ -327,7 +328,13 @@ static void route_keygen(struct nl_object *obj, uint32_t *hashkey,
 	rkey_sz = sizeof(*rkey);
 	if (addr)
 		rkey_sz += nl_addr_get_len(addr);
-	rkey = calloc(1, rkey_sz);
+
+	/* Avoid a heap allocation per lookup for the common address sizes */
+	if (rkey_sz <= sizeof(rkey_buf)) {
+		rkey = (void *) rkey_buf;
+		memset(rkey, 0, rkey_sz);
+	} else
+		rkey = calloc(1, rkey_sz);
 	if (!rkey) {
 		NL_DBG(2, "Warning: calloc failed for %d bytes...\n", rkey_sz);
 		*hashkey = 0;
@@ -348,7 +355,8 @@ static void route_keygen(struct nl_object *obj, uint32_t *hashkey,
 		rkey->rt_table, nl_addr2str(addr, buf, sizeof(buf)),
 		rkey_sz, *hashkey);
 
-	free(rkey);
+	if (rkey != (void *) rkey_buf)
+		free(rkey);
 
 	return;
 }
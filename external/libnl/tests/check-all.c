@@ -32,6 +32,9 @@ int main(int argc, char *argv[])
 	srunner_add_suite(runner, make_nl_addr_suite());
 	srunner_add_suite(runner, make_nl_attr_suite());
 	srunner_add_suite(runner, make_nl_ematch_tree_clone_suite());
+	srunner_add_suite(runner, make_nl_object_suite());
+	srunner_add_suite(runner, make_nl_hashtable_suite());
+	srunner_add_suite(runner, make_nl_cache_suite());
 
 	/* Do not add testsuites below this line */
 
@@ -0,0 +1,263 @@
+/*
+ * tests/check-cache.c		nl_cache unit tests
+ *
+ *	This library is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU Lesser General Public
+ *	License as published by the Free Software Foundation version 2.1
+ *	of the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <check.h>
+#include <netlink/netlink.h>
+#include <netlink/cache.h>
+#include <netlink/msg.h>
+#include <netlink/route/addr.h>
+
+#include <linux/if_addr.h>
+#include <linux/rtnetlink.h>
+
+#include "util.h"
+
+/*
+ * Dump replayed by the socket instead of asking the kernel, so that the
+ * cache can be updated with exactly the messages a test wants.
+ */
+static unsigned char *dump_buf;
+static int dump_len;
+
+static void dump_append(struct nl_msg *msg)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	int len = NLMSG_ALIGN(nlh->nlmsg_len);
+
+	dump_buf = realloc(dump_buf, dump_len + len);
+	fail_if(dump_buf == NULL, "Unable to grow dump");
+	memset(dump_buf + dump_len, 0, len);
+	memcpy(dump_buf + dump_len, nlh, nlh->nlmsg_len);
+	dump_len += len;
+
+	nlmsg_free(msg);
+}
+
+static void dump_addr(int ifindex, const char *local, const char *label)
+{
+	struct ifaddrmsg ifa = {
+		.ifa_family = AF_INET,
+		.ifa_prefixlen = 24,
+		.ifa_index = ifindex,
+	};
+	struct in_addr in;
+	struct nl_msg *msg;
+
+	fail_if(inet_pton(AF_INET, local, &in) != 1, "Invalid address");
+
+	msg = nlmsg_alloc_simple(RTM_NEWADDR, NLM_F_MULTI);
+	fail_if(msg == NULL, "Unable to allocate message");
+	fail_if(nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO) < 0 ||
+		nla_put(msg, IFA_LOCAL, sizeof(in), &in) < 0 ||
+		nla_put(msg, IFA_ADDRESS, sizeof(in), &in) < 0 ||
+		nla_put_string(msg, IFA_LABEL, label) < 0,
+		"Unable to build address message");
+
+	dump_append(msg);
+}
+
+static void dump_done(void)
+{
+	struct nl_msg *msg;
+	int err = 0;
+
+	msg = nlmsg_alloc_simple(NLMSG_DONE, NLM_F_MULTI);
+	fail_if(msg == NULL, "Unable to allocate message");
+	fail_if(nlmsg_append(msg, &err, sizeof(err), NLMSG_ALIGNTO) < 0,
+		"Unable to build done message");
+
+	dump_append(msg);
+}
+
+static void dump_reset(void)
+{
+	free(dump_buf);
+	dump_buf = NULL;
+	dump_len = 0;
+}
+
+static int dump_send(struct nl_sock *sk, struct nl_msg *msg)
+{
+	return nlmsg_hdr(msg)->nlmsg_len;
+}
+
+static int dump_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+		     unsigned char **buf, struct ucred **creds)
+{
+	*buf = malloc(dump_len);
+	if (!*buf)
+		return -NLE_NOMEM;
+
+	memcpy(*buf, dump_buf, dump_len);
+
+	return dump_len;
+}
+
+static struct nl_sock *dump_socket(void)
+{
+	struct nl_sock *sk;
+	struct nl_cb *cb;
+	int err;
+
+	sk = nl_socket_alloc();
+	fail_if(sk == NULL, "Unable to allocate socket");
+
+	err = nl_connect(sk, NETLINK_ROUTE);
+	nl_fail_if(err < 0, err, "Unable to connect socket");
+
+	nl_socket_disable_seq_check(sk);
+
+	cb = nl_socket_get_cb(sk);
+	nl_cb_overwrite_send(cb, dump_send);
+	nl_cb_overwrite_recv(cb, dump_recv);
+	nl_cb_put(cb);
+
+	return sk;
+}
+
+static struct rtnl_addr *find_addr(struct nl_cache *cache, int ifindex,
+				   const char *local)
+{
+	struct rtnl_addr *probe, *found;
+	struct nl_addr *a;
+	int err;
+
+	probe = rtnl_addr_alloc();
+	fail_if(probe == NULL, "Unable to allocate address object");
+
+	err = nl_addr_parse(local, AF_INET, &a);
+	nl_fail_if(err < 0, err, "Unable to parse address");
+	nl_addr_set_prefixlen(a, 24);
+
+	rtnl_addr_set_ifindex(probe, ifindex);
+	err = rtnl_addr_set_local(probe, a);
+	nl_fail_if(err < 0, err, "Unable to set local address");
+	nl_addr_put(a);
+
+	found = (struct rtnl_addr *) nl_cache_search(cache, OBJ_CAST(probe));
+	rtnl_addr_put(probe);
+
+	return found;
+}
+
+static void count_change(struct nl_cache *cache, struct nl_object *obj,
+			 int action, void *arg)
+{
+	int *changes = arg;
+
+	if (action >= 0 && action <= NL_ACT_MAX)
+		changes[action]++;
+}
+
+START_TEST(cache_resync_skip_unchanged)
+{
+	struct nl_sock *sk;
+	struct nl_cache *cache;
+	struct rtnl_addr *same, *changed, *removed, *added, *obj;
+	int changes[NL_ACT_MAX + 1];
+	int err;
+
+	sk = dump_socket();
+
+	err = nl_cache_alloc_name("route/addr", &cache);
+	nl_fail_if(err < 0, err, "Unable to allocate cache");
+	nl_cache_set_flags(cache, NL_CACHE_SKIP_UNCHANGED);
+
+	dump_addr(1, "192.0.2.1", "eth0");
+	dump_addr(1, "192.0.2.2", "eth0");
+	dump_addr(2, "198.51.100.1", "eth1");
+	dump_done();
+
+	err = nl_cache_refill(sk, cache);
+	nl_fail_if(err < 0, err, "Unable to fill cache");
+	fail_if(nl_cache_nitems(cache) != 3, "Cache should hold 3 addresses");
+
+	same = find_addr(cache, 1, "192.0.2.1");
+	changed = find_addr(cache, 1, "192.0.2.2");
+	removed = find_addr(cache, 2, "198.51.100.1");
+	fail_if(!same || !changed || !removed, "Address missing after refill");
+
+	dump_reset();
+	dump_addr(1, "192.0.2.1", "eth0");
+	dump_addr(1, "192.0.2.2", "eth0:1");
+	dump_addr(3, "203.0.113.1", "eth2");
+	dump_done();
+
+	memset(changes, 0, sizeof(changes));
+	err = nl_cache_resync(sk, cache, count_change, changes);
+	nl_fail_if(err < 0, err, "Unable to resync cache");
+	fail_if(nl_cache_nitems(cache) != 3, "Cache should hold 3 addresses");
+
+	obj = find_addr(cache, 1, "192.0.2.1");
+	fail_if(obj != same, "Unchanged address should be kept as is");
+	rtnl_addr_put(obj);
+
+	obj = find_addr(cache, 1, "192.0.2.2");
+	fail_if(obj == NULL, "Changed address missing after resync");
+	fail_if(strcmp(rtnl_addr_get_label(obj), "eth0:1"),
+		"Changed address should have been updated");
+	rtnl_addr_put(changed);
+	changed = obj;
+
+	obj = find_addr(cache, 2, "198.51.100.1");
+	fail_if(obj != NULL, "Removed address should be gone after resync");
+	fail_if(nl_object_get_cache(OBJ_CAST(removed)) != NULL,
+		"Removed address should no longer belong to the cache");
+	rtnl_addr_put(removed);
+
+	added = find_addr(cache, 3, "203.0.113.1");
+	fail_if(added == NULL, "New address missing after resync");
+
+	fail_if(changes[NL_ACT_NEW] != 1, "Expected 1 new address, got %d",
+		changes[NL_ACT_NEW]);
+	fail_if(changes[NL_ACT_CHANGE] != 1,
+		"Expected 1 changed address, got %d", changes[NL_ACT_CHANGE]);
+	fail_if(changes[NL_ACT_DEL] != 1, "Expected 1 removed address, got %d",
+		changes[NL_ACT_DEL]);
+
+	/* Objects parsed by the previous resync are skipped as well */
+	memset(changes, 0, sizeof(changes));
+	err = nl_cache_resync(sk, cache, count_change, changes);
+	nl_fail_if(err < 0, err, "Unable to resync cache");
+	fail_if(nl_cache_nitems(cache) != 3, "Cache should hold 3 addresses");
+
+	obj = find_addr(cache, 1, "192.0.2.2");
+	fail_if(obj != changed, "Updated address should be kept as is");
+	rtnl_addr_put(obj);
+
+	obj = find_addr(cache, 3, "203.0.113.1");
+	fail_if(obj != added, "New address should be kept as is");
+	rtnl_addr_put(obj);
+
+	fail_if(changes[NL_ACT_NEW] || changes[NL_ACT_CHANGE] ||
+		changes[NL_ACT_DEL], "Unchanged dump should not report changes");
+
+	rtnl_addr_put(same);
+	rtnl_addr_put(changed);
+	rtnl_addr_put(added);
+	nl_cache_free(cache);
+	nl_socket_free(sk);
+	dump_reset();
+}
+END_TEST
+
+Suite *make_nl_cache_suite(void)
+{
+	Suite *suite = suite_create("Caches");
+
+	TCase *resync = tcase_create("Resync");
+	tcase_add_test(resync, cache_resync_skip_unchanged);
+	suite_add_tcase(suite, resync);
+
+	return suite;
+}
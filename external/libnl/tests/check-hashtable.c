@@ -0,0 +1,116 @@
+/*
+ * tests/check-hashtable.c	nl_hash_table unit tests
+ *
+ *	This library is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU Lesser General Public
+ *	License as published by the Free Software Foundation version 2.1
+ *	of the License.
+ */
+
+#include <check.h>
+#include <netlink/errno.h>
+#include <netlink/hashtable.h>
+#include <netlink/object.h>
+#include <netlink/route/link.h>
+
+#include "util.h"
+
+#define INITIAL_SIZE	16
+#define NLINKS		1000
+
+static struct rtnl_link *build_link(int ifindex)
+{
+	struct rtnl_link *link;
+
+	link = rtnl_link_alloc();
+	fail_if(link == NULL, "Unable to allocate link object");
+	rtnl_link_set_family(link, AF_UNSPEC);
+	rtnl_link_set_ifindex(link, ifindex);
+
+	return link;
+}
+
+START_TEST(hashtable_grow)
+{
+	nl_hash_table_t *ht;
+	struct rtnl_link *links[NLINKS], *probe;
+	int i, j, err, size;
+
+	ht = nl_hash_table_alloc(INITIAL_SIZE);
+	fail_if(ht == NULL, "Unable to allocate hashtable");
+
+	size = ht->size;
+	for (i = 0; i < NLINKS; i++) {
+		links[i] = build_link(i + 1);
+		err = nl_hash_table_add(ht, OBJ_CAST(links[i]));
+		nl_fail_if(err < 0, err, "Unable to add object to hashtable");
+
+		/* Check right after every resize, not only at the end */
+		if (ht->size != size) {
+			fail_if(ht->size < size, "Hashtable should not shrink");
+			size = ht->size;
+
+			for (j = 0; j <= i; j++)
+				fail_if(nl_hash_table_lookup(ht,
+					OBJ_CAST(links[j])) != OBJ_CAST(links[j]),
+					"Link %d lost while growing to %d entries",
+					j + 1, size);
+		}
+	}
+
+	fail_if(ht->size <= INITIAL_SIZE,
+		"Hashtable should have grown with %d objects", NLINKS);
+
+	for (i = 0; i < NLINKS; i++) {
+		probe = build_link(i + 1);
+		fail_if(nl_hash_table_lookup(ht, OBJ_CAST(probe)) !=
+			OBJ_CAST(links[i]), "Link %d not found", i + 1);
+		fail_if(nl_hash_table_add(ht, OBJ_CAST(probe)) != -NLE_EXIST,
+			"Duplicate of link %d should be rejected", i + 1);
+		rtnl_link_put(probe);
+	}
+
+	probe = build_link(NLINKS + 1);
+	fail_if(nl_hash_table_lookup(ht, OBJ_CAST(probe)) != NULL,
+		"Unknown link should not be found");
+	rtnl_link_put(probe);
+
+	for (i = 0; i < NLINKS; i += 2) {
+		err = nl_hash_table_del(ht, OBJ_CAST(links[i]));
+		nl_fail_if(err < 0, err, "Unable to remove object from hashtable");
+		fail_if(nl_object_get_refcnt(OBJ_CAST(links[i])) != 1,
+			"Removing an object should drop its reference");
+	}
+
+	for (i = 0; i < NLINKS; i++) {
+		struct nl_object *found;
+
+		found = nl_hash_table_lookup(ht, OBJ_CAST(links[i]));
+		if (i % 2)
+			fail_if(found != OBJ_CAST(links[i]),
+				"Link %d not found after removals", i + 1);
+		else
+			fail_if(found != NULL,
+				"Removed link %d should not be found", i + 1);
+	}
+
+	nl_hash_table_free(ht);
+
+	for (i = 0; i < NLINKS; i++) {
+		fail_if(nl_object_get_refcnt(OBJ_CAST(links[i])) != 1,
+			"Freeing the hashtable should drop its references");
+		rtnl_link_put(links[i]);
+	}
+}
+END_TEST
+
+Suite *make_nl_hashtable_suite(void)
+{
+	Suite *suite = suite_create("Hashtable");
+
+	TCase *ht = tcase_create("Core");
+	tcase_add_test(ht, hashtable_grow);
+	suite_add_tcase(suite, ht);
+
+	return suite;
+}
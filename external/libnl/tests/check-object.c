@@ -0,0 +1,152 @@
+/*
+ * tests/check-object.c		nl_object unit tests
+ *
+ *	This library is free software; you can redistribute it and/or
+ *	modify it under the terms of the GNU Lesser General Public
+ *	License as published by the Free Software Foundation version 2.1
+ *	of the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <check.h>
+#include <netlink/addr.h>
+#include <netlink/cache.h>
+#include <netlink/object.h>
+#include <netlink/route/addr.h>
+
+#include "util.h"
+
+#define NADDRS		200
+
+static struct rtnl_addr *build_addr(int ifindex, const char *local)
+{
+	struct rtnl_addr *addr;
+	struct nl_addr *a;
+	int err;
+
+	addr = rtnl_addr_alloc();
+	fail_if(addr == NULL, "Unable to allocate address object");
+
+	err = nl_addr_parse(local, AF_INET, &a);
+	nl_fail_if(err < 0, err, "Unable to parse address");
+
+	rtnl_addr_set_ifindex(addr, ifindex);
+	err = rtnl_addr_set_local(addr, a);
+	nl_fail_if(err < 0, err, "Unable to set local address");
+	nl_addr_put(a);
+
+	return addr;
+}
+
+START_TEST(object_recycle)
+{
+	struct rtnl_addr *addr, *reused, *clone;
+	struct nl_addr *local;
+
+	addr = build_addr(2, "192.0.2.1/24");
+	rtnl_addr_set_label(addr, "eth0");
+	nl_object_mark(OBJ_CAST(addr));
+
+	local = nl_addr_get(rtnl_addr_get_local(addr));
+	rtnl_addr_put(addr);
+
+	fail_if(nl_addr_shared(local),
+		"Releasing an object should release its attributes");
+	nl_addr_put(local);
+
+	reused = rtnl_addr_alloc();
+	fail_if(reused != addr,
+		"Released object should be handed out again");
+	fail_if(nl_object_get_refcnt(OBJ_CAST(reused)) != 1,
+		"Recycled object should have a single reference");
+	fail_if(nl_object_is_marked(OBJ_CAST(reused)),
+		"Recycled object should not be marked");
+	fail_if(strcmp(nl_object_get_type(OBJ_CAST(reused)), "route/addr"),
+		"Recycled object should keep its type");
+	fail_if(rtnl_addr_get_local(reused) != NULL,
+		"Recycled object should have no local address");
+	fail_if(rtnl_addr_get_label(reused) != NULL,
+		"Recycled object should have no label");
+	fail_if(rtnl_addr_get_ifindex(reused) != 0,
+		"Recycled object should have no interface index");
+
+	rtnl_addr_put(reused);
+
+	reused = build_addr(3, "198.51.100.1/24");
+	clone = (struct rtnl_addr *) nl_object_clone(OBJ_CAST(reused));
+	fail_if(clone == NULL, "Unable to clone recycled object");
+	fail_if(!nl_object_identical(OBJ_CAST(reused), OBJ_CAST(clone)),
+		"Clone of recycled object should be identical");
+	fail_if(nl_object_diff(OBJ_CAST(reused), OBJ_CAST(clone)),
+		"Clone of recycled object should not differ");
+
+	rtnl_addr_put(clone);
+	rtnl_addr_put(reused);
+}
+END_TEST
+
+START_TEST(object_recycle_cache)
+{
+	struct nl_cache *cache;
+	struct rtnl_addr *addr, *found;
+	char buf[32];
+	int i, err;
+
+	err = nl_cache_alloc_name("route/addr", &cache);
+	nl_fail_if(err < 0, err, "Unable to allocate cache");
+
+	for (i = 0; i < NADDRS; i++) {
+		snprintf(buf, sizeof(buf), "10.0.%d.%d/16", i / 256, i % 256);
+		addr = build_addr(1, buf);
+		err = nl_cache_add(cache, OBJ_CAST(addr));
+		nl_fail_if(err < 0, err, "Unable to add object to cache");
+		rtnl_addr_put(addr);
+	}
+
+	/* Releases all objects, most of them into the pool */
+	nl_cache_clear(cache);
+	fail_if(nl_cache_nitems(cache) != 0,
+		"Cleared cache should be empty");
+
+	for (i = 0; i < NADDRS; i++) {
+		snprintf(buf, sizeof(buf), "10.1.%d.%d/16", i / 256, i % 256);
+		addr = build_addr(2, buf);
+		fail_if(nl_object_get_cache(OBJ_CAST(addr)) != NULL,
+			"Recycled object should not belong to a cache");
+		err = nl_cache_add(cache, OBJ_CAST(addr));
+		nl_fail_if(err < 0, err, "Unable to add recycled object to cache");
+		rtnl_addr_put(addr);
+	}
+
+	fail_if(nl_cache_nitems(cache) != NADDRS,
+		"Cache should hold all recycled objects");
+
+	for (i = 0; i < NADDRS; i++) {
+		snprintf(buf, sizeof(buf), "10.1.%d.%d/16", i / 256, i % 256);
+		addr = build_addr(2, buf);
+		found = (struct rtnl_addr *) nl_cache_search(cache,
+							    OBJ_CAST(addr));
+		fail_if(found == NULL, "Recycled object %s not found", buf);
+		fail_if(nl_object_get_cache(OBJ_CAST(found)) != cache,
+			"Recycled object should belong to the cache");
+		rtnl_addr_put(found);
+		rtnl_addr_put(addr);
+	}
+
+	nl_cache_free(cache);
+}
+END_TEST
+
+Suite *make_nl_object_suite(void)
+{
+	Suite *suite = suite_create("Objects");
+
+	TCase *pool = tcase_create("Pool");
+	tcase_add_test(pool, object_recycle);
+	tcase_add_test(pool, object_recycle_cache);
+	suite_add_tcase(suite, pool);
+
+	return suite;
+}
@@ -7,4 +7,7 @@
 Suite *make_nl_attr_suite(void);
 Suite *make_nl_addr_suite(void);
 Suite *make_nl_ematch_tree_clone_suite(void);
+Suite *make_nl_object_suite(void);
+Suite *make_nl_hashtable_suite(void);
+Suite *make_nl_cache_suite(void);
 
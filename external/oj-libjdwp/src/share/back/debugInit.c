@@ -37,6 +37,7 @@
 #include "debugLoop.h"
 #include "bag.h"
 #include "invoker.h"
+#include "outStream.h"
 #include "sys.h"
 
 // ANDROID-CHANGED: Allow us to initialize VMDebug & ddms apis.
@@ -798,6 +799,8 @@ initialize(JNIEnv *env, jthread thread, EventIndex triggering_ei)
     debugDispatch_initialize();
     classTrack_initialize(env);
     debugLoop_initialize();
+    // ANDROID-CHANGED: Set up the packet segment pool.
+    outStream_initialize();
 
     // ANDROID-CHANGED: Set up DDM
     DDM_initialize();
@@ -891,6 +894,8 @@ debugInit_reset(JNIEnv *env)
     util_reset();
     commonRef_reset(env);
     classTrack_reset();
+    // ANDROID-CHANGED: Drop the packet segments of the previous connection.
+    outStream_reset();
 
     /*
      * If this is a server, we are now ready to accept another connection.
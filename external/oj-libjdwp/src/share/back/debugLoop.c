@@ -148,7 +148,8 @@ debugLoop_run(void)
 
             /* Initialize the input and output streams */
             inStream_init(&in, p);
-            outStream_initReply(&out, inStream_id(&in));
+            // ANDROID-CHANGED: Size the reply after earlier replies to the same command.
+            outStream_initReplyToCommand(&out, inStream_id(&in), cmd->cmdSet, cmd->cmd);
 
             LOG_MISC(("Command set %d, command %d", cmd->cmdSet, cmd->cmd));
 
@@ -41,6 +41,8 @@
 #include "SDE.h"
 #include "jvmti.h"
 
+#include <stdint.h>
+
 typedef struct ClassFilter {
     jclass clazz;
 } ClassFilter;
@@ -84,8 +86,15 @@ typedef struct StepFilter {
     jthread thread;
 } StepFilter;
 
+/* ANDROID-CHANGED: The pattern is classified once when it is set. */
+#define MATCH_EXACT   0   /* no '*' at either end */
+#define MATCH_PREFIX  1   /* "java.lang.*" */
+#define MATCH_SUFFIX  2   /* "*.Object" */
+
 typedef struct MatchFilter {
     char *classPattern;
+    int matchKind;
+    int matchLength;      /* length of the literal part of the pattern */
 } MatchFilter;
 
 typedef struct SourceNameFilter {
@@ -120,7 +129,22 @@ typedef struct Filter_ {
  */
 #define MAX_FILTERS 10000
 
+/*
+ * ANDROID-CHANGED: Where a node is linked into the filter index of its
+ * event kind. See "filter index" below.
+ */
+typedef struct FilterIndexEntry_ {
+    jint key;                           /* INDEX_KEY_* */
+    unsigned int hash;                  /* for the hashed keys */
+    jlong sequence;                     /* 0 if not indexed */
+    struct HandlerNode_ **list;         /* list the node is linked into */
+    struct HandlerNode_ *next;
+    struct HandlerNode_ *prev;
+    struct PatternTrie_ *trie;          /* for prefix and suffix keys */
+} FilterIndexEntry;
+
 typedef struct EventFilters_ {
+    FilterIndexEntry index;
     jint filterCount;
     Filter filters[MAX_FILTERS];
 } EventFilters;
@@ -138,6 +162,7 @@ typedef struct EventFilterPrivate_HandlerNode_ {
 #define FILTER_COUNT(node)  (EVENT_FILTERS(node)->filterCount)
 #define FILTERS_ARRAY(node) (EVENT_FILTERS(node)->filters)
 #define FILTER(node,index)  ((FILTERS_ARRAY(node))[index])
+#define INDEX_ENTRY(node)   (&(EVENT_FILTERS(node)->index))
 #define NODE_EI(node)          (node->ei)
 
 /***** filter set-up / destruction *****/
@@ -276,6 +301,49 @@ patternStringMatch(char *classname, const char *pattern)
     }
 }
 
+/*
+ * ANDROID-CHANGED: Same as patternStringMatch(), with the pattern
+ * classified in advance by compileClassPattern().
+ */
+static jboolean
+classPatternMatch(char *classname, MatchFilter *filter)
+{
+    int offset;
+
+    if (classname == NULL) {
+        return JNI_FALSE;
+    }
+    switch (filter->matchKind) {
+        case MATCH_PREFIX:
+            return strncmp(filter->classPattern, classname,
+                           filter->matchLength) == 0;
+        case MATCH_SUFFIX:
+            offset = (int)strlen(classname) - filter->matchLength;
+            return offset >= 0 &&
+                   strcmp(filter->classPattern + 1, classname + offset) == 0;
+        default:
+            return strcmp(filter->classPattern, classname) == 0;
+    }
+}
+
+static void
+compileClassPattern(MatchFilter *filter, char *classPattern)
+{
+    int pattLen = (int)strlen(classPattern);
+
+    filter->classPattern = classPattern;
+    if (pattLen > 0 && classPattern[0] == '*') {
+        filter->matchKind = MATCH_SUFFIX;
+        filter->matchLength = pattLen - 1;
+    } else if (pattLen > 0 && classPattern[pattLen - 1] == '*') {
+        filter->matchKind = MATCH_PREFIX;
+        filter->matchLength = pattLen - 1;
+    } else {
+        filter->matchKind = MATCH_EXACT;
+        filter->matchLength = pattLen;
+    }
+}
+
 static jboolean isVersionGte12x() {
     jint version;
     jvmtiError err =
@@ -492,16 +560,14 @@ eventFilterRestricted_passesFilter(JNIEnv *env,
                 break;
 
         case JDWP_REQUEST_MODIFIER(ClassMatch): {
-            if (!patternStringMatch(classname,
-                       filter->u.ClassMatch.classPattern)) {
+            if (!classPatternMatch(classname, &filter->u.ClassMatch)) {
                 return JNI_FALSE;
             }
             break;
         }
 
         case JDWP_REQUEST_MODIFIER(ClassExclude): {
-            if (patternStringMatch(classname,
-                      filter->u.ClassExclude.classPattern)) {
+            if (classPatternMatch(classname, &filter->u.ClassExclude)) {
                 return JNI_FALSE;
             }
             break;
@@ -581,16 +647,14 @@ eventFilterRestricted_passesUnloadFilter(JNIEnv *env,
             }
 
             case JDWP_REQUEST_MODIFIER(ClassMatch): {
-                if (!patternStringMatch(classname,
-                        filter->u.ClassMatch.classPattern)) {
+                if (!classPatternMatch(classname, &filter->u.ClassMatch)) {
                     return JNI_FALSE;
                 }
                 break;
             }
 
             case JDWP_REQUEST_MODIFIER(ClassExclude): {
-                if (patternStringMatch(classname,
-                       filter->u.ClassExclude.classPattern)) {
+                if (classPatternMatch(classname, &filter->u.ClassExclude)) {
                     return JNI_FALSE;
                 }
                 break;
@@ -655,8 +719,7 @@ eventFilter_predictFiltering(HandlerNode *node, jclass clazz, char *classname)
             }
 
             case JDWP_REQUEST_MODIFIER(ClassMatch): {
-                if (!patternStringMatch(classname,
-                        filter->u.ClassMatch.classPattern)) {
+                if (!classPatternMatch(classname, &filter->u.ClassMatch)) {
                     willBeFiltered = JNI_TRUE;
                     done = JNI_TRUE;
                 }
@@ -664,8 +727,7 @@ eventFilter_predictFiltering(HandlerNode *node, jclass clazz, char *classname)
             }
 
             case JDWP_REQUEST_MODIFIER(ClassExclude): {
-                if (patternStringMatch(classname,
-                       filter->u.ClassExclude.classPattern)) {
+                if (classPatternMatch(classname, &filter->u.ClassExclude)) {
                     willBeFiltered = JNI_TRUE;
                     done = JNI_TRUE;
                 }
@@ -890,7 +952,7 @@ eventFilter_setClassMatchFilter(HandlerNode *node, jint index,
 
     FILTER(node, index).modifier =
                        JDWP_REQUEST_MODIFIER(ClassMatch);
-    filter->classPattern = classPattern;
+    compileClassPattern(filter, classPattern);
     return JVMTI_ERROR_NONE;
 }
 
@@ -911,7 +973,7 @@ eventFilter_setClassExcludeFilter(HandlerNode *node, jint index,
 
     FILTER(node, index).modifier =
                        JDWP_REQUEST_MODIFIER(ClassExclude);
-    filter->classPattern = classPattern;
+    compileClassPattern(filter, classPattern);
     return JVMTI_ERROR_NONE;
 }
 
@@ -1332,6 +1394,431 @@ disableEvents(HandlerNode *node)
 }
 
 
+/***** filter index *****/
+
+/*
+ * ANDROID-CHANGED: Dispatching an event used to run the filters of every
+ * handler of its kind. Each node is now also indexed by its most
+ * selective filter among those checked before any filter with side
+ * effects (Count, Step): a location, a field or a class name pattern.
+ * A node whose key does not match the event cannot pass its filters, so
+ * event_callback only runs the filters of the nodes found through the
+ * event's location, field and class name, plus the nodes with no key.
+ * The filters themselves are still evaluated in full, in chain order.
+ */
+
+#define INDEX_KEY_NONE      0
+#define INDEX_KEY_LOCATION  1
+#define INDEX_KEY_FIELD     2
+#define INDEX_KEY_NAME      3
+#define INDEX_KEY_PREFIX    4
+#define INDEX_KEY_SUFFIX    5
+
+#define INITIAL_INDEX_BUCKETS 64
+
+/* Class name patterns sharing a prefix (or suffix) share a path */
+typedef struct PatternTrie_ {
+    char c;
+    struct PatternTrie_ *parent;
+    struct PatternTrie_ *child;
+    struct PatternTrie_ *sibling;
+    HandlerNode *handlers;          /* nodes whose pattern ends here */
+} PatternTrie;
+
+typedef struct FilterIndex_ {
+    HandlerNode *unkeyed;
+    HandlerNode **buckets;          /* location, field and exact name keys */
+    jint bucketCount;
+    jint keyedCount;
+    PatternTrie prefixes;
+    PatternTrie suffixes;           /* spelled backwards */
+} FilterIndex;
+
+/* Protected by the eventHandler's handlerLock, like the handler chains */
+static FilterIndex filterIndexes[EI_max-EI_min+1];
+static jlong indexSequence;
+static jint indexGeneration;
+
+static unsigned int
+hashKey(jint key, uintptr_t a, uintptr_t b)
+{
+    uint64_t h = ((uint64_t)key << 56) ^ (uint64_t)a;
+
+    h = (h ^ (h >> 33)) * 0xff51afd7ed558ccdULL;
+    h ^= (uint64_t)b;
+    h = (h ^ (h >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return (unsigned int)(h ^ (h >> 33));
+}
+
+static unsigned int
+hashName(const char *name, int length)
+{
+    unsigned int h = 2166136261u;
+    int i;
+
+    for (i = 0; i < length; i++) {
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return (unsigned int)hashKey(INDEX_KEY_NAME, h, length);
+}
+
+static void
+indexLink(HandlerNode **list, HandlerNode *node)
+{
+    FilterIndexEntry *entry = INDEX_ENTRY(node);
+
+    entry->list = list;
+    entry->prev = NULL;
+    entry->next = *list;
+    if (*list != NULL) {
+        INDEX_ENTRY(*list)->prev = node;
+    }
+    *list = node;
+}
+
+static void
+indexUnlink(HandlerNode *node)
+{
+    FilterIndexEntry *entry = INDEX_ENTRY(node);
+
+    if (entry->prev != NULL) {
+        INDEX_ENTRY(entry->prev)->next = entry->next;
+    } else {
+        *entry->list = entry->next;
+    }
+    if (entry->next != NULL) {
+        INDEX_ENTRY(entry->next)->prev = entry->prev;
+    }
+    entry->list = NULL;
+    entry->next = NULL;
+    entry->prev = NULL;
+}
+
+/*
+ * Pick the key of a node. Filters after a Count or Step filter are not
+ * considered: those filters must still run when a later filter fails.
+ */
+static jint
+selectIndexKey(HandlerNode *node, unsigned int *hash, MatchFilter **match)
+{
+    Filter *filter = FILTERS_ARRAY(node);
+    jint key = INDEX_KEY_NONE;
+    int i;
+
+    for (i = 0; i < FILTER_COUNT(node); ++i, ++filter) {
+        switch (filter->modifier) {
+            case JDWP_REQUEST_MODIFIER(Count):
+            case JDWP_REQUEST_MODIFIER(Step):
+                return key;
+
+            case JDWP_REQUEST_MODIFIER(LocationOnly):
+                *hash = hashKey(INDEX_KEY_LOCATION,
+                                (uintptr_t)filter->u.LocationOnly.method,
+                                (uintptr_t)filter->u.LocationOnly.location);
+                return INDEX_KEY_LOCATION;
+
+            case JDWP_REQUEST_MODIFIER(FieldOnly):
+                if (key == INDEX_KEY_NONE || key > INDEX_KEY_FIELD) {
+                    key = INDEX_KEY_FIELD;
+                    *hash = hashKey(INDEX_KEY_FIELD,
+                                    (uintptr_t)filter->u.FieldOnly.field, 0);
+                }
+                break;
+
+            case JDWP_REQUEST_MODIFIER(ClassMatch): {
+                MatchFilter *m = &filter->u.ClassMatch;
+                jint matchKey = m->matchKind == MATCH_PREFIX ? INDEX_KEY_PREFIX :
+                                m->matchKind == MATCH_SUFFIX ? INDEX_KEY_SUFFIX :
+                                INDEX_KEY_NAME;
+                if (key == INDEX_KEY_NONE || key > matchKey) {
+                    key = matchKey;
+                    *match = m;
+                    if (matchKey == INDEX_KEY_NAME) {
+                        *hash = hashName(m->classPattern, m->matchLength);
+                    }
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    return key;
+}
+
+static void
+rehashIndex(FilterIndex *index, jint bucketCount)
+{
+    HandlerNode **buckets = jvmtiAllocate(bucketCount * (jint)sizeof(HandlerNode *));
+    jint i;
+
+    if (buckets == NULL) {
+        EXIT_ERROR(AGENT_ERROR_OUT_OF_MEMORY, "filter index");
+    }
+    (void)memset(buckets, 0, bucketCount * sizeof(HandlerNode *));
+    for (i = 0; i < index->bucketCount; i++) {
+        while (index->buckets[i] != NULL) {
+            HandlerNode *node = index->buckets[i];
+            indexUnlink(node);
+            indexLink(&buckets[INDEX_ENTRY(node)->hash & (bucketCount - 1)], node);
+        }
+    }
+    jvmtiDeallocate(index->buckets);
+    index->buckets = buckets;
+    index->bucketCount = bucketCount;
+}
+
+static PatternTrie *
+trieChild(PatternTrie *trie, char c, jboolean create)
+{
+    PatternTrie *child;
+
+    for (child = trie->child; child != NULL; child = child->sibling) {
+        if (child->c == c) {
+            return child;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    child = jvmtiAllocate((jint)sizeof(*child));
+    if (child == NULL) {
+        EXIT_ERROR(AGENT_ERROR_OUT_OF_MEMORY, "filter index");
+    }
+    child->c = c;
+    child->parent = trie;
+    child->child = NULL;
+    child->sibling = trie->child;
+    child->handlers = NULL;
+    trie->child = child;
+    return child;
+}
+
+/* Free the trie nodes that no longer lead to a pattern */
+static void
+pruneTrie(PatternTrie *trie)
+{
+    while (trie->parent != NULL && trie->handlers == NULL && trie->child == NULL) {
+        PatternTrie *parent = trie->parent;
+        PatternTrie **link = &parent->child;
+        while (*link != trie) {
+            link = &(*link)->sibling;
+        }
+        *link = trie->sibling;
+        jvmtiDeallocate(trie);
+        trie = parent;
+    }
+}
+
+void
+eventFilterRestricted_index(HandlerNode *node)
+{
+    FilterIndex *index = &filterIndexes[NODE_EI(node) - EI_min];
+    FilterIndexEntry *entry = INDEX_ENTRY(node);
+    MatchFilter *match = NULL;
+    PatternTrie *trie;
+    int i;
+
+    entry->hash = 0;
+    entry->key = selectIndexKey(node, &entry->hash, &match);
+    entry->sequence = ++indexSequence;
+    entry->trie = NULL;
+    indexGeneration++;
+
+    switch (entry->key) {
+        case INDEX_KEY_LOCATION:
+        case INDEX_KEY_FIELD:
+        case INDEX_KEY_NAME:
+            if (index->keyedCount >= index->bucketCount) {
+                rehashIndex(index, index->bucketCount == 0 ?
+                                   INITIAL_INDEX_BUCKETS : 2 * index->bucketCount);
+            }
+            index->keyedCount++;
+            indexLink(&index->buckets[entry->hash & (index->bucketCount - 1)], node);
+            break;
+
+        case INDEX_KEY_PREFIX:
+            trie = &index->prefixes;
+            for (i = 0; i < match->matchLength; i++) {
+                trie = trieChild(trie, match->classPattern[i], JNI_TRUE);
+            }
+            entry->trie = trie;
+            indexLink(&trie->handlers, node);
+            break;
+
+        case INDEX_KEY_SUFFIX:
+            trie = &index->suffixes;
+            for (i = match->matchLength; i > 0; i--) {
+                trie = trieChild(trie, match->classPattern[i], JNI_TRUE);
+            }
+            entry->trie = trie;
+            indexLink(&trie->handlers, node);
+            break;
+
+        default:
+            indexLink(&index->unkeyed, node);
+            break;
+    }
+}
+
+/* Safe for nodes that are not indexed */
+void
+eventFilterRestricted_unindex(HandlerNode *node)
+{
+    FilterIndex *index = &filterIndexes[NODE_EI(node) - EI_min];
+    FilterIndexEntry *entry = INDEX_ENTRY(node);
+
+    if (entry->sequence == 0) {
+        return;
+    }
+    indexUnlink(node);
+    switch (entry->key) {
+        case INDEX_KEY_LOCATION:
+        case INDEX_KEY_FIELD:
+        case INDEX_KEY_NAME:
+            index->keyedCount--;
+            break;
+        case INDEX_KEY_PREFIX:
+        case INDEX_KEY_SUFFIX:
+            pruneTrie(entry->trie);
+            entry->trie = NULL;
+            break;
+        default:
+            break;
+    }
+    entry->sequence = 0;
+    indexGeneration++;
+}
+
+/*
+ * Changes whenever a node is indexed or unindexed, so a dispatch loop can
+ * tell that the candidates it holds may be stale.
+ */
+jint
+eventFilterRestricted_indexGeneration(void)
+{
+    return indexGeneration;
+}
+
+jlong
+eventFilterRestricted_indexSequence(HandlerNode *node)
+{
+    return INDEX_ENTRY(node)->sequence;
+}
+
+static void
+addCandidates(FilterCandidates *candidates, HandlerNode *list,
+              jint key, unsigned int hash, jlong below)
+{
+    HandlerNode *node;
+
+    for (node = list; node != NULL; node = INDEX_ENTRY(node)->next) {
+        FilterIndexEntry *entry = INDEX_ENTRY(node);
+        if ((key != INDEX_KEY_NONE && (entry->key != key || entry->hash != hash)) ||
+            (below != 0 && entry->sequence >= below)) {
+            continue;
+        }
+        if (candidates->count == candidates->capacity) {
+            jint capacity = 2 * candidates->capacity;
+            HandlerNode **nodes = jvmtiAllocate(capacity * (jint)sizeof(HandlerNode *));
+            if (nodes == NULL) {
+                EXIT_ERROR(AGENT_ERROR_OUT_OF_MEMORY, "filter candidates");
+            }
+            (void)memcpy(nodes, candidates->nodes,
+                         candidates->count * sizeof(HandlerNode *));
+            if (candidates->nodes != candidates->inlineNodes) {
+                jvmtiDeallocate(candidates->nodes);
+            }
+            candidates->nodes = nodes;
+            candidates->capacity = capacity;
+        }
+        candidates->nodes[candidates->count++] = node;
+    }
+}
+
+static void
+addHashedCandidates(FilterCandidates *candidates, FilterIndex *index,
+                    jint key, unsigned int hash, jlong below)
+{
+    if (index->bucketCount > 0) {
+        addCandidates(candidates, index->buckets[hash & (index->bucketCount - 1)],
+                      key, hash, below);
+    }
+}
+
+/* Newest first, which is the order of the handler chain */
+static int
+compareSequenceDescending(const void *a, const void *b)
+{
+    jlong sa = INDEX_ENTRY(*(HandlerNode * const *)a)->sequence;
+    jlong sb = INDEX_ENTRY(*(HandlerNode * const *)b)->sequence;
+
+    return sa < sb ? 1 : (sa > sb ? -1 : 0);
+}
+
+/*
+ * Collect the nodes of the event's kind that may pass their filters for
+ * this event, in handler chain order. If below is not 0, only nodes that
+ * come after the node with that sequence number in the chain are
+ * collected.
+ */
+void
+eventFilterRestricted_findCandidates(char *classname, EventInfo *evinfo,
+                                     jlong below, FilterCandidates *candidates)
+{
+    FilterIndex *index = &filterIndexes[evinfo->ei - EI_min];
+    PatternTrie *trie;
+
+    candidates->nodes = candidates->inlineNodes;
+    candidates->count = 0;
+    candidates->capacity = sizeof(candidates->inlineNodes) / sizeof(HandlerNode *);
+
+    addCandidates(candidates, index->unkeyed, INDEX_KEY_NONE, 0, below);
+
+    /* The same union members the LocationOnly and FieldOnly filters read */
+    addHashedCandidates(candidates, index, INDEX_KEY_LOCATION,
+                        hashKey(INDEX_KEY_LOCATION, (uintptr_t)evinfo->method,
+                                (uintptr_t)evinfo->location), below);
+    addHashedCandidates(candidates, index, INDEX_KEY_FIELD,
+                        hashKey(INDEX_KEY_FIELD,
+                                (uintptr_t)evinfo->u.field_access.field, 0), below);
+
+    if (classname != NULL) {
+        int length = (int)strlen(classname);
+        int i;
+
+        addHashedCandidates(candidates, index, INDEX_KEY_NAME,
+                            hashName(classname, length), below);
+
+        trie = &index->prefixes;
+        for (i = 0; trie != NULL; i++) {
+            addCandidates(candidates, trie->handlers, INDEX_KEY_NONE, 0, below);
+            trie = i < length ? trieChild(trie, classname[i], JNI_FALSE) : NULL;
+        }
+        trie = &index->suffixes;
+        for (i = length - 1; trie != NULL; i--) {
+            addCandidates(candidates, trie->handlers, INDEX_KEY_NONE, 0, below);
+            trie = i >= 0 ? trieChild(trie, classname[i], JNI_FALSE) : NULL;
+        }
+    }
+
+    if (candidates->count > 1) {
+        qsort(candidates->nodes, candidates->count, sizeof(HandlerNode *),
+              compareSequenceDescending);
+    }
+}
+
+void
+eventFilterRestricted_freeCandidates(FilterCandidates *candidates)
+{
+    if (candidates->nodes != candidates->inlineNodes) {
+        jvmtiDeallocate(candidates->nodes);
+    }
+    candidates->nodes = NULL;
+    candidates->count = 0;
+}
+
 /***** filter (and event) installation and deinstallation *****/
 
 /**
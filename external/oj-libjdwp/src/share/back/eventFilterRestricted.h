@@ -50,4 +50,25 @@ jboolean eventFilterRestricted_isBreakpointInClass(JNIEnv *env,
                                                    jclass clazz,
                                                    HandlerNode *node);
 
+/*
+ * ANDROID-CHANGED: Index of the nodes of each event kind, used to find
+ * the nodes whose filters an event may pass without running every filter.
+ */
+typedef struct FilterCandidates_ {
+    HandlerNode **nodes;
+    jint count;
+    jint capacity;
+    HandlerNode *inlineNodes[16];
+} FilterCandidates;
+
+void eventFilterRestricted_index(HandlerNode *node);
+void eventFilterRestricted_unindex(HandlerNode *node);
+jint eventFilterRestricted_indexGeneration(void);
+jlong eventFilterRestricted_indexSequence(HandlerNode *node);
+void eventFilterRestricted_findCandidates(char *classname,
+                                          EventInfo *evinfo,
+                                          jlong below,
+                                          FilterCandidates *candidates);
+void eventFilterRestricted_freeCandidates(FilterCandidates *candidates);
+
 #endif
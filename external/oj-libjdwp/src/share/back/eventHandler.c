@@ -197,6 +197,8 @@ insert(HandlerChain *chain, HandlerNode *node)
         PREV(oldHead) = node;
     }
     chain->first = node;
+    // ANDROID-CHANGED: Keep the filter index in step with the chain.
+    eventFilterRestricted_index(node);
 }
 
 static HandlerNode *
@@ -229,6 +231,8 @@ deinsert(HandlerNode *node)
     if (chain == NULL) {
         return;
     }
+    // ANDROID-CHANGED: Keep the filter index in step with the chain.
+    eventFilterRestricted_unindex(node);
     if (chain->first == node) {
         chain->first = NEXT(node);
     }
@@ -637,40 +641,58 @@ event_callback(JNIEnv *env, EventInfo *evinfo)
 
     debugMonitorEnter(handlerLock);
     {
-        HandlerNode *node;
         char        *classname;
+        FilterCandidates candidates;
+        jlong       below = 0;
+        jboolean    rescan = JNI_TRUE;
 
         /* We must keep track of all classes prepared to know what's unloaded */
         if (evinfo->ei == EI_CLASS_PREPARE) {
             classTrack_addPreparedClass(env, evinfo->clazz);
         }
 
-        node = getHandlerChain(evinfo->ei)->first;
         classname = getClassname(evinfo->clazz);
 
-        while (node != NULL) {
-            /* save next so handlers can remove themselves */
-            HandlerNode *next = NEXT(node);
-            jboolean shouldDelete;
-
-            if (eventFilterRestricted_passesFilter(env, classname,
-                                                   evinfo, node,
-                                                   &shouldDelete)) {
-                HandlerFunction func;
-
-                func = HANDLER_FUNCTION(node);
-                if ( func == NULL ) {
-                    EXIT_ERROR(AGENT_ERROR_INTERNAL,"handler function NULL");
+        /*
+         * ANDROID-CHANGED: Only visit the handlers the filter index
+         * finds for this event, in chain order. If handlers are added
+         * or removed along the way, look the remaining ones up again.
+         */
+        while (rescan) {
+            jint i;
+
+            rescan = JNI_FALSE;
+            eventFilterRestricted_findCandidates(classname, evinfo, below,
+                                                 &candidates);
+            for (i = 0; i < candidates.count; i++) {
+                HandlerNode *node = candidates.nodes[i];
+                jint generation = eventFilterRestricted_indexGeneration();
+                jboolean shouldDelete;
+
+                below = eventFilterRestricted_indexSequence(node);
+                if (eventFilterRestricted_passesFilter(env, classname,
+                                                       evinfo, node,
+                                                       &shouldDelete)) {
+                    HandlerFunction func;
+
+                    func = HANDLER_FUNCTION(node);
+                    if ( func == NULL ) {
+                        EXIT_ERROR(AGENT_ERROR_INTERNAL,"handler function NULL");
+                    }
+                    (*func)(env, evinfo, node, eventBag);
+                }
+                if (shouldDelete) {
+                    /* We can safely free the node now that we are done
+                     * using it.
+                     */
+                    (void)freeHandler(node);
+                }
+                if (eventFilterRestricted_indexGeneration() != generation) {
+                    rescan = JNI_TRUE;
+                    break;
                 }
-                (*func)(env, evinfo, node, eventBag);
-            }
-            if (shouldDelete) {
-                /* We can safely free the node now that we are done
-                 * using it.
-                 */
-                (void)freeHandler(node);
             }
-            node = next;
+            eventFilterRestricted_freeCandidates(&candidates);
         }
         jvmtiDeallocate(classname);
     }
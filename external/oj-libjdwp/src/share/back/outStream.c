@@ -35,6 +35,152 @@
 #define INITIAL_ID_ALLOC  50
 #define SMALLEST(a, b) ((a) < (b)) ? (a) : (b)
 
+/*
+ * ANDROID-CHANGED: Segments are recycled through a pool instead of
+ * allocating a segment and a header every time a packet grows, and a
+ * reply starts out with room for as much data as the last reply to the
+ * same command, so large replies are built in one contiguous buffer.
+ */
+#define SEGMENT_POOL_MAX_BYTES   (4 * 1024 * 1024)
+#define MAX_HINTED_SEGMENT_SIZE  (1024 * 1024)
+#define REPLY_SIZE_HINTS         256
+
+static jrawMonitorID segmentPoolLock;
+static PacketData *segmentPool;
+static jint segmentPoolBytes;
+static jint replySizeHints[REPLY_SIZE_HINTS];
+
+void
+outStream_initialize(void)
+{
+    segmentPoolLock = debugMonitorCreate("JDWP Segment Pool Monitor");
+}
+
+static void
+freeSegments(PacketData *segment)
+{
+    while (segment != NULL) {
+        PacketData *next = segment->next;
+        jvmtiDeallocate(segment);
+        segment = next;
+    }
+}
+
+/*
+ * Release the pool and forget the size hints of the previous debugger.
+ */
+void
+outStream_reset(void)
+{
+    PacketData *pool;
+
+    debugMonitorEnter(segmentPoolLock);
+    pool = segmentPool;
+    segmentPool = NULL;
+    segmentPoolBytes = 0;
+    (void)memset(replySizeHints, 0, sizeof(replySizeHints));
+    debugMonitorExit(segmentPoolLock);
+
+    freeSegments(pool);
+}
+
+static PacketData *
+allocateSegment(jint size)
+{
+    PacketData *segment;
+    PacketData **prev;
+
+    debugMonitorEnter(segmentPoolLock);
+    for (prev = &segmentPool; (segment = *prev) != NULL; prev = &segment->next) {
+        if (segment->capacity >= size) {
+            *prev = segment->next;
+            segmentPoolBytes -= segment->capacity;
+            break;
+        }
+    }
+    debugMonitorExit(segmentPoolLock);
+
+    if (segment == NULL) {
+        segment = jvmtiAllocate((jint)sizeof(*segment) + size);
+        if (segment == NULL) {
+            return NULL;
+        }
+        segment->data = (jbyte *)(segment + 1);
+        segment->capacity = size;
+    }
+    segment->length = 0;
+    segment->next = NULL;
+    return segment;
+}
+
+static void
+releaseSegments(PacketData *segment)
+{
+    PacketData *unpooled = NULL;
+
+    debugMonitorEnter(segmentPoolLock);
+    while (segment != NULL) {
+        PacketData *next = segment->next;
+        if (segmentPoolBytes + segment->capacity <= SEGMENT_POOL_MAX_BYTES) {
+            segment->next = segmentPool;
+            segmentPool = segment;
+            segmentPoolBytes += segment->capacity;
+        } else {
+            segment->next = unpooled;
+            unpooled = segment;
+        }
+        segment = next;
+    }
+    debugMonitorExit(segmentPoolLock);
+
+    freeSegments(unpooled);
+}
+
+static jint
+replySizeHint(PacketOutputStream *stream)
+{
+    jint hint;
+
+    if (stream->sizeHint < 0) {
+        return 0;
+    }
+    debugMonitorEnter(segmentPoolLock);
+    hint = replySizeHints[stream->sizeHint];
+    debugMonitorExit(segmentPoolLock);
+    return hint;
+}
+
+static void
+recordReplySize(PacketOutputStream *stream, jint len)
+{
+    if (stream->sizeHint < 0 || stream->error) {
+        return;
+    }
+    debugMonitorEnter(segmentPoolLock);
+    replySizeHints[stream->sizeHint] = SMALLEST(len, MAX_HINTED_SEGMENT_SIZE);
+    debugMonitorExit(segmentPoolLock);
+}
+
+/*
+ * Move the data written so far out of initialSegment into a pooled
+ * buffer of at least size bytes, which becomes the data of firstSegment.
+ */
+static jboolean
+promoteFirstSegment(PacketOutputStream *stream, jint size)
+{
+    PacketData *buffer = allocateSegment(size);
+
+    if (buffer == NULL) {
+        return JNI_FALSE;
+    }
+    (void)memcpy(buffer->data, stream->firstSegment.data, stream->firstSegment.length);
+    stream->firstSegment.data = buffer->data;
+    stream->current = buffer->data + stream->firstSegment.length;
+    stream->left = buffer->capacity - stream->firstSegment.length;
+    stream->promoted = buffer;
+    return JNI_TRUE;
+}
+
 static void
 commonInit(PacketOutputStream *stream)
 {
@@ -50,6 +196,8 @@ commonInit(PacketOutputStream *stream)
     if (stream->ids == NULL) {
         stream->error = JDWP_ERROR(OUT_OF_MEMORY);
     }
+    stream->promoted = NULL;
+    stream->sizeHint = -1;
 }
 
 void
@@ -81,6 +229,14 @@ outStream_initReply(PacketOutputStream *stream, jint id)
     stream->packet.type.cmd.flags = (jbyte)JDWPTRANSPORT_FLAGS_REPLY;
 }
 
+void
+outStream_initReplyToCommand(PacketOutputStream *stream, jint id,
+                             jbyte commandSet, jbyte command)
+{
+    outStream_initReply(stream, id);
+    stream->sizeHint = ((unsigned char)commandSet * 31 + (unsigned char)command) & (REPLY_SIZE_HINTS - 1);
+}
+
 jint
 outStream_id(PacketOutputStream *stream)
 {
@@ -107,21 +263,27 @@ writeBytes(PacketOutputStream *stream, void *source, int size)
         jint count;
         if (stream->left == 0) {
             jint segSize = SMALLEST(2 * stream->segment->length, MAX_SEGMENT_SIZE);
-            jbyte *newSeg = jvmtiAllocate(segSize);
-            struct PacketData *newHeader = jvmtiAllocate(sizeof(*newHeader));
-            if ((newSeg == NULL) || (newHeader == NULL)) {
-                jvmtiDeallocate(newSeg);
-                jvmtiDeallocate(newHeader);
+            struct PacketData *newHeader;
+            /*
+             * ANDROID-CHANGED: The last reply to this command was larger
+             * than initialSegment, make room for all of it in one buffer.
+             */
+            if (stream->segment == &stream->firstSegment && stream->promoted == NULL) {
+                jint hint = replySizeHint(stream);
+                if (hint > stream->firstSegment.length &&
+                    promoteFirstSegment(stream, hint + size)) {
+                    continue;
+                }
+            }
+            newHeader = allocateSegment(segSize);
+            if (newHeader == NULL) {
                 stream->error = JDWP_ERROR(OUT_OF_MEMORY);
                 return stream->error;
             }
-            newHeader->length = 0;
-            newHeader->data = newSeg;
-            newHeader->next = NULL;
             stream->segment->next = newHeader;
             stream->segment = newHeader;
             stream->current = newHeader->data;
-            stream->left = segSize;
+            stream->left = newHeader->capacity;
         }
         count = SMALLEST(size, stream->left);
         (void)memcpy(stream->current, bytes, count);
@@ -406,7 +568,7 @@ outStream_send(PacketOutputStream *stream) {
 
     jint rc;
     jint len = 0;
-    PacketData *segment;
+    PacketData *segment, *buffer;
     jbyte *data, *posP;
 
     /*
@@ -417,6 +579,9 @@ outStream_send(PacketOutputStream *stream) {
         stream->packet.type.cmd.len = 11 + stream->firstSegment.length;
         stream->packet.type.cmd.data = stream->firstSegment.data;
         rc = transport_sendPacket(&stream->packet);
+        if (rc == 0) {
+            recordReplySize(stream, stream->firstSegment.length);
+        }
         return rc;
     }
 
@@ -430,10 +595,12 @@ outStream_send(PacketOutputStream *stream) {
         segment = segment->next;
     } while (segment != NULL);
 
-    data = jvmtiAllocate(len);
-    if (data == NULL) {
+    // ANDROID-CHANGED: Gather the segments into a pooled buffer.
+    buffer = allocateSegment(len);
+    if (buffer == NULL) {
         return JDWP_ERROR(OUT_OF_MEMORY);
     }
+    data = buffer->data;
 
     posP = data;
     segment = (PacketData *)&(stream->firstSegment);
@@ -447,7 +614,10 @@ outStream_send(PacketOutputStream *stream) {
     stream->packet.type.cmd.data = data;
     rc = transport_sendPacket(&stream->packet);
     stream->packet.type.cmd.data = NULL;
-    jvmtiDeallocate(data);
+    releaseSegments(buffer);
+    if (rc == 0) {
+        recordReplySize(stream, len);
+    }
 
     return rc;
 }
@@ -493,18 +663,11 @@ releaseID(void *elementPtr, void *arg)
 void
 outStream_destroy(PacketOutputStream *stream)
 {
-    struct PacketData *next;
-
     if (stream->error || !stream->sent) {
         (void)bagEnumerateOver(stream->ids, releaseID, NULL);
     }
 
-    next = stream->firstSegment.next;
-    while (next != NULL) {
-        struct PacketData *p = next;
-        next = p->next;
-        jvmtiDeallocate(p->data);
-        jvmtiDeallocate(p);
-    }
+    releaseSegments(stream->firstSegment.next);
+    releaseSegments(stream->promoted);
     bagDestroyBag(stream->ids);
 }
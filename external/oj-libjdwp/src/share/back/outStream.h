@@ -38,6 +38,8 @@ typedef struct PacketData {
     int length;
     jbyte *data;
     struct PacketData *next;
+    // ANDROID-CHANGED: Size of the data area, which follows the header in the same allocation.
+    int capacity;
 } PacketData;
 
 typedef struct PacketOutputStream {
@@ -50,11 +52,22 @@ typedef struct PacketOutputStream {
     jdwpPacket packet;
     jbyte initialSegment[INITIAL_SEGMENT_SIZE];
     struct bag *ids;
+    // ANDROID-CHANGED: Pooled buffer that replaced initialSegment as the data of firstSegment,
+    // and the slot of the reply size hint for the command being answered (-1 if none).
+    struct PacketData *promoted;
+    jint sizeHint;
 } PacketOutputStream;
 
+// ANDROID-CHANGED: Segment pool and reply size hints, kept for the lifetime of a connection.
+void outStream_initialize(void);
+void outStream_reset(void);
+
 void outStream_initCommand(PacketOutputStream *stream, jint id,
                            jbyte flags, jbyte commandSet, jbyte command);
 void outStream_initReply(PacketOutputStream *stream, jint id);
+// ANDROID-CHANGED: Like outStream_initReply, but sized after earlier replies to the command.
+void outStream_initReplyToCommand(PacketOutputStream *stream, jint id,
+                                  jbyte commandSet, jbyte command);
 
 jint outStream_id(PacketOutputStream *stream);
 jbyte outStream_command(PacketOutputStream *stream);
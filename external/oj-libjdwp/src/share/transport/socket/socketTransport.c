@@ -63,10 +63,11 @@ static jdwpTransportEnv single_env = (jdwpTransportEnv)&interface;
         }
 
 #define HEADER_SIZE     11
-#define MAX_DATA_SIZE 1000
 
 static jint recv_fully(int, char *, int);
 static jint send_fully(int, char *, int);
+// ANDROID-CHANGED: Vectored send_fully.
+static jint send_vector_fully(int, struct iovec *, int, int);
 
 /*
  * Record the last error for this thread.
@@ -533,11 +534,8 @@ static jdwpTransportError JNICALL
 socketTransport_writePacket(jdwpTransportEnv* env, const jdwpPacket *packet)
 {
     jint len, data_len, id;
-    /*
-     * room for header and up to MAX_DATA_SIZE data bytes
-     */
-    char header[HEADER_SIZE + MAX_DATA_SIZE];
-    jbyte *data;
+    char header[HEADER_SIZE];
+    struct iovec iov[2];
 
     /* packet can't be null */
     if (packet == NULL) {
@@ -568,25 +566,18 @@ socketTransport_writePacket(jdwpTransportEnv* env, const jdwpPacket *packet)
         header[10] = packet->type.cmd.cmd;
     }
 
-    data = packet->type.cmd.data;
-    /* Do one send for short packets, two for longer ones */
-    if (data_len <= MAX_DATA_SIZE) {
-        memcpy(header + HEADER_SIZE, data, data_len);
-        if (send_fully(socketFD, (char *)&header, HEADER_SIZE + data_len) !=
-            HEADER_SIZE + data_len) {
-            RETURN_IO_ERROR("send failed");
-        }
-    } else {
-        memcpy(header + HEADER_SIZE, data, MAX_DATA_SIZE);
-        if (send_fully(socketFD, (char *)&header, HEADER_SIZE + MAX_DATA_SIZE) !=
-            HEADER_SIZE + MAX_DATA_SIZE) {
-            RETURN_IO_ERROR("send failed");
-        }
-        /* Send the remaining data bytes right out of the data area. */
-        if (send_fully(socketFD, (char *)data + MAX_DATA_SIZE,
-                       data_len - MAX_DATA_SIZE) != data_len - MAX_DATA_SIZE) {
-            RETURN_IO_ERROR("send failed");
-        }
+    /*
+     * ANDROID-CHANGED: Send the header and the data with one writev
+     * instead of copying the start of the data behind the header and
+     * sending the rest separately.
+     */
+    iov[0].iov_base = header;
+    iov[0].iov_len = HEADER_SIZE;
+    iov[1].iov_base = packet->type.cmd.data;
+    iov[1].iov_len = data_len;
+    if (send_vector_fully(socketFD, iov, 2, HEADER_SIZE + data_len) !=
+        HEADER_SIZE + data_len) {
+        RETURN_IO_ERROR("send failed");
     }
 
     return JDWPTRANSPORT_ERROR_NONE;
@@ -624,6 +615,36 @@ send_fully(int f, char *buf, int len)
     return nbytes;
 }
 
+/*
+ * ANDROID-CHANGED: Like send_fully, for the len bytes described by iov.
+ * Consumes iov as data is sent.
+ */
+static jint
+send_vector_fully(int f, struct iovec *iov, int iovcnt, int len)
+{
+    int nbytes = 0;
+    while (nbytes < len) {
+        int res = dbgsysSendVector(f, iov, iovcnt);
+        if (res < 0) {
+            return res;
+        } else if (res == 0) {
+            break; /* eof, return nbytes which is less than len */
+        }
+        nbytes += res;
+        /* Skip the buffers that went out, and the start of a partial one */
+        while (iovcnt > 0 && (size_t)res >= iov->iov_len) {
+            res -= (int)iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + res;
+            iov->iov_len -= res;
+        }
+    }
+    return nbytes;
+}
+
 static jdwpTransportError JNICALL
 socketTransport_readPacket(jdwpTransportEnv* env, jdwpPacket* packet) {
     jint length, data_len;
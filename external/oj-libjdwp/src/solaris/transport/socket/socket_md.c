@@ -126,6 +126,17 @@ dbgsysSend(int fd, char *buf, size_t nBytes, int flags) {
     return rv;
 }
 
+// ANDROID-CHANGED: Send several buffers with one system call.
+int
+dbgsysSendVector(int fd, struct iovec *iov, int iovcnt) {
+    int rv;
+    do {
+        rv = writev(fd, iov, iovcnt);
+    } while (rv == -1 && errno == EINTR);
+
+    return rv;
+}
+
 struct hostent *
 dbgsysGetHostByName(char *hostname) {
     return gethostbyname(hostname);
@@ -27,3 +27,4 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>        /* Defines TCP_NODELAY, needed for 2.6 */
 #include <netdb.h>
+#include <sys/uio.h>           /* ANDROID-CHANGED: struct iovec */
@@ -451,6 +451,7 @@ void cil_db_init(struct cil_db **db)
 	(*db)->qualified_names = CIL_FALSE;
 	(*db)->target_platform = SEPOL_TARGET_SELINUX;
 	(*db)->policy_version = POLICYDB_VERSION_MAX;
+	(*db)->resolve_threads = 0;
 }
 
 void cil_db_destroy(struct cil_db **db)
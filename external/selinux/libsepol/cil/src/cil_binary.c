@@ -4696,15 +4696,38 @@ exit:
 	return rc;
 }
 
-static int cil_check_neverallow(const struct cil_db *db, policydb_t *pdb, struct cil_tree_node *node, int *violation)
+struct cil_neverallow_check {
+	struct cil_tree_node *node;
+	avrule_t *rule;
+	struct cil_list *xperms;
+};
+
+static void __cil_neverallow_check_destroy(struct cil_neverallow_check *check)
+{
+	struct cil_list_item *item;
+
+	if (check->xperms != NULL) {
+		cil_list_for_each(item, check->xperms) {
+			free(item->data);
+			item->data = NULL;
+		}
+		cil_list_destroy(&check->xperms, CIL_FALSE);
+	}
+
+	if (check->rule != NULL) {
+		check->rule->xperms = NULL;
+		__cil_destroy_sepol_avrules(check->rule);
+		check->rule = NULL;
+	}
+}
+
+static int __cil_neverallow_check_init(const struct cil_db *db, policydb_t *pdb, struct cil_tree_node *node, struct cil_neverallow_check *check)
 {
 	int rc = SEPOL_OK;
 	struct cil_avrule *cil_rule = node->data;
 	struct cil_symtab_datum *tgt = cil_rule->tgt;
 	uint32_t kind;
 	avrule_t *rule;
-	struct cil_list *xperms = NULL;
-	struct cil_list_item *item;
 
 	if (!cil_rule->is_extended) {
 		kind = AVRULE_NEVERALLOW;
@@ -4715,6 +4738,10 @@ static int cil_check_neverallow(const struct cil_db *db, policydb_t *pdb, struct
 	rule = __cil_init_sepol_avrule(kind, node);
 	rule->next = NULL;
 
+	check->node = node;
+	check->rule = rule;
+	check->xperms = NULL;
+
 	rc = __cil_add_sepol_type(pdb, db, cil_rule->src, &rule->stypes.types);
 	if (rc != SEPOL_OK) {
 		goto exit;
@@ -4734,41 +4761,116 @@ static int cil_check_neverallow(const struct cil_db *db, policydb_t *pdb, struct
 		if (rc != SEPOL_OK) {
 			goto exit;
 		}
-
-		rc = check_assertion(pdb, rule);
-		if (rc == CIL_TRUE) {
-// [ SEC_SELINUX_PORTING_COMMON
-			// Fixed build error when including neverallow
-			//*violation = CIL_TRUE;
-			*violation = CIL_FALSE;
-// ] SEC_SELINUX_PORTING_COMMON
-			rc = __cil_print_neverallow_failure(db, node);
-			if (rc != SEPOL_OK) {
-				goto exit;
-			}
-		}
-
 	} else {
 		rc = __cil_permx_to_sepol_class_perms(pdb, cil_rule->perms.x.permx, &rule->perms);
 		if (rc != SEPOL_OK) {
 			goto exit;
 		}
 
-		rc = __cil_permx_bitmap_to_sepol_xperms_list(cil_rule->perms.x.permx->perms, &xperms);
+		rc = __cil_permx_bitmap_to_sepol_xperms_list(cil_rule->perms.x.permx->perms, &check->xperms);
 		if (rc != SEPOL_OK) {
 			goto exit;
 		}
+	}
+
+	return SEPOL_OK;
+
+exit:
+	__cil_neverallow_check_destroy(check);
+	return rc;
+}
+
+/*
+ * Converts all neverallow rules first, checks them concurrently against the
+ * read-only policydb and then reports the failures in rule order. Each
+ * xperms item of a neverallowx rule is checked as a separate sepol avrule
+ * sharing the type sets and permissions of the converted rule.
+ */
+static int cil_check_neverallows(const struct cil_db *db, policydb_t *pdb, struct cil_list *neverallows, int *violation)
+{
+	int rc = SEPOL_OK;
+	int init_rc = SEPOL_OK;
+	struct cil_list_item *item;
+	struct cil_neverallow_check *checks = NULL;
+	avrule_t **rules = NULL;
+	int *results = NULL;
+	unsigned int nchecks = 0, ninit = 0, nrules = 0, i, j;
+
+	cil_list_for_each(item, neverallows) {
+		nchecks++;
+	}
+
+	if (nchecks == 0) {
+		return SEPOL_OK;
+	}
+
+	checks = cil_calloc(nchecks, sizeof(*checks));
+
+	cil_list_for_each(item, neverallows) {
+		init_rc = __cil_neverallow_check_init(db, pdb, item->data, &checks[ninit]);
+		if (init_rc != SEPOL_OK) {
+			break;
+		}
+		if (checks[ninit].xperms != NULL) {
+			struct cil_list_item *x;
+			cil_list_for_each(x, checks[ninit].xperms) {
+				nrules++;
+			}
+		} else {
+			nrules++;
+		}
+		ninit++;
+	}
+
+	if (nrules > 0) {
+		rules = cil_calloc(nrules, sizeof(*rules));
+		results = cil_calloc(nrules, sizeof(*results));
+	}
+
+	j = 0;
+	for (i = 0; i < ninit; i++) {
+		if (checks[i].xperms != NULL) {
+			struct cil_list_item *x;
+			cil_list_for_each(x, checks[i].xperms) {
+				avrule_t *rule = cil_malloc(sizeof(*rule));
+				*rule = *checks[i].rule;
+				rule->xperms = x->data;
+				rule->next = NULL;
+				rules[j++] = rule;
+			}
+		} else {
+			rules[j++] = checks[i].rule;
+		}
+	}
+
+	if (nrules > 0 && check_assertion_list(pdb, rules, nrules, results, 0) != 0) {
+		rc = SEPOL_ERR;
+		goto exit;
+	}
+
+	j = 0;
+	for (i = 0; i < ninit; i++) {
+		unsigned int n = 1, k;
+
+		if (checks[i].xperms != NULL) {
+			n = 0;
+			cil_list_for_each(item, checks[i].xperms) {
+				n++;
+			}
+		}
 
-		cil_list_for_each(item, xperms) {
-			rule->xperms = item->data;
-			rc = check_assertion(pdb, rule);
-			if (rc == CIL_TRUE) {
+		for (k = 0; k < n; k++, j++) {
+			if (results[j] < 0) {
+				rc = SEPOL_ERR;
+				goto exit;
+			}
+			if (results[j] == CIL_TRUE) {
 // [ SEC_SELINUX_PORTING_COMMON
 			// Fixed build error when including neverallow
 			//*violation = CIL_TRUE;
 			*violation = CIL_FALSE;
 // ] SEC_SELINUX_PORTING_COMMON
-				rc = __cil_print_neverallow_failure(db, node);
+				rc = __cil_print_neverallow_failure(db, checks[i].node);
 				if (rc != SEPOL_OK) {
 					goto exit;
 				}
@@ -4776,34 +4878,23 @@ static int cil_check_neverallow(const struct cil_db *db, policydb_t *pdb, struct
 		}
 	}
 
-exit:
-	if (xperms != NULL) {
-		cil_list_for_each(item, xperms) {
-			free(item->data);
-			item->data = NULL;
-		}
-		cil_list_destroy(&xperms, CIL_FALSE);
-	}
-
-	rule->xperms = NULL;
-	__cil_destroy_sepol_avrules(rule);
-
-	return rc;
-}
-
-static int cil_check_neverallows(const struct cil_db *db, policydb_t *pdb, struct cil_list *neverallows, int *violation)
-{
-	int rc = SEPOL_OK;
-	struct cil_list_item *item;
+	rc = init_rc;
 
-	cil_list_for_each(item, neverallows) {
-		rc = cil_check_neverallow(db, pdb, item->data, violation);
-		if (rc != SEPOL_OK) {
-			goto exit;
+exit:
+	for (i = 0, j = 0; i < ninit; i++) {
+		if (checks[i].xperms != NULL) {
+			cil_list_for_each(item, checks[i].xperms) {
+				free(rules[j++]);
+			}
+		} else {
+			j++;
 		}
+		__cil_neverallow_check_destroy(&checks[i]);
 	}
+	free(rules);
+	free(results);
+	free(checks);
 
-exit:
 	return rc;
 }
 
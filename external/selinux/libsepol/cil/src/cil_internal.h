@@ -329,6 +329,8 @@ struct cil_db {
 	int qualified_names;
 	int target_platform;
 	int policy_version;
+	/* threads resolving rules ahead of CIL_PASS_MISC3, 0 for one per CPU */
+	unsigned resolve_threads;
 };
 
 struct cil_root {
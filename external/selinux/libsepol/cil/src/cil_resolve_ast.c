@@ -30,6 +30,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include <sepol/policydb/conditional.h>
 
@@ -66,6 +68,24 @@ struct cil_args_resolve {
 	struct cil_list *in_list_before;
 	struct cil_list *in_list_after;
 	struct cil_list *abstract_blocks;
+	struct cil_resolve_batch *batch;
+};
+
+/*
+ * Rules whose resolution only looks names up and fills in the rule itself.
+ * They make up most of a large policy, so during CIL_PASS_MISC3 they are
+ * resolved by several threads before the tree walk, which then only picks
+ * up the results.
+ */
+struct cil_resolve_batch {
+	struct cil_args_resolve *args;
+	struct cil_tree_node **nodes;
+	char *resolved;
+	uint32_t count;
+	uint32_t alloc;
+	uint32_t pos;
+	uint32_t next;
+	pthread_mutex_t lock;
 };
 
 static struct cil_name * __cil_insert_name(struct cil_db *db, hashtab_key_t key, struct cil_tree_node *ast_node)
@@ -309,7 +329,16 @@ exit:
 	return rc;
 }
 
-int cil_resolve_avrule(struct cil_tree_node *current, void *extra_args)
+static void __cil_avrule_type_used(struct cil_avrule *rule)
+{
+	int used = (rule->rule_kind == CIL_AVRULE_NEVERALLOW) ?
+		CIL_ATTR_NEVERALLOW : CIL_ATTR_AVRULE;
+
+	cil_type_used(rule->src, used); /* src not used if tgt is self */
+	cil_type_used(rule->tgt, used);
+}
+
+static int __cil_resolve_avrule(struct cil_tree_node *current, void *extra_args, int mark_used)
 {
 	struct cil_args_resolve *args = extra_args;
 	struct cil_db *db = NULL;
@@ -318,7 +347,6 @@ int cil_resolve_avrule(struct cil_tree_node *current, void *extra_args)
 	struct cil_symtab_datum *src_datum = NULL;
 	struct cil_symtab_datum *tgt_datum = NULL;
 	struct cil_symtab_datum *permx_datum = NULL;
-	int used;
 	int rc = SEPOL_ERR;
 
 	if (args != NULL) {
@@ -339,10 +367,9 @@ int cil_resolve_avrule(struct cil_tree_node *current, void *extra_args)
 			goto exit;
 		}
 		rule->tgt = tgt_datum;
-		used = (rule->rule_kind == CIL_AVRULE_NEVERALLOW) ?
-			CIL_ATTR_NEVERALLOW : CIL_ATTR_AVRULE;
-		cil_type_used(src_datum, used); /* src not used if tgt is self */
-		cil_type_used(tgt_datum, used);
+		if (mark_used) {
+			__cil_avrule_type_used(rule);
+		}
 	}
 
 	if (!rule->is_extended) {
@@ -371,6 +398,11 @@ exit:
 	return rc;
 }
 
+int cil_resolve_avrule(struct cil_tree_node *current, void *extra_args)
+{
+	return __cil_resolve_avrule(current, extra_args, CIL_TRUE);
+}
+
 int cil_resolve_type_rule(struct cil_tree_node *current, void *extra_args)
 {
 	struct cil_type_rule *rule = current->data;
@@ -3603,6 +3635,179 @@ static int cil_check_for_bad_inheritance(struct cil_tree_node *node)
 	return rc;
 }
 
+/* Upper bound of threads used to resolve a batch */
+#define CIL_RESOLVE_MAX_THREADS 32
+
+/* Rules claimed by a thread at a time */
+#define CIL_RESOLVE_BATCH_CHUNK 256
+
+/* Do not bother with threads for fewer rules than this */
+#define CIL_RESOLVE_BATCH_MIN 4096
+
+static int __cil_resolve_batch_collect(struct cil_tree_node *node, uint32_t *finished, void *extra_args)
+{
+	struct cil_resolve_batch *batch = extra_args;
+	struct cil_list_item *curr;
+
+	/* Skip what __cil_resolve_ast_node_helper() skips */
+	if (node->flavor == CIL_MACRO ||
+	    (node->flavor == CIL_BLOCK && ((struct cil_block*)node->data)->is_abstract == CIL_TRUE)) {
+		*finished = CIL_TREE_SKIP_HEAD;
+		return SEPOL_OK;
+	}
+
+	if (node->flavor == CIL_AVRULE || node->flavor == CIL_AVRULEX) {
+		struct cil_avrule *rule = node->data;
+		if (!rule->is_extended) {
+			/* Named and anonymous sets may be shared between rules */
+			cil_list_for_each(curr, rule->perms.classperms) {
+				if (curr->flavor != CIL_CLASSPERMS) {
+					return SEPOL_OK;
+				}
+			}
+		}
+	} else if (node->flavor != CIL_TYPE_RULE) {
+		return SEPOL_OK;
+	}
+
+	if (batch->count == batch->alloc) {
+		batch->alloc = batch->alloc ? batch->alloc * 2 : 1024;
+		batch->nodes = cil_realloc(batch->nodes, batch->alloc * sizeof(*batch->nodes));
+	}
+	batch->nodes[batch->count++] = node;
+
+	return SEPOL_OK;
+}
+
+static void *__cil_resolve_batch_worker(void *arg)
+{
+	struct cil_resolve_batch *batch = arg;
+	struct cil_tree_node *node;
+	struct cil_list_item *curr;
+	uint32_t i, end;
+	int rc;
+
+	for (;;) {
+		pthread_mutex_lock(&batch->lock);
+		i = batch->next;
+		batch->next += CIL_RESOLVE_BATCH_CHUNK;
+		pthread_mutex_unlock(&batch->lock);
+
+		if (i >= batch->count) {
+			break;
+		}
+
+		end = i + CIL_RESOLVE_BATCH_CHUNK;
+		if (end > batch->count) {
+			end = batch->count;
+		}
+
+		for (; i < end; i++) {
+			node = batch->nodes[i];
+			if (node->flavor == CIL_TYPE_RULE) {
+				rc = cil_resolve_type_rule(node, batch->args);
+			} else {
+				struct cil_avrule *rule = node->data;
+				rc = __cil_resolve_avrule(node, batch->args, CIL_FALSE);
+				if (rc != SEPOL_OK && !rule->is_extended) {
+					/* Leave the rule as it was for the tree walk */
+					cil_list_for_each(curr, rule->perms.classperms) {
+						struct cil_classperms *cp = curr->data;
+						cp->class = NULL;
+						cil_list_destroy(&cp->perms, CIL_FALSE);
+					}
+				}
+			}
+			batch->resolved[i] = (rc == SEPOL_OK);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Resolve the batchable rules below current ahead of the CIL_PASS_MISC3
+ * tree walk.  Rules that fail are left for the walk, which resolves them
+ * again so that errors and disabled optionals are reported in order.
+ */
+static void __cil_resolve_batch_init(struct cil_resolve_batch *batch, struct cil_tree_node *current, struct cil_args_resolve *args)
+{
+	pthread_t threads[CIL_RESOLVE_MAX_THREADS];
+	enum cil_log_level log_level;
+	unsigned int nthreads = 0, i;
+	uint32_t min = CIL_RESOLVE_BATCH_MIN;
+	long ncpus;
+
+	memset(batch, 0, sizeof(*batch));
+	batch->args = args;
+
+	/* An explicit thread count batches any number of rules */
+	if (args->db->resolve_threads) {
+		ncpus = args->db->resolve_threads;
+		min = 1;
+	} else {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (ncpus < 2) {
+		return;
+	}
+	if (ncpus > CIL_RESOLVE_MAX_THREADS) {
+		ncpus = CIL_RESOLVE_MAX_THREADS;
+	}
+
+	cil_tree_walk(current, __cil_resolve_batch_collect, NULL, NULL, batch);
+	if (batch->count < min) {
+		batch->count = 0;
+		return;
+	}
+
+	batch->resolved = cil_malloc(batch->count);
+	pthread_mutex_init(&batch->lock, NULL);
+
+	/* Failures are logged by the tree walk */
+	log_level = cil_get_log_level();
+	cil_set_log_level(0);
+
+	/* The calling thread works on the batch as well */
+	while (nthreads + 1 < ncpus &&
+	       (nthreads + 1) * CIL_RESOLVE_BATCH_CHUNK < batch->count) {
+		if (pthread_create(&threads[nthreads], NULL,
+				   __cil_resolve_batch_worker, batch)) {
+			break;
+		}
+		nthreads++;
+	}
+
+	__cil_resolve_batch_worker(batch);
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	cil_set_log_level(log_level);
+	pthread_mutex_destroy(&batch->lock);
+}
+
+static void __cil_resolve_batch_destroy(struct cil_resolve_batch *batch)
+{
+	free(batch->nodes);
+	free(batch->resolved);
+	memset(batch, 0, sizeof(*batch));
+}
+
+/*
+ * Returns CIL_TRUE if node was resolved by the batch.  Nodes are taken in
+ * the order of the tree walk, which is the order they were collected in.
+ */
+static int __cil_resolve_batch_take(struct cil_resolve_batch *batch, struct cil_tree_node *node)
+{
+	if (batch == NULL || batch->pos >= batch->count || batch->nodes[batch->pos] != node) {
+		return CIL_FALSE;
+	}
+
+	return batch->resolved[batch->pos++];
+}
+
 int __cil_resolve_ast_node(struct cil_tree_node *node, void *extra_args)
 {
 	int rc = SEPOL_OK;
@@ -3765,12 +3970,22 @@ int __cil_resolve_ast_node(struct cil_tree_node *node, void *extra_args)
 			break;
 		case CIL_AVRULE:
 		case CIL_AVRULEX:
+			if (__cil_resolve_batch_take(args->batch, node)) {
+				struct cil_avrule *rule = node->data;
+				if (rule->tgt_str != CIL_KEY_SELF) {
+					__cil_avrule_type_used(rule);
+				}
+				break;
+			}
 			rc = cil_resolve_avrule(node, args);
 			break;
 		case CIL_PERMISSIONX:
 			rc = cil_resolve_permissionx(node, (struct cil_permissionx*)node->data, args);
 			break;
 		case CIL_TYPE_RULE:
+			if (__cil_resolve_batch_take(args->batch, node)) {
+				break;
+			}
 			rc = cil_resolve_type_rule(node, args);
 			break;
 		case CIL_USERROLE:
@@ -4082,6 +4297,7 @@ int cil_resolve_ast(struct cil_db *db, struct cil_tree_node *current)
 {
 	int rc = SEPOL_ERR;
 	struct cil_args_resolve extra_args;
+	struct cil_resolve_batch batch;
 	enum cil_pass pass = CIL_PASS_TIF;
 	uint32_t changed = 0;
 
@@ -4105,6 +4321,7 @@ int cil_resolve_ast(struct cil_db *db, struct cil_tree_node *current)
 	extra_args.in_list_before = NULL;
 	extra_args.in_list_after = NULL;
 	extra_args.abstract_blocks = NULL;
+	extra_args.batch = NULL;
 
 	cil_list_init(&extra_args.to_destroy, CIL_NODE);
 	cil_list_init(&extra_args.sidorder_lists, CIL_LIST_ITEM);
@@ -4118,7 +4335,15 @@ int cil_resolve_ast(struct cil_db *db, struct cil_tree_node *current)
 
 	for (pass = CIL_PASS_TIF; pass < CIL_PASS_NUM; pass++) {
 		extra_args.pass = pass;
+		if (pass == CIL_PASS_MISC3) {
+			__cil_resolve_batch_init(&batch, current, &extra_args);
+			extra_args.batch = &batch;
+		}
 		rc = cil_tree_walk(current, __cil_resolve_ast_node_helper, __cil_resolve_ast_first_child_helper, __cil_resolve_ast_last_child_helper, &extra_args);
+		if (extra_args.batch) {
+			__cil_resolve_batch_destroy(&batch);
+			extra_args.batch = NULL;
+		}
 		if (rc != SEPOL_OK) {
 			cil_log(CIL_INFO, "Pass %i of resolution failed\n", pass);
 			goto exit;
@@ -1969,6 +1969,7 @@ CuSuite* CilTestFullCil(void) {
 	CuSuite* suite = CuSuiteNew();
 	SUITE_ADD_TEST(suite, test_min_policy);
 	SUITE_ADD_TEST(suite, test_integration);
+	SUITE_ADD_TEST(suite, test_resolve_batch);
 
 	return suite;
 }
@@ -28,9 +28,15 @@
  */
 
 #include <sepol/policydb/policydb.h>
+#include <sepol/policydb.h>
+#include <cil/cil.h>
 
 #include "CuTest.h"
 #include "test_integration.h"
+#include "../../src/cil_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
@@ -74,3 +80,54 @@ void test_min_policy(CuTest *tc) {
 	CuAssertIntEquals(tc, 1, WIFEXITED(status));
 	CuAssertIntEquals(tc, 0, WEXITSTATUS(status));
 }
+
+static int resolve_batch_image(const char *buffer, size_t size, unsigned threads, void **data, size_t *len) {
+	struct cil_db *db = NULL;
+	sepol_policydb_t *pdb = NULL;
+	int rc;
+
+	cil_db_init(&db);
+	db->resolve_threads = threads;
+
+	rc = cil_add_file(db, "resolve_batch.cil", buffer, size);
+	if (rc == SEPOL_OK)
+		rc = cil_compile(db);
+	if (rc == SEPOL_OK)
+		rc = cil_build_policydb(db, &pdb);
+	if (rc == SEPOL_OK)
+		rc = sepol_policydb_to_image(NULL, pdb, data, len);
+
+	sepol_policydb_free(pdb);
+	cil_db_destroy(&db);
+
+	return rc;
+}
+
+void test_resolve_batch(CuTest *tc) {
+	struct stat st;
+	char *buffer;
+	void *serial = NULL, *batched = NULL;
+	size_t serial_len = 0, batched_len = 0;
+	int fd, rc1, rc2;
+
+	fd = open("test/integration_testing/resolve_batch.cil", O_RDONLY);
+	CuAssertTrue(tc, fd >= 0);
+	CuAssertIntEquals(tc, 0, fstat(fd, &st));
+	buffer = malloc(st.st_size);
+	CuAssertPtrNotNull(tc, buffer);
+	CuAssertIntEquals(tc, st.st_size, read(fd, buffer, st.st_size));
+	close(fd);
+
+	/* One thread resolves everything in the tree walk, four batch */
+	rc1 = resolve_batch_image(buffer, st.st_size, 1, &serial, &serial_len);
+	rc2 = resolve_batch_image(buffer, st.st_size, 4, &batched, &batched_len);
+	free(buffer);
+
+	CuAssertIntEquals(tc, SEPOL_OK, rc1);
+	CuAssertIntEquals(tc, SEPOL_OK, rc2);
+	CuAssertTrue(tc, serial_len == batched_len);
+	CuAssertIntEquals(tc, 0, memcmp(serial, batched, serial_len));
+
+	free(serial);
+	free(batched);
+}
@@ -34,5 +34,6 @@
 
 void test_min_policy(CuTest *);
 void test_integration(CuTest *);
+void test_resolve_batch(CuTest *);
 
 #endif
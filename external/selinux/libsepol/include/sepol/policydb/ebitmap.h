@@ -74,11 +74,51 @@ static inline int ebitmap_node_get_bit(const ebitmap_node_t * n, unsigned int bi
 	return 0;
 }
 
+/*
+ * Return the first set bit at or after the node *n, leaving *n on the
+ * node that holds it, or ebitmap_length(e) when there is none.
+ */
+static inline unsigned int ebitmap_first_positive(const ebitmap_t * e,
+						  ebitmap_node_t ** n)
+{
+	for (; *n; *n = (*n)->next) {
+		if ((*n)->map)
+			return (*n)->startbit + __builtin_ctzll((*n)->map);
+	}
+
+	return ebitmap_length(e);
+}
+
+static inline unsigned int ebitmap_start_positive(const ebitmap_t * e,
+						  ebitmap_node_t ** n)
+{
+	*n = e->node;
+	return ebitmap_first_positive(e, n);
+}
+
+static inline unsigned int ebitmap_next_positive(const ebitmap_t * e,
+						 ebitmap_node_t ** n,
+						 unsigned int bit)
+{
+	unsigned int ofs = bit - (*n)->startbit + 1;
+	MAPTYPE map;
+
+	if (ofs < MAPSIZE) {
+		map = (*n)->map & ~((MAPBIT << ofs) - 1);
+		if (map)
+			return (*n)->startbit + __builtin_ctzll(map);
+	}
+
+	*n = (*n)->next;
+	return ebitmap_first_positive(e, n);
+}
+
 #define ebitmap_for_each_bit(e, n, bit) \
 	for (bit = ebitmap_start(e, &n); bit < ebitmap_length(e); bit = ebitmap_next(&n, bit)) \
 
+/* Visits only the set bits, skipping clear ones a word at a time. */
 #define ebitmap_for_each_positive_bit(e, n, bit) \
-	ebitmap_for_each_bit(e, n, bit) if (ebitmap_node_get_bit(n, bit)) \
+	for (bit = ebitmap_start_positive(e, &n); bit < ebitmap_length(e); bit = ebitmap_next_positive(e, &n, bit)) \
 
 extern int ebitmap_cmp(const ebitmap_t * e1, const ebitmap_t * e2);
 extern int ebitmap_or(ebitmap_t * dst, const ebitmap_t * e1, const ebitmap_t * e2);
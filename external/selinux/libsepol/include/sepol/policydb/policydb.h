@@ -696,6 +696,15 @@ extern void level_datum_destroy(level_datum_t * x);
 extern void cat_datum_init(cat_datum_t * x);
 extern void cat_datum_destroy(cat_datum_t * x);
 extern int check_assertion(policydb_t *p, avrule_t *avrule);
+/*
+ * Run check_assertion() for each of the nrules rules on up to max_threads
+ * threads (0: one per online CPU), storing its result for avrules[i] in
+ * results[i]. The policy is only read.
+ * Returns -1 if the checks could not be started, 0 otherwise.
+ */
+extern int check_assertion_list(policydb_t *p, avrule_t **avrules,
+				unsigned int nrules, int *results,
+				unsigned int max_threads);
 extern int check_assertions(sepol_handle_t * handle,
 			    policydb_t * p, avrule_t * avrules);
 
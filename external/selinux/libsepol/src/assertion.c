@@ -20,6 +20,9 @@
  *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <pthread.h>
+#include <unistd.h>
+
 #include <sepol/policydb/avtab.h>
 #include <sepol/policydb/policydb.h>
 #include <sepol/policydb/expand.h>
@@ -540,11 +543,267 @@ int check_assertion(policydb_t *p, avrule_t *avrule)
 	return rc;
 }
 
+/* Allowed avtab entries grouped by source type */
+struct avtab_source_index {
+	avtab_ptr_t *nodes;
+	/* entries with source type s are nodes[start[s]] .. nodes[start[s + 1] - 1] */
+	uint32_t *start;
+};
+
+/*
+ * Read-only lookup structures shared by all assertion checks of a policy,
+ * so that each neverallow only visits the avtab entries whose source type
+ * can match the rule.
+ */
+struct assertion_index {
+	struct avtab_source_index te;
+	struct avtab_source_index te_cond;
+	/* type value - 1 => source types (value - 1) whose attr_type_map has it */
+	ebitmap_t *source_map;
+	uint32_t nprim;
+};
+
+static int avtab_source_index_init(struct avtab_source_index *idx,
+				   avtab_t *avtab, uint32_t nprim)
+{
+	avtab_ptr_t cur;
+	uint32_t i, s, total;
+
+	idx->nodes = NULL;
+	idx->start = calloc(nprim + 2, sizeof(*idx->start));
+	if (!idx->start)
+		return -1;
+
+	if (!avtab->htable || !avtab->nel)
+		return 0;
+
+	idx->nodes = calloc(avtab->nel, sizeof(*idx->nodes));
+	if (!idx->nodes)
+		return -1;
+
+	for (i = 0; i < avtab->nslot; i++) {
+		for (cur = avtab->htable[i]; cur; cur = cur->next) {
+			s = cur->key.source_type;
+			if ((cur->key.specified & AVTAB_ALLOWED) && s && s <= nprim)
+				idx->start[s]++;
+		}
+	}
+
+	for (s = 1; s <= nprim; s++)
+		idx->start[s] += idx->start[s - 1];
+	total = idx->start[nprim];
+
+	/* Filling back to front leaves start[s] at the first entry of s */
+	for (i = 0; i < avtab->nslot; i++) {
+		for (cur = avtab->htable[i]; cur; cur = cur->next) {
+			s = cur->key.source_type;
+			if ((cur->key.specified & AVTAB_ALLOWED) && s && s <= nprim)
+				idx->nodes[--idx->start[s]] = cur;
+		}
+	}
+	idx->start[nprim + 1] = total;
+
+	return 0;
+}
+
+static void avtab_source_index_destroy(struct avtab_source_index *idx)
+{
+	free(idx->nodes);
+	free(idx->start);
+}
+
+static void assertion_index_destroy(struct assertion_index *idx)
+{
+	uint32_t i;
+
+	avtab_source_index_destroy(&idx->te);
+	avtab_source_index_destroy(&idx->te_cond);
+	if (idx->source_map) {
+		for (i = 0; i < idx->nprim; i++)
+			ebitmap_destroy(&idx->source_map[i]);
+		free(idx->source_map);
+	}
+}
+
+static int assertion_index_init(struct assertion_index *idx, policydb_t *p)
+{
+	ebitmap_node_t *tnode;
+	uint32_t i, j;
+
+	memset(idx, 0, sizeof(*idx));
+	idx->nprim = p->p_types.nprim;
+
+	if (avtab_source_index_init(&idx->te, &p->te_avtab, idx->nprim))
+		goto oom;
+	if (avtab_source_index_init(&idx->te_cond, &p->te_cond_avtab, idx->nprim))
+		goto oom;
+
+	idx->source_map = calloc(idx->nprim, sizeof(*idx->source_map));
+	if (!idx->source_map)
+		goto oom;
+
+	for (i = 0; i < idx->nprim; i++) {
+		ebitmap_for_each_positive_bit(&p->attr_type_map[i], tnode, j) {
+			if (j >= idx->nprim)
+				continue;
+			if (ebitmap_set_bit(&idx->source_map[j], i, 1))
+				goto oom;
+		}
+	}
+
+	return 0;
+
+oom:
+	assertion_index_destroy(idx);
+	return -1;
+}
+
+static int check_assertion_source_index(struct avtab_source_index *idx,
+					ebitmap_t *sources,
+					struct avtab_match_args *args)
+{
+	ebitmap_node_t *snode;
+	avtab_ptr_t cur;
+	unsigned int i;
+	uint32_t j;
+	int rc;
+
+	ebitmap_for_each_positive_bit(sources, snode, i) {
+		for (j = idx->start[i + 1]; j < idx->start[i + 2]; j++) {
+			cur = idx->nodes[j];
+			rc = check_assertion_avtab_match(&cur->key, &cur->datum, args);
+			if (rc)
+				return rc;
+		}
+	}
+
+	return 0;
+}
+
+/* Same as check_assertion(), but only visits candidates from the index */
+static int check_assertion_indexed(policydb_t *p, avrule_t *avrule,
+				   struct assertion_index *idx)
+{
+	struct avtab_match_args args;
+	ebitmap_t sources;
+	ebitmap_node_t *tnode;
+	unsigned int i;
+	int rc = 0;
+
+	ebitmap_init(&sources);
+	ebitmap_for_each_positive_bit(&avrule->stypes.types, tnode, i) {
+		if (i >= idx->nprim)
+			continue;
+		rc = ebitmap_union(&sources, &idx->source_map[i]);
+		if (rc < 0)
+			goto exit;
+	}
+
+	args.handle = NULL;
+	args.p = p;
+	args.avrule = avrule;
+	args.errors = 0;
+
+	args.avtab = &p->te_avtab;
+	rc = check_assertion_source_index(&idx->te, &sources, &args);
+	if (rc == 0) {
+		args.avtab = &p->te_cond_avtab;
+		rc = check_assertion_source_index(&idx->te_cond, &sources, &args);
+	}
+
+exit:
+	ebitmap_destroy(&sources);
+	return rc;
+}
+
+struct assertion_batch {
+	policydb_t *p;
+	avrule_t **avrules;
+	int *results;
+	unsigned int nrules;
+	struct assertion_index idx;
+	pthread_mutex_t lock;
+	unsigned int next;
+};
+
+static void *check_assertion_worker(void *arg)
+{
+	struct assertion_batch *b = arg;
+	unsigned int i;
+
+	for (;;) {
+		pthread_mutex_lock(&b->lock);
+		i = b->next++;
+		pthread_mutex_unlock(&b->lock);
+
+		if (i >= b->nrules)
+			break;
+
+		b->results[i] = check_assertion_indexed(b->p, b->avrules[i], &b->idx);
+	}
+
+	return NULL;
+}
+
+/* Upper bound of threads used by check_assertion_list() */
+#define ASSERTION_MAX_THREADS 32
+
+/* Do not start a thread for less than this many rules */
+#define ASSERTION_RULES_PER_THREAD 16
+
+int check_assertion_list(policydb_t *p, avrule_t **avrules,
+			 unsigned int nrules, int *results,
+			 unsigned int max_threads)
+{
+	struct assertion_batch b;
+	pthread_t threads[ASSERTION_MAX_THREADS];
+	unsigned int nthreads = 0, i;
+	long ncpus;
+
+	if (!nrules)
+		return 0;
+
+	if (assertion_index_init(&b.idx, p))
+		return -1;
+
+	b.p = p;
+	b.avrules = avrules;
+	b.results = results;
+	b.nrules = nrules;
+	b.next = 0;
+	pthread_mutex_init(&b.lock, NULL);
+
+	ncpus = max_threads ? (long)max_threads : sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus > ASSERTION_MAX_THREADS)
+		ncpus = ASSERTION_MAX_THREADS;
+
+	/* The calling thread works on the rules as well */
+	while (nthreads + 1 < ncpus &&
+	       (nthreads + 1) * ASSERTION_RULES_PER_THREAD < nrules) {
+		if (pthread_create(&threads[nthreads], NULL,
+				   check_assertion_worker, &b))
+			break;
+		nthreads++;
+	}
+
+	check_assertion_worker(&b);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&b.lock);
+	assertion_index_destroy(&b.idx);
+
+	return 0;
+}
+
 int check_assertions(sepol_handle_t * handle, policydb_t * p,
 		     avrule_t * avrules)
 {
-	int rc;
-	avrule_t *a;
+	int rc = 0;
+	avrule_t *a, **rules = NULL;
+	int *results = NULL;
+	unsigned int nrules = 0, i;
 	unsigned long errors = 0;
 
 	if (!avrules) {
@@ -555,25 +814,51 @@ int check_assertions(sepol_handle_t * handle, policydb_t * p,
 	}
 
 	for (a = avrules; a != NULL; a = a->next) {
-		if (!(a->specified & (AVRULE_NEVERALLOW | AVRULE_XPERMS_NEVERALLOW)))
-			continue;
-		rc = check_assertion(p, a);
-		if (rc < 0) {
-			ERR(handle, "Error occurred while checking neverallows");
-			return -1;
-		}
+		if (a->specified & (AVRULE_NEVERALLOW | AVRULE_XPERMS_NEVERALLOW))
+			nrules++;
+	}
+
+	if (!nrules)
+		return 0;
+
+	rules = calloc(nrules, sizeof(*rules));
+	results = calloc(nrules, sizeof(*results));
+	if (!rules || !results)
+		goto err;
+
+	i = 0;
+	for (a = avrules; a != NULL; a = a->next) {
+		if (a->specified & (AVRULE_NEVERALLOW | AVRULE_XPERMS_NEVERALLOW))
+			rules[i++] = a;
+	}
+
+	/* Check concurrently, then report in rule order */
+	if (check_assertion_list(p, rules, nrules, results, 0))
+		goto err;
+
+	for (i = 0; i < nrules; i++) {
+		rc = results[i];
+		if (rc < 0)
+			goto err;
 		if (rc) {
-			rc = report_assertion_failures(handle, p, a);
-			if (rc < 0) {
-				ERR(handle, "Error occurred while checking neverallows");
-				return -1;
-			}
+			rc = report_assertion_failures(handle, p, rules[i]);
+			if (rc < 0)
+				goto err;
 			errors += rc;
 		}
 	}
 
+	free(rules);
+	free(results);
+
 	if (errors)
 		ERR(handle, "%lu neverallow failures occurred", errors);
 
 	return errors ? -1 : 0;
+
+err:
+	ERR(handle, "Error occurred while checking neverallows");
+	free(rules);
+	free(results);
+	return -1;
 }
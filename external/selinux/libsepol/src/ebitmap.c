@@ -15,6 +15,41 @@
 #include "debug.h"
 #include "private.h"
 
+/*
+ * Append a node holding map at startbit to the end of dst, which is being
+ * built in ascending order; *prev tracks the current tail.  Empty maps are
+ * dropped so that the result stays in canonical form.
+ */
+static int ebitmap_append(ebitmap_t * dst, ebitmap_node_t ** prev,
+			  uint32_t startbit, MAPTYPE map)
+{
+	ebitmap_node_t *new;
+
+	if (!map)
+		return 0;
+
+	if ((uint32_t)(startbit + MAPSIZE) == 0) {
+		ERR(NULL, "bitmap overflow, bit 0x%x", startbit);
+		return -EINVAL;
+	}
+
+	new = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
+	if (!new)
+		return -ENOMEM;
+
+	new->startbit = startbit;
+	new->map = map;
+	new->next = NULL;
+	if (*prev)
+		(*prev)->next = new;
+	else
+		dst->node = new;
+	*prev = new;
+	dst->highbit = startbit + MAPSIZE;
+
+	return 0;
+}
+
 int ebitmap_or(ebitmap_t * dst, const ebitmap_t * e1, const ebitmap_t * e2)
 {
 	const ebitmap_node_t *n1, *n2;
@@ -61,70 +96,160 @@ int ebitmap_or(ebitmap_t * dst, const ebitmap_t * e1, const ebitmap_t * e2)
 
 int ebitmap_union(ebitmap_t * dst, const ebitmap_t * e1)
 {
-	ebitmap_t tmp;
+	ebitmap_node_t **link = &dst->node, *new;
+	const ebitmap_node_t *n1 = e1->node;
 
-	if (ebitmap_or(&tmp, dst, e1))
-		return -1;
-	ebitmap_destroy(dst);
-	dst->node = tmp.node;
-	dst->highbit = tmp.highbit;
+	/* Merge in place so that nodes already in dst are not copied. */
+	while (n1) {
+		if (*link && (*link)->startbit < n1->startbit) {
+			link = &(*link)->next;
+			continue;
+		}
+
+		if (*link && (*link)->startbit == n1->startbit) {
+			(*link)->map |= n1->map;
+		} else {
+			new = (ebitmap_node_t *) malloc(sizeof(ebitmap_node_t));
+			if (!new)
+				return -1;
+			new->startbit = n1->startbit;
+			new->map = n1->map;
+			new->next = *link;
+			*link = new;
+			if (!new->next)
+				dst->highbit = new->startbit + MAPSIZE;
+		}
+
+		link = &(*link)->next;
+		n1 = n1->next;
+	}
 
 	return 0;
 }
 
 int ebitmap_and(ebitmap_t *dst, const ebitmap_t *e1, const ebitmap_t *e2)
 {
-	unsigned int i, length = min(ebitmap_length(e1), ebitmap_length(e2));
+	const ebitmap_node_t *n1 = e1->node, *n2 = e2->node;
+	ebitmap_node_t *prev = NULL;
+	int rc;
+
 	ebitmap_init(dst);
-	for (i=0; i < length; i++) {
-		if (ebitmap_get_bit(e1, i) && ebitmap_get_bit(e2, i)) {
-			int rc = ebitmap_set_bit(dst, i, 1);
+	while (n1 && n2) {
+		if (n1->startbit < n2->startbit) {
+			n1 = n1->next;
+		} else if (n2->startbit < n1->startbit) {
+			n2 = n2->next;
+		} else {
+			rc = ebitmap_append(dst, &prev, n1->startbit,
+					    n1->map & n2->map);
 			if (rc < 0)
-				return rc;
+				goto err;
+			n1 = n1->next;
+			n2 = n2->next;
 		}
 	}
 	return 0;
+
+err:
+	ebitmap_destroy(dst);
+	return rc;
 }
 
 int ebitmap_xor(ebitmap_t *dst, const ebitmap_t *e1, const ebitmap_t *e2)
 {
-	unsigned int i, length = max(ebitmap_length(e1), ebitmap_length(e2));
+	const ebitmap_node_t *n1 = e1->node, *n2 = e2->node;
+	ebitmap_node_t *prev = NULL;
+	uint32_t startbit;
+	MAPTYPE map;
+	int rc;
+
 	ebitmap_init(dst);
-	for (i=0; i < length; i++) {
-		int val = ebitmap_get_bit(e1, i) ^ ebitmap_get_bit(e2, i);
-		int rc = ebitmap_set_bit(dst, i, val);
+	while (n1 || n2) {
+		if (n1 && n2 && n1->startbit == n2->startbit) {
+			startbit = n1->startbit;
+			map = n1->map ^ n2->map;
+			n1 = n1->next;
+			n2 = n2->next;
+		} else if (!n2 || (n1 && n1->startbit < n2->startbit)) {
+			startbit = n1->startbit;
+			map = n1->map;
+			n1 = n1->next;
+		} else {
+			startbit = n2->startbit;
+			map = n2->map;
+			n2 = n2->next;
+		}
+
+		rc = ebitmap_append(dst, &prev, startbit, map);
 		if (rc < 0)
-			return rc;
+			goto err;
 	}
 	return 0;
+
+err:
+	ebitmap_destroy(dst);
+	return rc;
+}
+
+/* The bits of the node starting at startbit that lie below maxbit. */
+static inline MAPTYPE ebitmap_mask_below(uint32_t startbit, unsigned int maxbit)
+{
+	if (maxbit - startbit >= MAPSIZE)
+		return ~(MAPTYPE)0;
+	return (MAPBIT << (maxbit - startbit)) - 1;
 }
 
 int ebitmap_not(ebitmap_t *dst, const ebitmap_t *e1, unsigned int maxbit)
 {
-	unsigned int i;
+	const ebitmap_node_t *n = e1->node;
+	ebitmap_node_t *prev = NULL;
+	uint64_t startbit;
+	MAPTYPE map;
+	int rc;
+
 	ebitmap_init(dst);
-	for (i=0; i < maxbit; i++) {
-		int val = ebitmap_get_bit(e1, i);
-		int rc = ebitmap_set_bit(dst, i, !val);
+	for (startbit = 0; startbit < maxbit; startbit += MAPSIZE) {
+		while (n && n->startbit < startbit)
+			n = n->next;
+		map = (n && n->startbit == startbit) ? ~n->map : ~(MAPTYPE)0;
+		map &= ebitmap_mask_below(startbit, maxbit);
+
+		rc = ebitmap_append(dst, &prev, startbit, map);
 		if (rc < 0)
-			return rc;
+			goto err;
 	}
 	return 0;
+
+err:
+	ebitmap_destroy(dst);
+	return rc;
 }
 
 int ebitmap_andnot(ebitmap_t *dst, const ebitmap_t *e1, const ebitmap_t *e2, unsigned int maxbit)
 {
+	const ebitmap_node_t *n1 = e1->node, *n2 = e2->node;
+	ebitmap_node_t *prev = NULL;
+	MAPTYPE map;
 	int rc;
-	ebitmap_t e3;
+
 	ebitmap_init(dst);
-	rc = ebitmap_not(&e3, e2, maxbit);
-	if (rc < 0)
-		return rc;
-	rc = ebitmap_and(dst, e1, &e3);
-	ebitmap_destroy(&e3);
-	if (rc < 0)
-		return rc;
+	for (; n1 && n1->startbit < maxbit; n1 = n1->next) {
+		while (n2 && n2->startbit < n1->startbit)
+			n2 = n2->next;
+		map = n1->map;
+		if (n2 && n2->startbit == n1->startbit)
+			map &= ~n2->map;
+		map &= ebitmap_mask_below(n1->startbit, maxbit);
+
+		rc = ebitmap_append(dst, &prev, n1->startbit, map);
+		if (rc < 0)
+			goto err;
+	}
 	return 0;
+
+err:
+	ebitmap_destroy(dst);
+	return rc;
 }
 
 unsigned int ebitmap_cardinality(const ebitmap_t *e1)
@@ -352,8 +477,6 @@ int ebitmap_set_bit(ebitmap_t * e, unsigned int bit, int value)
 unsigned int ebitmap_highest_set_bit(const ebitmap_t * e)
 {
 	const ebitmap_node_t *n;
-	MAPTYPE map;
-	unsigned int pos = 0;
 
 	n = e->node;
 	if (!n)
@@ -362,11 +485,10 @@ unsigned int ebitmap_highest_set_bit(const ebitmap_t * e)
 	while (n->next)
 		n = n->next;
 
-	map = n->map;
-	while (map >>= 1)
-		pos++;
+	if (!n->map)
+		return n->startbit;
 
-	return n->startbit + pos;
+	return n->startbit + (MAPSIZE - 1 - __builtin_clzll(n->map));
 }
 
 void ebitmap_destroy(ebitmap_t * e)
@@ -0,0 +1,171 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The set operations work a node at a time; check each of them against
+ * the same operation done bit by bit on plain arrays.
+ */
+
+#include "test-ebitmap.h"
+
+#include <sepol/policydb/ebitmap.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define NBITS 700
+#define ROUNDS 64
+
+static unsigned int seed;
+
+static unsigned int next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0x7fff;
+}
+
+/* Fill a and e with the same bits: a random run with some holes punched in it. */
+static void random_bits(char *a, ebitmap_t *e)
+{
+	unsigned int i, lo = next_rand() % NBITS, hi = next_rand() % NBITS;
+	unsigned int density = next_rand() % 101;
+
+	if (lo > hi) {
+		i = lo;
+		lo = hi;
+		hi = i;
+	}
+
+	memset(a, 0, NBITS);
+	ebitmap_init(e);
+	for (i = lo; i < hi; i++) {
+		if (next_rand() % 100 < density) {
+			a[i] = 1;
+			CU_ASSERT_FATAL(ebitmap_set_bit(e, i, 1) == 0);
+		}
+	}
+	for (i = lo; i < hi; i += 7) {
+		a[i] = 0;
+		CU_ASSERT_FATAL(ebitmap_set_bit(e, i, 0) == 0);
+	}
+}
+
+static void check_bits(const char *a, const ebitmap_t *e)
+{
+	ebitmap_t expected;
+	ebitmap_node_t *n;
+	unsigned int i, bit, count = 0;
+
+	ebitmap_init(&expected);
+	for (i = 0; i < NBITS; i++) {
+		if (a[i]) {
+			CU_ASSERT_FATAL(ebitmap_set_bit(&expected, i, 1) == 0);
+			count++;
+		}
+	}
+
+	CU_ASSERT(ebitmap_cmp(&expected, e));
+	CU_ASSERT(ebitmap_cardinality(e) == count);
+
+	/* no empty nodes may be left behind */
+	for (n = ebitmap_startnode(e); n; n = n->next)
+		CU_ASSERT(n->map != 0);
+
+	i = 0;
+	ebitmap_for_each_positive_bit(e, n, bit) {
+		CU_ASSERT(bit < NBITS && a[bit]);
+		CU_ASSERT(ebitmap_node_get_bit(n, bit));
+		i++;
+	}
+	CU_ASSERT(i == count);
+
+	ebitmap_destroy(&expected);
+}
+
+static void test_ebitmap_ops(void)
+{
+	char a[NBITS], b[NBITS], r[NBITS];
+	ebitmap_t e1, e2, res;
+	unsigned int i, round, maxbit, highest;
+
+	seed = 1;
+	for (round = 0; round < ROUNDS; round++) {
+		random_bits(a, &e1);
+		random_bits(b, &e2);
+		maxbit = next_rand() % NBITS;
+
+		CU_ASSERT_FATAL(ebitmap_and(&res, &e1, &e2) == 0);
+		for (i = 0; i < NBITS; i++)
+			r[i] = a[i] && b[i];
+		check_bits(r, &res);
+		ebitmap_destroy(&res);
+
+		CU_ASSERT_FATAL(ebitmap_xor(&res, &e1, &e2) == 0);
+		for (i = 0; i < NBITS; i++)
+			r[i] = a[i] != b[i];
+		check_bits(r, &res);
+		ebitmap_destroy(&res);
+
+		CU_ASSERT_FATAL(ebitmap_not(&res, &e1, maxbit) == 0);
+		for (i = 0; i < NBITS; i++)
+			r[i] = i < maxbit && !a[i];
+		check_bits(r, &res);
+		ebitmap_destroy(&res);
+
+		CU_ASSERT_FATAL(ebitmap_andnot(&res, &e1, &e2, maxbit) == 0);
+		for (i = 0; i < NBITS; i++)
+			r[i] = i < maxbit && a[i] && !b[i];
+		check_bits(r, &res);
+		ebitmap_destroy(&res);
+
+		CU_ASSERT_FATAL(ebitmap_cpy(&res, &e1) == 0);
+		CU_ASSERT_FATAL(ebitmap_union(&res, &e2) == 0);
+		for (i = 0; i < NBITS; i++)
+			r[i] = a[i] || b[i];
+		check_bits(r, &res);
+		CU_ASSERT_FATAL(ebitmap_union(&res, &res) == 0);
+		check_bits(r, &res);
+		ebitmap_destroy(&res);
+
+		highest = 0;
+		for (i = 0; i < NBITS; i++) {
+			if (a[i])
+				highest = i;
+		}
+		CU_ASSERT(ebitmap_highest_set_bit(&e1) == highest);
+
+		ebitmap_destroy(&e1);
+		ebitmap_destroy(&e2);
+	}
+}
+
+int ebitmap_test_init(void)
+{
+	return 0;
+}
+
+int ebitmap_test_cleanup(void)
+{
+	return 0;
+}
+
+int ebitmap_add_tests(CU_pSuite suite)
+{
+	if (NULL == CU_add_test(suite, "ebitmap_ops", test_ebitmap_ops)) {
+		return CU_get_error();
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "test-neverallow.h"
+#include "helpers.h"
+
+#include <sepol/policydb/policydb.h>
+#include <sepol/policydb/link.h>
+#include <sepol/policydb/expand.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+extern int mls;
+
+/* Neverallow rules in policies/test-neverallow/policy.conf */
+#define NEVERALLOW_RULES	8
+#define NEVERALLOW_VIOLATED	4
+
+/*
+ * Each rule is checked this many times in one batch, so that the batch is
+ * large enough for check_assertion_list() to start all its threads.
+ */
+#define NEVERALLOW_REPEAT	16
+
+static policydb_t basemod;
+static policydb_t base_expanded;
+
+int neverallow_test_init(void)
+{
+	if (policydb_init(&base_expanded)) {
+		fprintf(stderr, "out of memory!\n");
+		return -1;
+	}
+
+	if (test_load_policy(&basemod, POLICY_BASE, mls, "test-neverallow", "policy.conf"))
+		goto cleanup;
+
+	if (link_modules(NULL, &basemod, NULL, 0, 0)) {
+		fprintf(stderr, "link modules failed\n");
+		goto cleanup;
+	}
+
+	/* No checks here, the policy violates some of its own neverallows */
+	if (expand_module(NULL, &basemod, &base_expanded, 0, 0)) {
+		fprintf(stderr, "expand module failed\n");
+		goto cleanup;
+	}
+
+	return 0;
+
+      cleanup:
+	policydb_destroy(&basemod);
+	policydb_destroy(&base_expanded);
+	return -1;
+}
+
+int neverallow_test_cleanup(void)
+{
+	policydb_destroy(&basemod);
+	policydb_destroy(&base_expanded);
+
+	return 0;
+}
+
+static void test_neverallow_threads(void)
+{
+	avrule_t *a, *rules[NEVERALLOW_RULES * NEVERALLOW_REPEAT];
+	int serial[NEVERALLOW_RULES];
+	int results[NEVERALLOW_RULES * NEVERALLOW_REPEAT];
+	unsigned int threads[] = { 1, 4 };
+	unsigned int nrules = 0, violated = 0, i, t;
+
+	for (a = base_expanded.global->branch_list->avrules; a; a = a->next) {
+		if (!(a->specified & AVRULE_NEVERALLOW))
+			continue;
+		CU_ASSERT_FATAL(nrules < NEVERALLOW_RULES);
+		serial[nrules] = check_assertion(&base_expanded, a);
+		CU_ASSERT(serial[nrules] == 0 || serial[nrules] == 1);
+		if (serial[nrules] == 1)
+			violated++;
+		rules[nrules++] = a;
+	}
+	CU_ASSERT_FATAL(nrules == NEVERALLOW_RULES);
+	CU_ASSERT(violated == NEVERALLOW_VIOLATED);
+
+	for (i = NEVERALLOW_RULES; i < NEVERALLOW_RULES * NEVERALLOW_REPEAT; i++)
+		rules[i] = rules[i % NEVERALLOW_RULES];
+
+	for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+		memset(results, -1, sizeof(results));
+		CU_ASSERT_FATAL(check_assertion_list(&base_expanded, rules,
+						     NEVERALLOW_RULES * NEVERALLOW_REPEAT,
+						     results, threads[t]) == 0);
+		for (i = 0; i < NEVERALLOW_RULES * NEVERALLOW_REPEAT; i++)
+			CU_ASSERT(results[i] == serial[i % NEVERALLOW_RULES]);
+	}
+
+	/* The public entry point reports the same violations */
+	CU_ASSERT(check_assertions(NULL, &base_expanded,
+				   base_expanded.global->branch_list->avrules) == -1);
+}
+
+int neverallow_add_tests(CU_pSuite suite)
+{
+	if (NULL == CU_add_test(suite, "neverallow_threads", test_neverallow_threads)) {
+		return CU_get_error();
+	}
+	return 0;
+}
@@ -57,9 +57,17 @@ class Adler32 implements Checksum {
      * @param b the byte to update the checksum with
      */
     public void update(int b) {
-        adler = update(adler, b);
+        // BEGIN Android-changed: Update a single byte without a JNI call.
+        // adler = update(adler, b);
+        int s1 = ((adler & 0xffff) + (b & 0xff)) % ADLER_BASE;
+        int s2 = ((adler >>> 16) + s1) % ADLER_BASE;
+        adler = (s2 << 16) | s1;
+        // END Android-changed: Update a single byte without a JNI call.
     }
 
+    // Android-added: Modulus of Adler-32, the largest prime below 65536.
+    private static final int ADLER_BASE = 65521;
+
     /**
      * Updates the checksum with the specified array of bytes.
      *
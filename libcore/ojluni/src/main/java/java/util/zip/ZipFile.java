@@ -44,6 +44,7 @@ import java.util.NoSuchElementException;
 import java.util.Spliterator;
 import java.util.Spliterators;
 import java.util.WeakHashMap;
+import java.util.concurrent.locks.ReentrantReadWriteLock;
 import java.util.stream.Stream;
 import java.util.stream.StreamSupport;
 
@@ -72,15 +73,20 @@ class ZipFile implements ZipConstants, Closeable {
     // and would cause serious problems if the method had taken a copy of that field and
     // then called a native method that would try to use it.
     //
-    // This field does not require the annotation because all usages of this field are enclosed
-    // within a synchronized(this) block and finalizing of the object referenced in a synchronized
-    // block is not allowed as that would release its monitor that is currently in use.
+    // This field does not require the annotation because all usages of this field hold the read
+    // lock of closeLock, and close(), which the finalizer calls, has to take the write lock before
+    // it releases the native data.
     private long jzfile;  // address of jzfile data
     private final String name;     // zip file name
     private final int total;       // total number of entries
     private final boolean locsig;  // if zip file starts with LOCSIG (usually true)
     private volatile boolean closeRequested = false;
 
+    // Android-changed: Guard the native data with a read/write lock instead of this monitor.
+    // The native lookups and reads do not modify the jzfile, so they only need to exclude close(),
+    // and threads reading entries of the same file do not contend.
+    private final ReentrantReadWriteLock closeLock = new ReentrantReadWriteLock();
+
     // Android-added: CloseGuard support.
     private final CloseGuard guard = CloseGuard.get();
 
@@ -332,12 +338,15 @@ class ZipFile implements ZipConstants, Closeable {
      * Since 1.7
      */
     public String getComment() {
-        synchronized (this) {
+        closeLock.readLock().lock();
+        try {
             ensureOpen();
             byte[] bcomm = getCommentBytes(jzfile);
             if (bcomm == null)
                 return null;
             return zc.toString(bcomm, bcomm.length);
+        } finally {
+            closeLock.readLock().unlock();
         }
     }
 
@@ -354,7 +363,8 @@ class ZipFile implements ZipConstants, Closeable {
             throw new NullPointerException("name");
         }
         long jzentry = 0;
-        synchronized (this) {
+        closeLock.readLock().lock();
+        try {
             ensureOpen();
             jzentry = getEntry(jzfile, zc.getBytes(name), true);
             if (jzentry != 0) {
@@ -362,6 +372,8 @@ class ZipFile implements ZipConstants, Closeable {
                 freeEntry(jzfile, jzentry);
                 return ze;
             }
+        } finally {
+            closeLock.readLock().unlock();
         }
         return null;
     }
@@ -396,7 +408,8 @@ class ZipFile implements ZipConstants, Closeable {
         }
         long jzentry = 0;
         ZipFileInputStream in = null;
-        synchronized (this) {
+        closeLock.readLock().lock();
+        try {
             ensureOpen();
             if (!zc.isUTF8() && (entry.flag & USE_UTF8) != 0) {
                 // Android-changed: Find entry by name, falling back to name/ if cannot be found.
@@ -440,6 +453,8 @@ class ZipFile implements ZipConstants, Closeable {
             default:
                 throw new ZipException("invalid compression method");
             }
+        } finally {
+            closeLock.readLock().unlock();
         }
     }
 
@@ -549,9 +564,12 @@ class ZipFile implements ZipConstants, Closeable {
         }
 
         public boolean hasNext() {
-            synchronized (ZipFile.this) {
+            closeLock.readLock().lock();
+            try {
                 ensureOpen();
                 return i < total;
+            } finally {
+                closeLock.readLock().unlock();
             }
         }
 
@@ -560,7 +578,8 @@ class ZipFile implements ZipConstants, Closeable {
         }
 
         public ZipEntry next() {
-            synchronized (ZipFile.this) {
+            closeLock.readLock().lock();
+            try {
                 ensureOpen();
                 if (i >= total) {
                     throw new NoSuchElementException();
@@ -584,6 +603,8 @@ class ZipFile implements ZipConstants, Closeable {
                 ZipEntry ze = getZipEntry(null, jzentry);
                 freeEntry(jzfile, jzentry);
                 return ze;
+            } finally {
+                closeLock.readLock().unlock();
             }
         }
     }
@@ -674,7 +695,14 @@ class ZipFile implements ZipConstants, Closeable {
         }
         closeRequested = true;
 
-        synchronized (this) {
+        // BEGIN Android-added: null field check to avoid NullPointerException during finalize.
+        if (closeLock == null) {
+            return;
+        }
+        // END Android-added: null field check to avoid NullPointerException during finalize.
+        // Android-changed: Wait for lookups and reads in progress, see closeLock.
+        closeLock.writeLock().lock();
+        try {
             // Close streams, release their inflaters
             // BEGIN Android-added: null field check to avoid NullPointerException during finalize.
             // If the constructor threw an exception then the streams / inflaterCache fields can
@@ -721,6 +749,8 @@ class ZipFile implements ZipConstants, Closeable {
             if (fileToRemoveOnClose != null) {
                 fileToRemoveOnClose.delete();
             }
+        } finally {
+            closeLock.writeLock().unlock();
         }
     }
 
@@ -791,28 +821,38 @@ class ZipFile implements ZipConstants, Closeable {
             // https://bugs.openjdk.java.net/browse/JDK-8142508.
             ensureOpenOrZipException();
 
-            synchronized (ZipFile.this) {
-                long rem = this.rem;
-                long pos = this.pos;
-                if (rem == 0) {
-                    return -1;
-                }
-                if (len <= 0) {
-                    return 0;
-                }
-                if (len > rem) {
-                    len = (int) rem;
-                }
+            // Android-changed: Hold the read lock rather than the ZipFile monitor, so that other
+            // streams read concurrently. Only this stream's position needs the stream's monitor,
+            // which is always taken after the lock, as close() does.
+            closeLock.readLock().lock();
+            try {
+                // Android-added: close() may have completed since the check above.
+                ensureOpenOrZipException();
+                synchronized (this) {
+                    long rem = this.rem;
+                    long pos = this.pos;
+                    if (rem == 0) {
+                        return -1;
+                    }
+                    if (len <= 0) {
+                        return 0;
+                    }
+                    if (len > rem) {
+                        len = (int) rem;
+                    }
 
-                // Android-removed: Always throw an exception when reading from closed zipfile.
-                // Moved to the start of the method.
-                //ensureOpenOrZipException();
-                len = ZipFile.read(ZipFile.this.jzfile, jzentry, pos, b,
-                                   off, len);
-                if (len > 0) {
-                    this.pos = (pos + len);
-                    this.rem = (rem - len);
+                    // Android-removed: Always throw an exception when reading from closed zipfile.
+                    // Moved to the start of the method.
+                    //ensureOpenOrZipException();
+                    len = ZipFile.read(ZipFile.this.jzfile, jzentry, pos, b,
+                                       off, len);
+                    if (len > 0) {
+                        this.pos = (pos + len);
+                        this.rem = (rem - len);
+                    }
                 }
+            } finally {
+                closeLock.readLock().unlock();
             }
             if (rem == 0) {
                 close();
@@ -854,11 +894,16 @@ class ZipFile implements ZipConstants, Closeable {
             zfisCloseRequested = true;
 
             rem = 0;
-            synchronized (ZipFile.this) {
-                if (jzentry != 0 && ZipFile.this.jzfile != 0) {
-                    freeEntry(ZipFile.this.jzfile, jzentry);
-                    jzentry = 0;
+            closeLock.readLock().lock();
+            try {
+                synchronized (this) {
+                    if (jzentry != 0 && ZipFile.this.jzfile != 0) {
+                        freeEntry(ZipFile.this.jzfile, jzentry);
+                        jzentry = 0;
+                    }
                 }
+            } finally {
+                closeLock.readLock().unlock();
             }
             synchronized (streams) {
                 streams.remove(this);
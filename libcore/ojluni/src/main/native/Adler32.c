@@ -32,6 +32,7 @@
 #include "jni_util.h"
 #include "jlong.h"
 #include <zlib.h>
+#include "zip_checksum.h"
 
 
 
@@ -44,7 +45,7 @@ Java_java_util_zip_Adler32_update(JNIEnv *env, jclass cls, jint adler, jint b)
     Bytef buf[1];
 
     buf[0] = (Bytef)b;
-    return adler32(adler, buf, 1);
+    return zipAdler32(adler, buf, 1);
 }
 
 JNIEXPORT jint JNICALL
@@ -53,7 +54,7 @@ Java_java_util_zip_Adler32_updateBytes(JNIEnv *env, jclass cls, jint adler,
 {
     Bytef *buf = (*env)->GetPrimitiveArrayCritical(env, b, 0);
     if (buf) {
-        adler = adler32(adler, buf + off, len);
+        adler = zipAdler32(adler, buf + off, len);
         (*env)->ReleasePrimitiveArrayCritical(env, b, buf, 0);
     }
     return adler;
@@ -65,7 +66,7 @@ Java_java_util_zip_Adler32_updateByteBuffer(JNIEnv *env, jclass cls, jint adler,
 {
     Bytef *buf = (Bytef *)jlong_to_ptr(address);
     if (buf) {
-        adler = adler32(adler, buf + off, len);
+        adler = zipAdler32(adler, buf + off, len);
     }
     return adler;
 }
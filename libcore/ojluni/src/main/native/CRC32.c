@@ -31,6 +31,7 @@
 #include "jni.h"
 #include "jni_util.h"
 #include <zlib.h>
+#include "zip_checksum.h"
 
 
 #define NATIVE_METHOD(className, functionName, signature) \
@@ -42,7 +43,7 @@ CRC32_update(JNIEnv *env, jclass cls, jint crc, jint b)
     Bytef buf[1];
 
     buf[0] = (Bytef)b;
-    return crc32(crc, buf, 1);
+    return zipCrc32(crc, buf, 1);
 }
 
 JNIEXPORT jint JNICALL
@@ -51,7 +52,7 @@ CRC32_updateBytes(JNIEnv *env, jclass cls, jint crc,
 {
     Bytef *buf = (*env)->GetPrimitiveArrayCritical(env, b, 0);
     if (buf) {
-        crc = crc32(crc, buf + off, len);
+        crc = zipCrc32(crc, buf + off, len);
         (*env)->ReleasePrimitiveArrayCritical(env, b, buf, 0);
     }
     return crc;
@@ -60,7 +61,7 @@ CRC32_updateBytes(JNIEnv *env, jclass cls, jint crc,
 JNIEXPORT jint JNICALL
 ZIP_CRC32(jint crc, const jbyte *buf, jint len)
 {
-    return crc32(crc, (Bytef*)buf, len);
+    return zipCrc32(crc, (Bytef*)buf, len);
 }
 
 JNIEXPORT jint JNICALL
@@ -69,7 +70,7 @@ CRC32_updateByteBuffer(JNIEnv *env, jclass cls, jint crc,
 {
     Bytef *buf = (Bytef *)jlong_to_ptr(address);
     if (buf) {
-        crc = crc32(crc, buf + off, len);
+        crc = zipCrc32(crc, buf + off, len);
     }
     return crc;
 }
@@ -57,6 +57,7 @@ SocketInputStream_socketRead0(JNIEnv *env, jobject this,
 {
     char BUF[MAX_BUFFER_LEN];
     char *bufP;
+    jbyte *pinned = NULL;
     jint fd, nread;
 
     if (IS_NULL(fdObj)) {
@@ -77,16 +78,22 @@ SocketInputStream_socketRead0(JNIEnv *env, jobject this,
 
     /*
      * If the read is greater than our stack allocated buffer then
-     * we allocate from the heap (up to a limit)
+     * we read straight into the array if the runtime lets us, or
+     * else use the thread's pooled buffer (up to a limit)
      */
     if (len > MAX_BUFFER_LEN) {
-        if (len > MAX_HEAP_BUFFER_LEN) {
-            len = MAX_HEAP_BUFFER_LEN;
-        }
-        bufP = (char *)malloc((size_t)len);
-        if (bufP == NULL) {
-            bufP = BUF;
-            len = MAX_BUFFER_LEN;
+        // Android-changed: Avoid a malloc and a copy per bulk read.
+        if ((pinned = JNU_GetPinnedByteArray(env, data, len)) != NULL) {
+            bufP = (char *)pinned + off;
+        } else {
+            if (len > MAX_HEAP_BUFFER_LEN) {
+                len = MAX_HEAP_BUFFER_LEN;
+            }
+            bufP = JNU_GetIOBuffer(len);
+            if (bufP == NULL) {
+                bufP = BUF;
+                len = MAX_BUFFER_LEN;
+            }
         }
     } else {
         bufP = BUF;
@@ -109,8 +116,10 @@ SocketInputStream_socketRead0(JNIEnv *env, jobject this,
                 JNU_ThrowByName(env, JNU_JAVAIOPKG "InterruptedIOException",
                             "Operation interrupted");
             }
-            if (bufP != BUF) {
-                free(bufP);
+            if (pinned != NULL) {
+                JNU_ReleasePinnedByteArray(env, data, pinned);
+            } else if (bufP != BUF) {
+                JNU_ReleaseIOBuffer(bufP);
             }
             return -1;
         }
@@ -143,12 +152,14 @@ SocketInputStream_socketRead0(JNIEnv *env, jobject this,
                         JNU_JAVANETPKG "SocketException", "Read failed");
             }
         }
-    } else {
+    } else if (pinned == NULL) {
         (*env)->SetByteArrayRegion(env, data, off, nread, (jbyte *)bufP);
     }
 
-    if (bufP != BUF) {
-        free(bufP);
+    if (pinned != NULL) {
+        JNU_ReleasePinnedByteArray(env, data, pinned);
+    } else if (bufP != BUF) {
+        JNU_ReleaseIOBuffer(bufP);
     }
     return nread;
 }
@@ -58,6 +58,7 @@ SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
                                               jint off, jint len) {
     char *bufP;
     char BUF[MAX_BUFFER_LEN];
+    jbyte *pinned = NULL;
     int buflen;
     int fd;
 
@@ -79,9 +80,14 @@ SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
     if (len <= MAX_BUFFER_LEN) {
         bufP = BUF;
         buflen = MAX_BUFFER_LEN;
+    } else if ((pinned = JNU_GetPinnedByteArray(env, data, len)) != NULL) {
+        // Android-changed: Send straight from the array if the runtime lets us.
+        bufP = (char *)pinned + off;
+        buflen = len;
     } else {
+        // Android-changed: Use the thread's pooled buffer instead of malloc.
         buflen = min(MAX_HEAP_BUFFER_LEN, len);
-        bufP = (char *)malloc((size_t)buflen);
+        bufP = JNU_GetIOBuffer(buflen);
 
         /* if heap exhausted resort to stack buffer */
         if (bufP == NULL) {
@@ -94,7 +100,9 @@ SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
         int loff = 0;
         int chunkLen = min(buflen, len);
         int llen = chunkLen;
-        (*env)->GetByteArrayRegion(env, data, off, chunkLen, (jbyte *)bufP);
+        if (pinned == NULL) {
+            (*env)->GetByteArrayRegion(env, data, off, chunkLen, (jbyte *)bufP);
+        }
 
         while(llen > 0) {
             int n = NET_Send(fd, bufP + loff, llen, 0);
@@ -114,8 +122,10 @@ SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
                         "Write failed");
                 }
             }
-            if (bufP != BUF) {
-                free(bufP);
+            if (pinned != NULL) {
+                JNU_ReleasePinnedByteArray(env, data, pinned);
+            } else if (bufP != BUF) {
+                JNU_ReleaseIOBuffer(bufP);
             }
             return;
         }
@@ -123,8 +133,10 @@ SocketOutputStream_socketWrite0(JNIEnv *env, jobject this,
         off += chunkLen;
     }
 
-    if (bufP != BUF) {
-        free(bufP);
+    if (pinned != NULL) {
+        JNU_ReleasePinnedByteArray(env, data, pinned);
+    } else if (bufP != BUF) {
+        JNU_ReleaseIOBuffer(bufP);
     }
 }
 
@@ -30,6 +30,21 @@
 #include <unistd.h>
 #include <errno.h>
 
+// BEGIN Android-added: Copy in the kernel where possible.
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+
+#ifdef __ANDROID__
+#include <android/api-level.h>
+#endif
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+// END Android-added: Copy in the kernel where possible.
+
 #include "sun_nio_fs_UnixCopyFile.h"
 
 #define RESTARTABLE(_cmd, _result) do { \
@@ -38,6 +53,18 @@
   } while((_result == -1) && (errno == EINTR)); \
 } while(0)
 
+/*
+ * Number of bytes copied between checks for cancellation. Each
+ * copy_file_range or sendfile call moves at most this much.
+ */
+#define TRANSFER_CHUNK (8 * 1024 * 1024)
+
+/*
+ * Buffer size of the user-space copy loop. The buffer is freed after
+ * the copy, not pooled, so that threads do not keep it.
+ */
+#define TRANSFER_BUFFER_SIZE (1024 * 1024)
+
 static void throwUnixException(JNIEnv* env, int errnum) {
     jobject x = JNU_NewObjectByName(env, "sun/nio/fs/UnixException",
         "(I)V", errnum);
@@ -46,27 +73,166 @@ static void throwUnixException(JNIEnv* env, int errnum) {
     }
 }
 
+static int cancelled(volatile jint* cancel) {
+    return cancel != NULL && *cancel != 0;
+}
+
+/*
+ * Returns true if a kernel copy failed with an error that means it is
+ * not supported for this pair of files, so the next method should be
+ * tried. The file offsets are where the last successful call left them.
+ */
+static int unsupported(int errnum) {
+    switch (errnum) {
+        case ENOSYS:
+        case EXDEV:
+        case EINVAL:
+        case EOPNOTSUPP:
+#if EOPNOTSUPP != ENOTSUP
+        case ENOTSUP:
+#endif
+        case ENOTTY:
+        case EBADF:
+        case EPERM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * copy_file_range(2) is only in the app seccomp allowlist from API 30
+ * on. Before that the filter kills the caller with SIGSYS rather than
+ * failing with ENOSYS, so the call cannot be used as its own probe.
+ */
+#define COPY_FILE_RANGE_MIN_API 30
+
+static int copyFileRangeAllowed(void) {
+#ifdef __ANDROID__
+    static int allowed = -1;
+    if (allowed < 0) {
+        allowed = android_get_device_api_level() >= COPY_FILE_RANGE_MIN_API;
+    }
+    return allowed;
+#else
+    return 1;
+#endif
+}
+
+/*
+ * Copies with copy_file_range(2), which lets the filesystem share
+ * extents or copy on the server. Returns 0 when done, 1 if the
+ * remaining bytes must be copied another way, or -1 with an exception
+ * thrown.
+ */
+static int copyFileRange(JNIEnv* env, int dst, int src, volatile jint* cancel) {
+#ifdef __NR_copy_file_range
+    jlong copied = 0;
+    if (!copyFileRangeAllowed()) {
+        return 1;
+    }
+    for (;;) {
+        ssize_t n;
+        RESTARTABLE(syscall(__NR_copy_file_range, src, NULL, dst, NULL,
+                            (size_t)TRANSFER_CHUNK, 0), n);
+        if (n == 0) {
+            /* Some pseudo files report EOF here even though they have
+             * data, so let read(2) have the final word on an empty copy */
+            return copied == 0 ? 1 : 0;
+        }
+        if (n < 0) {
+            if (unsupported(errno))
+                return 1;
+            throwUnixException(env, errno);
+            return -1;
+        }
+        copied += n;
+        if (cancelled(cancel)) {
+            throwUnixException(env, ECANCELED);
+            return -1;
+        }
+    }
+#else
+    return 1;
+#endif
+}
+
+/*
+ * Copies with sendfile(2), which moves the data through the page cache
+ * without a round trip through user space. Same results as
+ * copyFileRange.
+ */
+static int sendFile(JNIEnv* env, int dst, int src, volatile jint* cancel) {
+    jlong copied = 0;
+    for (;;) {
+        ssize_t n;
+        RESTARTABLE(sendfile(dst, src, NULL, (size_t)TRANSFER_CHUNK), n);
+        if (n == 0) {
+            return copied == 0 ? 1 : 0;
+        }
+        if (n < 0) {
+            if (unsupported(errno) || errno == EAGAIN)
+                return 1;
+            throwUnixException(env, errno);
+            return -1;
+        }
+        copied += n;
+        if (cancelled(cancel)) {
+            throwUnixException(env, ECANCELED);
+            return -1;
+        }
+    }
+}
+
 /**
- * Transfer all bytes from src to dst via user-space buffers
+ * Transfer all bytes from src to dst. The target is cloned if the
+ * filesystem supports reflinks. Otherwise the bytes are copied in the
+ * kernel with copy_file_range or sendfile, falling back to user-space
+ * buffers when neither works for these files.
  */
 JNIEXPORT void JNICALL
 Java_sun_nio_fs_UnixCopyFile_transfer
     (JNIEnv* env, jclass this, jint dst, jint src, jlong cancelAddress)
 {
-    char buf[8192];
+    char stackBuf[8192];
+    char* buf;
+    size_t bufsize;
     volatile jint* cancel = (jint*)jlong_to_ptr(cancelAddress);
+    int rv;
+
+    // BEGIN Android-added: Copy in the kernel where possible.
+    /* The target was just created, so it can take over the source's
+     * extents as a whole (btrfs, xfs, f2fs with compression, ...) */
+    if (ioctl((int)dst, FICLONE, (int)src) == 0) {
+        return;
+    }
+    if ((rv = copyFileRange(env, (int)dst, (int)src, cancel)) <= 0) {
+        return;
+    }
+    if ((rv = sendFile(env, (int)dst, (int)src, cancel)) <= 0) {
+        return;
+    }
+
+    buf = malloc(TRANSFER_BUFFER_SIZE);
+    if (buf != NULL) {
+        bufsize = TRANSFER_BUFFER_SIZE;
+    } else {
+        buf = stackBuf;
+        bufsize = sizeof(stackBuf);
+    }
+    // END Android-added: Copy in the kernel where possible.
 
     for (;;) {
         ssize_t n, pos, len;
-        RESTARTABLE(read((int)src, &buf, sizeof(buf)), n);
+        RESTARTABLE(read((int)src, buf, bufsize), n);
         if (n <= 0) {
             if (n < 0)
                 throwUnixException(env, errno);
-            return;
+            break;
         }
-        if (cancel != NULL && *cancel != 0) {
+        if (cancelled(cancel)) {
             throwUnixException(env, ECANCELED);
-            return;
+            break;
         }
         pos = 0;
         len = n;
@@ -76,10 +242,15 @@ Java_sun_nio_fs_UnixCopyFile_transfer
             RESTARTABLE(write((int)dst, bufp, len), n);
             if (n == -1) {
                 throwUnixException(env, errno);
-                return;
+                goto done;
             }
             pos += n;
             len -= n;
         } while (len > 0);
     }
+
+ done:
+    if (buf != stackBuf) {
+        free(buf);
+    }
 }
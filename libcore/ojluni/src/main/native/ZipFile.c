@@ -318,10 +318,8 @@ ZipFile_read(JNIEnv *env, jclass cls, jlong zfile,
     }
 
     jbyte *buf = (*env)->GetByteArrayElements(env, bytes, NULL);
-    ZIP_Lock(zip);
-    len = ZIP_Read(zip, jlong_to_ptr(zentry), pos, buf + off, len);
-    msg = zip->msg;
-    ZIP_Unlock(zip);
+    // Android-changed: Read with pread without taking the zip file lock.
+    len = ZIP_Read2(zip, jlong_to_ptr(zentry), pos, buf + off, len, &msg);
     (*env)->ReleaseByteArrayElements(env, bytes, buf, 0);
 
     if (len == -1) {
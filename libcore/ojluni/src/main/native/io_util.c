@@ -80,6 +80,7 @@ readBytes(JNIEnv *env, jobject this, jbyteArray bytes,
     jint nread;
     char stackBuf[BUF_SIZE];
     char *buf = NULL;
+    jbyte *pinned = NULL;
     FD fd;
 
     if (IS_NULL(bytes)) {
@@ -95,8 +96,10 @@ readBytes(JNIEnv *env, jobject this, jbyteArray bytes,
     if (len == 0) {
         return 0;
     } else if (len > BUF_SIZE) {
-        buf = malloc(len);
-        if (buf == NULL) {
+        // Android-changed: Read straight into the array or use a pooled buffer.
+        if ((pinned = JNU_GetPinnedByteArray(env, bytes, len)) != NULL) {
+            buf = (char *)pinned + off;
+        } else if ((buf = JNU_GetIOBuffer(len)) == NULL) {
             JNU_ThrowOutOfMemoryError(env, NULL);
             return 0;
         }
@@ -111,7 +114,9 @@ readBytes(JNIEnv *env, jobject this, jbyteArray bytes,
     } else {
         nread = (jint)IO_Read(fd, buf, len);
         if (nread > 0) {
-            (*env)->SetByteArrayRegion(env, bytes, off, nread, (jbyte *)buf);
+            if (pinned == NULL) {
+                (*env)->SetByteArrayRegion(env, bytes, off, nread, (jbyte *)buf);
+            }
         } else if (nread == JVM_IO_ERR) {
             JNU_ThrowIOExceptionWithLastError(env, "Read error");
         } else if (nread == JVM_IO_INTR) {
@@ -121,8 +126,10 @@ readBytes(JNIEnv *env, jobject this, jbyteArray bytes,
         }
     }
 
-    if (buf != stackBuf) {
-        free(buf);
+    if (pinned != NULL) {
+        JNU_ReleasePinnedByteArray(env, bytes, pinned);
+    } else if (buf != stackBuf) {
+        JNU_ReleaseIOBuffer(buf);
     }
     return nread;
 }
@@ -156,6 +163,7 @@ writeBytes(JNIEnv *env, jobject this, jbyteArray bytes,
     jint n;
     char stackBuf[BUF_SIZE];
     char *buf = NULL;
+    jbyte *pinned = NULL;
     FD fd;
 
     if (IS_NULL(bytes)) {
@@ -171,8 +179,10 @@ writeBytes(JNIEnv *env, jobject this, jbyteArray bytes,
     if (len == 0) {
         return;
     } else if (len > BUF_SIZE) {
-        buf = malloc(len);
-        if (buf == NULL) {
+        // Android-changed: Write straight from the array or use a pooled buffer.
+        if ((pinned = JNU_GetPinnedByteArray(env, bytes, len)) != NULL) {
+            buf = (char *)pinned + off;
+        } else if ((buf = JNU_GetIOBuffer(len)) == NULL) {
             JNU_ThrowOutOfMemoryError(env, NULL);
             return;
         }
@@ -180,7 +190,9 @@ writeBytes(JNIEnv *env, jobject this, jbyteArray bytes,
         buf = stackBuf;
     }
 
-    (*env)->GetByteArrayRegion(env, bytes, off, len, (jbyte *)buf);
+    if (pinned == NULL) {
+        (*env)->GetByteArrayRegion(env, bytes, off, len, (jbyte *)buf);
+    }
 
     if (!(*env)->ExceptionOccurred(env)) {
         off = 0;
@@ -206,8 +218,10 @@ writeBytes(JNIEnv *env, jobject this, jbyteArray bytes,
             len -= n;
         }
     }
-    if (buf != stackBuf) {
-        free(buf);
+    if (pinned != NULL) {
+        JNU_ReleasePinnedByteArray(env, bytes, pinned);
+    } else if (buf != stackBuf) {
+        JNU_ReleaseIOBuffer(buf);
     }
 }
 
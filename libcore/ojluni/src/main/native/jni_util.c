@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 
 #include "jvm.h"
 #include "jni.h"
@@ -1029,6 +1030,106 @@ JNU_NotifyAll(JNIEnv *env, jobject object)
 }
 
 
+// BEGIN Android-added: Pooled and pinned buffers for bulk array I/O.
+/************************************************************************
+ * Bulk I/O buffers
+ */
+
+/*
+ * Header of a buffer handed out by JNU_GetIOBuffer(). The data follows it.
+ */
+typedef struct {
+    size_t capacity;
+} iobuf;
+
+#define IOBUF_DATA(b)   ((char *)((b) + 1))
+#define IOBUF_HEADER(p) ((iobuf *)(p) - 1)
+
+static pthread_key_t ioBufferKey;
+static pthread_once_t ioBufferOnce = PTHREAD_ONCE_INIT;
+static int ioBufferKeyValid = 0;
+
+static void
+initIOBufferKey(void)
+{
+    ioBufferKeyValid = (pthread_key_create(&ioBufferKey, free) == 0);
+}
+
+JNIEXPORT char * JNICALL
+JNU_GetIOBuffer(jint len)
+{
+    iobuf *b = NULL;
+    size_t capacity;
+
+    if (len > JNU_IO_BUFFER_POOL_MAX) {
+        /* Freed on release, so it leaves the pooled buffer alone */
+        capacity = len;
+    } else {
+        pthread_once(&ioBufferOnce, initIOBufferKey);
+        if (ioBufferKeyValid) {
+            b = pthread_getspecific(ioBufferKey);
+            if (b != NULL) {
+                /* The buffer belongs to the caller until it is released */
+                pthread_setspecific(ioBufferKey, NULL);
+                if (b->capacity >= (size_t)len) {
+                    return IOBUF_DATA(b);
+                }
+                free(b);
+            }
+        }
+
+        /* Grow in powers of two so that a stream of similar sizes settles */
+        for (capacity = JNU_IO_BUFFER_MIN; capacity < (size_t)len; capacity <<= 1)
+            ;
+    }
+    b = malloc(sizeof(iobuf) + capacity);
+    if (b == NULL) {
+        return NULL;
+    }
+    b->capacity = capacity;
+    return IOBUF_DATA(b);
+}
+
+JNIEXPORT void JNICALL
+JNU_ReleaseIOBuffer(char *buf)
+{
+    iobuf *b = IOBUF_HEADER(buf);
+
+    if (b->capacity > JNU_IO_BUFFER_POOL_MAX || !ioBufferKeyValid ||
+        pthread_getspecific(ioBufferKey) != NULL ||
+        pthread_setspecific(ioBufferKey, b) != 0) {
+        free(b);
+    }
+}
+
+JNIEXPORT jbyte * JNICALL
+JNU_GetPinnedByteArray(JNIEnv *env, jbyteArray array, jint len)
+{
+    jboolean isCopy;
+    jbyte *elems;
+
+    if (len < JNU_PIN_MIN) {
+        return NULL;
+    }
+    elems = (*env)->GetByteArrayElements(env, array, &isCopy);
+    if (elems == NULL) {
+        /* Failed to allocate a copy: the caller falls back to a buffer */
+        (*env)->ExceptionClear(env);
+    } else if (isCopy) {
+        (*env)->ReleaseByteArrayElements(env, array, elems, JNI_ABORT);
+        elems = NULL;
+    }
+    return elems;
+}
+
+JNIEXPORT void JNICALL
+JNU_ReleasePinnedByteArray(JNIEnv *env, jbyteArray array, jbyte *elems)
+{
+    /* The elements are the array itself, so there is nothing to copy back */
+    (*env)->ReleaseByteArrayElements(env, array, elems, JNI_ABORT);
+}
+// END Android-added: Pooled and pinned buffers for bulk array I/O.
+
 /************************************************************************
  * Debugging utilities
  */
@@ -298,6 +298,42 @@ JNU_NotifyAll(JNIEnv *env, jobject object);
     } while (0)                                 \
 
 
+// BEGIN Android-added: Pooled and pinned buffers for bulk array I/O.
+/************************************************************************
+ * Bulk I/O buffers
+ *
+ * JNU_GetIOBuffer returns a native buffer of at least len bytes that is
+ * owned by the calling thread until it is passed to JNU_ReleaseIOBuffer,
+ * or NULL if out of memory. Buffers up to JNU_IO_BUFFER_POOL_MAX bytes
+ * are kept for reuse by the next call on the same thread, which saves
+ * a malloc and free per bulk read or write. Larger buffers are freed on
+ * release, so a thread never holds more than that cap between calls.
+ *
+ * JNU_GetPinnedByteArray returns the elements of array when the runtime
+ * hands out the array itself rather than a copy, which ART does for
+ * arrays in the non-moving large object space, so that data can be read
+ * or written in place. It returns NULL, with no exception pending, for
+ * arrays shorter than JNU_PIN_MIN bytes or when the runtime would copy.
+ * Release the elements with JNU_ReleasePinnedByteArray.
+ */
+
+#define JNU_IO_BUFFER_MIN 16384
+#define JNU_IO_BUFFER_POOL_MAX 65536
+#define JNU_PIN_MIN 65536
+
+JNIEXPORT char * JNICALL
+JNU_GetIOBuffer(jint len);
+
+JNIEXPORT void JNICALL
+JNU_ReleaseIOBuffer(char *buf);
+
+JNIEXPORT jbyte * JNICALL
+JNU_GetPinnedByteArray(JNIEnv *env, jbyteArray array, jint len);
+
+JNIEXPORT void JNICALL
+JNU_ReleasePinnedByteArray(JNIEnv *env, jbyteArray array, jbyte *elems);
+// END Android-added: Pooled and pinned buffers for bulk array I/O.
+
 /************************************************************************
  * Debugging utilities
  */
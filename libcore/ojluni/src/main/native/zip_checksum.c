@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  The Android Open Source
+ * Project designates this particular file as subject to the "Classpath"
+ * exception as provided by The Android Open Source Project in the LICENSE
+ * file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * CRC-32 and Adler-32 kernels for java.util.zip.
+ */
+
+#include <limits.h>
+#include <zlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZIP_CHECKSUM_X86 1
+#endif
+
+#include "zip_checksum.h"
+
+/* Shortest input worth handing to a vector kernel */
+#define MIN_SIMD_LEN 64
+
+/* Largest length zlib takes in one call */
+#define MAX_ZLIB_LEN ((size_t)UINT_MAX & ~(size_t)0xffff)
+
+static uint32_t
+crc32Zlib(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    while (len > MAX_ZLIB_LEN) {
+        crc = (uint32_t)crc32(crc, buf, (uInt)MAX_ZLIB_LEN);
+        buf += MAX_ZLIB_LEN;
+        len -= MAX_ZLIB_LEN;
+    }
+    return (uint32_t)crc32(crc, buf, (uInt)len);
+}
+
+static uint32_t
+adler32Zlib(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    while (len > MAX_ZLIB_LEN) {
+        adler = (uint32_t)adler32(adler, buf, (uInt)MAX_ZLIB_LEN);
+        buf += MAX_ZLIB_LEN;
+        len -= MAX_ZLIB_LEN;
+    }
+    return (uint32_t)adler32(adler, buf, (uInt)len);
+}
+
+#ifdef ZIP_CHECKSUM_X86
+
+/*
+ * CRC-32 by carry-less multiplication, after Gopal et al., "Fast CRC
+ * Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ * Four 128-bit lanes are folded forward 512 bits at a time, folded
+ * together, and Barrett-reduced to 32 bits. len must be at least 64
+ * and a multiple of 16. crc is the raw (not inverted) register.
+ */
+__attribute__((target("sse4.1,pclmul")))
+static uint32_t
+crc32Fold(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    static const uint64_t k1k2[2] = { 0x0154442bd4, 0x01c6e41596 };
+    static const uint64_t k3k4[2] = { 0x01751997d0, 0x00ccaa009e };
+    static const uint64_t k5k0[2] = { 0x0163cd6124, 0x0000000000 };
+    static const uint64_t poly[2] = { 0x01db710641, 0x01f7011641 };
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    x0 = _mm_loadu_si128((const __m128i *)k1k2);
+    buf += 64;
+    len -= 64;
+
+    /* Fold 512 bits at a time */
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        len -= 64;
+    }
+
+    /* Fold the four lanes into one */
+    x0 = _mm_loadu_si128((const __m128i *)k3k4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* Fold the remaining 128-bit blocks */
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64 */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_loadu_si128((const __m128i *)poly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t
+crc32Pclmul(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    if (len >= MIN_SIMD_LEN) {
+        size_t n = len & ~(size_t)15;
+        crc = ~crc32Fold(~crc, buf, n);
+        buf += n;
+        len -= n;
+    }
+    return crc32Zlib(crc, buf, len);
+}
+
+/* Blocks of 32 bytes that can be summed before s2 may overflow 32 bits */
+#define ADLER_BASE 65521
+#define ADLER_NMAX_BLOCKS (5552 / 32)
+
+__attribute__((target("avx2")))
+static uint32_t
+adler32Avx2(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    uint32_t s1 = adler & 0xffff;
+    uint32_t s2 = adler >> 16;
+    size_t blocks = len / 32;
+    const __m256i taps = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                          24, 23, 22, 21, 20, 19, 18, 17,
+                                          16, 15, 14, 13, 12, 11, 10, 9,
+                                          8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i zero = _mm256_setzero_si256();
+
+    if (len < MIN_SIMD_LEN) {
+        return adler32Zlib(adler, buf, len);
+    }
+
+    len -= blocks * 32;
+    while (blocks > 0) {
+        size_t n = blocks < ADLER_NMAX_BLOCKS ? blocks : ADLER_NMAX_BLOCKS;
+        __m256i vs1 = zero;
+        __m256i vs2 = zero;
+        /* Sum of s1 before each block; times 32 gives its share of s2 */
+        __m256i vps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        __m128i t;
+        blocks -= n;
+
+        do {
+            __m256i bytes = _mm256_loadu_si256((const __m256i *)buf);
+            vps = _mm256_add_epi32(vps, vs1);
+            vs1 = _mm256_add_epi32(vs1, _mm256_sad_epu8(bytes, zero));
+            vs2 = _mm256_add_epi32(vs2, _mm256_madd_epi16(
+                    _mm256_maddubs_epi16(bytes, taps), ones));
+            buf += 32;
+        } while (--n);
+
+        vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(vps, 5));
+
+        t = _mm_add_epi32(_mm256_castsi256_si128(vs1),
+                          _mm256_extracti128_si256(vs1, 1));
+        t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 += (uint32_t)_mm_cvtsi128_si32(t);
+        t = _mm_add_epi32(_mm256_castsi256_si128(vs2),
+                          _mm256_extracti128_si256(vs2, 1));
+        t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(1, 0, 3, 2)));
+        t = _mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1)));
+        s2 += (uint32_t)_mm_cvtsi128_si32(t);
+
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+    return adler32Zlib((s2 << 16) | s1, buf, len);
+}
+
+#endif /* ZIP_CHECKSUM_X86 */
+
+/*
+ * The kernel is picked on first use. Racing threads pick the same one,
+ * so relaxed atomic accesses to the pointers are enough.
+ */
+static uint32_t crc32Resolve(uint32_t crc, const unsigned char *buf, size_t len);
+static uint32_t adler32Resolve(uint32_t adler, const unsigned char *buf, size_t len);
+
+static uint32_t (*crc32Impl)(uint32_t, const unsigned char *, size_t) = crc32Resolve;
+static uint32_t (*adler32Impl)(uint32_t, const unsigned char *, size_t) = adler32Resolve;
+
+static uint32_t
+crc32Resolve(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    uint32_t (*impl)(uint32_t, const unsigned char *, size_t) = crc32Zlib;
+#ifdef ZIP_CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+        impl = crc32Pclmul;
+#endif
+    __atomic_store_n(&crc32Impl, impl, __ATOMIC_RELAXED);
+    return impl(crc, buf, len);
+}
+
+static uint32_t
+adler32Resolve(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    uint32_t (*impl)(uint32_t, const unsigned char *, size_t) = adler32Zlib;
+#ifdef ZIP_CHECKSUM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        impl = adler32Avx2;
+#endif
+    __atomic_store_n(&adler32Impl, impl, __ATOMIC_RELAXED);
+    return impl(adler, buf, len);
+}
+
+uint32_t
+zipCrc32(uint32_t crc, const unsigned char *buf, size_t len)
+{
+    return __atomic_load_n(&crc32Impl, __ATOMIC_RELAXED)(crc, buf, len);
+}
+
+uint32_t
+zipAdler32(uint32_t adler, const unsigned char *buf, size_t len)
+{
+    return __atomic_load_n(&adler32Impl, __ATOMIC_RELAXED)(adler, buf, len);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * This code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 only, as
+ * published by the Free Software Foundation.  The Android Open Source
+ * Project designates this particular file as subject to the "Classpath"
+ * exception as provided by The Android Open Source Project in the LICENSE
+ * file that accompanied this code.
+ *
+ * This code is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * version 2 for more details (a copy is included in the LICENSE file that
+ * accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License version
+ * 2 along with this work; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef _ZIP_CHECKSUM_H_
+#define _ZIP_CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * CRC-32 and Adler-32 checksums, with the same values as zlib's crc32()
+ * and adler32(). Vector kernels are used when the CPU has them (PCLMULQDQ
+ * for CRC-32, AVX2 for Adler-32), and zlib otherwise.
+ */
+
+uint32_t zipCrc32(uint32_t crc, const unsigned char *buf, size_t len);
+uint32_t zipAdler32(uint32_t adler, const unsigned char *buf, size_t len);
+
+#endif /* !_ZIP_CHECKSUM_H_ */
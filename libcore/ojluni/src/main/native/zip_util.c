@@ -54,10 +54,7 @@
 #define mmap64 mmap
 #endif
 
-/* USE_MMAP means mmap the CEN & ENDHDR part of the zip file. */
-#ifdef USE_MMAP
 #include <sys/mman.h>
-#endif
 
 #define MAXREFS 0xFFFF  /* max number of open zip file references */
 
@@ -248,14 +245,11 @@ freeZip(jzfile *zip)
     free(zip->name);
     freeCEN(zip);
 
-#ifdef USE_MMAP
     if (zip->usemmap) {
         if (zip->maddr != NULL)
             munmap((char *)zip->maddr, zip->mlen);
-    } else
-#endif
-    {
-        free(zip->cencache.data);
+    } else {
+        free(zip->maddr);
     }
     if (zip->comment != NULL)
         free(zip->comment);
@@ -430,6 +424,52 @@ hash_append(unsigned int hash, char c)
     return ((int)hash)*31 + c;
 }
 
+/*
+ * Returns the first table slot to probe for a name hash. The high bits
+ * are folded in because the table length is a power of two.
+ */
+static jint
+hashSlot(jzfile *zip, unsigned int hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    return (jint)(hash & (unsigned int)(zip->tablelen - 1));
+}
+
+/*
+ * Returns the CEN header of the given hash cell.
+ */
+static unsigned char *
+cellCEN(jzfile *zip, const jzcell *zc)
+{
+    return zip->maddr + (zc->cenpos - zip->offset);
+}
+
+/*
+ * Returns the index into zip->entries of the entry called name, or
+ * ZIP_ENDCHAIN if there is none. The CEN is never modified after
+ * readCEN(), so no lock is needed.
+ */
+static jint
+findCell(jzfile *zip, const char *name, jint ulen, unsigned int hsh)
+{
+    jint mask = zip->tablelen - 1;
+    jint slot = hashSlot(zip, hsh);
+    jint idx;
+
+    while ((idx = zip->table[slot]) != ZIP_ENDCHAIN) {
+        const jzcell *zc = &zip->entries[idx];
+        if (zc->hash == hsh) {
+            const unsigned char *cen = cellCEN(zip, zc);
+            if (CENNAM(cen) == ulen && memcmp(cen + CENHDR, name, ulen) == 0)
+                return idx;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return ZIP_ENDCHAIN;
+}
+
 /*
  * Returns true if the specified entry's name begins with the string
  * "META-INF/".
@@ -554,10 +594,8 @@ readCEN(jzfile *zip, jint knownTotal)
     unsigned char *cenbuf = NULL;
     unsigned char *cenend;
     unsigned char *cp;
-#ifdef USE_MMAP
     static jlong pagesize;
     jlong offset;
-#endif
     unsigned char endbuf[ENDHDR];
     jint endhdrlen = ENDHDR;
     jzcell *entries;
@@ -600,7 +638,6 @@ readCEN(jzfile *zip, jint knownTotal)
         ZIP_FORMAT_ERROR("invalid END header (bad central directory offset)");
     }
 
-#ifdef USE_MMAP
     if (zip->usemmap) {
       /* On Solaris & Linux prior to JDK 6, we used to mmap the whole jar file to
        * read the jar file contents. However, this greatly increased the perceived
@@ -640,12 +677,17 @@ readCEN(jzfile *zip, jint knownTotal)
             }
         }
         cenbuf = zip->maddr + cenpos - offset;
-    } else
-#endif
-    {
-        if ((cenbuf = malloc((size_t) cenlen)) == NULL ||
-            (readFullyAt(zip->zfd, cenbuf, cenlen, cenpos) == -1))
-        goto Catch;
+    } else {
+        /* Keep a private copy of the CEN for the lifetime of the zip file
+         * so that entries are always built straight from memory. */
+        if (knownTotal == -1) {
+            zip->mlen = cenlen;
+            zip->offset = cenpos;
+            if ((zip->maddr = malloc((size_t) cenlen)) == NULL ||
+                (readFullyAt(zip->zfd, zip->maddr, cenlen, cenpos) == -1))
+                goto Catch;
+        }
+        cenbuf = zip->maddr;
     }
 
     cenend = cenbuf + cenlen;
@@ -662,8 +704,14 @@ readCEN(jzfile *zip, jint knownTotal)
      * the Zip64 enabled.
      */
     total = (knownTotal != -1) ? knownTotal : total;
+    if (total > (1 << 29)) {
+        ZIP_FORMAT_ERROR("invalid END header (too many entries)");
+    }
+    /* Keep the table at most half full so that probe sequences stay short */
+    for (tablelen = 4; tablelen < 2 * total; tablelen <<= 1)
+        ;
     entries  = zip->entries  = calloc(total, sizeof(entries[0]));
-    tablelen = zip->tablelen = ((total/2) | 1); // Odd -> fewer collisions
+    zip->tablelen = tablelen;
     table    = zip->table    = malloc(tablelen * sizeof(table[0]));
     /* According to ISO C it is perfectly legal for malloc to return zero
      * if called with a zero argument. We check this for 'entries' but not
@@ -676,7 +724,6 @@ readCEN(jzfile *zip, jint knownTotal)
     for (i = 0, cp = cenbuf; cp <= cenend - CENHDR; i++, cp += CENSIZE(cp)) {
         /* Following are unsigned 16-bit */
         jint method, nlen;
-        unsigned int hsh;
 
         if (i >= total) {
             /* This will only happen if the zip file has an incorrect
@@ -717,31 +764,17 @@ readCEN(jzfile *zip, jint knownTotal)
         /* Record the CEN offset and the name hash in our hash cell. */
         entries[i].cenpos = cenpos + (cp - cenbuf);
         entries[i].hash = hashN(entryName, nlen);
-        entries[i].next = ZIP_ENDCHAIN;
-
-        /* Add the entry to the hash table */
-        hsh = entries[i].hash % tablelen;
-
-        /* First check that there are no other entries that have the same name. */
-        int chain = table[hsh];
-        while (chain != ZIP_ENDCHAIN) {
-            const jzcell* cell = &entries[chain];
-            if (cell->hash == entries[i].hash) {
-                const char* cenStart = (const char *) cenbuf + cell->cenpos - cenpos;
-                if (CENNAM(cenStart) == nlen) {
-                    const char* chainName = cenStart + CENHDR;
-                    if (strncmp(entryName, chainName, nlen) == 0) {
-                        ZIP_FORMAT_ERROR("invalid CEN header (duplicate entry)");
-                    }
-                }
-            }
 
-            chain = cell->next;
+        /* Add the entry to the hash table, checking that there are no
+         * other entries that have the same name. */
+        if (findCell(zip, entryName, nlen, entries[i].hash) != ZIP_ENDCHAIN) {
+            ZIP_FORMAT_ERROR("invalid CEN header (duplicate entry)");
         }
-
-
-        entries[i].next = table[hsh];
-        table[hsh] = i;
+        for (j = hashSlot(zip, entries[i].hash);
+             table[j] != ZIP_ENDCHAIN;
+             j = (j + 1) & (tablelen - 1))
+            ;
+        table[j] = i;
     }
     if (cp != cenend) {
         ZIP_FORMAT_ERROR("invalid CEN header (bad header size)");
@@ -755,11 +788,6 @@ readCEN(jzfile *zip, jint knownTotal)
     cenpos = -1;
 
  Finally:
-#ifdef USE_MMAP
-    if (!zip->usemmap)
-#endif
-        free(cenbuf);
-
     return cenpos;
 }
 
@@ -881,9 +909,7 @@ ZIP_Put_In_Cache0(const char *name, ZFILE zfd, char **pmsg, jlong lastModified,
         return NULL;
     }
 
-#ifdef USE_MMAP
     zip->usemmap = usemmap;
-#endif
     zip->refs = 1;
     zip->lastModified = lastModified;
 
@@ -985,67 +1011,16 @@ ZIP_Close(jzfile *zip)
     return;
 }
 
-/* Empirically, most CEN headers are smaller than this. */
-#define AMPLE_CEN_HEADER_SIZE 160
-
-/* A good buffer size when we want to read CEN headers sequentially. */
-#define CENCACHE_PAGESIZE 8192
-
-static char *
-readCENHeader(jzfile *zip, jlong cenpos, jint bufsize)
-{
-    jint censize;
-    ZFILE zfd = zip->zfd;
-    char *cen;
-    if (bufsize > zip->len - cenpos)
-        bufsize = (jint)(zip->len - cenpos);
-    if ((cen = malloc(bufsize)) == NULL)       goto Catch;
-    if (readFullyAt(zfd, cen, bufsize, cenpos) == -1)     goto Catch;
-    censize = CENSIZE(cen);
-    if (censize <= bufsize) return cen;
-    if ((cen = realloc(cen, censize)) == NULL)              goto Catch;
-    if (readFullyAt(zfd, cen+bufsize, censize-bufsize, cenpos + bufsize) == -1) goto Catch;
-    return cen;
-
- Catch:
-    free(cen);
-    return NULL;
-}
-
-static char *
-sequentialAccessReadCENHeader(jzfile *zip, jlong cenpos)
-{
-    cencache *cache = &zip->cencache;
-    char *cen;
-    if (cache->data != NULL
-        && (cenpos >= cache->pos)
-        && (cenpos + CENHDR <= cache->pos + CENCACHE_PAGESIZE))
-    {
-        cen = cache->data + cenpos - cache->pos;
-        if (cenpos + CENSIZE(cen) <= cache->pos + CENCACHE_PAGESIZE)
-            /* A cache hit */
-            return cen;
-    }
-
-    if ((cen = readCENHeader(zip, cenpos, CENCACHE_PAGESIZE)) == NULL)
-        return NULL;
-    free(cache->data);
-    cache->data = cen;
-    cache->pos  = cenpos;
-    return cen;
-}
-
-typedef enum { ACCESS_RANDOM, ACCESS_SEQUENTIAL } AccessHint;
-
 /*
  * Return a new initialized jzentry corresponding to a given hash cell.
  * In case of error, returns NULL.
  * We already sanity-checked all the CEN headers for ZIP format errors
  * in readCEN(), so we don't check them again here.
- * The ZIP lock should be held here.
+ * The CEN is held in memory and never modified after readCEN(), so the
+ * ZIP lock does not need to be held here.
  */
 static jzentry *
-newEntry(jzfile *zip, jzcell *zc, AccessHint accessHint)
+newEntry(jzfile *zip, jzcell *zc)
 {
     jlong locoff;
     jint nlen, elen, clen;
@@ -1057,18 +1032,7 @@ newEntry(jzfile *zip, jzcell *zc, AccessHint accessHint)
     ze->extra   = NULL;
     ze->comment = NULL;
 
-#ifdef USE_MMAP
-    if (zip->usemmap) {
-        cen = (char*) zip->maddr + zc->cenpos - zip->offset;
-    } else
-#endif
-    {
-        if (accessHint == ACCESS_RANDOM)
-            cen = readCENHeader(zip, zc->cenpos, AMPLE_CEN_HEADER_SIZE);
-        else
-            cen = sequentialAccessReadCENHeader(zip, zc->cenpos);
-        if (cen == NULL) goto Catch;
-    }
+    cen = (char *) cellCEN(zip, zc);
 
     nlen      = CENNAM(cen);
     elen      = CENEXT(cen);
@@ -1145,33 +1109,32 @@ newEntry(jzfile *zip, jzcell *zc, AccessHint accessHint)
     ze = NULL;
 
  Finally:
-#ifdef USE_MMAP
-    if (!zip->usemmap)
-#endif
-        if (cen != NULL && accessHint == ACCESS_RANDOM) free(cen);
     return ze;
 }
 
+static void
+freeEntry(jzentry *ze)
+{
+    free(ze->name);
+    if (ze->extra)   free(ze->extra);
+    if (ze->comment) free(ze->comment);
+    free(ze);
+}
+
 /*
  * Free the given jzentry.
  * In fact we maintain a one-entry cache of the most recently used
  * jzentry for each zip.  This optimizes a common access pattern.
+ * The cache slot is swapped atomically rather than under the ZIP lock.
  */
 
 void
 ZIP_FreeEntry(jzfile *jz, jzentry *ze)
 {
-    jzentry *last;
-    ZIP_Lock(jz);
-    last = jz->cache;
-    jz->cache = ze;
-    ZIP_Unlock(jz);
+    jzentry *last = __atomic_exchange_n(&jz->cache, ze, __ATOMIC_ACQ_REL);
     if (last != NULL) {
         /* Free the previously cached jzentry */
-        free(last->name);
-        if (last->extra)   free(last->extra);
-        if (last->comment) free(last->comment);
-        free(last);
+        freeEntry(last);
     }
 }
 
@@ -1200,6 +1163,27 @@ jboolean equals(char* name1, int len1, char* name2, int len2) {
     return JNI_TRUE;
 }
 
+/*
+ * Takes the cached jzentry out of the cache if it is called name.
+ * Returns NULL otherwise.
+ */
+static jzentry *
+takeCachedEntry(jzfile *zip, char *name, jint ulen)
+{
+    jzentry *ze = __atomic_exchange_n(&zip->cache, NULL, __ATOMIC_ACQ_REL);
+    jzentry *empty = NULL;
+
+    if (ze == NULL || equals(ze->name, ze->nlen, name, ulen)) {
+        return ze;
+    }
+    /* Not ours: put it back, unless another entry was freed meanwhile */
+    if (!__atomic_compare_exchange_n(&zip->cache, &empty, ze, JNI_FALSE,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        freeEntry(ze);
+    }
+    return NULL;
+}
+
 /*
  * Returns the zip entry corresponding to the specified name, or
  * NULL if not found.
@@ -1213,13 +1197,10 @@ ZIP_GetEntry2(jzfile *zip, char *name, jint ulen, jboolean addSlash)
     jint idx;
     jzentry *ze = 0;
 
-    ZIP_Lock(zip);
     if (zip->total == 0) {
-        goto Finally;
+        return 0;
     }
 
-    idx = zip->table[hsh % zip->tablelen];
-
     /*
      * This while loop is an optimization where a double lookup
      * for name and name+/ is being performed. The name char
@@ -1229,50 +1210,20 @@ ZIP_GetEntry2(jzfile *zip, char *name, jint ulen, jboolean addSlash)
     while(1) {
 
         /* Check the cached entry first */
-        ze = zip->cache;
-        if (ze && equals(ze->name, ze->nlen, name, ulen)) {
-            /* Cache hit!  Remove and return the cached entry. */
-            zip->cache = 0;
-            ZIP_Unlock(zip);
+        ze = takeCachedEntry(zip, name, ulen);
+        if (ze != 0) {
+            /* Cache hit!  Return the cached entry. */
             return ze;
         }
-        ze = 0;
 
         /*
-         * Search down the target hash chain for a cell whose
-         * 32 bit hash matches the hashed name.
+         * The table and the CEN are read-only after readCEN(), so
+         * names are compared against the CEN in place and a jzentry
+         * is only built for the match.
          */
-        while (idx != ZIP_ENDCHAIN) {
-            jzcell *zc = &zip->entries[idx];
-
-            if (zc->hash == hsh) {
-                /*
-                 * OK, we've found a ZIP entry whose 32 bit hashcode
-                 * matches the name we're looking for.  Try to read
-                 * its entry information from the CEN.  If the CEN
-                 * name matches the name we're looking for, we're
-                 * done.
-                 * If the names don't match (which should be very rare)
-                 * we keep searching.
-                 */
-                ze = newEntry(zip, zc, ACCESS_RANDOM);
-                if (ze && equals(ze->name, ze->nlen, name, ulen)) {
-                    break;
-                }
-                if (ze != 0) {
-                    /* We need to release the lock across the free call */
-                    ZIP_Unlock(zip);
-                    ZIP_FreeEntry(zip, ze);
-                    ZIP_Lock(zip);
-                }
-                ze = 0;
-            }
-            idx = zc->next;
-        }
-
-        /* Entry found, return it */
-        if (ze != 0) {
-            break;
+        idx = findCell(zip, name, ulen, hsh);
+        if (idx != ZIP_ENDCHAIN) {
+            return newEntry(zip, &zip->entries[idx]);
         }
 
         /* If no need to try appending slash, we are done */
@@ -1289,13 +1240,10 @@ ZIP_GetEntry2(jzfile *zip, char *name, jint ulen, jboolean addSlash)
         name[ulen++] = '/';
         name[ulen] = '\0';
         hsh = hash_append(hsh, '/');
-        idx = zip->table[hsh % zip->tablelen];
         addSlash = JNI_FALSE;
     }
 
-Finally:
-    ZIP_Unlock(zip);
-    return ze;
+    return 0;
 }
 
 /*
@@ -1309,9 +1257,7 @@ ZIP_GetNextEntry(jzfile *zip, jint n)
     if (n < 0 || n >= zip->total) {
         return 0;
     }
-    ZIP_Lock(zip);
-    result = newEntry(zip, &zip->entries[n], ACCESS_SEQUENTIAL);
-    ZIP_Unlock(zip);
+    result = newEntry(zip, &zip->entries[n]);
     return result;
 }
 
@@ -1335,11 +1281,11 @@ ZIP_Unlock(jzfile *zip)
 
 /*
  * Returns the offset of the entry data within the zip file.
- * Returns -1 if an error occurred, in which case zip->msg will
+ * Returns -1 if an error occurred, in which case *msg will
  * contain the error text.
  */
-jlong
-ZIP_GetEntryDataOffset(jzfile *zip, jzentry *entry)
+static jlong
+entryDataOffset(jzfile *zip, jzentry *entry, char **msg)
 {
     /* The Zip file spec explicitly allows the LOC extra data size to
      * be different from the CEN extra data size, although the JDK
@@ -1353,11 +1299,11 @@ ZIP_GetEntryDataOffset(jzfile *zip, jzentry *entry)
     if (entry->pos <= 0) {
         unsigned char loc[LOCHDR];
         if (readFullyAt(zip->zfd, loc, LOCHDR, -(entry->pos)) == -1) {
-            zip->msg = "error reading zip file";
+            *msg = "error reading zip file";
             return -1;
         }
         if (GETSIG(loc) != LOCSIG) {
-            zip->msg = "invalid LOC header (bad signature)";
+            *msg = "invalid LOC header (bad signature)";
             return -1;
         }
         entry->pos = (- entry->pos) + LOCHDR + LOCNAM(loc) + LOCEXT(loc);
@@ -1365,6 +1311,17 @@ ZIP_GetEntryDataOffset(jzfile *zip, jzentry *entry)
     return entry->pos;
 }
 
+/*
+ * Returns the offset of the entry data within the zip file.
+ * Returns -1 if an error occurred, in which case zip->msg will
+ * contain the error text.
+ */
+jlong
+ZIP_GetEntryDataOffset(jzfile *zip, jzentry *entry)
+{
+    return entryDataOffset(zip, entry, &zip->msg);
+}
+
 /*
  * Reads bytes from the specified zip entry. Assumes that the zip
  * file had been previously locked with ZIP_Lock(). Returns the
@@ -1376,6 +1333,21 @@ ZIP_GetEntryDataOffset(jzfile *zip, jzentry *entry)
  */
 jint
 ZIP_Read(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len)
+{
+    if (zip == 0) {
+        return -1;
+    }
+    return ZIP_Read2(zip, entry, pos, buf, len, &zip->msg);
+}
+
+/*
+ * Like ZIP_Read(), but reports a zip error through *msg instead of
+ * zip->msg. The data is read with positional reads and nothing shared
+ * in the zip file is modified, so the zip file does not need to be
+ * locked. The entry must not be used by another thread meanwhile.
+ */
+jint
+ZIP_Read2(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len, char **msg)
 {
     jlong entry_size;
     jlong start;
@@ -1385,10 +1357,10 @@ ZIP_Read(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len)
     }
 
     /* Clear previous zip error */
-    zip->msg = NULL;
+    *msg = NULL;
 
     if (entry == 0) {
-        zip->msg = "ZIP_Read: jzentry is NULL";
+        *msg = "ZIP_Read: jzentry is NULL";
         return -1;
     }
 
@@ -1396,7 +1368,7 @@ ZIP_Read(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len)
 
     /* Check specified position */
     if (pos < 0 || pos > entry_size - 1) {
-        zip->msg = "ZIP_Read: specified offset out of range";
+        *msg = "ZIP_Read: specified offset out of range";
         return -1;
     }
 
@@ -1407,18 +1379,18 @@ ZIP_Read(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len)
         len = (jint)(entry_size - pos);
 
     /* Get file offset to start reading data */
-    start = ZIP_GetEntryDataOffset(zip, entry);
+    start = entryDataOffset(zip, entry, msg);
     if (start < 0)
         return -1;
     start += pos;
 
     if (start + len > zip->len) {
-        zip->msg = "ZIP_Read: corrupt zip file: invalid entry size";
+        *msg = "ZIP_Read: corrupt zip file: invalid entry size";
         return -1;
     }
 
     if (readFullyAt(zip->zfd, buf, len, start) == -1) {
-        zip->msg = "ZIP_Read: error reading zip file";
+        *msg = "ZIP_Read: error reading zip file";
         return -1;
     }
     return len;
@@ -1464,9 +1436,7 @@ InflateFully(jzfile *zip, jzentry *entry, void *buf, char **msg)
 
     while (count > 0) {
         jint n = count > (jlong)sizeof(tmp) ? (jint)sizeof(tmp) : (jint)count;
-        ZIP_Lock(zip);
-        n = ZIP_Read(zip, entry, pos, tmp, n);
-        ZIP_Unlock(zip);
+        n = ZIP_Read2(zip, entry, pos, tmp, n, msg);
         if (n <= 0) {
             if (n == 0) {
                 *msg = "inflateFully: Unexpected end of file";
@@ -1542,10 +1512,7 @@ ZIP_ReadEntry(jzfile *zip, jzentry *entry, unsigned char *buf, char *entryname)
                 /* These casts suppress a VC++ Internal Compiler Error */
                 (jint) (size - pos) :
                 (jint) limit;
-            ZIP_Lock(zip);
-            n = ZIP_Read(zip, entry, pos, buf, count);
-            msg = zip->msg;
-            ZIP_Unlock(zip);
+            n = ZIP_Read2(zip, entry, pos, buf, count, &msg);
             if (n == -1) {
                 if (msg == 0) {
                     getErrorString(errno, tmpbuf, sizeof(tmpbuf));
@@ -1562,9 +1529,6 @@ ZIP_ReadEntry(jzfile *zip, jzentry *entry, unsigned char *buf, char *entryname)
         int ok = InflateFully(zip, entry, buf, &msg);
         if (!ok) {
             if ((msg == NULL) || (*msg == 0)) {
-                msg = zip->msg;
-            }
-            if (msg == 0) {
                 getErrorString(errno, tmpbuf, sizeof(tmpbuf));
                 msg = tmpbuf;
             }
@@ -179,15 +179,9 @@ typedef struct jzentry {  /* Zip file entry */
  */
 typedef struct jzcell {
     unsigned int hash;    /* 32 bit hashcode on name */
-    unsigned int next;    /* hash chain: index into jzfile->entries */
     jlong cenpos;         /* Offset of central directory file header */
 } jzcell;
 
-typedef struct cencache {
-    char *data;           /* A cached page of CEN headers */
-    jlong pos;            /* file offset of data */
-} cencache;
-
 /*
  * Use ZFILE to represent access to a file in a platform-indepenent
  * fashion.
@@ -198,11 +192,6 @@ typedef struct cencache {
 #define ZFILE int
 #endif
 
-/*
- * Use mmap for CEN & ENDHDR sections
- */
-#define USE_MMAP 1
-
 /*
  * Descriptor for a ZIP file.
  */
@@ -210,15 +199,13 @@ typedef struct jzfile {   /* Zip file */
     char *name;           /* zip file name */
     jint refs;            /* number of active references */
     jlong len;            /* length (in bytes) of zip file */
-#ifdef USE_MMAP
-    unsigned char *maddr; /* beginning address of the CEN & ENDHDR */
-    jlong mlen;           /* length (in bytes) mmaped */
-    jlong offset;         /* offset of the mmapped region from the
+    unsigned char *maddr; /* beginning address of the CEN (& ENDHDR if
+                             mmaped) */
+    jlong mlen;           /* length (in bytes) of maddr */
+    jlong offset;         /* offset of the maddr region from the
                              start of the file. */
-    jboolean usemmap;     /* if mmap is used. */
-#endif
+    jboolean usemmap;     /* if maddr is mmaped, otherwise malloc'ed */
     jboolean locsig;      /* if zip file starts with LOCSIG */
-    cencache cencache;    /* CEN header cache */
     ZFILE zfd;            /* open file descriptor */
     void *lock;           /* read lock */
     char *comment;        /* zip file comment */
@@ -226,8 +213,9 @@ typedef struct jzfile {   /* Zip file */
     char *msg;            /* zip error message */
     jzcell *entries;      /* array of hash cells */
     jint total;           /* total number of entries */
-    jint *table;          /* Hash chain heads: indexes into entries */
-    jint tablelen;        /* number of hash heads */
+    jint *table;          /* Open addressed hash table: indexes into
+                             entries, or ZIP_ENDCHAIN if empty */
+    jint tablelen;        /* number of table slots, a power of two */
     struct jzfile *next;  /* next zip file in search list */
     jzentry *cache;       /* we cache the most recently freed jzentry */
     /* Information on metadata names in META-INF directory */
@@ -239,7 +227,7 @@ typedef struct jzfile {   /* Zip file */
 } jzfile;
 
 /*
- * Index representing end of hash chain
+ * Index representing an empty hash table slot
  */
 #define ZIP_ENDCHAIN ((jint)-1)
 
@@ -274,6 +262,7 @@ jzentry * ZIP_GetEntry(jzfile *zip, char *name, jint ulen);
 void ZIP_Lock(jzfile *zip);
 void ZIP_Unlock(jzfile *zip);
 jint ZIP_Read(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len);
+jint ZIP_Read2(jzfile *zip, jzentry *entry, jlong pos, void *buf, jint len, char **msg);
 void ZIP_FreeEntry(jzfile *zip, jzentry *ze);
 jlong ZIP_GetEntryDataOffset(jzfile *zip, jzentry *entry);
 jzentry * ZIP_GetEntry2(jzfile *zip, char *name, jint ulen, jboolean addSlash);